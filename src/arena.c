@@ -0,0 +1,130 @@
+/**********************************************************************************************
+*
+*   raycaster - Memory arenas
+*
+*   Bump allocators over a block allocated once, and the heap allocations counter.
+*
+**********************************************************************************************/
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+#if defined(TRACK_ALLOCATIONS)
+static __thread long allocationsCount = 0;     // Allocations of the thread
+#endif
+
+//----------------------------------------------------------------------------------
+// Memory Arenas Functions Definition
+//----------------------------------------------------------------------------------
+
+// Load an arena able to hold capacity bytes
+MemoryArena *LoadMemoryArena(size_t capacity)
+{
+    MemoryArena *arena = (MemoryArena *)calloc(1, sizeof(MemoryArena));
+
+    arena->capacity = capacity;
+    arena->data = (unsigned char *)malloc((capacity > 0)? capacity : 1);
+
+    return arena;
+}
+
+// Unload an arena, its allocations can't be used anymore
+void UnloadMemoryArena(MemoryArena *arena)
+{
+    if (arena == NULL) return;
+
+    free(arena->data);
+    free(arena);
+}
+
+// Free every allocation of an arena
+void ResetMemoryArena(MemoryArena *arena)
+{
+    arena->used = 0;
+}
+
+// Allocate memory from an arena, valid until the arena is reset
+// NOTE: Not thread safe, every thread allocating memory needs its own arena
+void *ArenaAlloc(MemoryArena *arena, size_t size)
+{
+    size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if ((start > arena->capacity) || (size > arena->capacity - start))
+    {
+        arena->failedCount++;
+        return NULL;
+    }
+
+    arena->used = start + size;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+
+    return arena->data + start;
+}
+
+// Allocate zeroed memory from an arena for count elements of size bytes
+void *ArenaCalloc(MemoryArena *arena, size_t count, size_t size)
+{
+    if ((size > 0) && (count > (size_t)-1/size))
+    {
+        arena->failedCount++;
+        return NULL;
+    }
+
+    void *data = ArenaAlloc(arena, count*size);
+    if (data != NULL) memset(data, 0, count*size);
+
+    return data;
+}
+
+// Get the number of heap allocations, reallocations and frees made by the calling thread so far
+long GetAllocationsCount(void)
+{
+#if defined(TRACK_ALLOCATIONS)
+    return allocationsCount;
+#else
+    return 0;
+#endif
+}
+
+//----------------------------------------------------------------------------------
+// Heap Allocations Tracking
+//----------------------------------------------------------------------------------
+#if defined(TRACK_ALLOCATIONS)
+
+// NOTE: The linker sends every call to malloc() of the objects it links to __wrap_malloc(), __real_malloc()
+// is the C library one. Calls made inside the C library and shared libraries (raylib, GPU driver) are not wrapped
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *data, size_t size);
+void __real_free(void *data);
+
+void *__wrap_malloc(size_t size)
+{
+    allocationsCount++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    allocationsCount++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *data, size_t size)
+{
+    allocationsCount++;
+    return __real_realloc(data, size);
+}
+
+void __wrap_free(void *data)
+{
+    if (data != NULL) allocationsCount++;
+    __real_free(data);
+}
+
+#endif
@@ -0,0 +1,59 @@
+/**********************************************************************************************
+*
+*   raycaster - Memory arenas
+*
+*   Bump allocators over a block allocated once. Allocations are never freed one by one, the
+*   whole arena is reset at the end of the lifetime of its data: a frame arena is reset every
+*   frame, a map arena when the map is unloaded. Arenas keep their peak usage so they can be
+*   sized for the target, allocations that don't fit fail and are counted.
+*
+*   Builds defining TRACK_ALLOCATIONS count the heap allocations of every thread, linking with
+*   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free (GNU ld), so the main loop can
+*   check it does not allocate. Only the calls of the linked objects are wrapped: allocations
+*   made inside the C library (i.e. stdio buffers) and shared libraries are not counted.
+*
+**********************************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define ARENA_ALIGNMENT 16              // Alignment of every allocation, enough for SIMD loads
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MemoryArena
+{
+    unsigned char *data;
+    size_t capacity;            // Bytes
+    size_t used;                // Bytes allocated since the last reset
+    size_t peak;                // Highest usage since the arena was loaded
+    int failedCount;            // Allocations that did not fit since the arena was loaded
+}
+MemoryArena;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Memory Arenas Functions Declaration
+//----------------------------------------------------------------------------------
+MemoryArena *LoadMemoryArena(size_t capacity);
+void UnloadMemoryArena(MemoryArena *arena);
+void ResetMemoryArena(MemoryArena *arena);                      // Free every allocation, peak usage is kept
+void *ArenaAlloc(MemoryArena *arena, size_t size);              // Uninitialized memory, NULL when it does not fit
+void *ArenaCalloc(MemoryArena *arena, size_t count, size_t size);   // Zeroed memory, NULL when it does not fit
+
+long GetAllocationsCount(void);         // Heap allocations and frees of the calling thread so far, 0 without TRACK_ALLOCATIONS
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARENA_H
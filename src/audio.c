@@ -0,0 +1,293 @@
+/**********************************************************************************************
+*
+*   raycaster - Audio streaming
+*
+*   Lock-free ring of audio frames filled by a streaming thread, from memory or a decoder.
+*
+**********************************************************************************************/
+
+#include "audio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+struct AudioStreamer
+{
+    AudioRing *ring;
+    const short *samples;               // Source in memory, not owned
+    unsigned int frameCount;
+    AudioDecodeFunc decode;             // Decoder source, used instead of samples when set
+    AudioRewindFunc rewind;
+    void *decoder;                      // Decoder userData, not owned
+    unsigned int position;              // Next source frame to write, streaming thread only
+    int sampleRate;
+    bool looping;
+    bool finished;                      // Whole source written (atomic)
+    bool stopRequested;                 // (atomic)
+    bool threaded;
+    pthread_t thread;
+};
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void *StreamerThread(void *arg);
+static void FillAudioStreamer(AudioStreamer *streamer);
+static void DecodeAudioStreamer(AudioStreamer *streamer);
+static void StartAudioStreamer(AudioStreamer *streamer);
+
+//----------------------------------------------------------------------------------
+// Audio Ring Functions Definition
+//----------------------------------------------------------------------------------
+
+AudioRing *LoadAudioRing(unsigned int frames, int channels)
+{
+    AudioRing *ring = (AudioRing *)calloc(1, sizeof(AudioRing));
+
+    ring->capacity = 1;
+    while (ring->capacity < frames) ring->capacity <<= 1;
+    ring->channels = channels;
+    ring->samples = (short *)calloc((size_t)ring->capacity*channels, sizeof(short));
+
+    return ring;
+}
+
+void UnloadAudioRing(AudioRing *ring)
+{
+    if (ring == NULL) return;
+
+    free(ring->samples);
+    free(ring);
+}
+
+// Copy up to frames into the free space of the ring, producer thread only
+unsigned int WriteAudioRing(AudioRing *ring, const short *samples, unsigned int frames)
+{
+    unsigned int writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_RELAXED);
+    unsigned int readIndex = __atomic_load_n(&ring->readIndex, __ATOMIC_ACQUIRE);
+    unsigned int space = ring->capacity - (writeIndex - readIndex);
+    if (frames > space) frames = space;
+
+    // Two copies when the frames wrap around the end of the buffer
+    unsigned int start = writeIndex & (ring->capacity - 1);
+    unsigned int first = (frames < ring->capacity - start)? frames : ring->capacity - start;
+
+    memcpy(ring->samples + (size_t)start*ring->channels, samples, (size_t)first*ring->channels*sizeof(short));
+    memcpy(ring->samples, samples + (size_t)first*ring->channels, (size_t)(frames - first)*ring->channels*sizeof(short));
+
+    __atomic_store_n(&ring->writeIndex, writeIndex + frames, __ATOMIC_RELEASE);
+
+    return frames;
+}
+
+// Take frames out of the ring, consumer thread only, frames the ring is short of are silence
+unsigned int ReadAudioRing(AudioRing *ring, short *samples, unsigned int frames)
+{
+    unsigned int readIndex = __atomic_load_n(&ring->readIndex, __ATOMIC_RELAXED);
+    unsigned int writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_ACQUIRE);
+    unsigned int available = writeIndex - readIndex;
+    unsigned int count = (frames < available)? frames : available;
+
+    unsigned int start = readIndex & (ring->capacity - 1);
+    unsigned int first = (count < ring->capacity - start)? count : ring->capacity - start;
+
+    memcpy(samples, ring->samples + (size_t)start*ring->channels, (size_t)first*ring->channels*sizeof(short));
+    memcpy(samples + (size_t)first*ring->channels, ring->samples, (size_t)(count - first)*ring->channels*sizeof(short));
+
+    __atomic_store_n(&ring->readIndex, readIndex + count, __ATOMIC_RELEASE);
+
+    if (count < frames)
+    {
+        memset(samples + (size_t)count*ring->channels, 0, (size_t)(frames - count)*ring->channels*sizeof(short));
+
+        __atomic_fetch_add(&ring->underrunsCount, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&ring->underrunFrames, frames - count, __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
+
+// Frames waiting in the ring, from any thread
+unsigned int GetAudioRingFill(const AudioRing *ring)
+{
+    return __atomic_load_n(&ring->writeIndex, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->readIndex, __ATOMIC_ACQUIRE);
+}
+
+//----------------------------------------------------------------------------------
+// Audio Streamer Functions Definition
+//----------------------------------------------------------------------------------
+
+// Stream samples from their own thread, the ring is filled before returning so playback starts right away
+AudioStreamer *LoadAudioStreamer(const short *samples, unsigned int frameCount, int channels, int sampleRate, bool looping)
+{
+    AudioStreamer *streamer = (AudioStreamer *)calloc(1, sizeof(AudioStreamer));
+
+    streamer->ring = LoadAudioRing(AUDIO_RING_FRAMES, channels);
+    streamer->samples = samples;
+    streamer->frameCount = frameCount;
+    streamer->sampleRate = sampleRate;
+    streamer->looping = looping;
+
+    StartAudioStreamer(streamer);
+
+    return streamer;
+}
+
+// Stream from a decoder pulled by the streaming thread, only the first ring of frames is decoded before returning
+AudioStreamer *LoadAudioStreamerFromDecoder(AudioDecodeFunc decode, AudioRewindFunc rewind, void *userData, int channels, int sampleRate, bool looping)
+{
+    AudioStreamer *streamer = (AudioStreamer *)calloc(1, sizeof(AudioStreamer));
+
+    streamer->ring = LoadAudioRing(AUDIO_RING_FRAMES, channels);
+    streamer->decode = decode;
+    streamer->rewind = rewind;
+    streamer->decoder = userData;
+    streamer->sampleRate = sampleRate;
+    streamer->looping = looping;
+
+    StartAudioStreamer(streamer);
+
+    return streamer;
+}
+
+void UnloadAudioStreamer(AudioStreamer *streamer)
+{
+    if (streamer == NULL) return;
+
+    if (streamer->threaded)
+    {
+        __atomic_store_n(&streamer->stopRequested, true, __ATOMIC_RELEASE);
+        pthread_join(streamer->thread, NULL);
+    }
+
+    UnloadAudioRing(streamer->ring);
+    free(streamer);
+}
+
+void UpdateAudioStreamer(AudioStreamer *streamer)
+{
+    if (!streamer->threaded) FillAudioStreamer(streamer);
+}
+
+// Read frames for the audio device, the end of a non looping source is silence, not an underrun
+unsigned int ReadAudioStreamer(AudioStreamer *streamer, short *samples, unsigned int frames)
+{
+    if (__atomic_load_n(&streamer->finished, __ATOMIC_ACQUIRE))
+    {
+        unsigned int fill = GetAudioRingFill(streamer->ring);
+        unsigned int count = ReadAudioRing(streamer->ring, samples, (frames < fill)? frames : fill);
+
+        memset(samples + (size_t)count*streamer->ring->channels, 0, (size_t)(frames - count)*streamer->ring->channels*sizeof(short));
+
+        return count;
+    }
+
+    return ReadAudioRing(streamer->ring, samples, frames);
+}
+
+AudioStreamerStats GetAudioStreamerStats(const AudioStreamer *streamer)
+{
+    AudioStreamerStats stats = { 0 };
+
+    stats.fillFrames = GetAudioRingFill(streamer->ring);
+    stats.capacityFrames = streamer->ring->capacity;
+    stats.underrunsCount = __atomic_load_n(&streamer->ring->underrunsCount, __ATOMIC_RELAXED);
+    stats.underrunFrames = __atomic_load_n(&streamer->ring->underrunFrames, __ATOMIC_RELAXED);
+    stats.threaded = streamer->threaded;
+
+    return stats;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Streaming thread: top up the ring four times per ring duration
+static void *StreamerThread(void *arg)
+{
+    AudioStreamer *streamer = (AudioStreamer *)arg;
+
+    long periodNs = (long)((double)streamer->ring->capacity/4/streamer->sampleRate*1e9);
+    struct timespec period = { periodNs/1000000000L, periodNs%1000000000L };
+
+    while (!__atomic_load_n(&streamer->stopRequested, __ATOMIC_ACQUIRE))
+    {
+        FillAudioStreamer(streamer);
+        nanosleep(&period, NULL);
+    }
+
+    return NULL;
+}
+
+// Fill the ring before playback starts, then hand it to the streaming thread
+static void StartAudioStreamer(AudioStreamer *streamer)
+{
+    FillAudioStreamer(streamer);
+
+    streamer->threaded = (pthread_create(&streamer->thread, NULL, StreamerThread, streamer) == 0);
+}
+
+// Write source frames until the ring is full or the source ends
+static void FillAudioStreamer(AudioStreamer *streamer)
+{
+    AudioRing *ring = streamer->ring;
+
+    if (streamer->decode != NULL)
+    {
+        DecodeAudioStreamer(streamer);
+        return;
+    }
+
+    while (!streamer->finished)
+    {
+        unsigned int remaining = streamer->frameCount - streamer->position;
+        unsigned int written = WriteAudioRing(ring, streamer->samples + (size_t)streamer->position*ring->channels, remaining);
+
+        streamer->position += written;
+
+        if (streamer->position == streamer->frameCount)
+        {
+            if (streamer->looping && (streamer->frameCount > 0)) streamer->position = 0;
+            else __atomic_store_n(&streamer->finished, true, __ATOMIC_RELEASE);
+        }
+
+        if (written < remaining) break;     // Ring full
+    }
+}
+
+// Decode into the free space of the ring until it is full or the source ends, no intermediate buffer
+// NOTE: The free space wraps around the end of the buffer, every decode call fills the contiguous part
+static void DecodeAudioStreamer(AudioStreamer *streamer)
+{
+    AudioRing *ring = streamer->ring;
+    bool rewound = false;               // Nothing decoded since the last rewind, an empty source ends instead of looping
+
+    while (!streamer->finished)
+    {
+        unsigned int writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_RELAXED);
+        unsigned int readIndex = __atomic_load_n(&ring->readIndex, __ATOMIC_ACQUIRE);
+        unsigned int space = ring->capacity - (writeIndex - readIndex);
+        if (space == 0) break;          // Ring full
+
+        unsigned int start = writeIndex & (ring->capacity - 1);
+        unsigned int frames = (space < ring->capacity - start)? space : ring->capacity - start;
+        unsigned int decoded = streamer->decode(streamer->decoder, ring->samples + (size_t)start*ring->channels, frames);
+
+        if (decoded > 0)
+        {
+            __atomic_store_n(&ring->writeIndex, writeIndex + decoded, __ATOMIC_RELEASE);
+            rewound = false;
+        }
+        else if (streamer->looping && !rewound && (streamer->rewind != NULL))
+        {
+            streamer->rewind(streamer->decoder);
+            rewound = true;
+        }
+        else __atomic_store_n(&streamer->finished, true, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,89 @@
+/**********************************************************************************************
+*
+*   raycaster - Audio streaming
+*
+*   Music streamed by its own thread, independent of the frame rate. The streaming thread
+*   copies the samples of the music into a ring buffer and the audio device callback takes
+*   them out, the ring is single producer / single consumer and lock-free so the callback
+*   never waits on the streaming thread. When the callback finds the ring short of frames it
+*   plays silence and counts an underrun.
+*
+*   Samples are 16 bit PCM, interleaved channels. The source is either samples already in
+*   memory or a decoder pulled by the streaming thread, which decodes straight into the free
+*   space of the ring as the music plays, so compressed music is never decoded whole.
+*   Without threads (web builds without pthreads) call UpdateAudioStreamer() every frame, it
+*   fills the ring from the calling thread.
+*
+**********************************************************************************************/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define AUDIO_RING_FRAMES 8192          // Ring size, ~185 ms at 44100 Hz, covers the streaming thread wake-ups
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Single producer / single consumer ring of interleaved frames
+typedef struct AudioRing
+{
+    short *samples;                     // capacity*channels samples
+    unsigned int capacity;              // Frames, power of two
+    int channels;
+    unsigned int writeIndex;            // Frames written and read since the start, wrap around (atomic)
+    unsigned int readIndex;
+    unsigned int underrunsCount;        // Reads that found fewer frames than requested (atomic)
+    unsigned int underrunFrames;        // Silent frames played because of them (atomic)
+}
+AudioRing;
+
+typedef struct AudioStreamer AudioStreamer;     // Streaming thread and its source
+
+// Decoder source, called from the streaming thread only (or the thread calling UpdateAudioStreamer())
+typedef unsigned int (*AudioDecodeFunc)(void *userData, short *samples, unsigned int frames);  // Frames decoded, 0 at the end of the source
+typedef void (*AudioRewindFunc)(void *userData);                                                 // Back to the first frame, for looping
+
+typedef struct AudioStreamerStats
+{
+    unsigned int fillFrames;            // Frames waiting in the ring
+    unsigned int capacityFrames;
+    unsigned int underrunsCount;
+    unsigned int underrunFrames;
+    bool threaded;                      // false when UpdateAudioStreamer() must be called
+}
+AudioStreamerStats;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Audio Ring Functions Declaration
+//----------------------------------------------------------------------------------
+AudioRing *LoadAudioRing(unsigned int frames, int channels);    // Capacity rounded up to a power of two
+void UnloadAudioRing(AudioRing *ring);
+unsigned int WriteAudioRing(AudioRing *ring, const short *samples, unsigned int frames);    // Producer, returns frames written
+unsigned int ReadAudioRing(AudioRing *ring, short *samples, unsigned int frames);           // Consumer, missing frames are silence
+unsigned int GetAudioRingFill(const AudioRing *ring);
+
+//----------------------------------------------------------------------------------
+// Audio Streamer Functions Declaration
+//----------------------------------------------------------------------------------
+AudioStreamer *LoadAudioStreamer(const short *samples, unsigned int frameCount, int channels, int sampleRate, bool looping);
+AudioStreamer *LoadAudioStreamerFromDecoder(AudioDecodeFunc decode, AudioRewindFunc rewind, void *userData, int channels, int sampleRate, bool looping);
+void UnloadAudioStreamer(AudioStreamer *streamer);          // Stop the streaming thread, samples or decoder can be released after
+void UpdateAudioStreamer(AudioStreamer *streamer);          // Fill the ring when there is no streaming thread, no-op otherwise
+unsigned int ReadAudioStreamer(AudioStreamer *streamer, short *samples, unsigned int frames);   // Audio device callback side
+AudioStreamerStats GetAudioStreamerStats(const AudioStreamer *streamer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_H
@@ -0,0 +1,92 @@
+/**********************************************************************************************
+*
+*   raycaster - Benchmark helpers
+*
+*   Timing, seeded random numbers and generated test maps shared by the benchmark programs.
+*   Benchmarks link the raylib-free game modules only, so they run without a window.
+*
+**********************************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "map.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct BenchMap
+{
+    Map map;
+    int *tiles;
+    portal_t portals[2];
+}
+BenchMap;
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition
+//----------------------------------------------------------------------------------
+
+// Get monotonic time in seconds
+static inline double GetBenchTime(void)
+{
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+}
+
+// Get a random number in [0, 1), xorshift32 with caller-owned state (never 0)
+static inline float GetBenchRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(x >> 8)/16777216.0f;
+}
+
+// Generate a walled map with random wall and translucent tiles and one portal pair
+// NOTE: Portals are placed on the top and bottom borders, like in the game level
+static inline BenchMap *LoadBenchMap(int numCols, int numRows, float wallDensity, uint32_t seed)
+{
+    BenchMap *benchMap = (BenchMap *)calloc(1, sizeof(BenchMap));
+    benchMap->tiles = (int *)calloc((size_t)numCols*numRows, sizeof(int));
+
+    for (int y = 0; y < numRows; y++)
+    {
+        for (int x = 0; x < numCols; x++)
+        {
+            int tile = TILE_EMPTY;
+
+            if ((x == 0) || (y == 0) || (x == numCols - 1) || (y == numRows - 1)) tile = TILE_WALL;
+            else if (GetBenchRandom(&seed) < wallDensity) tile = (GetBenchRandom(&seed) < 0.5f)? TILE_WALL : TILE_TRANSLUCENT;
+
+            benchMap->tiles[y*numCols + x] = tile;
+        }
+    }
+
+    benchMap->portals[0] = (portal_t){ .gridIndexX = 1, .gridIndexY = 0 };
+    benchMap->portals[1] = (portal_t){ .gridIndexX = numCols - 2, .gridIndexY = numRows - 1 };
+    benchMap->tiles[1] = TILE_PORTAL;
+    benchMap->tiles[numCols + 1] = TILE_EMPTY;
+    benchMap->tiles[(numRows - 1)*numCols + numCols - 2] = TILE_PORTAL;
+    benchMap->tiles[(numRows - 2)*numCols + numCols - 2] = TILE_EMPTY;
+
+    benchMap->map = (Map){ .numCols = numCols, .numRows = numRows, .tiles = benchMap->tiles,
+        .portals = benchMap->portals, .portalsCount = 2 };
+
+    return benchMap;
+}
+
+static inline void UnloadBenchMap(BenchMap *benchMap)
+{
+    free(benchMap->tiles);
+    free(benchMap);
+}
+
+#endif // BENCH_H
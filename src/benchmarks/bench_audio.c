@@ -0,0 +1,176 @@
+/**********************************************************************************************
+*
+*   raycaster - Audio streaming benchmark
+*
+*   Plays 3 seconds of music into a simulated audio device, a thread taking 512 frames every
+*   11.6 ms, while the main loop runs 16 ms frames with a 250 ms spike every second. Music fed
+*   once per frame (like UpdateMusicStream()) is compared against the streaming thread, from
+*   samples in memory and pulled from a decoder, with the underruns the device found and the
+*   ring fill level left after each spike.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "audio.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define BENCH_SAMPLE_RATE 44100
+#define BENCH_CHANNELS 2
+#define BENCH_DEVICE_FRAMES 512         // Frames per audio device callback
+#define BENCH_PLAY_SECONDS 3
+#define BENCH_FRAME_MS 16
+#define BENCH_SPIKE_MS 250              // Long frame, once every second
+#define BENCH_FRAME_RING_FRAMES 4096    // Per-frame feeding buffer, two raylib music buffers
+
+typedef enum BenchFeed {
+    BENCH_FEED_FRAME = 0,               // Ring topped up once per frame
+    BENCH_FEED_THREAD,                  // Streaming thread, samples in memory
+    BENCH_FEED_DECODER                  // Streaming thread, samples pulled from a decoder
+} BenchFeed;
+
+// Decoder standing for a vorbis stream, hands out the tone in the frames asked for
+typedef struct BenchDecoder
+{
+    const short *samples;
+    unsigned int frameCount;
+    unsigned int position;
+}
+BenchDecoder;
+
+typedef struct BenchDevice
+{
+    AudioRing *ring;                    // Per-frame feeding reads this ring
+    AudioStreamer *streamer;            // Streaming thread reads the streamer
+    bool stopRequested;
+}
+BenchDevice;
+
+static void SleepMilliseconds(int milliseconds)
+{
+    struct timespec duration = { milliseconds/1000, (long)(milliseconds%1000)*1000000L };
+    nanosleep(&duration, NULL);
+}
+
+// Audio device thread: read a buffer every BENCH_DEVICE_FRAMES frames of real time
+static void *DeviceThread(void *arg)
+{
+    BenchDevice *device = (BenchDevice *)arg;
+    short buffer[BENCH_DEVICE_FRAMES*BENCH_CHANNELS] = { 0 };
+    double period = (double)BENCH_DEVICE_FRAMES/BENCH_SAMPLE_RATE;
+    double next = GetBenchTime();
+
+    while (!__atomic_load_n(&device->stopRequested, __ATOMIC_ACQUIRE))
+    {
+        if (device->streamer != NULL) ReadAudioStreamer(device->streamer, buffer, BENCH_DEVICE_FRAMES);
+        else ReadAudioRing(device->ring, buffer, BENCH_DEVICE_FRAMES);
+
+        next += period;
+        double wait = next - GetBenchTime();
+        if (wait > 0.0) SleepMilliseconds((int)(wait*1000.0));
+    }
+
+    return NULL;
+}
+
+static unsigned int DecodeBench(void *userData, short *samples, unsigned int frames)
+{
+    BenchDecoder *decoder = (BenchDecoder *)userData;
+    unsigned int remaining = decoder->frameCount - decoder->position;
+    if (frames > remaining) frames = remaining;
+
+    memcpy(samples, decoder->samples + (size_t)decoder->position*BENCH_CHANNELS, (size_t)frames*BENCH_CHANNELS*sizeof(short));
+    decoder->position += frames;
+
+    return frames;
+}
+
+static void RewindBench(void *userData)
+{
+    ((BenchDecoder *)userData)->position = 0;
+}
+
+static void RunAudioBenchmark(const short *samples, unsigned int frameCount, BenchFeed feed, const char *label)
+{
+    BenchDevice device = { 0 };
+    BenchDecoder decoder = { samples, frameCount, 0 };
+    bool threaded = (feed != BENCH_FEED_FRAME);
+    unsigned int position = 0;
+    unsigned int minSpikeFill = 0xffffffff;
+
+    if (feed == BENCH_FEED_THREAD) device.streamer = LoadAudioStreamer(samples, frameCount, BENCH_CHANNELS, BENCH_SAMPLE_RATE, true);
+    else if (feed == BENCH_FEED_DECODER) device.streamer = LoadAudioStreamerFromDecoder(DecodeBench, RewindBench, &decoder, BENCH_CHANNELS, BENCH_SAMPLE_RATE, true);
+    else
+    {
+        device.ring = LoadAudioRing(BENCH_FRAME_RING_FRAMES, BENCH_CHANNELS);
+        position = WriteAudioRing(device.ring, samples, frameCount);
+    }
+
+    pthread_t thread = { 0 };
+    pthread_create(&thread, NULL, DeviceThread, &device);
+
+    int framesPerSecond = 1000/BENCH_FRAME_MS;
+
+    for (int frame = 0; frame < BENCH_PLAY_SECONDS*framesPerSecond; frame++)
+    {
+        // Per-frame feeding tops up the ring once per frame, like the game loop did
+        if (!threaded) position = (position + WriteAudioRing(device.ring, samples + (size_t)position*BENCH_CHANNELS, frameCount - position))%frameCount;
+
+        bool spike = (frame%framesPerSecond) == framesPerSecond - 1;
+        SleepMilliseconds(spike? BENCH_SPIKE_MS : BENCH_FRAME_MS);
+
+        if (spike)
+        {
+            unsigned int fill = threaded? GetAudioStreamerStats(device.streamer).fillFrames : GetAudioRingFill(device.ring);
+            if (fill < minSpikeFill) minSpikeFill = fill;
+        }
+    }
+
+    __atomic_store_n(&device.stopRequested, true, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    unsigned int underruns = 0;
+    unsigned int underrunFrames = 0;
+    unsigned int capacity = 0;
+
+    if (threaded)
+    {
+        AudioStreamerStats stats = GetAudioStreamerStats(device.streamer);
+        underruns = stats.underrunsCount;
+        underrunFrames = stats.underrunFrames;
+        capacity = stats.capacityFrames;
+        UnloadAudioStreamer(device.streamer);
+    }
+    else
+    {
+        underruns = device.ring->underrunsCount;
+        underrunFrames = device.ring->underrunFrames;
+        capacity = device.ring->capacity;
+        UnloadAudioRing(device.ring);
+    }
+
+    printf("%-16s | underruns: %4u | silent: %6.1f ms | ring: %5u frames | fill after spikes: %5u frames\n",
+        label, underruns, 1000.0*underrunFrames/BENCH_SAMPLE_RATE, capacity, minSpikeFill);
+}
+
+int main(void)
+{
+    // One second of a looping tone
+    unsigned int frameCount = BENCH_SAMPLE_RATE;
+    short *samples = (short *)malloc((size_t)frameCount*BENCH_CHANNELS*sizeof(short));
+    for (unsigned int i = 0; i < frameCount*BENCH_CHANNELS; i++) samples[i] = (short)((i/BENCH_CHANNELS)%200*100 - 10000);
+
+    printf("%i s of music, %i Hz, %i frames per device buffer, %i ms frames, %i ms spike every second\n",
+        BENCH_PLAY_SECONDS, BENCH_SAMPLE_RATE, BENCH_DEVICE_FRAMES, BENCH_FRAME_MS, BENCH_SPIKE_MS);
+
+    RunAudioBenchmark(samples, frameCount, BENCH_FEED_FRAME, "per frame");
+    RunAudioBenchmark(samples, frameCount, BENCH_FEED_THREAD, "streaming thread");
+    RunAudioBenchmark(samples, frameCount, BENCH_FEED_DECODER, "decoding thread");
+
+    free(samples);
+
+    return 0;
+}
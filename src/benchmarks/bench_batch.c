@@ -0,0 +1,102 @@
+/**********************************************************************************************
+*
+*   raycaster - Batch rendering benchmark
+*
+*   Measures frames per second, and per core, rendering batches of 1 to 4096 small frames from
+*   random poses in every batch format. Batch frames are checked against a render context.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "renderer.h"
+#include "jobs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_MAP_SIZE 64
+#define BENCH_WIDTH 128
+#define BENCH_HEIGHT 64
+#define BENCH_FOV (60*(PI/180))
+#define BENCH_MAX_BATCH 4096
+#define BENCH_FRAMES_PER_SIZE 8192      // Frames rendered per batch size, at least one batch
+
+static const char *formatNames[] = { "RGBA", "GRAY", "DEPTH" };
+
+static void RunBatchBenchmark(const Map *map, int format, const RenderCamera *poses, void *frames)
+{
+    RenderBatch *batch = LoadRenderBatch(map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV, format, 0.0f);
+    int cores = GetJobWorkersCount() + 1;
+
+    for (int size = 1; size <= BENCH_MAX_BATCH; size *= 4)
+    {
+        int batches = (BENCH_FRAMES_PER_SIZE/size > 0)? BENCH_FRAMES_PER_SIZE/size : 1;
+
+        RenderBatchFrames(batch, poses, size, frames);      // Warmup
+
+        double start = GetBenchTime();
+        for (int i = 0; i < batches; i++) RenderBatchFrames(batch, poses, size, frames);
+        double elapsed = GetBenchTime() - start;
+
+        double framesPerSecond = (double)batches*size/elapsed;
+        printf("%-5s %ix%i batch: %4i | threads: %2i | %9.0f frames/s | %9.0f frames/s/core\n",
+            formatNames[format], BENCH_WIDTH, BENCH_HEIGHT, size, cores, framesPerSecond, framesPerSecond/cores);
+    }
+
+    UnloadRenderBatch(batch);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.08f, 42);
+    const Map *map = &benchMap->map;
+    RenderCamera *poses = (RenderCamera *)malloc(BENCH_MAX_BATCH*sizeof(RenderCamera));
+    void *frames = malloc((size_t)BENCH_MAX_BATCH*BENCH_WIDTH*BENCH_HEIGHT*4);
+    uint32_t seed = 23;
+
+    // Poses at random places of the empty tiles
+    for (int i = 0; i < BENCH_MAX_BATCH; i++)
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        do
+        {
+            x = (1.0f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 2))*TILE_SIZE;
+            y = (1.0f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 2))*TILE_SIZE;
+        } while (MapHasWallAt(map, x, y));
+
+        poses[i] = (RenderCamera){ x, y, GetBenchRandom(&seed)*TWO_PI };
+    }
+
+    InitJobSystem(-1);
+
+    // Batch frames must match the frames of a render context
+    RenderBatch *batch = LoadRenderBatch(map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV, RENDER_FORMAT_RGBA, 0.0f);
+    RenderContext *context = LoadRenderContext(map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+    bool matches = true;
+
+    RenderBatchFrames(batch, poses, 64, frames);
+
+    for (int i = 0; i < 64; i++)
+    {
+        context->camera = poses[i];
+        RenderView(context);
+        matches = matches && (memcmp(context->pixels, (uint32_t *)frames + i*BENCH_WIDTH*BENCH_HEIGHT, BENCH_WIDTH*BENCH_HEIGHT*4) == 0);
+    }
+
+    printf("Batch frames match render context frames: %s\n", matches? "OK" : "FAILED");
+
+    UnloadRenderContext(context);
+    UnloadRenderBatch(batch);
+
+    for (int format = RENDER_FORMAT_RGBA; format <= RENDER_FORMAT_DEPTH; format++) RunBatchBenchmark(map, format, poses, frames);
+
+    CloseJobSystem();
+
+    free(poses);
+    free(frames);
+    UnloadBenchMap(benchMap);
+
+    return matches? 0 : 1;
+}
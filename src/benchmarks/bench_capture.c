@@ -0,0 +1,229 @@
+/**********************************************************************************************
+*
+*   raycaster - Frame capture benchmark
+*
+*   Renders 960x624 views at 100 frames per second (sleeping the rest of every frame) with and
+*   without capture, and reports the game thread time per frame: rendering, acquiring and
+*   submitting the capture buffers. Sinks are raw and y4m files, and a shared memory object read
+*   by a reader thread standing for an encoder process. A copy of every frame on the game thread
+*   is timed as the reference a copying capture would pay. A reader slower than the frame rate
+*   shows the drop and block policies at work.
+*
+*   The whole game thread frame is compared to the run without capture, not only the capture
+*   calls: the writer thread (and the reader) slow the game thread down through the caches. With
+*   one CPU online there is no writer thread, the capture calls include the writes.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "capture.h"
+#include "renderer.h"
+#include "jobs.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+
+#define BENCH_MAP_SIZE 64
+#define BENCH_WIDTH 960
+#define BENCH_HEIGHT 624
+#define BENCH_FOV (60*(PI/180))
+#define BENCH_FPS 100
+#define BENCH_FRAMES 1000
+#define BENCH_FILE "bench_capture.out"
+#define BENCH_SHM_NAME "/raycaster_bench_capture"
+#define BENCH_SLOW_READER_TIME 15000000L    // Nanoseconds a slow reader takes per frame, more than a frame
+
+typedef enum BenchCapture {
+    BENCH_CAPTURE_NONE = 0,
+    BENCH_CAPTURE_COPY,                 // memcpy of every frame on the game thread
+    BENCH_CAPTURE_SINK                  // FrameCapture
+} BenchCapture;
+
+typedef struct BenchReader
+{
+    bool stopRequested;                 // (atomic)
+    long frameReadTime;                 // Extra nanoseconds per frame read
+    int framesRead;
+    uint32_t checksum;
+}
+BenchReader;
+
+// Shm reader standing for an encoder process: maps the capture by name and sums every frame
+static void *ReaderThread(void *arg)
+{
+    BenchReader *reader = (BenchReader *)arg;
+    struct timespec wait = { 0, 1000000 };
+
+    int fd = shm_open(BENCH_SHM_NAME, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    // Header page first for the frames layout
+    CaptureShmHeader header = { 0 };
+    void *headerMapping = mmap(NULL, CAPTURE_SHM_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (headerMapping == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    memcpy(&header, headerMapping, sizeof(header));
+    munmap(headerMapping, CAPTURE_SHM_HEADER_SIZE);
+
+    size_t size = CAPTURE_SHM_HEADER_SIZE + (size_t)header.slotsCount*header.slotSize;
+    unsigned char *mapping = (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    CaptureShmHeader *shm = (CaptureShmHeader *)mapping;
+    __atomic_store_n(&shm->readerAttached, 1, __ATOMIC_RELEASE);
+
+    while (true)
+    {
+        uint64_t readCount = __atomic_load_n(&shm->readCount, __ATOMIC_RELAXED);
+
+        if (readCount < __atomic_load_n(&shm->writeCount, __ATOMIC_ACQUIRE))
+        {
+            const uint32_t *pixels = (const uint32_t *)(mapping + CAPTURE_SHM_HEADER_SIZE + (readCount%header.slotsCount)*header.slotSize);
+            for (int p = 0; p < header.width*header.height; p++) reader->checksum += pixels[p];
+            if (reader->frameReadTime > 0)
+            {
+                struct timespec readTime = { 0, reader->frameReadTime };
+                nanosleep(&readTime, NULL);
+            }
+
+            __atomic_store_n(&shm->readCount, readCount + 1, __ATOMIC_RELEASE);
+            reader->framesRead++;
+        }
+        else if (__atomic_load_n(&reader->stopRequested, __ATOMIC_ACQUIRE)) break;
+        else nanosleep(&wait, NULL);
+    }
+
+    munmap(mapping, size);
+
+    return NULL;
+}
+
+// Returns the game thread time per frame, seconds
+static double RunCaptureBenchmark(RenderContext *view, BenchCapture mode, int sink, int policy, long readerTime, double baseFrameTime, const char *label)
+{
+    const char *target = (sink == CAPTURE_SINK_SHM)? BENCH_SHM_NAME : BENCH_FILE;
+    FrameCapture *capture = (mode == BENCH_CAPTURE_SINK)? LoadFrameCapture(BENCH_WIDTH, BENCH_HEIGHT, BENCH_FPS, sink, target, policy) : NULL;
+    uint32_t *copy = (mode == BENCH_CAPTURE_COPY)? (uint32_t *)malloc((size_t)BENCH_WIDTH*BENCH_HEIGHT*sizeof(uint32_t)) : NULL;
+    uint32_t *viewPixels = view->pixels;
+    BenchReader reader = { .frameReadTime = readerTime };
+    pthread_t readerThread = { 0 };
+    bool readerRunning = false;
+    uint32_t seed = 17;
+    double frameTime = 0.0;
+    double worstFrame = 0.0;
+    double captureTime = 0.0;           // Acquiring and submitting, or copying
+
+    if ((mode == BENCH_CAPTURE_SINK) && (capture == NULL))
+    {
+        printf("%-24s | sink can't be opened\n", label);
+        return 0.0;
+    }
+
+    if (sink == CAPTURE_SINK_SHM) readerRunning = (pthread_create(&readerThread, NULL, ReaderThread, &reader) == 0);
+
+    double deadline = GetBenchTime();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*2*PI };
+
+        double start = GetBenchTime();
+
+        uint32_t *captureFrame = (capture != NULL)? AcquireCaptureFrame(capture) : NULL;
+        if (captureFrame != NULL) view->pixels = captureFrame;
+
+        double renderStart = GetBenchTime();
+        RenderView(view);
+        double renderEnd = GetBenchTime();
+
+        if (copy != NULL) memcpy(copy, view->pixels, (size_t)BENCH_WIDTH*BENCH_HEIGHT*sizeof(uint32_t));
+        if (captureFrame != NULL) SubmitCaptureFrame(capture);
+        view->pixels = viewPixels;
+
+        double elapsed = GetBenchTime() - start;
+        captureTime += elapsed - (renderEnd - renderStart);
+        frameTime += elapsed;
+        if (elapsed > worstFrame) worstFrame = elapsed;
+
+        // Sleep the rest of the frame, the writer thread runs meanwhile
+        deadline += 1.0/BENCH_FPS;
+        double rest = deadline - GetBenchTime();
+        if (rest > 0.0)
+        {
+            struct timespec sleep = { (time_t)rest, (long)((rest - (time_t)rest)*1e9) };
+            nanosleep(&sleep, NULL);
+        }
+        else deadline = GetBenchTime();
+    }
+
+    frameTime /= BENCH_FRAMES;
+
+    printf("%-24s | game thread %6.3f ms/frame (%+6.3f ms), worst %6.3f ms, capture calls %6.3f ms/frame", label, frameTime*1e3,
+        (baseFrameTime > 0.0)? (frameTime - baseFrameTime)*1e3 : 0.0, worstFrame*1e3, captureTime*1e3/BENCH_FRAMES);
+
+    if (capture != NULL)
+    {
+        CaptureStats stats = GetCaptureStats(capture);
+        UnloadFrameCapture(capture);
+
+        printf(" | captured %3i, dropped %3i, blocked %7.2f ms | writer %6.3f ms/frame", stats.submittedCount, stats.droppedCount,
+            stats.blockedTime*1e3, (stats.writtenCount > 0)? stats.writeTime*1e3/stats.writtenCount : 0.0);
+    }
+
+    if (readerRunning)
+    {
+        __atomic_store_n(&reader.stopRequested, true, __ATOMIC_RELEASE);
+        pthread_join(readerThread, NULL);
+        printf(" | read %3i", reader.framesRead);
+    }
+
+    printf("\n");
+
+    free(copy);
+    if (sink != CAPTURE_SINK_SHM) remove(BENCH_FILE);
+
+    return frameTime;
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.15f, 42);
+
+    InitJobSystem(-1);
+
+    RenderContext *view = LoadRenderContext(&benchMap->map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+
+    printf("Capture of %ix%i frames at %i fps, %i frames, %i capture buffers, cores: %i%s\n", BENCH_WIDTH, BENCH_HEIGHT, BENCH_FPS,
+        BENCH_FRAMES, CAPTURE_BUFFERS, GetJobWorkersCount() + 1, (GetJobWorkersCount() == 0)? " (no writer thread, frames written on submission)" : "");
+    printf("Game thread frame compared to no capture in brackets\n");
+
+    double base = RunCaptureBenchmark(view, BENCH_CAPTURE_NONE, CAPTURE_SINK_RAW, CAPTURE_POLICY_DROP, 0, 0.0, "no capture");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_COPY, CAPTURE_SINK_RAW, CAPTURE_POLICY_DROP, 0, base, "copy on game thread");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_RAW, CAPTURE_POLICY_DROP, 0, base, "raw file, drop");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_RAW, CAPTURE_POLICY_BLOCK, 0, base, "raw file, block");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_Y4M, CAPTURE_POLICY_DROP, 0, base, "y4m file, drop");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_Y4M, CAPTURE_POLICY_BLOCK, 0, base, "y4m file, block");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_SHM, CAPTURE_POLICY_DROP, 0, base, "shm + reader, drop");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_SHM, CAPTURE_POLICY_BLOCK, 0, base, "shm + reader, block");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_SHM, CAPTURE_POLICY_DROP, BENCH_SLOW_READER_TIME, base, "shm + slow reader, drop");
+    RunCaptureBenchmark(view, BENCH_CAPTURE_SINK, CAPTURE_SINK_SHM, CAPTURE_POLICY_BLOCK, BENCH_SLOW_READER_TIME, base, "shm + slow reader, block");
+
+    UnloadRenderContext(view);
+    CloseJobSystem();
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**********************************************************************************************
+*
+*   raycaster - Collision benchmark
+*
+*   Moves thousands of boxes around a generated map with MoveBoxOnMap, at a normal frame step
+*   and at very large steps, and reports the cost per move. Every box is checked against the
+*   map after each tick: a box overlapping a wall means the sweep tunneled.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "collision.h"
+
+#include <stdio.h>
+
+#define BENCH_MAP_SIZE 256
+#define BENCH_TICKS 200
+#define BENCH_HALF_EXTENT 8.0f
+
+static void RunCollisionBenchmark(const Map *map, int count, float stepLength)
+{
+    float *x = (float *)malloc(count*sizeof(float));
+    float *y = (float *)malloc(count*sizeof(float));
+    float *angle = (float *)malloc(count*sizeof(float));
+    uint32_t seed = 1234;
+
+    // Spawn every box in the center of a random empty tile
+    for (int i = 0; i < count; i++)
+    {
+        int gridIndexX = 0;
+        int gridIndexY = 0;
+
+        do
+        {
+            gridIndexX = (int)(GetBenchRandom(&seed)*map->numCols);
+            gridIndexY = (int)(GetBenchRandom(&seed)*map->numRows);
+        } while (GetMapTile(map, gridIndexX, gridIndexY) != TILE_EMPTY);
+
+        x[i] = (gridIndexX + 0.5f)*TILE_SIZE;
+        y[i] = (gridIndexY + 0.5f)*TILE_SIZE;
+        angle[i] = GetBenchRandom(&seed)*6.2831853f;
+    }
+
+    int blockedMoves = 0;
+    int portalMoves = 0;
+    int overlaps = 0;
+    double elapsed = 0.0;
+
+    for (int tick = 0; tick < BENCH_TICKS; tick++)
+    {
+        double start = GetBenchTime();
+
+        for (int i = 0; i < count; i++)
+        {
+            MoveResult move = MoveBoxOnMap(map, x[i], y[i], BENCH_HALF_EXTENT, BENCH_HALF_EXTENT,
+                cosf(angle[i])*stepLength, sinf(angle[i])*stepLength);
+
+            x[i] = move.x;
+            y[i] = move.y;
+            if (move.flags & (MOVE_BLOCKED_X | MOVE_BLOCKED_Y)) { angle[i] += 2.0f; blockedMoves++; }
+            if (move.flags & MOVE_CROSSED_PORTAL) portalMoves++;
+        }
+
+        elapsed += GetBenchTime() - start;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (CheckCollisionBoxMap(map, x[i], y[i], BENCH_HALF_EXTENT, BENCH_HALF_EXTENT)) overlaps++;
+        }
+    }
+
+    double moves = (double)count*BENCH_TICKS;
+    printf("boxes: %6i | step: %6.1f px | %7.1f ns/move | %7.2f Mmoves/s | tick: %8.3f ms | blocked: %5.1f%% | portal moves: %i | overlaps: %i\n",
+        count, stepLength, elapsed*1e9/moves, moves/elapsed*1e-6, elapsed*1e3/BENCH_TICKS,
+        100.0*blockedMoves/moves, portalMoves, overlaps);
+
+    free(x);
+    free(y);
+    free(angle);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.15f, 42);
+
+    printf("MoveBoxOnMap on a %ix%i map, %i ticks\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE, BENCH_TICKS);
+
+    int counts[] = { 1000, 10000, 100000 };
+    float steps[] = { 2.0f, 24.0f, 300.0f };    // 200 px/s at 100 FPS, at 8 FPS, and a 1.5 s hitch
+
+    for (int s = 0; s < 3; s++)
+    {
+        for (int c = 0; c < 3; c++) RunCollisionBenchmark(&benchMap->map, counts[c], steps[s]);
+    }
+
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
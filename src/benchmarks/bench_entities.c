@@ -0,0 +1,69 @@
+/**********************************************************************************************
+*
+*   raycaster - Entities benchmark
+*
+*   Updates stores of colliding entities walking and bouncing around a generated map, first
+*   on the calling thread only and then with one worker thread per extra core.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "entities.h"
+#include "jobs.h"
+
+#include <stdio.h>
+
+#define BENCH_MAP_SIZE 256
+#define BENCH_TICKS 100
+#define BENCH_DELTA_TIME 0.01f
+
+static void RunEntitiesBenchmark(const Map *map, int count)
+{
+    EntityStore *store = LoadEntityStore(count);
+    uint32_t seed = 99;
+
+    while (store->count < count)
+    {
+        int gridIndexX = (int)(GetBenchRandom(&seed)*map->numCols);
+        int gridIndexY = (int)(GetBenchRandom(&seed)*map->numRows);
+        if (GetMapTile(map, gridIndexX, gridIndexY) != TILE_EMPTY) continue;
+
+        float angle = GetBenchRandom(&seed)*6.2831853f;
+        float speed = 50.0f + GetBenchRandom(&seed)*250.0f;
+
+        SpawnEntity(store, (gridIndexX + 0.5f)*TILE_SIZE, (gridIndexY + 0.5f)*TILE_SIZE, cosf(angle)*speed, sinf(angle)*speed,
+            4.0f + GetBenchRandom(&seed)*8.0f, ENTITY_COLLIDES | ENTITY_BOUNCES | ENTITY_FACES_VELOCITY);
+    }
+
+    UpdateEntities(store, map, BENCH_DELTA_TIME);      // Warmup
+
+    double start = GetBenchTime();
+    for (int tick = 0; tick < BENCH_TICKS; tick++) UpdateEntities(store, map, BENCH_DELTA_TIME);
+    double elapsed = GetBenchTime() - start;
+
+    printf("threads: %2i | entities: %7i | tick: %8.3f ms | %6.1f ns/entity\n", GetJobWorkersCount() + 1, count,
+        elapsed*1e3/BENCH_TICKS, elapsed*1e9/((double)BENCH_TICKS*count));
+
+    UnloadEntityStore(store);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.15f, 42);
+    int counts[] = { 10000, 100000, 1000000 };
+
+    printf("UpdateEntities on a %ix%i map, %i ticks of %.0f ms\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE, BENCH_TICKS, BENCH_DELTA_TIME*1000.0f);
+
+    for (int c = 0; c < 3; c++) RunEntitiesBenchmark(&benchMap->map, counts[c]);
+
+    InitJobSystem(-1);
+    if (GetJobWorkersCount() > 0)
+    {
+        for (int c = 0; c < 3; c++) RunEntitiesBenchmark(&benchMap->map, counts[c]);
+    }
+    CloseJobSystem();
+
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
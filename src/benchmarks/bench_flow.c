@@ -0,0 +1,313 @@
+/**********************************************************************************************
+*
+*   raycaster - Flow field benchmark
+*
+*   Builds flow fields on a 1024x1024 map, single-threaded and over the job system, in one go
+*   and time-sliced, then measures the per-agent cost of steering 100K agents with them.
+*   Costs are checked against a plain sequential search, and walking the directions from random
+*   tiles, through the portals, must reach the goal. A build on a 3000x3000 open map without
+*   job workers expands search levels of thousands of tiles in a single job call. Moving the goal
+*   one tile counts the costs and directions that change, what an incremental rebuild could keep.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "flow.h"
+#include "jobs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_MAP_SIZE 1024
+#define BENCH_BUILDS 8
+#define BENCH_SLICE_TILES 65536         // Tiles budget of the time-sliced builds
+#define BENCH_AGENTS 100000
+#define BENCH_FRAMES 100
+#define BENCH_FRAME_TIME (1.0f/60.0f)
+#define BENCH_AGENT_SPEED (3.0f*TILE_SIZE)
+#define BENCH_WALKS 2000
+#define BENCH_OPEN_MAP_SIZE 3000        // Open map, search levels up to 4*1500 tiles wide
+
+// Random empty tile of the map
+static int GetBenchEmptyTile(const Map *map, uint32_t *seed)
+{
+    int tile = 0;
+
+    do tile = (int)(GetBenchRandom(seed)*map->numRows)*map->numCols + (int)(GetBenchRandom(seed)*map->numCols);
+    while (map->tiles[tile] != TILE_EMPTY);
+
+    return tile;
+}
+
+static void RunBuildBenchmark(FlowField *field, const int *goals)
+{
+    double start = GetBenchTime();
+    for (int i = 0; i < BENCH_BUILDS; i++) BuildFlowField(field, goals[i]%field->map->numCols, goals[i]/field->map->numCols);
+    double elapsed = (GetBenchTime() - start)/BENCH_BUILDS;
+
+    printf("full build   threads: %2i | %7.2f ms/build | %6.2f ns/tile\n", GetJobWorkersCount() + 1,
+        elapsed*1e3, elapsed*1e9/(field->map->numCols*field->map->numRows));
+}
+
+static void RunSlicedBenchmark(FlowField *field, const int *goals)
+{
+    double worstCall = 0.0;
+    int callsCount = 0;
+
+    for (int i = 0; i < BENCH_BUILDS; i++)
+    {
+        SetFlowFieldGoal(field, goals[i]%field->map->numCols, goals[i]/field->map->numCols);
+
+        bool done = false;
+        while (!done)
+        {
+            double start = GetBenchTime();
+            done = UpdateFlowField(field, BENCH_SLICE_TILES);
+            double elapsed = GetBenchTime() - start;
+
+            if (elapsed > worstCall) worstCall = elapsed;
+            callsCount++;
+        }
+    }
+
+    printf("time-sliced  threads: %2i | %7.2f calls/build | worst call: %6.2f ms (budget %i tiles)\n", GetJobWorkersCount() + 1,
+        (double)callsCount/BENCH_BUILDS, worstCall*1e3, BENCH_SLICE_TILES);
+}
+
+// Sequential search with the same rules, walls and portal links
+static int CountCostMismatches(const FlowField *field)
+{
+    const Map *map = field->map;
+    int tilesCount = map->numCols*map->numRows;
+    uint32_t *costs = (uint32_t *)malloc(tilesCount*sizeof(uint32_t));
+    int *queue = (int *)malloc(tilesCount*sizeof(int));
+    int head = 0;
+    int tail = 0;
+    int mismatches = 0;
+
+    memset(costs, 0xff, tilesCount*sizeof(uint32_t));
+    costs[field->goalY*map->numCols + field->goalX] = 0;
+    queue[tail++] = field->goalY*map->numCols + field->goalX;
+
+    while (head < tail)
+    {
+        int tile = queue[head++];
+        int sources[8] = { 0 };
+        int sourcesCount = 0;
+
+        for (int direction = 0; direction < 4; direction++)
+        {
+            int x = tile%map->numCols + (int)flowDirectionX[direction];
+            int y = tile/map->numCols + (int)flowDirectionY[direction];
+            if (GetMapTile(map, x, y) == TILE_EMPTY) sources[sourcesCount++] = y*map->numCols + x;
+        }
+
+        for (int i = 0; i < field->linksCount; i++) if (field->links[i].exit == tile) sources[sourcesCount++] = field->links[i].entrance;
+
+        for (int i = 0; i < sourcesCount; i++)
+        {
+            if (costs[sources[i]] != FLOW_UNREACHABLE) continue;
+            costs[sources[i]] = costs[tile] + 1;
+            queue[tail++] = sources[i];
+        }
+    }
+
+    for (int i = 0; i < tilesCount; i++) mismatches += (costs[i] != field->costs[i]);
+
+    free(queue);
+    free(costs);
+
+    return mismatches;
+}
+
+// Move the goal to a neighbour tile, like a player walking, counting the reachable tiles whose cost and direction change
+static void RunGoalStepCheck(FlowField *field, const int *goals)
+{
+    const Map *map = field->map;
+    int tilesCount = map->numCols*map->numRows;
+    uint32_t *costs = (uint32_t *)malloc(tilesCount*sizeof(uint32_t));
+    unsigned char *directions = (unsigned char *)malloc(tilesCount);
+    long reachable = 0;
+    long changedCosts = 0;
+    long changedDirections = 0;
+
+    for (int i = 0; i < BENCH_BUILDS; i++)
+    {
+        int goalX = goals[i]%map->numCols;
+        int goalY = goals[i]/map->numCols;
+        int direction = 0;
+
+        while ((direction < 4) && (GetMapTile(map, goalX + (int)flowDirectionX[direction], goalY + (int)flowDirectionY[direction]) != TILE_EMPTY)) direction++;
+        if (direction == 4) continue;
+
+        BuildFlowField(field, goalX, goalY);
+        memcpy(costs, field->costs, tilesCount*sizeof(uint32_t));
+        memcpy(directions, field->directions, tilesCount);
+        BuildFlowField(field, goalX + (int)flowDirectionX[direction], goalY + (int)flowDirectionY[direction]);
+
+        for (int t = 0; t < tilesCount; t++)
+        {
+            if (costs[t] == FLOW_UNREACHABLE) continue;
+
+            reachable++;
+            changedCosts += (costs[t] != field->costs[t]);
+            changedDirections += (directions[t] != field->directions[t]);
+        }
+    }
+
+    printf("goal moved one tile: %5.1f%% of the reachable costs change, %5.1f%% of the directions\n",
+        100.0*changedCosts/reachable, 100.0*changedDirections/reachable);
+
+    free(directions);
+    free(costs);
+}
+
+// Walk the directions from random tiles, going through the portals, every step must get closer to the goal
+static void CheckFlowWalks(const FlowField *field)
+{
+    const Map *map = field->map;
+    uint32_t seed = 7;
+    int reached = 0;
+    int unreachable = 0;
+    int portalsTaken = 0;
+    long stepsCount = 0;
+    long costsTotal = 0;
+
+    for (int walk = 0; walk < BENCH_WALKS; walk++)
+    {
+        int tile = GetBenchEmptyTile(map, &seed);
+        uint32_t cost = field->costs[tile];
+
+        if (cost == FLOW_UNREACHABLE)
+        {
+            unreachable++;
+            continue;
+        }
+
+        costsTotal += cost;
+
+        while (field->costs[tile] > 0)
+        {
+            int direction = field->directions[tile];
+            if (direction == FLOW_DIRECTION_NONE) break;
+
+            int x = tile%map->numCols + ((flowDirectionX[direction] > 0.0f) - (flowDirectionX[direction] < 0.0f));
+            int y = tile/map->numCols + ((flowDirectionY[direction] > 0.0f) - (flowDirectionY[direction] < 0.0f));
+            float offsetX = 0.0f;
+            float offsetY = 0.0f;
+
+            if (GetMapPortalTransit(map, x, y, x - tile%map->numCols, y - tile/map->numCols, &offsetX, &offsetY))
+            {
+                x += (int)(offsetX/TILE_SIZE);
+                y += (int)(offsetY/TILE_SIZE);
+                portalsTaken++;
+            }
+
+            int next = y*map->numCols + x;
+            if ((GetMapTile(map, x, y) != TILE_EMPTY) || (field->costs[next] >= field->costs[tile])) break;
+
+            tile = next;
+            stepsCount++;
+        }
+
+        reached += (field->costs[tile] == 0);
+    }
+
+    printf("walks: %i of %i reached the goal (%i unreachable starts) | %.1f steps for %.1f search steps | portals taken: %i\n",
+        reached, BENCH_WALKS - unreachable, unreachable, (double)stepsCount/reached, (double)costsTotal/reached, portalsTaken);
+}
+
+static void RunAgentsBenchmark(const FlowField *field)
+{
+    const Map *map = field->map;
+    float *agentsX = (float *)malloc(BENCH_AGENTS*sizeof(float));
+    float *agentsY = (float *)malloc(BENCH_AGENTS*sizeof(float));
+    uint32_t seed = 99;
+    int arrived = 0;
+
+    for (int i = 0; i < BENCH_AGENTS; i++)
+    {
+        int tile = GetBenchEmptyTile(map, &seed);
+        agentsX[i] = (tile%map->numCols + 0.5f)*TILE_SIZE;
+        agentsY[i] = (tile/map->numCols + 0.5f)*TILE_SIZE;
+    }
+
+    double start = GetBenchTime();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (int i = 0; i < BENCH_AGENTS; i++)
+        {
+            float directionX = 0.0f;
+            float directionY = 0.0f;
+
+            if (GetFlowDirection(field, agentsX[i], agentsY[i], &directionX, &directionY) == FLOW_DIRECTION_NONE) arrived++;
+
+            agentsX[i] += directionX*BENCH_AGENT_SPEED*BENCH_FRAME_TIME;
+            agentsY[i] += directionY*BENCH_AGENT_SPEED*BENCH_FRAME_TIME;
+        }
+    }
+
+    double elapsed = GetBenchTime() - start;
+
+    printf("agents: %i | %5.2f ns/agent sample and move | %6.3f ms/frame | stopped samples: %i\n",
+        BENCH_AGENTS, elapsed*1e9/((double)BENCH_AGENTS*BENCH_FRAMES), elapsed*1e3/BENCH_FRAMES, arrived);
+
+    free(agentsY);
+    free(agentsX);
+}
+
+// Build from the center of an open map, the whole search level goes to one ExpandFlowFrontier() call
+static void RunOpenMapBenchmark(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_OPEN_MAP_SIZE, BENCH_OPEN_MAP_SIZE, 0.0f, 42);
+    FlowField *field = LoadFlowField(&benchMap->map);
+
+    double start = GetBenchTime();
+    BuildFlowField(field, BENCH_OPEN_MAP_SIZE/2, BENCH_OPEN_MAP_SIZE/2);
+    double elapsed = GetBenchTime() - start;
+
+    int mismatches = CountCostMismatches(field);
+    printf("open %ix%i threads: %2i | %7.2f ms/build | costs: %s (%i tiles differ)\n", BENCH_OPEN_MAP_SIZE, BENCH_OPEN_MAP_SIZE,
+        GetJobWorkersCount() + 1, elapsed*1e3, (mismatches == 0)? "match" : "DIFFER", mismatches);
+
+    UnloadFlowField(field);
+    UnloadBenchMap(benchMap);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.25f, 42);
+    const Map *map = &benchMap->map;
+    FlowField *field = LoadFlowField(map);
+    int goals[BENCH_BUILDS] = { 0 };
+    uint32_t seed = 1234;
+
+    for (int i = 0; i < BENCH_BUILDS; i++) goals[i] = GetBenchEmptyTile(map, &seed);
+
+    printf("Flow fields of a %ix%i map, %i portal links\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE, field->linksCount);
+
+    RunBuildBenchmark(field, goals);
+    RunSlicedBenchmark(field, goals);
+    RunOpenMapBenchmark();
+    RunGoalStepCheck(field, goals);
+
+    InitJobSystem(-1);
+    RunBuildBenchmark(field, goals);
+    RunSlicedBenchmark(field, goals);
+
+    // Goal next to a portal exit, so walks from the far corner go through the portal
+    BuildFlowField(field, BENCH_MAP_SIZE - 2, BENCH_MAP_SIZE - 3);
+    CloseJobSystem();
+
+    int mismatches = CountCostMismatches(field);
+    printf("costs: %s (%i tiles differ from the sequential search)\n", (mismatches == 0)? "match" : "DIFFER", mismatches);
+
+    CheckFlowWalks(field);
+    RunAgentsBenchmark(field);
+
+    UnloadFlowField(field);
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/**********************************************************************************************
+*
+*   raycaster - Input latency benchmark
+*
+*   Plays a minute of scripted presses of one key (holds and short taps) through three frame
+*   loops, in simulated time so results do not depend on the machine:
+*     - polled: key state polled once per frame at the end of the previous one (raylib
+*       EndDrawing() with a target FPS), the frame moves with it for the whole frame time
+*     - queued: the same poll feeding the input queue, taps between two polls are kept but
+*       latency and held times stay those of polled (web build, the browser schedules frames)
+*     - latched: input sampled every millisecond while waiting, latched right before the frame,
+*       the simulation integrates from the sample of every event (desktop builds)
+*   Reports the presses lost, the press to present latency and the error of the time moved per
+*   press against the time the key was held, at several frame rates.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "input.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#define BENCH_KEY 265
+#define BENCH_DURATION 60.0             // Seconds of scripted input per run
+#define BENCH_MAX_PRESSES 1024
+#define BENCH_TAP_RATIO 0.3f            // Presses shorter than 25 ms
+#define BENCH_WORK_TIME 0.004           // Seconds to update and render a frame
+#define BENCH_POLL_INTERVAL 0.001       // Seconds between samples while waiting for the latch
+
+typedef enum BenchLoop {
+    BENCH_LOOP_POLLED = 0,
+    BENCH_LOOP_QUEUED,
+    BENCH_LOOP_LATCHED
+} BenchLoop;
+
+typedef struct BenchScript
+{
+    double pressTimes[BENCH_MAX_PRESSES];
+    double releaseTimes[BENCH_MAX_PRESSES];
+    int pressesCount;
+    int tapsCount;
+}
+BenchScript;
+
+static BenchScript script = { 0 };
+static double keyboardTime = 0.0;       // Time the fake keyboard is read at
+static int downCursor = 0;              // First press not released at keyboardTime
+static int pressedCursor = 0;           // First press not reported by GetBenchKeyPressed()
+
+// Scripted key state, like raylib IsKeyDown()
+static bool IsBenchKeyDown(int key)
+{
+    while ((downCursor < script.pressesCount) && (script.releaseTimes[downCursor] <= keyboardTime)) downCursor++;
+
+    return (key == BENCH_KEY) && (downCursor < script.pressesCount) && (script.pressTimes[downCursor] <= keyboardTime);
+}
+
+// Scripted presses since the last call, like raylib GetKeyPressed()
+static int GetBenchKeyPressed(void)
+{
+    if ((pressedCursor == script.pressesCount) || (script.pressTimes[pressedCursor] > keyboardTime)) return 0;
+
+    pressedCursor++;
+
+    return BENCH_KEY;
+}
+
+// Index of the last scripted press at or before a time
+static int GetScriptPress(double time)
+{
+    int press = -1;
+    while ((press + 1 < script.pressesCount) && (script.pressTimes[press + 1] <= time)) press++;
+
+    return press;
+}
+
+static void LoadBenchScript(uint32_t seed)
+{
+    double time = 0.1;
+
+    while ((script.pressesCount < BENCH_MAX_PRESSES) && (time < BENCH_DURATION))
+    {
+        bool tap = (GetBenchRandom(&seed) < BENCH_TAP_RATIO);
+        double hold = tap ? 0.005 + 0.02*GetBenchRandom(&seed) : 0.05 + 0.45*GetBenchRandom(&seed);
+
+        script.pressTimes[script.pressesCount] = time;
+        script.releaseTimes[script.pressesCount] = time + hold;
+        script.pressesCount++;
+        script.tapsCount += tap;
+
+        time += hold + 0.05 + 0.35*GetBenchRandom(&seed);
+    }
+}
+
+static void RunInputBenchmark(BenchLoop loop, int fps, const char *label)
+{
+    const double framePeriod = 1.0/fps;
+    InputQueue queue = { 0 };
+    InputLatch latch = { 0 };
+    const int keys[] = { BENCH_KEY };
+    int seenPresses = 0;
+    int lastPress = -1;                 // Script press of the last press event
+    double pressEventTime = 0.0;
+    double latencySum = 0.0;
+    double worstLatency = 0.0;
+    double holdErrorSum = 0.0;
+    int holdsCount = 0;
+
+    InitInputQueue(&queue, keys, 1);
+    InitInputLatch(&latch, framePeriod, 0.0);
+    keyboardTime = 0.0;
+    downCursor = 0;
+    pressedCursor = 0;
+
+    double presentTime = 0.0;
+
+    while (presentTime < BENCH_DURATION + 1.0)
+    {
+        double latchTime = 0.0;
+
+        if (loop == BENCH_LOOP_LATCHED)
+        {
+            // Samples while waiting, the last one at the latch time
+            latchTime = GetInputLatchTime(&latch);
+            for (double time = presentTime; time < latchTime; time += BENCH_POLL_INTERVAL)
+            {
+                keyboardTime = time;
+                SampleInputKeys(&queue, IsBenchKeyDown, GetBenchKeyPressed, time);
+            }
+            keyboardTime = latchTime;
+            SampleInputKeys(&queue, IsBenchKeyDown, GetBenchKeyPressed, latchTime);
+        }
+        else
+        {
+            // Polled when the last frame was presented, sampled as the frame starts
+            latchTime = presentTime + (framePeriod - BENCH_WORK_TIME);
+            keyboardTime = presentTime;
+            SampleInputKeys(&queue, IsBenchKeyDown, (loop == BENCH_LOOP_QUEUED) ? GetBenchKeyPressed : NULL, latchTime);
+        }
+
+        presentTime = latchTime + BENCH_WORK_TIME;
+
+        // The simulation moves with the key from its press event to its release event
+        InputEvent event = { 0 };
+        while (PopInputEvent(&queue, latchTime, &event))
+        {
+            if (event.pressed)
+            {
+                // Queues see every press in order, the poll only the press holding the key down
+                int press = (loop == BENCH_LOOP_POLLED) ? GetScriptPress(keyboardTime) : lastPress + 1;
+                double latency = presentTime - script.pressTimes[press];
+
+                latencySum += latency;
+                if (latency > worstLatency) worstLatency = latency;
+                seenPresses++;
+                lastPress = press;
+                pressEventTime = event.time;
+            }
+            else if (lastPress >= 0)
+            {
+                double held = script.releaseTimes[lastPress] - script.pressTimes[lastPress];
+
+                holdErrorSum += fabs((event.time - pressEventTime) - held);
+                holdsCount++;
+            }
+        }
+
+        if (loop == BENCH_LOOP_LATCHED) UpdateInputLatch(&latch, latchTime, presentTime);
+    }
+
+    printf("%3i fps | %-8s | presses seen: %4i of %4i | latency %6.2f ms, worst %6.2f ms | held time error %6.2f ms\n",
+        fps, label, seenPresses, script.pressesCount, latencySum*1e3/seenPresses, worstLatency*1e3, holdErrorSum*1e3/holdsCount);
+}
+
+int main(void)
+{
+    const int framesPerSecond[] = { 20, 30, 60, 100 };
+
+    LoadBenchScript(7);
+
+    printf("Input latency: %i presses (%i taps) in %.0f s, %.1f ms to update and render, samples every %.1f ms while waiting\n",
+        script.pressesCount, script.tapsCount, BENCH_DURATION, BENCH_WORK_TIME*1e3, BENCH_POLL_INTERVAL*1e3);
+
+    for (int i = 0; i < (int)(sizeof(framesPerSecond)/sizeof(framesPerSecond[0])); i++)
+    {
+        RunInputBenchmark(BENCH_LOOP_POLLED, framesPerSecond[i], "polled");
+        RunInputBenchmark(BENCH_LOOP_QUEUED, framesPerSecond[i], "queued");
+        RunInputBenchmark(BENCH_LOOP_LATCHED, framesPerSecond[i], "latched");
+    }
+
+    return 0;
+}
@@ -0,0 +1,367 @@
+/**********************************************************************************************
+*
+*   raycaster - Kernels microbenchmark
+*
+*   Measures the hot kernels of the renderer one by one on seeded random inputs: ray casting,
+*   angle normalization, distances, map lookups, color blending and the pixel fill and blend
+*   kernels. Every kernel runs a few warmup repetitions, then its timed repetitions are reported
+*   with their minimum, median, mean and standard deviation in ns per operation. Kernels writing
+*   over their own inputs get them back before every repetition, untimed.
+*
+*   Results can also be written as CSV, one kernel per line, to compare commits and compilers:
+*       bench_kernels results.csv
+*   The checksum column changes when a kernel computes different results: the sum of the scalar
+*   results, or a hash of the whole window buffer after the last repetition of the pixel kernels.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "raycast.h"
+#include "pixels.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define BENCH_MAP_SIZE 64
+#define BENCH_WIDTH 960
+#define BENCH_HEIGHT 624
+#define BENCH_INPUTS 4096               // Inputs of the scalar kernels, every repetition goes through all of them
+#define BENCH_MAX_HITS 10
+#define BENCH_WARMUP_REPS 3
+#define BENCH_REPS 25
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Inputs shared by the kernels, generated once from a fixed seed
+typedef struct KernelInputs
+{
+    const Map *map;
+    RayQuery queries[BENCH_INPUTS];
+    float angles[BENCH_INPUTS];
+    float points[BENCH_INPUTS][4];      // Point pairs
+    uint32_t colors[BENCH_INPUTS][2];   // Color pairs, first one over the second one
+    int columnHeights[BENCH_WIDTH];     // Wall heights of a frame, in pixels
+    uint32_t *pixels;                   // Window sized buffer
+    uint32_t *initialPixels;            // Random pixels the buffer is reset to
+}
+KernelInputs;
+
+// Kernel run over all its inputs, returns a checksum of its results (0 for the pixel kernels)
+typedef double (*KernelFunc)(KernelInputs *inputs);
+typedef void (*KernelResetFunc)(KernelInputs *inputs);
+
+typedef struct KernelBench
+{
+    const char *name;
+    KernelFunc func;
+    int operations;                     // Operations per run: rays, calls or pixels
+    const char *unit;
+    bool writesPixels;                  // Checksum of the window buffer instead of the returned one
+    KernelResetFunc reset;              // Before every run, untimed, NULL when the kernel does not read what it writes
+}
+KernelBench;
+
+typedef struct KernelStats
+{
+    double min;                         // ns per operation
+    double median;
+    double mean;
+    double stddev;
+    double checksum;
+}
+KernelStats;
+
+//----------------------------------------------------------------------------------
+// Kernels
+//----------------------------------------------------------------------------------
+static double RunCastRayFirstWall(KernelInputs *inputs)
+{
+    WallHit hits[BENCH_MAX_HITS] = { 0 };
+    double checksum = 0.0;
+
+    for (int i = 0; i < BENCH_INPUTS; i++)
+    {
+        RayQuery query = inputs->queries[i];
+        query.flags = 0;
+        if (CastRayQuery(inputs->map, &query, hits, BENCH_MAX_HITS) > 0) checksum += hits[0].distance;
+    }
+
+    return checksum;
+}
+
+static double RunCastRayRenderer(KernelInputs *inputs)
+{
+    WallHit hits[BENCH_MAX_HITS] = { 0 };
+    double checksum = 0.0;
+
+    for (int i = 0; i < BENCH_INPUTS; i++)
+    {
+        int count = CastRayQuery(inputs->map, &inputs->queries[i], hits, BENCH_MAX_HITS);
+        for (int h = 0; h < count; h++) checksum += hits[h].distance;
+    }
+
+    return checksum;
+}
+
+static double RunNormalizeAngle(KernelInputs *inputs)
+{
+    double checksum = 0.0;
+    for (int i = 0; i < BENCH_INPUTS; i++) checksum += NormalizeAngle(inputs->angles[i]);
+
+    return checksum;
+}
+
+static double RunDistance(KernelInputs *inputs)
+{
+    double checksum = 0.0;
+    for (int i = 0; i < BENCH_INPUTS; i++) checksum += distanceBetweenPoints(inputs->points[i][0], inputs->points[i][1], inputs->points[i][2], inputs->points[i][3], true);
+
+    return checksum;
+}
+
+static double RunDistanceSquared(KernelInputs *inputs)
+{
+    double checksum = 0.0;
+    for (int i = 0; i < BENCH_INPUTS; i++) checksum += distanceBetweenPoints(inputs->points[i][0], inputs->points[i][1], inputs->points[i][2], inputs->points[i][3], false);
+
+    return checksum;
+}
+
+static double RunMapHasWallAt(KernelInputs *inputs)
+{
+    double checksum = 0.0;
+    for (int i = 0; i < BENCH_INPUTS; i++) checksum += MapHasWallAt(inputs->map, inputs->points[i][0], inputs->points[i][1]);
+
+    return checksum;
+}
+
+static double RunGetMixedColor(KernelInputs *inputs)
+{
+    uint32_t checksum = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) checksum += GetMixedColor(inputs->colors[i][0], inputs->colors[i][1]);
+
+    return checksum;
+}
+
+// Clear of the window buffer
+static double RunFillPixels(KernelInputs *inputs)
+{
+    FillPixels(inputs->pixels, BENCH_WIDTH*BENCH_HEIGHT, 0xFF000000);
+
+    return 0.0;
+}
+
+// Ceiling, wall and floor of every column, the pixels written one by one
+static double RunFillPixelColumn(KernelInputs *inputs)
+{
+    for (int x = 0; x < BENCH_WIDTH; x++)
+    {
+        uint32_t *pixels = inputs->pixels + x;
+        int wallHeight = inputs->columnHeights[x];
+        int wallTop = (BENCH_HEIGHT - wallHeight)/2;
+
+        FillPixelColumn(pixels, BENCH_WIDTH, wallTop, 0xFF333333);
+        FillPixelColumn(pixels + BENCH_WIDTH*wallTop, BENCH_WIDTH, wallHeight, inputs->colors[x][0] | 0xFF000000);
+        FillPixelColumn(pixels + BENCH_WIDTH*(wallTop + wallHeight), BENCH_WIDTH, BENCH_HEIGHT - wallTop - wallHeight, 0xFF777777);
+    }
+
+    return 0.0;
+}
+
+// Translucent wall blended over every column
+static double RunMixPixelColumn(KernelInputs *inputs)
+{
+    for (int x = 0; x < BENCH_WIDTH; x++)
+    {
+        int wallHeight = inputs->columnHeights[x];
+        int wallTop = (BENCH_HEIGHT - wallHeight)/2;
+
+        MixPixelColumn(inputs->pixels + BENCH_WIDTH*wallTop + x, BENCH_WIDTH, wallHeight, inputs->colors[x][1], false);
+    }
+
+    return 0.0;
+}
+
+// Blending reads the pixels it writes, every run starts from the same frame
+static void ResetPixels(KernelInputs *inputs)
+{
+    memcpy(inputs->pixels, inputs->initialPixels, BENCH_WIDTH*BENCH_HEIGHT*sizeof(uint32_t));
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition
+//----------------------------------------------------------------------------------
+
+// Generate the inputs of every kernel
+static void InitKernelInputs(KernelInputs *inputs, const Map *map)
+{
+    uint32_t seed = 23;
+    float mapWidth = (float)(map->numCols*TILE_SIZE);
+    float mapHeight = (float)(map->numRows*TILE_SIZE);
+
+    inputs->map = map;
+
+    for (int i = 0; i < BENCH_INPUTS; i++)
+    {
+        inputs->queries[i] = (RayQuery){ .originX = (1.5f + GetBenchRandom(&seed)*(map->numCols - 3))*TILE_SIZE,
+            .originY = (1.5f + GetBenchRandom(&seed)*(map->numRows - 3))*TILE_SIZE, .angle = GetBenchRandom(&seed)*TWO_PI,
+            .maxDistance = FLT_MAX, .flags = RAY_PASS_TRANSLUCENT | RAY_PASS_PORTALS, .maxTranslucentWalls = 0 };
+
+        // Angles of several turns either way, like accumulated player rotations
+        inputs->angles[i] = (GetBenchRandom(&seed) - 0.5f)*8*TWO_PI;
+
+        // Points a bit outside of the map too
+        for (int c = 0; c < 4; c += 2)
+        {
+            inputs->points[i][c] = (GetBenchRandom(&seed)*1.1f - 0.05f)*mapWidth;
+            inputs->points[i][c + 1] = (GetBenchRandom(&seed)*1.1f - 0.05f)*mapHeight;
+        }
+
+        inputs->colors[i][0] = (uint32_t)(GetBenchRandom(&seed)*4294967296.0);
+        inputs->colors[i][1] = (uint32_t)(GetBenchRandom(&seed)*4294967296.0);
+    }
+
+    for (int x = 0; x < BENCH_WIDTH; x++) inputs->columnHeights[x] = (int)(GetBenchRandom(&seed)*BENCH_HEIGHT);
+
+    inputs->pixels = (uint32_t *)malloc(BENCH_WIDTH*BENCH_HEIGHT*sizeof(uint32_t));
+    inputs->initialPixels = (uint32_t *)malloc(BENCH_WIDTH*BENCH_HEIGHT*sizeof(uint32_t));
+    for (int i = 0; i < BENCH_WIDTH*BENCH_HEIGHT; i++) inputs->initialPixels[i] = (uint32_t)(GetBenchRandom(&seed)*4294967296.0);
+    ResetPixels(inputs);
+}
+
+// FNV-1a hash of the whole window buffer
+static double GetPixelsChecksum(const KernelInputs *inputs)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < BENCH_WIDTH*BENCH_HEIGHT; i++)
+    {
+        hash ^= inputs->pixels[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
+
+// Run the warmup and timed repetitions of a kernel
+static KernelStats RunKernelBench(const KernelBench *bench, KernelInputs *inputs)
+{
+    double times[BENCH_REPS] = { 0 };
+    KernelStats stats = { 0 };
+
+    for (int rep = 0; rep < BENCH_WARMUP_REPS; rep++)
+    {
+        if (bench->reset != NULL) bench->reset(inputs);
+        stats.checksum = bench->func(inputs);
+    }
+
+    for (int rep = 0; rep < BENCH_REPS; rep++)
+    {
+        if (bench->reset != NULL) bench->reset(inputs);
+
+        double start = GetBenchTime();
+        stats.checksum = bench->func(inputs);
+        times[rep] = (GetBenchTime() - start)*1e9/bench->operations;
+    }
+
+    if (bench->writesPixels) stats.checksum = GetPixelsChecksum(inputs);
+
+    qsort(times, BENCH_REPS, sizeof(double), CompareDoubles);
+
+    for (int rep = 0; rep < BENCH_REPS; rep++) stats.mean += times[rep]/BENCH_REPS;
+    for (int rep = 0; rep < BENCH_REPS; rep++) stats.stddev += (times[rep] - stats.mean)*(times[rep] - stats.mean)/BENCH_REPS;
+
+    stats.min = times[0];
+    stats.median = times[BENCH_REPS/2];
+    stats.stddev = sqrt(stats.stddev);
+
+    return stats;
+}
+
+int main(int argc, char **argv)
+{
+    static KernelInputs inputs = { 0 };
+
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.08f, 42);
+    InitKernelInputs(&inputs, &benchMap->map);
+
+    // Walls blended per frame, the pixels between the ceiling and the floor
+    int wallPixels = 0;
+    for (int x = 0; x < BENCH_WIDTH; x++) wallPixels += inputs.columnHeights[x];
+
+    const KernelBench benches[] = {
+        { .name = "CastRayQuery (first wall)", .func = RunCastRayFirstWall, .operations = BENCH_INPUTS, .unit = "ray", .writesPixels = false, .reset = NULL },
+        { .name = "CastRayQuery (renderer)", .func = RunCastRayRenderer, .operations = BENCH_INPUTS, .unit = "ray", .writesPixels = false, .reset = NULL },
+        { .name = "NormalizeAngle", .func = RunNormalizeAngle, .operations = BENCH_INPUTS, .unit = "call", .writesPixels = false, .reset = NULL },
+        { .name = "distanceBetweenPoints", .func = RunDistance, .operations = BENCH_INPUTS, .unit = "call", .writesPixels = false, .reset = NULL },
+        { .name = "distanceBetweenPoints (squared)", .func = RunDistanceSquared, .operations = BENCH_INPUTS, .unit = "call", .writesPixels = false, .reset = NULL },
+        { .name = "MapHasWallAt", .func = RunMapHasWallAt, .operations = BENCH_INPUTS, .unit = "call", .writesPixels = false, .reset = NULL },
+        { .name = "GetMixedColor", .func = RunGetMixedColor, .operations = BENCH_INPUTS, .unit = "call", .writesPixels = false, .reset = NULL },
+        { .name = "FillPixels (clear)", .func = RunFillPixels, .operations = BENCH_WIDTH*BENCH_HEIGHT, .unit = "pixel", .writesPixels = true, .reset = NULL },
+        { .name = "FillPixelColumn (columns)", .func = RunFillPixelColumn, .operations = BENCH_WIDTH*BENCH_HEIGHT, .unit = "pixel", .writesPixels = true, .reset = NULL },
+        { .name = "MixPixelColumn (walls)", .func = RunMixPixelColumn, .operations = wallPixels, .unit = "pixel", .writesPixels = true, .reset = ResetPixels }
+    };
+    int benchesCount = (int)(sizeof(benches)/sizeof(benches[0]));
+
+    FILE *results = NULL;
+    if (argc > 1)
+    {
+        results = fopen(argv[1], "w");
+        if (results == NULL)
+        {
+            printf("Can't write the results to %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+#if defined(__clang__)
+    const char *compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const char *compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const char *compiler = "msvc";
+#else
+    const char *compiler = "unknown";
+#endif
+
+    printf("Kernels: %i warmup + %i repetitions | compiler: %s\n", BENCH_WARMUP_REPS, BENCH_REPS, compiler);
+    printf("%-32s | %9s | %9s | %9s | %8s | unit\n", "kernel", "min ns", "median ns", "mean ns", "stddev");
+
+    if (results != NULL)
+    {
+        fprintf(results, "# compiler: %s\n", compiler);
+        fprintf(results, "kernel,unit,operations,reps,min_ns,median_ns,mean_ns,stddev_ns,checksum\n");
+    }
+
+    for (int i = 0; i < benchesCount; i++)
+    {
+        const KernelBench *bench = &benches[i];
+        KernelStats stats = RunKernelBench(bench, &inputs);
+
+        printf("%-32s | %9.3f | %9.3f | %9.3f | %8.3f | %s\n", bench->name, stats.min, stats.median, stats.mean, stats.stddev, bench->unit);
+
+        if (results != NULL)
+        {
+            fprintf(results, "%s,%s,%i,%i,%.4f,%.4f,%.4f,%.4f,%.17g\n", bench->name, bench->unit, bench->operations, BENCH_REPS,
+                stats.min, stats.median, stats.mean, stats.stddev, stats.checksum);
+        }
+    }
+
+    if (results != NULL) fclose(results);
+
+    free(inputs.initialPixels);
+    free(inputs.pixels);
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
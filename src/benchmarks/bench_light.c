@@ -0,0 +1,189 @@
+/**********************************************************************************************
+*
+*   raycaster - Lightmap benchmark
+*
+*   Bakes 32 point lights into the lightmap of a 256x256 map with a portal pair, then moves
+*   one light a quarter tile per frame and relights the tiles it reaches, on the calling thread
+*   and on the loader thread, reporting the relight cost per moved light. A tile next to the light
+*   is toggled between wall and empty every few frames, while relights run. The relit lightmap is
+*   compared to a bake of the final lights from scratch, and views are rendered with and without
+*   lightmap.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "light.h"
+#include "renderer.h"
+#include "jobs.h"
+#include "loader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+
+#define BENCH_MAP_SIZE 256
+#define BENCH_LIGHTS 32
+#define BENCH_LIGHT_RADIUS (6.0f*TILE_SIZE)
+#define BENCH_FRAMES 200
+#define BENCH_LIGHT_STEP (0.25f*TILE_SIZE)
+#define BENCH_EDIT_INTERVAL 10          // Frames between edits of the tile next to the moving light
+#define BENCH_WIDTH 960
+#define BENCH_HEIGHT 624
+#define BENCH_FOV (60*(PI/180))
+
+static Lightmap *LoadBenchLightmap(const Map *map, const Light *lights)
+{
+    Lightmap *lightmap = LoadLightmap(map, 40);
+
+    for (int i = 0; i < BENCH_LIGHTS; i++) AddLight(lightmap, lights[i]);
+
+    return lightmap;
+}
+
+// Count the tiles of the relight installed by the last update
+static void AddRelightTiles(const Lightmap *lightmap, int *relightsCount, long *relitTiles)
+{
+    if (lightmap->stats.relightsCount == *relightsCount) return;
+
+    *relightsCount = lightmap->stats.relightsCount;
+    *relitTiles += lightmap->stats.relitTiles;
+}
+
+// Move the first light around a circle, relighting every frame
+// NOTE: Frames sleep 1 ms after the update, time the loader thread gets on a single core
+static void RunRelightBenchmark(Lightmap *lightmap, BenchMap *benchMap, const char *label)
+{
+    Light center = lightmap->lights[0];
+    int editX = (int)(center.x/TILE_SIZE) + 3;
+    int editY = (int)(center.y/TILE_SIZE);
+    struct timespec frameRest = { 0, 1000000 };
+    double updateTime = 0.0;
+    double worstUpdate = 0.0;
+    double relightTime = lightmap->stats.totalRelightTime;
+    int firstRelight = lightmap->stats.relightsCount;
+    int relightsCount = firstRelight;
+    long relitTiles = 0;
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        float angle = frame*BENCH_LIGHT_STEP/(2.0f*TILE_SIZE);
+
+        MoveLight(lightmap, 0, center.x + cosf(angle)*2.0f*TILE_SIZE, center.y + sinf(angle)*2.0f*TILE_SIZE);
+
+        // Edited on this thread while the loader thread may be relighting
+        if (frame%BENCH_EDIT_INTERVAL == 0)
+        {
+            int *tile = &benchMap->tiles[editY*BENCH_MAP_SIZE + editX];
+            *tile = (*tile == TILE_EMPTY)? TILE_WALL : TILE_EMPTY;
+            InvalidateLightmapTile(lightmap, editX, editY);
+        }
+
+        double start = GetBenchTime();
+        UpdateLightmap(lightmap);
+        double elapsed = GetBenchTime() - start;
+
+        updateTime += elapsed;
+        if (elapsed > worstUpdate) worstUpdate = elapsed;
+
+        AddRelightTiles(lightmap, &relightsCount, &relitTiles);
+        nanosleep(&frameRest, NULL);
+    }
+
+    while (!UpdateLightmap(lightmap)) AddRelightTiles(lightmap, &relightsCount, &relitTiles);
+    AddRelightTiles(lightmap, &relightsCount, &relitTiles);
+
+    int relights = relightsCount - firstRelight;
+    relightTime = lightmap->stats.totalRelightTime - relightTime;
+
+    printf("%-20s | relights: %3i | %6.3f ms, %5li tiles per relight | %7.1f ns/tile | main thread %6.3f ms/frame, worst %6.3f ms\n",
+        label, relights, relightTime*1e3/relights, relitTiles/relights, relightTime*1e9/relitTiles,
+        updateTime*1e3/BENCH_FRAMES, worstUpdate*1e3);
+}
+
+static void RunRenderBenchmark(RenderContext *view, const char *label)
+{
+    uint32_t seed = 17;
+    double start = GetBenchTime();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*2*PI };
+        RenderView(view);
+    }
+
+    double elapsed = GetBenchTime() - start;
+
+    printf("%-20s | %7.3f ms/frame\n", label, elapsed*1e3/BENCH_FRAMES);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.15f, 42);
+    const Map *map = &benchMap->map;
+    Light lights[BENCH_LIGHTS] = { 0 };
+    uint32_t seed = 5;
+
+    // First light in front of the portal on the top border, its light comes out at the bottom right corner
+    for (int y = 1; y < 8; y++) benchMap->tiles[y*BENCH_MAP_SIZE + 1] = TILE_EMPTY;
+    lights[0] = (Light){ 1.5f*TILE_SIZE, 4.5f*TILE_SIZE, BENCH_LIGHT_RADIUS, 0.8f };
+    for (int i = 1; i < BENCH_LIGHTS; i++)
+    {
+        lights[i] = (Light){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, BENCH_LIGHT_RADIUS, 0.8f };
+    }
+
+    printf("Lightmap of a %ix%i map, %i lights of %.0f tiles radius, %i bytes per tile\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE, BENCH_LIGHTS,
+        BENCH_LIGHT_RADIUS/TILE_SIZE, LIGHTMAP_LAYERS);
+
+    InitJobSystem(-1);
+
+    Lightmap *lightmap = LoadBenchLightmap(map, lights);
+    int bakedTiles = lightmap->markedCount;
+    double start = GetBenchTime();
+    BakeLightmap(lightmap);
+    double bakeTime = GetBenchTime() - start;
+
+    printf("bake threads: %2i     | %7.2f ms | %i tiles | %7.1f ns/tile\n", GetJobWorkersCount() + 1, bakeTime*1e3, bakedTiles, bakeTime*1e9/bakedTiles);
+
+    int lit = 0;
+    for (int i = 0; i < BENCH_MAP_SIZE*BENCH_MAP_SIZE*LIGHTMAP_LAYERS; i++) lit += (lightmap->levels[i] > lightmap->ambient);
+    int portalLit = 0;
+    for (int y = BENCH_MAP_SIZE - 8; y < BENCH_MAP_SIZE; y++)
+    {
+        for (int x = BENCH_MAP_SIZE - 8; x < BENCH_MAP_SIZE; x++)
+        {
+            for (int face = 0; face < LIGHTMAP_LAYERS; face++) portalLit += (GetLightmapLevel(lightmap, x, y, face) > lightmap->ambient);
+        }
+    }
+    printf("lit levels: %i | faces lit through the portal: %i\n", lit, portalLit);
+
+    RunRelightBenchmark(lightmap, benchMap, "relight inline");
+
+    InitLoader();
+    RunRelightBenchmark(lightmap, benchMap, "relight on loader");
+    CloseLoader();
+
+    // Relit levels against a bake from scratch of the final lights
+    Lightmap *baked = LoadBenchLightmap(map, lightmap->lights);
+    BakeLightmap(baked);
+    int differences = 0;
+    for (int i = 0; i < BENCH_MAP_SIZE*BENCH_MAP_SIZE*LIGHTMAP_LAYERS; i++) differences += (baked->levels[i] != lightmap->levels[i]);
+    printf("relit levels: %s (%i levels differ from a full bake)\n", (differences == 0)? "match" : "DIFFER", differences);
+    UnloadLightmap(baked);
+
+    RenderContext *view = LoadRenderContext(map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+    RunRenderBenchmark(view, "render flat");
+    view->lightmap = lightmap;
+    RunRenderBenchmark(view, "render lightmap");
+    UnloadRenderContext(view);
+
+    CloseJobSystem();
+    UnloadLightmap(lightmap);
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**********************************************************************************************
+*
+*   raycaster - Background loader benchmark
+*
+*   Plays the transition into the gameplay screen at 60 frames per second (sleeping the rest of
+*   every frame): 21 frames fading in, the switch to the level, 51 frames fading out. The level
+*   is prepared like the gameplay screen does (map, wall faces, view and its first frame):
+*     - inline: on the main thread in the switch frame, as an init without loader
+*     - loader, early: submitted to the loader thread a second before the transition (logo and
+*       title screens)
+*     - loader, late: submitted when the fade in ends, the faded out frame is held meanwhile
+*   Reports the main thread time per frame, average and longest, and the frames held waiting,
+*   for the built-in 12x10 level and a 256x256 level loaded from a map file.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "loader.h"
+#include "edges.h"
+#include "renderer.h"
+
+#include <stdio.h>
+
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+
+#define BENCH_FPS 60
+#define BENCH_FADE_IN_FRAMES 21         // Alpha +0.05 per frame up to 1.01
+#define BENCH_FADE_OUT_FRAMES 51        // Alpha -0.02 per frame down to -0.01
+#define BENCH_EARLY_FRAMES 60           // Frames between an early submission and the transition
+#define BENCH_VIEW_WIDTH 800
+#define BENCH_VIEW_HEIGHT 450
+#define BENCH_LEVEL_FILE "bench_loader.rcm"
+
+typedef enum BenchPrepare {
+    BENCH_PREPARE_INLINE = 0,
+    BENCH_PREPARE_EARLY,
+    BENCH_PREPARE_LATE
+} BenchPrepare;
+
+typedef struct BenchLevel
+{
+    const Map *source;                  // Level when no file is given
+    const char *fileName;
+    Map map;
+    bool loaded;                        // map loaded from the file
+    MapEdges *edges;
+    RenderContext *view;
+}
+BenchLevel;
+
+// Load job: everything PrepareLevel() of the gameplay screen does
+static void PrepareBenchLevel(void *userData)
+{
+    BenchLevel *level = (BenchLevel *)userData;
+
+    level->loaded = (level->fileName != NULL);
+    level->map = level->loaded? LoadMap(level->fileName) : *level->source;
+    level->edges = BuildMapEdges(&level->map);
+    level->view = LoadRenderContext(&level->map, BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT, 60.0f*(PI/180.0f));
+    level->view->edges = level->edges;
+    SetRenderContextMethod(level->view, RENDER_METHOD_FACES);
+    level->view->camera = (RenderCamera){ .x = 0.5f*level->map.numCols*TILE_SIZE, .y = 0.5f*level->map.numRows*TILE_SIZE, .angle = 0.0f };
+    RenderView(level->view);
+}
+
+static void UnloadBenchLevel(BenchLevel *level)
+{
+    UnloadRenderContext(level->view);
+    UnloadMapEdges(level->edges);
+    if (level->loaded) UnloadMap(level->map);
+}
+
+// Sleep until the next frame deadline
+static void WaitBenchFrame(double *deadline)
+{
+    *deadline += 1.0/BENCH_FPS;
+    double rest = *deadline - GetBenchTime();
+
+    if (rest > 0.0)
+    {
+        struct timespec sleep = { (time_t)rest, (long)((rest - (time_t)rest)*1e9) };
+        nanosleep(&sleep, NULL);
+    }
+    else *deadline = GetBenchTime();
+}
+
+static void RunTransitionBenchmark(const Map *source, const char *fileName, BenchPrepare prepare, const char *label)
+{
+    BenchLevel level = { .source = source, .fileName = fileName };
+    LoadFence fence = 0;
+    bool submitted = false;
+    double deadline = GetBenchTime();
+    double frameTime = 0.0;
+    double worstFrame = 0.0;
+    int framesCount = 0;
+    int heldFrames = 0;
+
+    // Logo and title screens submit the preparation ahead
+    if (prepare == BENCH_PREPARE_EARLY)
+    {
+        fence = SubmitLoadJob(PrepareBenchLevel, &level);
+        submitted = true;
+        for (int frame = 0; frame < BENCH_EARLY_FRAMES; frame++) WaitBenchFrame(&deadline);
+    }
+
+    for (int frame = 0; frame < BENCH_FADE_IN_FRAMES + 1 + BENCH_FADE_OUT_FRAMES; frame++)
+    {
+        double start = GetBenchTime();
+
+        if (frame == BENCH_FADE_IN_FRAMES)
+        {
+            if (prepare == BENCH_PREPARE_INLINE) PrepareBenchLevel(&level);
+            else
+            {
+                if (!submitted) fence = SubmitLoadJob(PrepareBenchLevel, &level);
+                submitted = true;
+
+                // Faded out frame held until the level is ready
+                if (!IsLoadFenceReached(fence))
+                {
+                    heldFrames++;
+                    frame--;
+                }
+            }
+        }
+
+        double elapsed = GetBenchTime() - start;
+        frameTime += elapsed;
+        framesCount++;
+        if (elapsed > worstFrame) worstFrame = elapsed;
+
+        WaitBenchFrame(&deadline);
+    }
+
+    printf("%-22s | %3i frames | frame %6.3f ms, worst %6.3f ms (budget %5.2f ms) | held %3i frames\n", label, framesCount,
+        frameTime*1e3/framesCount, worstFrame*1e3, 1e3/BENCH_FPS, heldFrames);
+
+    UnloadBenchLevel(&level);
+}
+
+int main(void)
+{
+    BenchMap *smallMap = LoadBenchMap(12, 10, 0.15f, 42);
+    BenchMap *largeMap = LoadBenchMap(256, 256, 0.15f, 42);
+
+    remove(BENCH_LEVEL_FILE);
+    ExportMap(&largeMap->map, BENCH_LEVEL_FILE);
+
+    InitLoader();
+
+    printf("Transition into a level at %i fps, %i frames fading in, %i fading out, %ix%i first frame\n", BENCH_FPS,
+        BENCH_FADE_IN_FRAMES, BENCH_FADE_OUT_FRAMES, BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+
+    printf("built-in 12x10 level\n");
+    RunTransitionBenchmark(&smallMap->map, NULL, BENCH_PREPARE_INLINE, "inline");
+    RunTransitionBenchmark(&smallMap->map, NULL, BENCH_PREPARE_EARLY, "loader, early");
+    RunTransitionBenchmark(&smallMap->map, NULL, BENCH_PREPARE_LATE, "loader, late");
+
+    printf("256x256 level file\n");
+    RunTransitionBenchmark(NULL, BENCH_LEVEL_FILE, BENCH_PREPARE_INLINE, "inline");
+    RunTransitionBenchmark(NULL, BENCH_LEVEL_FILE, BENCH_PREPARE_EARLY, "loader, early");
+    RunTransitionBenchmark(NULL, BENCH_LEVEL_FILE, BENCH_PREPARE_LATE, "loader, late");
+
+    CloseLoader();
+    remove(BENCH_LEVEL_FILE);
+    UnloadBenchMap(largeMap);
+    UnloadBenchMap(smallMap);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**********************************************************************************************
+*
+*   raycaster - Paged map benchmark
+*
+*   Exports a 16384x16384 tiles paged map and walks a player across it, sampling the tiles
+*   along 320 view rays every frame, with a chunk cache of 1 MB (256 chunks). Frames run
+*   without prefetching, where every new chunk is a miss read in the frame, and with background
+*   prefetching on the loader thread. The file pages are dropped from the OS cache before every
+*   run (Linux) so misses go to the disk. Lookups are checked against the generated tiles.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "paged.h"
+#include "loader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+
+#define BENCH_MAP_FILE "bench_paged.rcpm"
+#define BENCH_MAP_SIZE 16384
+#define BENCH_CACHED_CHUNKS 256
+#define BENCH_FRAMES 4000
+#define BENCH_FRAME_TIME (1.0f/60.0f)
+#define BENCH_SPEED (8.0f*TILE_SIZE/BENCH_FRAME_TIME)      // 8 tiles per frame
+#define BENCH_RAYS 320
+#define BENCH_RAY_STEPS 80                                  // Half tile steps, 40 tiles view distance
+
+// Tile of the generated world: walls scattered at 8% density, open fields with no walls at all
+static unsigned char GetBenchTile(int x, int y)
+{
+    if ((((x >> 9) + (y >> 9))%3) == 0) return TILE_EMPTY;
+
+    uint32_t hash = (uint32_t)x*73856093u ^ (uint32_t)y*19349663u;
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+
+    return ((hash%100) < 8)? TILE_WALL : TILE_EMPTY;
+}
+
+static void GenerateBenchChunk(void *userData, int chunkX, int chunkY, unsigned char *tiles)
+{
+    (void)userData;
+
+    for (int y = 0; y < PAGED_CHUNK_SIZE; y++)
+    {
+        for (int x = 0; x < PAGED_CHUNK_SIZE; x++) tiles[y*PAGED_CHUNK_SIZE + x] = GetBenchTile(chunkX*PAGED_CHUNK_SIZE + x, chunkY*PAGED_CHUNK_SIZE + y);
+    }
+}
+
+// Drop the pages of the file from the OS cache, chunk reads go to the disk
+static void DropFileCache(const char *fileName)
+{
+#if defined(__linux__)
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)fileName;
+#endif
+}
+
+static void RunPagedBenchmark(const char *name, bool prefetch)
+{
+    DropFileCache(BENCH_MAP_FILE);
+
+    PagedMap *map = LoadPagedMap(BENCH_MAP_FILE, BENCH_CACHED_CHUNKS);
+    if (!prefetch) map->prefetchRadius = -1;
+
+    float x = 100.5f*TILE_SIZE;
+    float y = 100.5f*TILE_SIZE;
+    float heading = 0.6f;
+    int walls = 0;
+    int mismatches = 0;
+    long lookups = 0;
+    double worstFrame = 0.0;
+    double start = GetBenchTime();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        double frameStart = GetBenchTime();
+
+        // Wander across the map, turning slowly and away from the borders
+        heading += 0.01f*sinf(frame*0.013f);
+        float velocityX = cosf(heading)*BENCH_SPEED;
+        float velocityY = sinf(heading)*BENCH_SPEED;
+        x += velocityX*BENCH_FRAME_TIME;
+        y += velocityY*BENCH_FRAME_TIME;
+        if ((x < 64*TILE_SIZE) || (x > (BENCH_MAP_SIZE - 64)*TILE_SIZE) || (y < 64*TILE_SIZE) || (y > (BENCH_MAP_SIZE - 64)*TILE_SIZE)) heading += PI/2;
+
+        UpdatePagedMap(map, x, y, velocityX, velocityY);
+
+        for (int ray = 0; ray < BENCH_RAYS; ray++)
+        {
+            float angle = heading + ((float)ray/BENCH_RAYS - 0.5f)*(PI/3);
+            float stepX = cosf(angle)*0.5f*TILE_SIZE;
+            float stepY = sinf(angle)*0.5f*TILE_SIZE;
+
+            for (int step = 1; step <= BENCH_RAY_STEPS; step++)
+            {
+                float sampleX = x + stepX*step;
+                float sampleY = y + stepY*step;
+                int tile = GetPagedMapWallTypeAt(map, sampleX, sampleY);
+                walls += (tile != TILE_EMPTY);
+
+                if ((lookups%97) == 0)
+                {
+                    int gridIndexX = (int)floorf(sampleX/TILE_SIZE);
+                    int gridIndexY = (int)floorf(sampleY/TILE_SIZE);
+                    bool inside = (gridIndexX >= 0) && (gridIndexX < BENCH_MAP_SIZE) && (gridIndexY >= 0) && (gridIndexY < BENCH_MAP_SIZE);
+                    mismatches += (tile != (inside? GetBenchTile(gridIndexX, gridIndexY) : TILE_WALL));
+                }
+
+                lookups++;
+            }
+        }
+
+        double frameTime = GetBenchTime() - frameStart;
+        if (frameTime > worstFrame) worstFrame = frameTime;
+    }
+
+    double elapsed = GetBenchTime() - start;
+    PagedMapStats stats = GetPagedMapStats(map);
+
+    printf("%-11s | %6.1f Mlookups/s | worst frame: %6.2f ms | lookups: %9li | misses: %5llu | prefetches: %5llu | evictions: %5llu | resident: %4i | %s\n",
+        name, lookups/elapsed/1e6, worstFrame*1000.0, lookups, (unsigned long long)stats.missesCount,
+        (unsigned long long)stats.prefetchesCount, (unsigned long long)stats.evictionsCount, stats.residentCount,
+        (mismatches == 0)? "tiles match" : "TILES DIFFER");
+
+    (void)walls;
+    UnloadPagedMap(map);
+}
+
+int main(void)
+{
+    double start = GetBenchTime();
+    bool exported = ExportPagedMap(BENCH_MAP_FILE, BENCH_MAP_SIZE, BENCH_MAP_SIZE, GenerateBenchChunk, NULL);
+    double exportTime = GetBenchTime() - start;
+
+    if (!exported)
+    {
+        printf("paged map export failed\n");
+        return 1;
+    }
+
+    FILE *file = fopen(BENCH_MAP_FILE, "rb");
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fclose(file);
+
+    printf("%ix%i tiles map: %.1f MB file (%.1f MB as int tiles), exported in %.2f s | cache: %i chunks, %.1f MB\n",
+        BENCH_MAP_SIZE, BENCH_MAP_SIZE, fileSize/(1024.0*1024.0), (double)BENCH_MAP_SIZE*BENCH_MAP_SIZE*sizeof(int)/(1024.0*1024.0),
+        exportTime, BENCH_CACHED_CHUNKS, BENCH_CACHED_CHUNKS*PAGED_PAGE_SIZE/(1024.0*1024.0));
+    printf("%i frames, %i rays of %i samples, %.0f tiles per frame\n", BENCH_FRAMES, BENCH_RAYS, BENCH_RAY_STEPS, BENCH_SPEED*BENCH_FRAME_TIME/TILE_SIZE);
+
+    RunPagedBenchmark("no prefetch", false);
+
+    InitLoader();
+    RunPagedBenchmark("prefetch", true);
+    CloseLoader();
+
+    remove(BENCH_MAP_FILE);
+
+    return 0;
+}
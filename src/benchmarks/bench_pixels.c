@@ -0,0 +1,96 @@
+/**********************************************************************************************
+*
+*   raycaster - Pixel kernels benchmark
+*
+*   Measures the column fill and blend kernels and the indexed pixels expansion on a window sized
+*   buffer, checking the blending kernel against the per pixel GetMixedColor() results.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "pixels.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_WIDTH 960
+#define BENCH_HEIGHT 624
+#define BENCH_FRAMES 200
+
+static void FillRandomPixels(uint32_t *pixels, int count, uint32_t seed)
+{
+    for (int i = 0; i < count; i++) pixels[i] = (uint32_t)(GetBenchRandom(&seed)*4294967296.0);
+}
+
+int main(void)
+{
+    int count = BENCH_WIDTH*BENCH_HEIGHT;
+    uint32_t *pixels = (uint32_t *)malloc(count*sizeof(uint32_t));
+    uint32_t *expected = (uint32_t *)malloc(count*sizeof(uint32_t));
+
+#if defined(__SSE2__)
+    printf("Pixel kernels on a %ix%i buffer (SIMD)\n", BENCH_WIDTH, BENCH_HEIGHT);
+#else
+    printf("Pixel kernels on a %ix%i buffer (scalar)\n", BENCH_WIDTH, BENCH_HEIGHT);
+#endif
+
+    // Blending kernel against the per pixel function, every column with its own color and opacity
+    FillRandomPixels(pixels, count, 3);
+    memcpy(expected, pixels, count*sizeof(uint32_t));
+
+    for (int x = 0; x < BENCH_WIDTH; x++)
+    {
+        uint32_t color = 0x9c3f7a10 ^ (x*2654435761u);
+        bool makeOpaque = (x%3) == 0;
+
+        MixPixelColumn(pixels + x, BENCH_WIDTH, BENCH_HEIGHT, color, makeOpaque);
+        for (int y = 0; y < BENCH_HEIGHT; y++) expected[y*BENCH_WIDTH + x] = GetMixedColor(color, expected[y*BENCH_WIDTH + x]) | (makeOpaque? 0xff000000 : 0);
+    }
+
+    bool matches = memcmp(pixels, expected, count*sizeof(uint32_t)) == 0;
+    printf("MixPixelColumn matches GetMixedColor: %s\n", matches? "OK" : "FAILED");
+
+    double start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (int x = 0; x < BENCH_WIDTH; x++) MixPixelColumn(pixels + x, BENCH_WIDTH, BENCH_HEIGHT, 0xC8CCCCCC, false);
+    }
+    double elapsed = GetBenchTime() - start;
+    printf("MixPixelColumn          %6.3f ms/frame | %5.2f ns/pixel\n", elapsed*1e3/BENCH_FRAMES, elapsed*1e9/((double)BENCH_FRAMES*count));
+
+    start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (int x = 0; x < BENCH_WIDTH; x++)
+            for (int y = 0; y < BENCH_HEIGHT; y++) pixels[y*BENCH_WIDTH + x] = GetMixedColor(0xC8CCCCCC, pixels[y*BENCH_WIDTH + x]);
+    }
+    elapsed = GetBenchTime() - start;
+    printf("GetMixedColor per pixel %6.3f ms/frame | %5.2f ns/pixel\n", elapsed*1e3/BENCH_FRAMES, elapsed*1e9/((double)BENCH_FRAMES*count));
+
+    start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (int x = 0; x < BENCH_WIDTH; x++) FillPixelColumn(pixels + x, BENCH_WIDTH, BENCH_HEIGHT, 0xFF333333 + frame);
+    }
+    elapsed = GetBenchTime() - start;
+    printf("FillPixelColumn         %6.3f ms/frame | %5.2f ns/pixel\n", elapsed*1e3/BENCH_FRAMES, elapsed*1e9/((double)BENCH_FRAMES*count));
+
+    start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) FillPixels(pixels, count, 0xFF000000 + frame);
+    elapsed = GetBenchTime() - start;
+    printf("FillPixels              %6.3f ms/frame | %5.2f ns/pixel\n", elapsed*1e3/BENCH_FRAMES, elapsed*1e9/((double)BENCH_FRAMES*count));
+
+    unsigned char *indices = (unsigned char *)malloc(count);
+    for (int i = 0; i < count; i++) indices[i] = (unsigned char)(i*7);
+
+    start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) ExpandIndexedPixels(pixels, indices, count, expected);
+    elapsed = GetBenchTime() - start;
+    printf("ExpandIndexedPixels     %6.3f ms/frame | %5.2f ns/pixel\n", elapsed*1e3/BENCH_FRAMES, elapsed*1e9/((double)BENCH_FRAMES*count));
+
+    free(indices);
+    free(pixels);
+    free(expected);
+
+    return matches? 0 : 1;
+}
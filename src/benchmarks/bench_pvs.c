@@ -0,0 +1,223 @@
+/**********************************************************************************************
+*
+*   raycaster - Potentially visible sets benchmark
+*
+*   Measures the set precomputation, the encoded sets size against plain bitsets over the whole
+*   map, on a small map and a large one, the query cost and the map file round-trip of the sets.
+*   Sampled sets are compared to a dense build to count the tiles they miss, and a map without
+*   border walls checks hits out of the map are skipped.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "pvs.h"
+#include "jobs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_MAP_SIZE 48
+#define BENCH_LARGE_MAP_SIZE 256
+#define BENCH_LARGE_SAMPLES 1           // Sampling of the large map, keeps its build in seconds
+#define BENCH_LARGE_RAYS 180
+#define BENCH_MISS_MAP_SIZE 24
+#define BENCH_MISS_SAMPLES 8            // Dense build the sampled sets are compared to
+#define BENCH_MISS_RAYS 4096
+#define BENCH_QUERIES 1000000
+#define BENCH_MAP_FILE "bench_pvs.rcmp"
+
+static MapPvs *RunBuildBenchmark(const Map *map, int samples, int rays)
+{
+    double start = GetBenchTime();
+    MapPvs *pvs = BuildMapPvs(map, samples, rays);
+    double elapsed = GetBenchTime() - start;
+
+    printf("BuildMapPvs threads: %2i | %ix%i samples, %4i rays | %8.1f ms | %6.1f us/tile\n", GetJobWorkersCount() + 1,
+        samples, samples, rays, elapsed*1e3, elapsed*1e6/(map->numCols*map->numRows));
+
+    return pvs;
+}
+
+// Encoded size against bitsets of every tile over the whole map
+static void PrintPvsSize(const Map *map, const MapPvs *pvs)
+{
+    long tilesCount = (long)map->numCols*map->numRows;
+    long bitsetsSize = tilesCount*((tilesCount + 7)/8);
+    long size = pvs->dataSize + (tilesCount + 1)*(long)sizeof(int);
+    int runsSets = 0;
+    int sets = 0;
+
+    for (long i = 0; i < tilesCount; i++)
+    {
+        if (pvs->offsets[i] == pvs->offsets[i + 1]) continue;
+
+        runsSets += (pvs->data[pvs->offsets[i]] == PVS_ENCODING_RUNS);
+        sets++;
+    }
+
+    printf("Size: %li bytes (%i sets, %i as runs, %li offsets bytes) | plain bitsets %li bytes | %.1fx smaller\n",
+        size, sets, runsSets, (tilesCount + 1)*(long)sizeof(int), bitsetsSize, (double)bitsetsSize/size);
+}
+
+// Visible tiles per empty tile
+static void PrintPvsVisibility(const Map *map, const MapPvs *pvs, int *tiles)
+{
+    int tilesCount = map->numCols*map->numRows;
+    long visibleTotal = 0;
+    int emptyTiles = 0;
+
+    for (int i = 0; i < tilesCount; i++)
+    {
+        if (map->tiles[i] != TILE_EMPTY) continue;
+
+        visibleTotal += GetPvsTiles(pvs, i%map->numCols, i/map->numCols, tiles, tilesCount);
+        emptyTiles++;
+    }
+
+    printf("Visible tiles per empty tile: %.1f of %i (%.1f%%)\n", (double)visibleTotal/emptyTiles, tilesCount, 100.0*visibleTotal/((double)emptyTiles*tilesCount));
+}
+
+// Count the tiles of a dense build the default sampling misses, they must be seen from somewhere in the tile
+static void RunMissBenchmark(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MISS_MAP_SIZE, BENCH_MISS_MAP_SIZE, 0.2f, 9);
+    const Map *map = &benchMap->map;
+    int tilesCount = map->numCols*map->numRows;
+
+    MapPvs *pvs = BuildMapPvs(map, PVS_DEFAULT_SAMPLES, PVS_DEFAULT_RAYS);
+    MapPvs *dense = BuildMapPvs(map, BENCH_MISS_SAMPLES, BENCH_MISS_RAYS);
+    int *tiles = (int *)malloc(tilesCount*sizeof(int));
+    long denseTotal = 0;
+    long missed = 0;
+    int setsMissing = 0;
+
+    for (int i = 0; i < tilesCount; i++)
+    {
+        int count = GetPvsTiles(dense, i%map->numCols, i/map->numCols, tiles, tilesCount);
+        int setMissed = 0;
+
+        for (int t = 0; t < count; t++) setMissed += !IsTileInPvs(pvs, i%map->numCols, i/map->numCols, tiles[t]%map->numCols, tiles[t]/map->numCols);
+
+        denseTotal += count;
+        missed += setMissed;
+        setsMissing += (setMissed > 0);
+    }
+
+    printf("Missed against a %ix%i samples, %i rays build (%ix%i map): %li of %li visible tiles (%.3f%%), in %i sets\n", BENCH_MISS_SAMPLES,
+        BENCH_MISS_SAMPLES, BENCH_MISS_RAYS, BENCH_MISS_MAP_SIZE, BENCH_MISS_MAP_SIZE, missed, denseTotal, 100.0*missed/denseTotal, setsMissing);
+
+    free(tiles);
+    UnloadMapPvs(dense);
+    UnloadMapPvs(pvs);
+    UnloadBenchMap(benchMap);
+}
+
+// Build on an open map without border walls, rays leave the map
+static bool RunBorderlessCheck(void)
+{
+    int tiles[16] = { 0 };
+    Map map = { .numCols = 4, .numRows = 4, .tiles = tiles };
+
+    MapPvs *pvs = BuildMapPvs(&map, PVS_DEFAULT_SAMPLES, PVS_DEFAULT_RAYS);
+    int listed[16] = { 0 };
+    bool passed = (GetPvsTiles(pvs, 1, 1, listed, 16) == 16) && IsTileInPvs(pvs, 0, 0, 3, 3) && !IsTileInPvs(pvs, 0, 0, 4, 0);
+
+    printf("Map without border walls: %s\n", passed? "OK" : "FAILED");
+
+    UnloadMapPvs(pvs);
+
+    return passed;
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.12f, 42);
+    const Map *map = &benchMap->map;
+    int tilesCount = map->numCols*map->numRows;
+
+    printf("Potentially visible sets of a %ix%i map\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE);
+
+    UnloadMapPvs(RunBuildBenchmark(map, PVS_DEFAULT_SAMPLES, PVS_DEFAULT_RAYS));
+
+    InitJobSystem(-1);
+    MapPvs *pvs = RunBuildBenchmark(map, PVS_DEFAULT_SAMPLES, PVS_DEFAULT_RAYS);
+
+    int *tiles = (int *)malloc(tilesCount*sizeof(int));
+    PrintPvsVisibility(map, pvs, tiles);
+    PrintPvsSize(map, pvs);
+
+    // Random tile pair queries
+    uint32_t seed = 5;
+    int visible = 0;
+    double start = GetBenchTime();
+
+    for (int i = 0; i < BENCH_QUERIES; i++)
+    {
+        int from = (int)(GetBenchRandom(&seed)*tilesCount);
+        int to = (int)(GetBenchRandom(&seed)*tilesCount);
+        visible += IsTileInPvs(pvs, from%map->numCols, from/map->numCols, to%map->numCols, to/map->numCols);
+    }
+
+    double elapsed = GetBenchTime() - start;
+    printf("IsTileInPvs    %6.1f ns/query (visible %i)\n", elapsed*1e9/BENCH_QUERIES, visible);
+
+    start = GetBenchTime();
+    long listed = 0;
+
+    for (int i = 0; i < BENCH_QUERIES/100; i++)
+    {
+        int from = (int)(GetBenchRandom(&seed)*tilesCount);
+        listed += GetPvsTiles(pvs, from%map->numCols, from/map->numCols, tiles, tilesCount);
+    }
+
+    elapsed = GetBenchTime() - start;
+    printf("GetPvsTiles    %6.1f ns/query | %5.2f ns/tile\n", elapsed*1e9/(BENCH_QUERIES/100), (listed > 0)? elapsed*1e9/listed : 0.0);
+
+    // Map file round-trip, then sets dropped once the tiles change
+    remove(BENCH_MAP_FILE);
+    bool exported = ExportMap(map, BENCH_MAP_FILE) && ExportMapPvs(pvs, BENCH_MAP_FILE) && ExportMap(map, BENCH_MAP_FILE);
+    Map loadedMap = LoadMap(BENCH_MAP_FILE);
+    MapPvs *loaded = LoadMapPvs(&loadedMap, BENCH_MAP_FILE);
+
+    bool matches = exported && (loaded != NULL) && (loaded->dataSize == pvs->dataSize) &&
+        (memcmp(loaded->offsets, pvs->offsets, (tilesCount + 1)*sizeof(int)) == 0) && (memcmp(loaded->data, pvs->data, pvs->dataSize) == 0) &&
+        (loadedMap.numCols == map->numCols) && (loadedMap.numRows == map->numRows) && (memcmp(loadedMap.tiles, map->tiles, tilesCount*sizeof(int)) == 0);
+
+    printf("Map file round-trip: %s\n", matches? "OK" : "FAILED");
+
+    benchMap->tiles[tilesCount/2] = (benchMap->tiles[tilesCount/2] == TILE_EMPTY)? TILE_WALL : TILE_EMPTY;
+    MapPvs *stale = (ExportMap(map, BENCH_MAP_FILE))? LoadMapPvs(&loadedMap, BENCH_MAP_FILE) : NULL;
+    bool dropped = (stale == NULL);
+    benchMap->tiles[tilesCount/2] = loadedMap.tiles[tilesCount/2];
+
+    printf("Sets dropped after a tile change: %s\n", dropped? "OK" : "FAILED");
+
+    remove(BENCH_MAP_FILE);
+    UnloadMapPvs(stale);
+    UnloadMap(loadedMap);
+    UnloadMapPvs(loaded);
+    UnloadMapPvs(pvs);
+    free(tiles);
+
+    // Large map, sets grow with what is visible
+    BenchMap *largeMap = LoadBenchMap(BENCH_LARGE_MAP_SIZE, BENCH_LARGE_MAP_SIZE, 0.3f, 42);
+    int *largeTiles = (int *)malloc(BENCH_LARGE_MAP_SIZE*BENCH_LARGE_MAP_SIZE*sizeof(int));
+
+    printf("Potentially visible sets of a %ix%i map\n", BENCH_LARGE_MAP_SIZE, BENCH_LARGE_MAP_SIZE);
+
+    MapPvs *largePvs = RunBuildBenchmark(&largeMap->map, BENCH_LARGE_SAMPLES, BENCH_LARGE_RAYS);
+    PrintPvsVisibility(&largeMap->map, largePvs, largeTiles);
+    PrintPvsSize(&largeMap->map, largePvs);
+
+    free(largeTiles);
+    UnloadMapPvs(largePvs);
+    UnloadBenchMap(largeMap);
+    CloseJobSystem();
+
+    RunMissBenchmark();
+    bool borderless = RunBorderlessCheck();
+
+    UnloadBenchMap(benchMap);
+
+    return (matches && dropped && borderless)? 0 : 1;
+}
@@ -0,0 +1,95 @@
+/**********************************************************************************************
+*
+*   raycaster - Ray casting benchmark
+*
+*   Measures single ray queries like the renderer casts them, and batches of line of sight
+*   checks between random points, on the calling thread and over the job system workers.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "raycast.h"
+#include "jobs.h"
+
+#include <stdio.h>
+#include <float.h>
+
+#define BENCH_MAP_SIZE 64
+#define BENCH_RAYS 100000
+#define BENCH_LOS_QUERIES 10000
+#define BENCH_LOS_TICKS 50
+#define BENCH_MAX_HITS 10
+
+static void RunRayQueryBenchmark(const Map *map, int flags, const char *label)
+{
+    static WallHit hits[BENCH_MAX_HITS];
+    uint32_t seed = 7;
+    long totalHits = 0;
+
+    double start = GetBenchTime();
+
+    for (int i = 0; i < BENCH_RAYS; i++)
+    {
+        RayQuery query = { .originX = (1.5f + GetBenchRandom(&seed)*(map->numCols - 3))*TILE_SIZE,
+            .originY = (1.5f + GetBenchRandom(&seed)*(map->numRows - 3))*TILE_SIZE, .angle = GetBenchRandom(&seed)*TWO_PI,
+            .maxDistance = FLT_MAX, .flags = flags, .maxTranslucentWalls = 0 };
+        totalHits += CastRayQuery(map, &query, hits, BENCH_MAX_HITS);
+    }
+
+    double elapsed = GetBenchTime() - start;
+
+    printf("CastRayQuery %-22s | %7.1f ns/ray | %5.2f hits/ray\n", label, elapsed*1e9/BENCH_RAYS, (double)totalHits/BENCH_RAYS);
+}
+
+static void RunLineOfSightBenchmark(const Map *map, const LineOfSightQuery *queries, bool *results)
+{
+    double start = GetBenchTime();
+    for (int tick = 0; tick < BENCH_LOS_TICKS; tick++) CheckLineOfSightBatch(map, queries, BENCH_LOS_QUERIES, RAY_PASS_TRANSLUCENT, results);
+    double elapsed = GetBenchTime() - start;
+
+    int visible = 0;
+    for (int i = 0; i < BENCH_LOS_QUERIES; i++) visible += results[i];
+
+    printf("CheckLineOfSightBatch threads: %2i | %i queries: %7.3f ms/tick | %6.1f ns/query | visible: %4.1f%%\n",
+        GetJobWorkersCount() + 1, BENCH_LOS_QUERIES, elapsed*1e3/BENCH_LOS_TICKS, elapsed*1e9/((double)BENCH_LOS_TICKS*BENCH_LOS_QUERIES),
+        100.0*visible/BENCH_LOS_QUERIES);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.08f, 42);
+    const Map *map = &benchMap->map;
+
+    printf("Ray queries on a %ix%i map\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE);
+
+    RunRayQueryBenchmark(map, 0, "(first wall)");
+    RunRayQueryBenchmark(map, RAY_PASS_TRANSLUCENT | RAY_PASS_PORTALS, "(renderer)");
+    RunRayQueryBenchmark(map, RAY_PASS_TRANSLUCENT | RAY_REPORT_BLOCKING_ONLY, "(occlusion)");
+
+    // Lines of sight between random points no farther than 12 tiles apart
+    LineOfSightQuery *queries = (LineOfSightQuery *)malloc(BENCH_LOS_QUERIES*sizeof(LineOfSightQuery));
+    bool *results = (bool *)malloc(BENCH_LOS_QUERIES*sizeof(bool));
+    uint32_t seed = 11;
+
+    for (int i = 0; i < BENCH_LOS_QUERIES; i++)
+    {
+        float fromX = (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE;
+        float fromY = (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE;
+        float angle = GetBenchRandom(&seed)*TWO_PI;
+        float distance = GetBenchRandom(&seed)*12*TILE_SIZE;
+
+        queries[i] = (LineOfSightQuery){ fromX, fromY, fromX + cosf(angle)*distance, fromY + sinf(angle)*distance };
+    }
+
+    RunLineOfSightBenchmark(map, queries, results);
+
+    InitJobSystem(-1);
+    if (GetJobWorkersCount() > 0) RunLineOfSightBenchmark(map, queries, results);
+    CloseJobSystem();
+
+    free(queries);
+    free(results);
+    UnloadBenchMap(benchMap);
+
+    return 0;
+}
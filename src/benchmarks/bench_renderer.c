@@ -0,0 +1,377 @@
+/**********************************************************************************************
+*
+*   raycaster - Renderer benchmark
+*
+*   Measures a full window view, the 4-way split-screen and four full window views rendered
+*   together, on the calling thread and over the job system workers. A full window view is also
+*   measured with every combination of color, indexed, depth and hit information outputs, and on a map
+*   of stacked translucent walls, where most of the walls a ray could traverse are hidden. Both
+*   maps are measured casting a ray every 1 to 16 columns, counting the rays cast per frame, and
+*   with the face walk method at horizontal resolutions of 960 to 3840 columns.
+*
+*   The cast, project and upload stages of single threaded frames are profiled with the hardware
+*   counters when the system allows them (perf_event_open() on Linux), timings only otherwise.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "renderer.h"
+#include "jobs.h"
+#include "pixels.h"
+#include "counters.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_MAP_SIZE 32
+#define BENCH_WIDTH 960
+#define BENCH_HEIGHT 624
+#define BENCH_FOV (60*(PI/180))
+#define BENCH_FRAMES 100
+#define BENCH_VIEWS 4
+#define BENCH_TRANSLUCENT_DENSITY 0.3f
+
+static void RunRenderBenchmark(RenderContext **views, int count, const char *label)
+{
+    uint32_t seed = 17;
+    double start = GetBenchTime();
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            views[i]->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+                (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*TWO_PI };
+        }
+
+        RenderViews(views, count);
+    }
+
+    double elapsed = GetBenchTime() - start;
+
+    printf("%-24s threads: %2i | %7.3f ms/frame | %7.1f FPS\n", label, GetJobWorkersCount() + 1, elapsed*1e3/BENCH_FRAMES, BENCH_FRAMES/elapsed);
+}
+
+static void RunRenderBenchmarks(RenderContext *fullView, RenderContext **splitViews, RenderContext **fullViews)
+{
+    RunRenderBenchmark(&fullView, 1, "1 view 960x624");
+    RunRenderBenchmark(splitViews, BENCH_VIEWS, "4-way split 480x312");
+    RunRenderBenchmark(fullViews, BENCH_VIEWS, "4 views 960x624");
+}
+
+static void RunOutputsBenchmarks(RenderContext *view)
+{
+    static const struct { int outputs; const char *label; } modes[] = {
+        { RENDER_OUTPUT_COLOR, "color" },
+        { RENDER_OUTPUT_INDEXED, "indexed" },
+        { RENDER_OUTPUT_COLOR | RENDER_OUTPUT_DEPTH | RENDER_OUTPUT_HIT_INFO, "color+depth+hit info" },
+        { RENDER_OUTPUT_DEPTH | RENDER_OUTPUT_HIT_INFO, "depth+hit info" },
+        { RENDER_OUTPUT_DEPTH, "depth" }
+    };
+
+    for (int i = 0; i < (int)(sizeof(modes)/sizeof(modes[0])); i++)
+    {
+        SetRenderContextOutputs(view, modes[i].outputs);
+        RunRenderBenchmark(&view, 1, modes[i].label);
+    }
+
+    SetRenderContextOutputs(view, RENDER_OUTPUT_COLOR);
+}
+
+// Compare the indexed output of a view, expanded with its palette, to its color output
+static void RunIndexedBenchmark(RenderContext *view)
+{
+    int pixelsCount = view->width*view->height;
+    uint32_t *expanded = (uint32_t *)malloc(pixelsCount*sizeof(uint32_t));
+    int maxDifference = 0;
+    uint32_t seed = 31;
+
+    SetRenderContextOutputs(view, RENDER_OUTPUT_COLOR | RENDER_OUTPUT_INDEXED);
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*TWO_PI };
+        RenderView(view);
+        ExpandIndexedPixels(expanded, view->indices, pixelsCount, view->palette->colors);
+
+        for (int i = 0; i < pixelsCount; i++)
+        {
+            // Translucent color pixels are compared as shown, over black
+            uint32_t color = view->pixels[i];
+            int alpha = color >> 24;
+
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                int difference = abs((int)((expanded[i] >> shift) & 0xFF) - (int)(((color >> shift) & 0xFF)*alpha + 127)/255);
+                if (difference > maxDifference) maxDifference = difference;
+            }
+        }
+    }
+
+    double start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) ExpandIndexedPixels(expanded, view->indices, pixelsCount, view->palette->colors);
+    double elapsed = GetBenchTime() - start;
+
+    printf("indexed expansion %7.3f ms/frame | gray palette vs color max difference: %i\n", elapsed*1e3/BENCH_FRAMES, maxDifference);
+
+    SetRenderContextOutputs(view, RENDER_OUTPUT_COLOR);
+    free(expanded);
+}
+
+// Render random views with a cast interval, counting the rays cast, returns the ms per frame
+static double RunCastIntervalFrames(RenderContext *view, int interval, double *castsPerFrame)
+{
+    long long castsCount = 0;
+    uint32_t seed = 17;
+
+    view->castInterval = interval;
+
+    double start = GetBenchTime();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*TWO_PI };
+        RenderView(view);
+
+        for (int col = 0; col < view->width; col++) castsCount += view->columns[col].wasCast;
+    }
+    double elapsed = GetBenchTime() - start;
+
+    view->castInterval = 1;
+    *castsPerFrame = (double)castsCount/BENCH_FRAMES;
+
+    return elapsed*1e3/BENCH_FRAMES;
+}
+
+static void RunCastIntervalBenchmarks(RenderContext *view, const char *mapLabel)
+{
+    for (int interval = 1; interval <= 16; interval *= 2)
+    {
+        double castsPerFrame = 0.0;
+        double geometryCastsPerFrame = 0.0;
+        double colorTime = RunCastIntervalFrames(view, interval, &castsPerFrame);
+
+        // Without outputs rays stop at the first wall that is not a portal
+        int outputs = view->outputs;
+        SetRenderContextOutputs(view, 0);
+        double geometryTime = RunCastIntervalFrames(view, interval, &geometryCastsPerFrame);
+        SetRenderContextOutputs(view, outputs);
+
+        printf("%-11s cast interval %2i | color: %6.3f ms/frame, %5.1f rays (%5.1f%%) | no outputs: %6.3f ms/frame, %5.1f rays (%5.1f%%)\n",
+            mapLabel, interval, colorTime, castsPerFrame, 100.0*castsPerFrame/view->width,
+            geometryTime, geometryCastsPerFrame, 100.0*geometryCastsPerFrame/view->width);
+    }
+}
+
+// Render random views from the empty tiles of a map, counting the rays cast, returns the ms per frame
+static double RunFaceWalkFrames(RenderContext *view, const Map *map, double *castsPerFrame)
+{
+    long long castsCount = 0;
+    uint32_t seed = 17;
+    double elapsed = 0.0;
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        do
+        {
+            x = (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE;
+            y = (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE;
+        } while (MapHasWallAt(map, x, y));
+
+        view->camera = (RenderCamera){ x, y, GetBenchRandom(&seed)*TWO_PI };
+
+        double start = GetBenchTime();
+        RenderView(view);
+        elapsed += GetBenchTime() - start;
+
+        for (int col = 0; col < view->width; col++) castsCount += view->columns[col].wasCast;
+    }
+
+    *castsPerFrame = (double)castsCount/BENCH_FRAMES;
+
+    return elapsed*1e3/BENCH_FRAMES;
+}
+
+// Compare the face walk method to casting every column at growing widths, the height is kept
+static void RunFaceWalkBenchmarks(const Map *map, const char *mapLabel)
+{
+    MapEdges *edges = BuildMapEdges(map);
+
+    for (int width = BENCH_WIDTH; width <= 4*BENCH_WIDTH; width *= 2)
+    {
+        RenderContext *view = LoadRenderContext(map, width, BENCH_HEIGHT, BENCH_FOV);
+        double castsPerFrame = 0.0;
+        double times[2][2] = { 0 };     // [method][outputs]
+
+        view->edges = edges;
+
+        for (int method = RENDER_METHOD_RAYS; method <= RENDER_METHOD_FACES; method++)
+        {
+            SetRenderContextMethod(view, method);
+            SetRenderContextOutputs(view, RENDER_OUTPUT_COLOR);
+            times[method][0] = RunFaceWalkFrames(view, map, &castsPerFrame);
+            SetRenderContextOutputs(view, 0);
+            times[method][1] = RunFaceWalkFrames(view, map, &castsPerFrame);
+        }
+
+        printf("%-11s %4ix%i | color: rays %7.3f, walks %7.3f ms/frame | no outputs: rays %6.3f, walks %6.3f ms/frame, walks cast %5.1f rays (%4.2f%%)\n",
+            mapLabel, width, BENCH_HEIGHT, times[0][0], times[1][0], times[0][1], times[1][1], castsPerFrame, 100.0*castsPerFrame/width);
+
+        UnloadRenderContext(view);
+    }
+
+    UnloadMapEdges(edges);
+}
+
+// Run the stages of single threaded frames one by one, reporting their per frame averages
+// NOTE: Upload is the copy to the texture staging buffer, indexed views expand their palette
+static void RunStageCounters(RenderContext *view, const PerfCounters *counters, const char *label)
+{
+    enum { STAGE_CAST = 0, STAGE_PROJECT, STAGE_UPLOAD, STAGES_COUNT };
+    PerfStage stages[STAGES_COUNT] = {
+        { .name = "cast", .samplesCount = 0, .time = 0.0, .values = { 0 } },
+        { .name = "project", .samplesCount = 0, .time = 0.0, .values = { 0 } },
+        { .name = "upload", .samplesCount = 0, .time = 0.0, .values = { 0 } }
+    };
+    int pixelsCount = view->width*view->height;
+    uint32_t *upload = (uint32_t *)malloc(pixelsCount*sizeof(uint32_t));
+    uint32_t seed = 17;
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        PerfSample samples[STAGES_COUNT + 1] = { 0 };
+
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*TWO_PI };
+
+        ReadPerfCounters(counters, &samples[STAGE_CAST]);
+        CastRenderColumns(view);
+        ReadPerfCounters(counters, &samples[STAGE_PROJECT]);
+        ProjectRenderColumns(view);
+        ReadPerfCounters(counters, &samples[STAGE_UPLOAD]);
+        if (view->pixels != NULL) memcpy(upload, view->pixels, pixelsCount*sizeof(uint32_t));
+        else ExpandIndexedPixels(upload, view->indices, pixelsCount, view->palette->colors);
+        ReadPerfCounters(counters, &samples[STAGES_COUNT]);
+
+        for (int i = 0; i < STAGES_COUNT; i++) AddPerfStageSample(&stages[i], &samples[i], &samples[i + 1]);
+    }
+
+    for (int i = 0; i < STAGES_COUNT; i++)
+    {
+        const PerfStage *stage = &stages[i];
+
+        printf("%-20s %-7s %7.3f ms/frame", label, stage->name, stage->time*1e3/stage->samplesCount);
+
+        if (IsPerfCounterAvailable(counters, PERF_COUNTER_CYCLES) && IsPerfCounterAvailable(counters, PERF_COUNTER_INSTRUCTIONS))
+        {
+            printf(" | IPC %4.2f", stage->values[PERF_COUNTER_INSTRUCTIONS]/stage->values[PERF_COUNTER_CYCLES]);
+        }
+
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+        {
+            if (IsPerfCounterAvailable(counters, c)) printf(" | %s %9.1fK", GetPerfCounterName(c), stage->values[c]/stage->samplesCount/1e3);
+        }
+
+        printf("\n");
+    }
+
+    free(upload);
+}
+
+static void RunTranslucentBenchmark(const PerfCounters *counters)
+{
+    // Every inner wall translucent, rays go through several of them and the border portals
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, BENCH_TRANSLUCENT_DENSITY, 7);
+
+    for (int y = 1; y < BENCH_MAP_SIZE - 1; y++)
+    {
+        for (int x = 1; x < BENCH_MAP_SIZE - 1; x++)
+        {
+            if (benchMap->tiles[y*BENCH_MAP_SIZE + x] == TILE_WALL) benchMap->tiles[y*BENCH_MAP_SIZE + x] = TILE_TRANSLUCENT;
+        }
+    }
+
+    RenderContext *view = LoadRenderContext(&benchMap->map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+    long long wallsCount = 0;
+    uint32_t seed = 17;
+
+    RunRenderBenchmark(&view, 1, "translucent 960x624");
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        view->camera = (RenderCamera){ (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE,
+            (1.5f + GetBenchRandom(&seed)*(BENCH_MAP_SIZE - 3))*TILE_SIZE, GetBenchRandom(&seed)*TWO_PI };
+        RenderView(view);
+
+        for (int col = 0; col < BENCH_WIDTH; col++) wallsCount += view->columns[col].wallsCount;
+    }
+
+    printf("walls cast per column: %.2f\n", (double)wallsCount/((double)BENCH_FRAMES*BENCH_WIDTH));
+
+    RunCastIntervalBenchmarks(view, "translucent");
+    RunFaceWalkBenchmarks(&benchMap->map, "translucent");
+    RunStageCounters(view, counters, "translucent color");
+
+    UnloadRenderContext(view);
+    UnloadBenchMap(benchMap);
+}
+
+int main(void)
+{
+    BenchMap *benchMap = LoadBenchMap(BENCH_MAP_SIZE, BENCH_MAP_SIZE, 0.08f, 42);
+    RenderContext *fullView = LoadRenderContext(&benchMap->map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+    RenderPalette *palette = LoadRenderPalette(NULL, 0);
+    RenderContext *splitViews[BENCH_VIEWS] = { 0 };
+    RenderContext *fullViews[BENCH_VIEWS] = { 0 };
+
+    for (int i = 0; i < BENCH_VIEWS; i++)
+    {
+        splitViews[i] = LoadRenderContext(&benchMap->map, BENCH_WIDTH/2, BENCH_HEIGHT/2, BENCH_FOV);
+        fullViews[i] = LoadRenderContext(&benchMap->map, BENCH_WIDTH, BENCH_HEIGHT, BENCH_FOV);
+    }
+
+    PerfCounters *counters = LoadPerfCounters();
+
+    printf("Render contexts on a %ix%i map\n", BENCH_MAP_SIZE, BENCH_MAP_SIZE);
+    if (counters->availableCount > 0) printf("Hardware counters: %i of %i available\n", counters->availableCount, PERF_COUNTER_COUNT);
+    else printf("Hardware counters unavailable, stages report timings only\n");
+
+    fullView->palette = palette;
+
+    RunRenderBenchmarks(fullView, splitViews, fullViews);
+    RunOutputsBenchmarks(fullView);
+    RunIndexedBenchmark(fullView);
+    RunCastIntervalBenchmarks(fullView, "default");
+    RunFaceWalkBenchmarks(&benchMap->map, "default");
+
+    RunStageCounters(fullView, counters, "default color");
+    SetRenderContextOutputs(fullView, RENDER_OUTPUT_INDEXED);
+    RunStageCounters(fullView, counters, "default indexed");
+    SetRenderContextOutputs(fullView, RENDER_OUTPUT_COLOR);
+
+    RunTranslucentBenchmark(counters);
+
+    InitJobSystem(-1);
+    if (GetJobWorkersCount() > 0)
+    {
+        RunRenderBenchmarks(fullView, splitViews, fullViews);
+        RunOutputsBenchmarks(fullView);
+    }
+    CloseJobSystem();
+
+    UnloadRenderContext(fullView);
+    UnloadRenderPalette(palette);
+    for (int i = 0; i < BENCH_VIEWS; i++)
+    {
+        UnloadRenderContext(splitViews[i]);
+        UnloadRenderContext(fullViews[i]);
+    }
+    UnloadBenchMap(benchMap);
+    UnloadPerfCounters(counters);
+
+    return 0;
+}
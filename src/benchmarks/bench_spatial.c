@@ -0,0 +1,235 @@
+/**********************************************************************************************
+*
+*   raycaster - Spatial hash benchmark
+*
+*   Moves 100K objects bouncing around a 256x256 tiles area and keeps a spatial hash up to
+*   date every frame, against clearing and refilling it. Radius, nearest object and tile
+*   queries are timed single and in batches, and checked against a brute force scan.
+*
+**********************************************************************************************/
+
+#include "bench.h"
+#include "spatial.h"
+#include "jobs.h"
+
+#include <stdio.h>
+
+#define BENCH_AREA_SIZE 256             // Tiles
+#define BENCH_OBJECTS 100000
+#define BENCH_FRAMES 100
+#define BENCH_FRAME_TIME (1.0f/60.0f)
+#define BENCH_QUERIES 10000
+#define BENCH_QUERY_RADIUS (2.0f*TILE_SIZE)
+#define BENCH_MAX_IDS 256               // Ids per radius query of the batches
+#define BENCH_CHECKS 500
+
+typedef struct BenchObjects
+{
+    float x[BENCH_OBJECTS];
+    float y[BENCH_OBJECTS];
+    float velocityX[BENCH_OBJECTS];
+    float velocityY[BENCH_OBJECTS];
+}
+BenchObjects;
+
+static BenchObjects objects = { 0 };
+static SpatialQuery queries[BENCH_QUERIES] = { 0 };
+static int queryIds[BENCH_QUERIES*BENCH_MAX_IDS] = { 0 };
+static int queryCounts[BENCH_QUERIES] = { 0 };
+static int nearestIds[BENCH_QUERIES] = { 0 };
+
+static void MoveBenchObjects(void)
+{
+    const float size = (float)(BENCH_AREA_SIZE*TILE_SIZE);
+
+    for (int i = 0; i < BENCH_OBJECTS; i++)
+    {
+        objects.x[i] += objects.velocityX[i]*BENCH_FRAME_TIME;
+        objects.y[i] += objects.velocityY[i]*BENCH_FRAME_TIME;
+
+        if ((objects.x[i] < 0.0f) || (objects.x[i] >= size))
+        {
+            objects.velocityX[i] = -objects.velocityX[i];
+            objects.x[i] = fminf(fmaxf(objects.x[i], 0.0f), size - 1.0f);
+        }
+        if ((objects.y[i] < 0.0f) || (objects.y[i] >= size))
+        {
+            objects.velocityY[i] = -objects.velocityY[i];
+            objects.y[i] = fminf(fmaxf(objects.y[i], 0.0f), size - 1.0f);
+        }
+    }
+}
+
+static void RunUpdateBenchmark(SpatialGrid *grid, bool rebuild)
+{
+    double updateTime = 0.0;
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        MoveBenchObjects();
+
+        double start = GetBenchTime();
+
+        if (rebuild)
+        {
+            ClearSpatialGrid(grid);
+            for (int i = 0; i < BENCH_OBJECTS; i++) InsertSpatialObject(grid, i, objects.x[i], objects.y[i]);
+        }
+        else
+        {
+            for (int i = 0; i < BENCH_OBJECTS; i++) MoveSpatialObject(grid, i, objects.x[i], objects.y[i]);
+        }
+
+        updateTime += GetBenchTime() - start;
+    }
+
+    printf("%-12s | %7.3f ms/frame | %5.1f ns/object\n", rebuild? "rebuild" : "incremental",
+        updateTime*1e3/BENCH_FRAMES, updateTime*1e9/((double)BENCH_FRAMES*BENCH_OBJECTS));
+}
+
+static void RunQueryBenchmark(const SpatialGrid *grid)
+{
+    int found = 0;
+    double start = GetBenchTime();
+    for (int i = 0; i < BENCH_QUERIES; i++) found += QuerySpatialRadius(grid, queries[i].x, queries[i].y, queries[i].radius, queryIds, BENCH_MAX_IDS);
+    double radiusTime = GetBenchTime() - start;
+
+    start = GetBenchTime();
+    QuerySpatialRadiusBatch(grid, queries, BENCH_QUERIES, queryIds, BENCH_MAX_IDS, queryCounts);
+    double radiusBatchTime = GetBenchTime() - start;
+
+    start = GetBenchTime();
+    for (int i = 0; i < BENCH_QUERIES; i++) nearestIds[i] = FindNearestSpatialObject(grid, queries[i].x, queries[i].y, 8.0f*TILE_SIZE, -1);
+    double nearestTime = GetBenchTime() - start;
+
+    for (int i = 0; i < BENCH_QUERIES; i++) queries[i].radius = 8.0f*TILE_SIZE;
+    start = GetBenchTime();
+    FindNearestSpatialObjectBatch(grid, queries, BENCH_QUERIES, nearestIds);
+    double nearestBatchTime = GetBenchTime() - start;
+    for (int i = 0; i < BENCH_QUERIES; i++) queries[i].radius = BENCH_QUERY_RADIUS;
+
+    int occupied = 0;
+    start = GetBenchTime();
+    for (int i = 0; i < BENCH_QUERIES; i++) occupied += GetSpatialTileObjects(grid, (int)(queries[i].x/TILE_SIZE), (int)(queries[i].y/TILE_SIZE), queryIds, BENCH_MAX_IDS);
+    double tileTime = GetBenchTime() - start;
+    (void)occupied;
+
+    printf("threads: %2i | radius %6.1f ns/query (%.1f objects), batch %6.1f | nearest %6.1f ns/query, batch %6.1f | tile %5.1f ns/query\n",
+        GetJobWorkersCount() + 1, radiusTime*1e9/BENCH_QUERIES, (double)found/BENCH_QUERIES, radiusBatchTime*1e9/BENCH_QUERIES,
+        nearestTime*1e9/BENCH_QUERIES, nearestBatchTime*1e9/BENCH_QUERIES, tileTime*1e9/BENCH_QUERIES);
+}
+
+// Compare the queries to a scan of all the objects
+static void CheckQueries(const SpatialGrid *grid)
+{
+    static char listed[BENCH_OBJECTS] = { 0 };
+    int mismatches = 0;
+    double scanTime = 0.0;
+
+    QuerySpatialRadiusBatch(grid, queries, BENCH_CHECKS, queryIds, BENCH_MAX_IDS, queryCounts);
+
+    for (int q = 0; q < BENCH_CHECKS; q++)
+    {
+        const SpatialQuery *query = &queries[q];
+        float radiusSquared = query->radius*query->radius;
+        int expected = 0;
+        int nearest = -1;
+        float nearestDistance = 64.0f*TILE_SIZE*TILE_SIZE;      // 8 tiles squared
+
+        for (int i = 0; i < queryCounts[q]; i++) listed[queryIds[q*BENCH_MAX_IDS + i]]++;
+
+        double start = GetBenchTime();
+        for (int i = 0; i < BENCH_OBJECTS; i++)
+        {
+            float dx = objects.x[i] - query->x;
+            float dy = objects.y[i] - query->y;
+            float distance = dx*dx + dy*dy;
+
+            if (distance <= radiusSquared)
+            {
+                expected++;
+                mismatches += (listed[i] != 1);
+            }
+            if (distance <= nearestDistance)
+            {
+                nearestDistance = distance;
+                nearest = i;
+            }
+        }
+        scanTime += GetBenchTime() - start;
+
+        for (int i = 0; i < queryCounts[q]; i++) listed[queryIds[q*BENCH_MAX_IDS + i]] = 0;
+        mismatches += (expected != queryCounts[q]);
+
+        // Ties may pick another object at the same distance
+        int found = FindNearestSpatialObject(grid, query->x, query->y, 8.0f*TILE_SIZE, -1);
+        if ((found < 0) || (nearest < 0)) mismatches += (found != nearest);
+        else
+        {
+            float dx = objects.x[found] - query->x;
+            float dy = objects.y[found] - query->y;
+            mismatches += (dx*dx + dy*dy != nearestDistance);
+        }
+
+        int tileX = (int)floorf(query->x/TILE_SIZE);
+        int tileY = (int)floorf(query->y/TILE_SIZE);
+        int onTile = 0;
+        for (int i = 0; i < BENCH_OBJECTS; i++) onTile += ((int)floorf(objects.x[i]/TILE_SIZE) == tileX) && ((int)floorf(objects.y[i]/TILE_SIZE) == tileY);
+        mismatches += (onTile != GetSpatialTileObjects(grid, tileX, tileY, queryIds, BENCH_MAX_IDS));
+    }
+
+    printf("queries: %s (%i mismatches in %i checks) | brute force scan: %.1f us/query\n", (mismatches == 0)? "match" : "DIFFER",
+        mismatches, BENCH_CHECKS, scanTime*1e6/BENCH_CHECKS);
+}
+
+int main(void)
+{
+    uint32_t seed = 99;
+
+    for (int i = 0; i < BENCH_OBJECTS; i++)
+    {
+        float angle = GetBenchRandom(&seed)*6.2831853f;
+        float speed = 20.0f + GetBenchRandom(&seed)*280.0f;
+
+        objects.x[i] = GetBenchRandom(&seed)*BENCH_AREA_SIZE*TILE_SIZE;
+        objects.y[i] = GetBenchRandom(&seed)*BENCH_AREA_SIZE*TILE_SIZE;
+        objects.velocityX[i] = cosf(angle)*speed;
+        objects.velocityY[i] = sinf(angle)*speed;
+    }
+
+    for (int i = 0; i < BENCH_QUERIES; i++)
+    {
+        queries[i].x = GetBenchRandom(&seed)*BENCH_AREA_SIZE*TILE_SIZE;
+        queries[i].y = GetBenchRandom(&seed)*BENCH_AREA_SIZE*TILE_SIZE;
+        queries[i].radius = BENCH_QUERY_RADIUS;
+    }
+
+    SpatialGrid *grid = LoadSpatialGrid(BENCH_OBJECTS);
+    for (int i = 0; i < BENCH_OBJECTS; i++) InsertSpatialObject(grid, i, objects.x[i], objects.y[i]);
+
+    printf("Spatial hash of %i objects over %ix%i tiles, %i buckets, %i frames\n", BENCH_OBJECTS, BENCH_AREA_SIZE, BENCH_AREA_SIZE,
+        grid->bucketsCount, BENCH_FRAMES);
+
+    RunUpdateBenchmark(grid, false);
+    RunUpdateBenchmark(grid, true);
+
+    RunQueryBenchmark(grid);
+    InitJobSystem(-1);
+    RunQueryBenchmark(grid);
+    CheckQueries(grid);
+    CloseJobSystem();
+
+    // Remove every other object and check again
+    for (int i = 0; i < BENCH_OBJECTS; i += 2)
+    {
+        RemoveSpatialObject(grid, i);
+        objects.x[i] = -1e9f;
+        objects.y[i] = -1e9f;
+    }
+    printf("after removing half: %i objects | ", grid->count);
+    CheckQueries(grid);
+
+    UnloadSpatialGrid(grid);
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+/**********************************************************************************************
+*
+*   raycaster - Asset bundle
+*
+*   Pre-decoded assets in one file, mapped read-only at startup.
+*
+**********************************************************************************************/
+
+#include "bundle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Map the bundle where POSIX mmap() is available, read it into memory otherwise
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    #define BUNDLE_MMAP_SUPPORTED
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BUNDLE_TABLE_OFFSET 16          // Assets table, after the identifier, version and assets count padded to 16 bytes
+#define BUNDLE_ASSET_SIZE 120           // Assets table entry
+#define BUNDLE_MAX_IMAGE_FORMAT 10      // Uncompressed raylib PixelFormat values, 1 to 10 in every raylib version
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static uint32_t ReadBundleUint32(const unsigned char *bytes);
+static uint64_t ReadBundleUint64(const unsigned char *bytes);
+static void WriteBundleUint32(unsigned char *bytes, uint32_t value);
+static void WriteBundleUint64(unsigned char *bytes, uint64_t value);
+static void ReadBundleAsset(const unsigned char *bytes, BundleAsset *asset);
+static void WriteBundleAsset(unsigned char *bytes, const BundleAsset *asset);
+static bool IsBundleValid(const unsigned char *data, size_t size);
+static bool IsBundleAssetValid(const BundleAsset *asset, size_t size);
+
+//----------------------------------------------------------------------------------
+// Asset Bundle Functions Definition
+//----------------------------------------------------------------------------------
+
+// Map a bundle file, every asset is checked to be inside the file and to hold its pixels or samples
+AssetBundle *LoadAssetBundle(const char *fileName)
+{
+    unsigned char *data = NULL;
+    size_t size = 0;
+    bool isMapped = false;
+
+#if defined(BUNDLE_MMAP_SUPPORTED)
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat status = { 0 };
+    if ((fstat(fd, &status) == 0) && (status.st_size > 0))
+    {
+        void *mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            data = (unsigned char *)mapping;
+            size = (size_t)status.st_size;
+            isMapped = true;
+        }
+    }
+
+    close(fd);      // The mapping keeps the file
+#else
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize > 0)
+    {
+        data = (unsigned char *)malloc((size_t)fileSize);
+        size = (size_t)fileSize;
+
+        if (fread(data, 1, size, file) != size)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+#endif
+
+    if (data == NULL) return NULL;
+
+    BundleAsset *assets = NULL;
+    int assetsCount = 0;
+    bool valid = IsBundleValid(data, size);
+
+    if (valid)
+    {
+        assetsCount = (int)ReadBundleUint32(data + 8);
+        assets = (BundleAsset *)calloc(assetsCount + 1, sizeof(BundleAsset));
+
+        for (int i = 0; valid && (i < assetsCount); i++)
+        {
+            ReadBundleAsset(data + BUNDLE_TABLE_OFFSET + (size_t)i*BUNDLE_ASSET_SIZE, &assets[i]);
+            valid = IsBundleAssetValid(&assets[i], size);
+        }
+    }
+
+    if (!valid)
+    {
+        free(assets);
+#if defined(BUNDLE_MMAP_SUPPORTED)
+        munmap(data, size);
+#else
+        free(data);
+#endif
+        return NULL;
+    }
+
+    AssetBundle *bundle = (AssetBundle *)calloc(1, sizeof(AssetBundle));
+
+    bundle->data = data;
+    bundle->size = size;
+    bundle->assets = assets;
+    bundle->assetsCount = assetsCount;
+    bundle->isMapped = isMapped;
+
+    return bundle;
+}
+
+// Unmap a bundle
+void UnloadAssetBundle(AssetBundle *bundle)
+{
+    if (bundle == NULL) return;
+
+#if defined(BUNDLE_MMAP_SUPPORTED)
+    if (bundle->isMapped) munmap((void *)bundle->data, bundle->size);
+    else free((void *)bundle->data);
+#else
+    free((void *)bundle->data);
+#endif
+
+    free((void *)bundle->assets);
+    free(bundle);
+}
+
+// Find an asset by name
+const BundleAsset *GetBundleAsset(const AssetBundle *bundle, const char *name)
+{
+    if (bundle == NULL) return NULL;
+
+    for (int i = 0; i < bundle->assetsCount; i++)
+    {
+        if (strncmp(bundle->assets[i].name, name, BUNDLE_NAME_SIZE) == 0) return &bundle->assets[i];
+    }
+
+    return NULL;
+}
+
+const void *GetBundleAssetData(const AssetBundle *bundle, const BundleAsset *asset)
+{
+    return bundle->data + asset->offset;
+}
+
+// Write a bundle: header, assets table and the prefix and data of every asset, aligned
+bool ExportAssetBundle(const char *fileName, BundleAsset *assets, const void **data, const void **prefixes, int count)
+{
+    static const unsigned char padding[BUNDLE_ALIGNMENT] = { 0 };
+
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL) return false;
+
+    // Data offsets, every asset data aligned after its prefix
+    uint64_t offset = BUNDLE_TABLE_OFFSET + (uint64_t)count*BUNDLE_ASSET_SIZE;
+
+    for (int i = 0; i < count; i++)
+    {
+        offset += assets[i].prefixSize;
+        offset = (offset + BUNDLE_ALIGNMENT - 1) & ~(uint64_t)(BUNDLE_ALIGNMENT - 1);
+        assets[i].offset = offset;
+        offset += assets[i].size;
+    }
+
+    unsigned char header[BUNDLE_TABLE_OFFSET] = { 'R', 'C', 'B', 'N' };
+    unsigned char *table = (unsigned char *)calloc((size_t)count + 1, BUNDLE_ASSET_SIZE);
+    uint64_t position = BUNDLE_TABLE_OFFSET + (uint64_t)count*BUNDLE_ASSET_SIZE;
+
+    WriteBundleUint32(header + 4, BUNDLE_FILE_VERSION);
+    WriteBundleUint32(header + 8, (uint32_t)count);
+    for (int i = 0; i < count; i++) WriteBundleAsset(table + (size_t)i*BUNDLE_ASSET_SIZE, &assets[i]);
+
+    bool success = (fwrite(header, 1, BUNDLE_TABLE_OFFSET, file) == BUNDLE_TABLE_OFFSET) &&
+        (fwrite(table, BUNDLE_ASSET_SIZE, count, file) == (size_t)count);
+
+    free(table);
+
+    for (int i = 0; success && (i < count); i++)
+    {
+        uint64_t prefixStart = assets[i].offset - assets[i].prefixSize;
+
+        success = (fwrite(padding, 1, (size_t)(prefixStart - position), file) == (size_t)(prefixStart - position)) &&
+            ((assets[i].prefixSize == 0) || (fwrite(prefixes[i], 1, assets[i].prefixSize, file) == assets[i].prefixSize)) &&
+            (fwrite(data[i], 1, (size_t)assets[i].size, file) == (size_t)assets[i].size);
+
+        position = assets[i].offset + assets[i].size;
+    }
+
+    success = (fclose(file) == 0) && success;
+
+    return success;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Little-endian values of bundle files, any host byte order
+static uint32_t ReadBundleUint32(const unsigned char *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t ReadBundleUint64(const unsigned char *bytes)
+{
+    return (uint64_t)ReadBundleUint32(bytes) | ((uint64_t)ReadBundleUint32(bytes + 4) << 32);
+}
+
+static void WriteBundleUint32(unsigned char *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) bytes[i] = (unsigned char)(value >> (8*i));
+}
+
+static void WriteBundleUint64(unsigned char *bytes, uint64_t value)
+{
+    WriteBundleUint32(bytes, (uint32_t)value);
+    WriteBundleUint32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+// Decode an assets table entry, the name and then every field in the BundleAsset order
+static void ReadBundleAsset(const unsigned char *bytes, BundleAsset *asset)
+{
+    memcpy(asset->name, bytes, BUNDLE_NAME_SIZE);
+    asset->type = (int32_t)ReadBundleUint32(bytes + 64);
+    asset->width = (int32_t)ReadBundleUint32(bytes + 68);
+    asset->height = (int32_t)ReadBundleUint32(bytes + 72);
+    asset->format = (int32_t)ReadBundleUint32(bytes + 76);
+    asset->sampleRate = (int32_t)ReadBundleUint32(bytes + 80);
+    asset->sampleSize = (int32_t)ReadBundleUint32(bytes + 84);
+    asset->channels = (int32_t)ReadBundleUint32(bytes + 88);
+    asset->frameCount = ReadBundleUint32(bytes + 92);
+    asset->prefixSize = ReadBundleUint32(bytes + 96);
+    asset->reserved = ReadBundleUint32(bytes + 100);
+    asset->offset = ReadBundleUint64(bytes + 104);
+    asset->size = ReadBundleUint64(bytes + 112);
+}
+
+static void WriteBundleAsset(unsigned char *bytes, const BundleAsset *asset)
+{
+    memcpy(bytes, asset->name, BUNDLE_NAME_SIZE);
+    WriteBundleUint32(bytes + 64, (uint32_t)asset->type);
+    WriteBundleUint32(bytes + 68, (uint32_t)asset->width);
+    WriteBundleUint32(bytes + 72, (uint32_t)asset->height);
+    WriteBundleUint32(bytes + 76, (uint32_t)asset->format);
+    WriteBundleUint32(bytes + 80, (uint32_t)asset->sampleRate);
+    WriteBundleUint32(bytes + 84, (uint32_t)asset->sampleSize);
+    WriteBundleUint32(bytes + 88, (uint32_t)asset->channels);
+    WriteBundleUint32(bytes + 92, asset->frameCount);
+    WriteBundleUint32(bytes + 96, asset->prefixSize);
+    WriteBundleUint32(bytes + 100, asset->reserved);
+    WriteBundleUint64(bytes + 104, asset->offset);
+    WriteBundleUint64(bytes + 112, asset->size);
+}
+
+// Check the header and that the assets table is inside the file
+static bool IsBundleValid(const unsigned char *data, size_t size)
+{
+    if (size < BUNDLE_TABLE_OFFSET) return false;
+
+    uint32_t assetsCount = ReadBundleUint32(data + 8);
+
+    if ((memcmp(data, "RCBN", 4) != 0) || (ReadBundleUint32(data + 4) != BUNDLE_FILE_VERSION) || (assetsCount > INT32_MAX)) return false;
+
+    return (size - BUNDLE_TABLE_OFFSET)/BUNDLE_ASSET_SIZE >= assetsCount;
+}
+
+// Check that an asset is inside the file and that its data holds the pixels or samples it describes
+// NOTE: Sizes are compared per pixel and per frame, products of the stored values could overflow
+static bool IsBundleAssetValid(const BundleAsset *asset, size_t size)
+{
+    static const int formatBytes[BUNDLE_MAX_IMAGE_FORMAT + 1] = { 0, 1, 2, 2, 3, 2, 2, 4, 4, 12, 16 };
+
+    if ((asset->offset < asset->prefixSize) || (asset->offset > size) || (asset->size > size - asset->offset)) return false;
+    if (memchr(asset->name, 0, BUNDLE_NAME_SIZE) == NULL) return false;
+
+    switch (asset->type)
+    {
+        case BUNDLE_ASSET_RAW: return true;
+        case BUNDLE_ASSET_IMAGE:
+        {
+            if ((asset->width <= 0) || (asset->height <= 0) || (asset->format < 1) || (asset->format > BUNDLE_MAX_IMAGE_FORMAT)) return false;
+
+            return (uint64_t)asset->width*(uint64_t)asset->height <= asset->size/formatBytes[asset->format];
+        }
+        case BUNDLE_ASSET_WAVE:
+        {
+            if ((asset->channels <= 0) || ((asset->sampleSize != 8) && (asset->sampleSize != 16) && (asset->sampleSize != 32))) return false;
+
+            return (uint64_t)asset->frameCount*(uint64_t)asset->channels <= asset->size/(asset->sampleSize/8);
+        }
+        default: return false;
+    }
+}
@@ -0,0 +1,98 @@
+/**********************************************************************************************
+*
+*   raycaster - Asset bundle
+*
+*   All the game resources in one file, mapped at startup: images are stored in their final
+*   pixel format and sounds as PCM, so they are not decoded at startup. Music stays compressed
+*   (stored as found in the resource file), it is decoded by the music streaming thread as it
+*   plays, straight from the mapping. Asset data points into the mapped file, nothing is copied.
+*
+*   Bundle files start with the "RCBN" identifier, the format version and the assets count,
+*   followed by the assets table and the assets data. Asset data is BUNDLE_ALIGNMENT aligned.
+*   Waves are preceded by a RIFF header, the prefix and the samples together are a .wav file
+*   that can be streamed from memory.
+*
+*   The header and the assets table are little-endian on any host, the table is decoded at load
+*   and every asset checked to be inside the file and to hold the pixels or samples it describes.
+*   Asset data is stored as packed: pixels and samples in the byte order of the packing machine
+*   (every supported platform is little-endian).
+*
+*   Bundles are built by the bundle_pack tool (make bundle), the only part using raylib.
+*
+**********************************************************************************************/
+
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BUNDLE_FILE_VERSION 1
+#define BUNDLE_NAME_SIZE 64             // Asset names, resource paths i.e. "resources/coin.wav"
+#define BUNDLE_ALIGNMENT 64             // Alignment of the data of every asset in the file
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum BundleAssetType
+{
+    BUNDLE_ASSET_RAW = 0,               // Data as found in the resource file (i.e. compressed music)
+    BUNDLE_ASSET_IMAGE,                 // Pixels, width*height in the stored pixel format
+    BUNDLE_ASSET_WAVE                   // Interleaved PCM samples
+}
+BundleAssetType;
+
+// Assets table entry, the fields in this order in the file (120 bytes)
+typedef struct BundleAsset
+{
+    char name[BUNDLE_NAME_SIZE];
+    int32_t type;                       // BundleAssetType
+    int32_t width;                      // Images: size and raylib PixelFormat
+    int32_t height;
+    int32_t format;
+    int32_t sampleRate;                 // Waves: samples format and count
+    int32_t sampleSize;                 // Bits per sample
+    int32_t channels;
+    uint32_t frameCount;
+    uint32_t prefixSize;                // Bytes of container header right before the data (waves: RIFF header)
+    uint32_t reserved;
+    uint64_t offset;                    // Data offset from the start of the file
+    uint64_t size;                      // Data bytes, prefix excluded
+}
+BundleAsset;
+
+typedef struct AssetBundle
+{
+    const unsigned char *data;          // Whole file, mapped read-only
+    size_t size;
+    const BundleAsset *assets;          // Assets table, decoded from the file
+    int assetsCount;
+    bool isMapped;                      // false when the file was read into memory (no mmap)
+}
+AssetBundle;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Asset Bundle Functions Declaration
+//----------------------------------------------------------------------------------
+AssetBundle *LoadAssetBundle(const char *fileName);     // Map a bundle file, NULL when missing or invalid
+void UnloadAssetBundle(AssetBundle *bundle);            // Asset data can't be used anymore
+const BundleAsset *GetBundleAsset(const AssetBundle *bundle, const char *name);    // NULL when not found
+const void *GetBundleAssetData(const AssetBundle *bundle, const BundleAsset *asset);    // Data of an asset, prefix excluded
+
+// Write a bundle, assets offsets are set on write, every asset data is size bytes at data[i]
+// NOTE: prefixSize bytes are written before each asset data from prefixes[i], NULL for none
+bool ExportAssetBundle(const char *fileName, BundleAsset *assets, const void **data, const void **prefixes, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_H
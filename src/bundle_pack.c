@@ -0,0 +1,168 @@
+/**********************************************************************************************
+*
+*   raycaster - Asset bundle packer
+*
+*   Decodes the resources once at build time and writes them as an asset bundle:
+*       bundle_pack <bundle file> <resource files...>
+*
+*   Images are converted to R8G8B8A8 pixels and .wav sounds to 16 bit PCM, keeping their sample
+*   rate and channels. Compressed audio (.ogg, .mp3, .flac) and any other file are stored as is,
+*   music is streamed and decoded as it plays, decoded PCM would be ten times its size. Assets
+*   are named by their path as given, the game looks them up by the same paths it would load
+*   them from.
+*
+**********************************************************************************************/
+
+#include "raylib.h"
+#include "bundle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define WAVE_HEADER_SIZE 44             // RIFF header of a PCM .wav file
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void WriteWaveHeader(unsigned char *header, const Wave *wave);
+static void WriteUint32(unsigned char *bytes, unsigned int value);
+static void WriteUint16(unsigned char *bytes, unsigned short value);
+
+//----------------------------------------------------------------------------------
+// Program main entry point
+//----------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: bundle_pack <bundle file> <resource files...>\n");
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    int count = argc - 2;
+    BundleAsset *assets = (BundleAsset *)calloc(count, sizeof(BundleAsset));
+    const void **data = (const void **)calloc(count, sizeof(void *));
+    const void **prefixes = (const void **)calloc(count, sizeof(void *));
+    unsigned char (*waveHeaders)[WAVE_HEADER_SIZE] = calloc(count, WAVE_HEADER_SIZE);
+    bool success = true;
+
+    for (int i = 0; success && (i < count); i++)
+    {
+        const char *fileName = argv[i + 2];
+        BundleAsset *asset = &assets[i];
+
+        if (strlen(fileName) >= BUNDLE_NAME_SIZE)
+        {
+            printf("bundle_pack: asset name too long: %s\n", fileName);
+            success = false;
+            break;
+        }
+
+        strcpy(asset->name, fileName);
+
+        if (IsFileExtension(fileName, ".png"))
+        {
+            Image image = LoadImage(fileName);
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+            asset->type = BUNDLE_ASSET_IMAGE;
+            asset->width = image.width;
+            asset->height = image.height;
+            asset->format = image.format;
+            asset->size = (uint64_t)GetPixelDataSize(image.width, image.height, image.format);
+            data[i] = image.data;
+        }
+        else if (IsFileExtension(fileName, ".wav"))
+        {
+            Wave wave = LoadWave(fileName);
+            WaveFormat(&wave, wave.sampleRate, 16, wave.channels);
+
+            asset->type = BUNDLE_ASSET_WAVE;
+            asset->sampleRate = (int32_t)wave.sampleRate;
+            asset->sampleSize = (int32_t)wave.sampleSize;
+            asset->channels = (int32_t)wave.channels;
+            asset->frameCount = wave.frameCount;
+            asset->prefixSize = WAVE_HEADER_SIZE;
+            asset->size = (uint64_t)wave.frameCount*wave.channels*(wave.sampleSize/8);
+            WriteWaveHeader(waveHeaders[i], &wave);
+            prefixes[i] = waveHeaders[i];
+            data[i] = wave.data;
+        }
+        else
+        {
+            int dataSize = 0;
+
+            asset->type = BUNDLE_ASSET_RAW;
+            data[i] = LoadFileData(fileName, &dataSize);
+            asset->size = (uint64_t)dataSize;
+        }
+
+        if (data[i] == NULL)
+        {
+            printf("bundle_pack: failed to load %s\n", fileName);
+            success = false;
+        }
+    }
+
+    if (success) success = ExportAssetBundle(argv[1], assets, data, prefixes, count);
+
+    if (success)
+    {
+        uint64_t totalSize = 0;
+        for (int i = 0; i < count; i++) totalSize += assets[i].size;
+
+        printf("bundle_pack: %s, %i assets, %.2f MB\n", argv[1], count, (double)totalSize/(1024.0*1024.0));
+    }
+    else printf("bundle_pack: failed to write %s\n", argv[1]);
+
+    // Image, wave and file data are all allocated with raylib allocator
+    for (int i = 0; i < count; i++) MemFree((void *)data[i]);
+
+    free(waveHeaders);
+    free(prefixes);
+    free(data);
+    free(assets);
+
+    return success? 0 : 1;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// RIFF header of a .wav file holding the samples of a wave, 16 bit PCM
+static void WriteWaveHeader(unsigned char *header, const Wave *wave)
+{
+    unsigned int dataSize = wave->frameCount*wave->channels*(wave->sampleSize/8);
+    unsigned short blockAlign = (unsigned short)(wave->channels*(wave->sampleSize/8));
+
+    memcpy(header, "RIFF", 4);
+    WriteUint32(header + 4, WAVE_HEADER_SIZE - 8 + dataSize);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteUint32(header + 16, 16);                           // fmt chunk size
+    WriteUint16(header + 20, 1);                            // PCM
+    WriteUint16(header + 22, (unsigned short)wave->channels);
+    WriteUint32(header + 24, wave->sampleRate);
+    WriteUint32(header + 28, wave->sampleRate*blockAlign);  // Bytes per second
+    WriteUint16(header + 32, blockAlign);
+    WriteUint16(header + 34, (unsigned short)wave->sampleSize);
+    memcpy(header + 36, "data", 4);
+    WriteUint32(header + 40, dataSize);
+}
+
+static void WriteUint32(unsigned char *bytes, unsigned int value)
+{
+    for (int i = 0; i < 4; i++) bytes[i] = (unsigned char)(value >> (8*i));
+}
+
+static void WriteUint16(unsigned char *bytes, unsigned short value)
+{
+    bytes[0] = (unsigned char)value;
+    bytes[1] = (unsigned char)(value >> 8);
+}
@@ -0,0 +1,411 @@
+/**********************************************************************************************
+*
+*   raycaster - Frame capture
+*
+*   Ring of frame buffers between the game and a writer thread, frame n in buffer
+*   n%CAPTURE_BUFFERS. The game acquires the buffer of the next frame once the writer freed it,
+*   renders into it and submits it; the writer thread writes the submitted frames in order.
+*
+**********************************************************************************************/
+
+#include "capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Shared memory sink where POSIX shm_open() is available
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    #define CAPTURE_SHM_SUPPORTED
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define CAPTURE_SHM_NAME_SIZE 64
+#define CAPTURE_SHM_READER_WAIT 500000L     // Nanoseconds between checks of the shm reader progress
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+struct FrameCapture
+{
+    int width;
+    int height;
+    int fps;
+    int sink;                           // CaptureSink
+    int policy;                         // CapturePolicy
+    int frameSize;                      // Bytes of a frame buffer
+    uint32_t *buffers[CAPTURE_BUFFERS];
+    bool acquired;                      // Buffer of the next frame handed to the game
+
+    FILE *file;                         // Raw and y4m sinks
+    unsigned char *planes;              // Y, U and V planes of the frame being written (y4m)
+    CaptureShmHeader *shm;              // Mapping of the shm sink, frame buffers included
+    size_t shmSize;
+    char shmName[CAPTURE_SHM_NAME_SIZE];
+
+    pthread_t thread;
+    bool threaded;
+    pthread_mutex_t mutex;
+    pthread_cond_t frameSubmitted;
+    pthread_cond_t frameWritten;
+    unsigned int submittedCount;        // Frames submitted and written since the start, wrap around
+    unsigned int writtenCount;
+    bool stopRequested;                 // (atomic)
+    CaptureStats stats;                 // Protected by the mutex
+};
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static double GetCaptureTime(void);
+static bool OpenCaptureSink(FrameCapture *capture, const char *target);
+static void CloseCaptureSink(FrameCapture *capture);
+static long long WriteCaptureFrame(FrameCapture *capture, unsigned int frame, bool waitReader);
+static void ConvertCaptureFrameYuv(const FrameCapture *capture, const uint32_t *pixels, unsigned char *planes);
+static void *CaptureThread(void *arg);
+
+//----------------------------------------------------------------------------------
+// Frame Capture Functions Definition
+//----------------------------------------------------------------------------------
+
+// Open the sink, allocate the buffers ring and start the writer thread
+FrameCapture *LoadFrameCapture(int width, int height, int fps, int sink, const char *target, int policy)
+{
+    FrameCapture *capture = (FrameCapture *)calloc(1, sizeof(FrameCapture));
+
+    capture->width = width;
+    capture->height = height;
+    capture->fps = fps;
+    capture->sink = sink;
+    capture->policy = policy;
+    capture->frameSize = width*height*(int)sizeof(uint32_t);
+
+    if (!OpenCaptureSink(capture, target))
+    {
+        free(capture);
+        return NULL;
+    }
+
+    // Shm frame buffers are the slots of the mapping
+    for (int i = 0; i < CAPTURE_BUFFERS; i++)
+    {
+        if (capture->shm != NULL) capture->buffers[i] = (uint32_t *)((unsigned char *)capture->shm + CAPTURE_SHM_HEADER_SIZE + (size_t)i*capture->shm->slotSize);
+        else capture->buffers[i] = (uint32_t *)calloc((size_t)width*height, sizeof(uint32_t));
+    }
+
+    pthread_mutex_init(&capture->mutex, NULL);
+    pthread_cond_init(&capture->frameSubmitted, NULL);
+    pthread_cond_init(&capture->frameWritten, NULL);
+
+    // A writer thread sharing the only core slows the game frames more than writing on submission
+    long cores = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    capture->threaded = (cores > 1) && (pthread_create(&capture->thread, NULL, CaptureThread, capture) == 0);
+    capture->stats.threaded = capture->threaded;
+
+    return capture;
+}
+
+// Stop the writer thread once every submitted frame is written, a frame acquired and not submitted is lost
+void UnloadFrameCapture(FrameCapture *capture)
+{
+    if (capture == NULL) return;
+
+    if (capture->threaded)
+    {
+        pthread_mutex_lock(&capture->mutex);
+        __atomic_store_n(&capture->stopRequested, true, __ATOMIC_RELEASE);
+        pthread_cond_signal(&capture->frameSubmitted);
+        pthread_mutex_unlock(&capture->mutex);
+
+        pthread_join(capture->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&capture->mutex);
+    pthread_cond_destroy(&capture->frameSubmitted);
+    pthread_cond_destroy(&capture->frameWritten);
+
+    if (capture->shm == NULL)
+    {
+        for (int i = 0; i < CAPTURE_BUFFERS; i++) free(capture->buffers[i]);
+    }
+
+    CloseCaptureSink(capture);
+    free(capture);
+}
+
+// Get the buffer of the next frame, applying the back-pressure policy when the writer has not freed it yet
+// NOTE: Acquiring again before submitting returns the same buffer
+uint32_t *AcquireCaptureFrame(FrameCapture *capture)
+{
+    if (capture->acquired) return capture->buffers[capture->submittedCount%CAPTURE_BUFFERS];
+
+    pthread_mutex_lock(&capture->mutex);
+
+    if (capture->submittedCount - capture->writtenCount == CAPTURE_BUFFERS)
+    {
+        if (capture->policy == CAPTURE_POLICY_DROP)
+        {
+            capture->stats.droppedCount++;
+            pthread_mutex_unlock(&capture->mutex);
+            return NULL;
+        }
+
+        double start = GetCaptureTime();
+        while (capture->submittedCount - capture->writtenCount == CAPTURE_BUFFERS) pthread_cond_wait(&capture->frameWritten, &capture->mutex);
+        capture->stats.blockedTime += GetCaptureTime() - start;
+    }
+
+    pthread_mutex_unlock(&capture->mutex);
+
+    capture->acquired = true;
+
+    return capture->buffers[capture->submittedCount%CAPTURE_BUFFERS];
+}
+
+// Queue the acquired buffer for the writer thread, or write it now without thread
+void SubmitCaptureFrame(FrameCapture *capture)
+{
+    if (!capture->acquired) return;
+
+    capture->acquired = false;
+
+    if (!capture->threaded)
+    {
+        unsigned int frame = capture->submittedCount++;
+        double start = GetCaptureTime();
+        long long bytes = WriteCaptureFrame(capture, frame, false);
+
+        capture->writtenCount++;
+        capture->stats.submittedCount++;
+        capture->stats.writtenCount++;
+        capture->stats.writeTime += GetCaptureTime() - start;
+        capture->stats.writtenBytes += bytes;
+        return;
+    }
+
+    pthread_mutex_lock(&capture->mutex);
+    capture->submittedCount++;
+    capture->stats.submittedCount++;
+    pthread_cond_signal(&capture->frameSubmitted);
+    pthread_mutex_unlock(&capture->mutex);
+}
+
+CaptureStats GetCaptureStats(FrameCapture *capture)
+{
+    pthread_mutex_lock(&capture->mutex);
+    CaptureStats stats = capture->stats;
+    pthread_mutex_unlock(&capture->mutex);
+
+    return stats;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+static double GetCaptureTime(void)
+{
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+}
+
+// Create the output file or shared memory object, writing its header
+static bool OpenCaptureSink(FrameCapture *capture, const char *target)
+{
+    if (capture->sink == CAPTURE_SINK_SHM)
+    {
+#if defined(CAPTURE_SHM_SUPPORTED)
+        if (strlen(target) >= CAPTURE_SHM_NAME_SIZE) return false;
+
+        int slotSize = (capture->frameSize + 63) & ~63;
+        size_t size = CAPTURE_SHM_HEADER_SIZE + (size_t)CAPTURE_BUFFERS*slotSize;
+
+        shm_unlink(target);     // Readers of a previous capture keep their mapping
+        int fd = shm_open(target, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return false;
+
+        void *mapping = MAP_FAILED;
+        if (ftruncate(fd, (off_t)size) == 0) mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);      // The mapping keeps the object
+
+        if (mapping == MAP_FAILED)
+        {
+            shm_unlink(target);
+            return false;
+        }
+
+        capture->shm = (CaptureShmHeader *)mapping;
+        capture->shmSize = size;
+        strcpy(capture->shmName, target);
+
+        *capture->shm = (CaptureShmHeader){ { 'R', 'C', 'F', 'C' }, CAPTURE_SHM_VERSION, capture->width, capture->height,
+            capture->fps, CAPTURE_BUFFERS, slotSize, 0, 0, 0 };
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    capture->file = fopen(target, "wb");
+    if (capture->file == NULL) return false;
+
+    if (capture->sink == CAPTURE_SINK_Y4M)
+    {
+        int chromaSize = ((capture->width + 1)/2)*((capture->height + 1)/2);
+
+        capture->planes = (unsigned char *)malloc((size_t)capture->width*capture->height + 2*(size_t)chromaSize);
+        fprintf(capture->file, "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg\n", capture->width, capture->height, capture->fps);
+    }
+
+    return true;
+}
+
+static void CloseCaptureSink(FrameCapture *capture)
+{
+#if defined(CAPTURE_SHM_SUPPORTED)
+    if (capture->shm != NULL)
+    {
+        munmap(capture->shm, capture->shmSize);
+        shm_unlink(capture->shmName);
+    }
+#endif
+
+    if (capture->file != NULL) fclose(capture->file);
+    free(capture->planes);
+}
+
+// Write a frame to the sink, bytes written
+// NOTE: Shm frames are only published, with a reader attached they are written once it has read them
+static long long WriteCaptureFrame(FrameCapture *capture, unsigned int frame, bool waitReader)
+{
+    const uint32_t *pixels = capture->buffers[frame%CAPTURE_BUFFERS];
+    long long bytes = 0;
+
+    switch (capture->sink)
+    {
+        case CAPTURE_SINK_RAW:
+        {
+            bytes = (long long)fwrite(pixels, 1, (size_t)capture->frameSize, capture->file);
+        } break;
+        case CAPTURE_SINK_Y4M:
+        {
+            int chromaSize = ((capture->width + 1)/2)*((capture->height + 1)/2);
+            size_t planesSize = (size_t)capture->width*capture->height + 2*(size_t)chromaSize;
+
+            ConvertCaptureFrameYuv(capture, pixels, capture->planes);
+            bytes = (long long)fwrite("FRAME\n", 1, 6, capture->file);
+            bytes += (long long)fwrite(capture->planes, 1, planesSize, capture->file);
+        } break;
+        case CAPTURE_SINK_SHM:
+        {
+            CaptureShmHeader *shm = capture->shm;
+            uint64_t published = __atomic_load_n(&shm->writeCount, __ATOMIC_RELAXED) + 1;
+            struct timespec wait = { 0, CAPTURE_SHM_READER_WAIT };
+
+            __atomic_store_n(&shm->writeCount, published, __ATOMIC_RELEASE);
+            bytes = capture->frameSize;
+
+            while (waitReader && __atomic_load_n(&shm->readerAttached, __ATOMIC_ACQUIRE) &&
+                (__atomic_load_n(&shm->readCount, __ATOMIC_ACQUIRE) < published) &&
+                !__atomic_load_n(&capture->stopRequested, __ATOMIC_ACQUIRE)) nanosleep(&wait, NULL);
+        } break;
+        default: break;
+    }
+
+    return bytes;
+}
+
+// Convert 0xAARRGGBB pixels to full range BT.601 planes, chroma averaged over 2x2 pixels (JPEG siting)
+static void ConvertCaptureFrameYuv(const FrameCapture *capture, const uint32_t *pixels, unsigned char *planes)
+{
+    int width = capture->width;
+    int height = capture->height;
+    int chromaWidth = (width + 1)/2;
+    int chromaHeight = (height + 1)/2;
+    unsigned char *lumas = planes;
+    unsigned char *blues = planes + (size_t)width*height;
+    unsigned char *reds = blues + (size_t)chromaWidth*chromaHeight;
+
+    for (int p = 0; p < width*height; p++)
+    {
+        uint32_t color = pixels[p];
+        lumas[p] = (unsigned char)((29*(color & 0xff) + 150*((color >> 8) & 0xff) + 77*((color >> 16) & 0xff)) >> 8);
+    }
+
+    for (int y = 0; y < chromaHeight; y++)
+    {
+        const uint32_t *row = pixels + (size_t)2*y*width;
+        const uint32_t *nextRow = (2*y + 1 < height)? row + width : row;
+
+        for (int x = 0; x < chromaWidth; x++)
+        {
+            int x1 = (2*x + 1 < width)? 2*x + 1 : 2*x;
+            uint32_t quad[4] = { row[2*x], row[x1], nextRow[2*x], nextRow[x1] };
+            int red = 2;
+            int green = 2;
+            int blue = 2;
+
+            for (int i = 0; i < 4; i++)
+            {
+                red += (quad[i] >> 16) & 0xff;
+                green += (quad[i] >> 8) & 0xff;
+                blue += quad[i] & 0xff;
+            }
+
+            red >>= 2;
+            green >>= 2;
+            blue >>= 2;
+
+            int u = (-43*red - 85*green + 128*blue + 32896) >> 8;
+            int v = (128*red - 107*green - 21*blue + 32896) >> 8;
+
+            blues[y*chromaWidth + x] = (unsigned char)((u > 255)? 255 : u);
+            reds[y*chromaWidth + x] = (unsigned char)((v > 255)? 255 : v);
+        }
+    }
+}
+
+// Writer thread: write the submitted frames in order until stopped with nothing left to write
+static void *CaptureThread(void *arg)
+{
+    FrameCapture *capture = (FrameCapture *)arg;
+
+    pthread_mutex_lock(&capture->mutex);
+
+    while (true)
+    {
+        while (!capture->stopRequested && (capture->writtenCount == capture->submittedCount)) pthread_cond_wait(&capture->frameSubmitted, &capture->mutex);
+
+        if (capture->writtenCount == capture->submittedCount) break;    // Stopped with every frame written
+
+        unsigned int frame = capture->writtenCount;
+        pthread_mutex_unlock(&capture->mutex);
+
+        double start = GetCaptureTime();
+        long long bytes = WriteCaptureFrame(capture, frame, true);
+        double elapsed = GetCaptureTime() - start;
+
+        pthread_mutex_lock(&capture->mutex);
+        capture->writtenCount++;
+        capture->stats.writtenCount++;
+        capture->stats.writeTime += elapsed;
+        capture->stats.writtenBytes += bytes;
+        pthread_cond_broadcast(&capture->frameWritten);
+    }
+
+    pthread_mutex_unlock(&capture->mutex);
+
+    return NULL;
+}
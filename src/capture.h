@@ -0,0 +1,105 @@
+/**********************************************************************************************
+*
+*   raycaster - Frame capture
+*
+*   Rendered frames exported by a writer thread for recordings and streaming. The capture owns
+*   a ring of CAPTURE_BUFFERS frame buffers: the game renders the next frame straight into a
+*   free buffer and submits it, the writer thread writes it out and frees it, frames are never
+*   copied on the game thread.
+*
+*   Sinks:
+*     - raw: frames one after the other, width*height pixels of 4 bytes (BGRA bytes order)
+*     - y4m: YUV4MPEG2 stream, 4:2:0 (C420jpeg), converted on the writer thread
+*     - shm: POSIX shared memory object an encoder process maps, the ring buffers live in it
+*       so submitting a frame only publishes it (see CaptureShmHeader)
+*
+*   When the writer falls behind and no buffer is free, the drop policy skips capturing the
+*   frame and the block policy waits for a free buffer. Without threads frames are written by
+*   the game thread as they are submitted.
+*
+*   The writer thread needs a spare core: the game thread only pays the acquire and submit
+*   calls, but on a single core the writing (and the y4m conversion) runs between and during
+*   its frames. With only one CPU online no writer thread is started, frames are written on
+*   submission.
+*
+**********************************************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define CAPTURE_BUFFERS 4               // Frames in flight between the game and the writer thread
+#define CAPTURE_SHM_VERSION 1
+#define CAPTURE_SHM_HEADER_SIZE 4096    // Frame buffers start one page into the shared memory object
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum CaptureSink {
+    CAPTURE_SINK_RAW = 0,       // File of raw frames
+    CAPTURE_SINK_Y4M,           // YUV4MPEG2 file
+    CAPTURE_SINK_SHM            // POSIX shared memory object, target is its name (i.e. "/raycaster")
+} CaptureSink;
+
+typedef enum CapturePolicy {
+    CAPTURE_POLICY_DROP = 0,    // No free buffer: the frame is not captured
+    CAPTURE_POLICY_BLOCK        // No free buffer: wait for the writer thread
+} CapturePolicy;
+
+// Start of the shared memory object, followed by slotsCount frames of slotSize bytes
+// NOTE: Readers set readerAttached, then read frame n from slot n%slotsCount while n < writeCount
+// and advance readCount past it; a slot is only reused once readCount passed its frame. Without
+// reader attached frames are published and reused without waiting
+typedef struct CaptureShmHeader
+{
+    char identifier[4];         // "RCFC"
+    int32_t version;            // CAPTURE_SHM_VERSION
+    int32_t width;
+    int32_t height;
+    int32_t fps;
+    int32_t slotsCount;
+    int32_t slotSize;           // Bytes between frames, width*height*4 rounded up to 64
+    int32_t readerAttached;     // Written by the reader (atomic)
+    uint64_t writeCount;        // Frames published (atomic)
+    uint64_t readCount;         // Frames read, written by the reader (atomic)
+}
+CaptureShmHeader;
+
+typedef struct FrameCapture FrameCapture;   // Buffers ring, sink and writer thread
+
+typedef struct CaptureStats
+{
+    int submittedCount;         // Frames submitted to the writer
+    int writtenCount;           // Frames written out
+    int droppedCount;           // Frames not captured, no buffer was free (drop policy)
+    double blockedTime;         // Seconds the game waited for a free buffer (block policy)
+    double writeTime;           // Seconds spent writing frames out, waiting for the shm reader included
+    long long writtenBytes;
+    bool threaded;              // false when frames are written on submission (one CPU online or no threads)
+}
+CaptureStats;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Frame Capture Functions Declaration
+//----------------------------------------------------------------------------------
+FrameCapture *LoadFrameCapture(int width, int height, int fps, int sink, const char *target, int policy);   // NULL when the sink can't be opened
+void UnloadFrameCapture(FrameCapture *capture);    // Writes the submitted frames, then closes the sink
+
+uint32_t *AcquireCaptureFrame(FrameCapture *capture);  // Buffer to render the next frame into (0xAARRGGBB), NULL when dropped
+void SubmitCaptureFrame(FrameCapture *capture);        // Hand the acquired buffer to the writer, it must not be touched after
+CaptureStats GetCaptureStats(FrameCapture *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_H
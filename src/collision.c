@@ -0,0 +1,193 @@
+/**********************************************************************************************
+*
+*   raycaster - Collision module
+*
+*   Swept axis-aligned box movement against the tile grid of a Map.
+*
+**********************************************************************************************/
+
+#include "collision.h"
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static bool SweepAxis(const Map *map, float *x, float *y, float halfWidth, float halfHeight, float delta, bool alongX, int *portalTransits);
+
+//----------------------------------------------------------------------------------
+// Collision Functions Definition
+//----------------------------------------------------------------------------------
+
+// Move a box by (deltaX, deltaY), sliding along the walls it hits
+// NOTE: The x axis is swept first and the y axis from the resulting position
+MoveResult MoveBoxOnMap(const Map *map, float x, float y, float halfWidth, float halfHeight, float deltaX, float deltaY)
+{
+    MoveResult result = { x, y, 0 };
+    int portalTransits = 0;
+
+    // Fast path: the box swept over the whole movement only touches empty tiles
+    float sweptMinX = ((deltaX < 0.0f)? x + deltaX : x) - halfWidth;
+    float sweptMaxX = ((deltaX > 0.0f)? x + deltaX : x) + halfWidth;
+    float sweptMinY = ((deltaY < 0.0f)? y + deltaY : y) - halfHeight;
+    float sweptMaxY = ((deltaY > 0.0f)? y + deltaY : y) + halfHeight;
+
+    if ((sweptMinX >= 0.0f) && (sweptMinY >= 0.0f))
+    {
+        int firstX = (int)(sweptMinX/TILE_SIZE);
+        int lastX = (int)(sweptMaxX/TILE_SIZE);
+        int firstY = (int)(sweptMinY/TILE_SIZE);
+        int lastY = (int)(sweptMaxY/TILE_SIZE);
+
+        if ((lastX < map->numCols) && (lastY < map->numRows) && ((lastX - firstX + 1)*(lastY - firstY + 1) <= 9))
+        {
+            bool empty = true;
+
+            for (int gridIndexY = firstY; (gridIndexY <= lastY) && empty; gridIndexY++)
+            {
+                const int *row = &map->tiles[gridIndexY*map->numCols];
+                for (int gridIndexX = firstX; gridIndexX <= lastX; gridIndexX++) empty &= (row[gridIndexX] == TILE_EMPTY);
+            }
+
+            if (empty)
+            {
+                result.x += deltaX;
+                result.y += deltaY;
+                return result;
+            }
+        }
+    }
+
+    if (SweepAxis(map, &result.x, &result.y, halfWidth, halfHeight, deltaX, true, &portalTransits)) result.flags |= MOVE_BLOCKED_X;
+    if (SweepAxis(map, &result.x, &result.y, halfWidth, halfHeight, deltaY, false, &portalTransits)) result.flags |= MOVE_BLOCKED_Y;
+    if (portalTransits > 0) result.flags |= MOVE_CROSSED_PORTAL;
+
+    return result;
+}
+
+// Check if a box overlaps any wall tile
+// NOTE: Portal tiles are not checked, a box going through a portal is partially inside it
+bool CheckCollisionBoxMap(const Map *map, float x, float y, float halfWidth, float halfHeight)
+{
+    int firstX = (int)floorf((x - halfWidth)/TILE_SIZE);
+    int lastX = (int)ceilf((x + halfWidth)/TILE_SIZE) - 1;
+    int firstY = (int)floorf((y - halfHeight)/TILE_SIZE);
+    int lastY = (int)ceilf((y + halfHeight)/TILE_SIZE) - 1;
+
+    for (int gridIndexY = firstY; gridIndexY <= lastY; gridIndexY++)
+    {
+        for (int gridIndexX = firstX; gridIndexX <= lastX; gridIndexX++)
+        {
+            int tile = GetMapTile(map, gridIndexX, gridIndexY);
+            if ((tile != TILE_EMPTY) && (tile != TILE_PORTAL)) return true;
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Sweep a box along one axis, returns true if a wall stopped it
+// NOTE: Works on the box center along the movement (u axis) and the tiles it overlaps across it
+// (v axis). Boxes cover the half-open range [center - half, center + half). A box that fits in a
+// portal opening can move into the portal tile, and it's moved to the destination portal once
+// its center goes through the portal face.
+static bool SweepAxis(const Map *map, float *x, float *y, float halfWidth, float halfHeight, float delta, bool alongX, int *portalTransits)
+{
+    if (delta == 0.0f) return false;
+
+    int step = (delta > 0.0f)? 1 : -1;
+    float halfU = alongX? halfWidth : halfHeight;
+    float halfV = alongX? halfHeight : halfWidth;
+    float u = alongX? *x : *y;
+    float v = alongX? *y : *x;
+    float remaining = fabsf(delta);
+    bool blocked = false;
+
+    while (remaining > 0.0f)
+    {
+        float target = u + step*remaining;
+        float lead = u + step*halfU;
+        float targetLead = target + step*halfU;
+        int firstV = (int)floorf((v - halfV)/TILE_SIZE);
+        int lastV = (int)ceilf((v + halfV)/TILE_SIZE) - 1;
+        bool fitsPortal = (firstV == lastV) && (2.0f*halfU <= TILE_SIZE) && (*portalTransits < MAX_PORTAL_TRANSITS_PER_MOVE);
+        bool crossedPortal = false;
+
+        // Start from the cell under the leading edge, it can be a portal the box is already in
+        int cell = (step > 0)? (int)ceilf(lead/TILE_SIZE) - 1 : (int)floorf(lead/TILE_SIZE);
+
+        remaining = 0.0f;
+
+        for (;; cell += step)
+        {
+            float entry = (float)(((step > 0)? cell : cell + 1)*TILE_SIZE);     // Face crossed to enter the cell
+            bool occupied = (step > 0)? (entry < lead) : (entry > lead);
+
+            if (!occupied && ((step > 0)? (entry >= targetLead) : (entry <= targetLead))) break;
+
+            int tile = TILE_EMPTY;
+            for (int w = firstV; (w <= lastV) && (tile == TILE_EMPTY); w++) tile = alongX? GetMapTile(map, cell, w) : GetMapTile(map, w, cell);
+
+            if (tile == TILE_EMPTY) continue;
+
+            float offsetU = 0.0f;
+            float offsetV = 0.0f;
+
+            if ((tile == TILE_PORTAL) && fitsPortal &&
+                (alongX? GetMapPortalTransit(map, cell, firstV, step, 0, &offsetU, &offsetV) :
+                         GetMapPortalTransit(map, firstV, cell, 0, step, &offsetV, &offsetU)))
+            {
+                // The center stays on this side of the portal face, the box just moves into the opening
+                if ((step > 0)? (target <= entry) : (target >= entry)) break;
+
+                // Go through only if the box fits in the cell right after the destination face
+                int beyondU = cell + (int)offsetU/TILE_SIZE;
+                int beyondV = firstV + (int)offsetV/TILE_SIZE;
+
+                if ((alongX? GetMapTile(map, beyondU, beyondV) : GetMapTile(map, beyondV, beyondU)) == TILE_EMPTY)
+                {
+                    remaining = fabsf(target - entry);
+                    u = entry + offsetU;
+                    v += offsetV;
+                    crossedPortal = true;
+                    (*portalTransits)++;
+                    break;
+                }
+
+                // Stop with the center right before the portal face
+                float stop = entry - step*COLLISION_SKIN;
+                if ((step > 0)? (stop > u) : (stop < u)) u = stop;
+
+                blocked = true;
+                break;
+            }
+
+            // Tiles the box already overlaps never stop it, so it can always move out of them
+            if (occupied) continue;
+
+            // Stop right before the wall, never pushing the box backwards
+            float stop = entry - step*(COLLISION_SKIN + halfU);
+            if ((step > 0)? (stop > u) : (stop < u)) u = stop;
+
+            blocked = true;
+            break;
+        }
+
+        if (!crossedPortal && !blocked) u = target;
+    }
+
+    if (alongX)
+    {
+        *x = u;
+        *y = v;
+    }
+    else
+    {
+        *y = u;
+        *x = v;
+    }
+
+    return blocked;
+}
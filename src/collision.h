@@ -0,0 +1,54 @@
+/**********************************************************************************************
+*
+*   raycaster - Collision module
+*
+*   Swept axis-aligned box movement against the tile grid of a Map. Each axis is swept on its
+*   own so a blocked box slides along walls, every tile crossed by the sweep is tested so big
+*   steps never tunnel, and portal tiles move the whole box to the linked portal.
+*
+*   Boxes are given by their center and half extents, no memory is allocated.
+*
+**********************************************************************************************/
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "map.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define COLLISION_SKIN 0.01f                // Gap kept between a blocked box and the wall
+#define MAX_PORTAL_TRANSITS_PER_MOVE 4      // Avoids endless loops between facing portals
+
+// Movement result flags
+#define MOVE_BLOCKED_X 1
+#define MOVE_BLOCKED_Y 2
+#define MOVE_CROSSED_PORTAL 4
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MoveResult
+{
+    float x;                    // Final box center x
+    float y;                    // Final box center y
+    int flags;                  // MOVE_BLOCKED_X | MOVE_BLOCKED_Y | MOVE_CROSSED_PORTAL
+}
+MoveResult;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Collision Functions Declaration
+//----------------------------------------------------------------------------------
+MoveResult MoveBoxOnMap(const Map *map, float x, float y, float halfWidth, float halfHeight, float deltaX, float deltaY);
+bool CheckCollisionBoxMap(const Map *map, float x, float y, float halfWidth, float halfHeight);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COLLISION_H
@@ -0,0 +1,148 @@
+/**********************************************************************************************
+*
+*   raycaster - Performance counters
+*
+*   Hardware counters of the calling thread over perf_event_open() on Linux.
+*
+**********************************************************************************************/
+
+#include "counters.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    #define PERF_EVENTS_SUPPORTED
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static const char *counterNames[PERF_COUNTER_COUNT] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static int OpenPerfCounter(int counter);
+
+//----------------------------------------------------------------------------------
+// Performance Counters Functions Definition
+//----------------------------------------------------------------------------------
+
+// Open the counters of the calling thread, every counter the system refuses is left unavailable
+PerfCounters *LoadPerfCounters(void)
+{
+    PerfCounters *counters = (PerfCounters *)calloc(1, sizeof(PerfCounters));
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        counters->fds[i] = OpenPerfCounter(i);
+        if (counters->fds[i] >= 0) counters->availableCount++;
+    }
+
+    return counters;
+}
+
+void UnloadPerfCounters(PerfCounters *counters)
+{
+    if (counters == NULL) return;
+
+#if defined(PERF_EVENTS_SUPPORTED)
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (counters->fds[i] >= 0) close(counters->fds[i]);
+    }
+#endif
+
+    free(counters);
+}
+
+bool IsPerfCounterAvailable(const PerfCounters *counters, int counter)
+{
+    return (counters != NULL) && (counter >= 0) && (counter < PERF_COUNTER_COUNT) && (counters->fds[counter] >= 0);
+}
+
+const char *GetPerfCounterName(int counter)
+{
+    return ((counter >= 0) && (counter < PERF_COUNTER_COUNT))? counterNames[counter] : "unknown";
+}
+
+// Read the time and the counters, unavailable counters read 0
+void ReadPerfCounters(const PerfCounters *counters, PerfSample *sample)
+{
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    memset(sample, 0, sizeof(PerfSample));
+    sample->time = (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+
+#if defined(PERF_EVENTS_SUPPORTED)
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        // Value, time enabled and time running, the counter only counts while it has a hardware slot
+        uint64_t values[3] = { 0 };
+
+        if ((counters == NULL) || (counters->fds[i] < 0)) continue;
+        if (read(counters->fds[i], values, sizeof(values)) != (ssize_t)sizeof(values)) continue;
+
+        sample->values[i] = (values[2] > 0)? (double)values[0]*((double)values[1]/(double)values[2]) : 0.0;
+    }
+#endif
+}
+
+// Add the time and counts between two samples to a stage
+void AddPerfStageSample(PerfStage *stage, const PerfSample *start, const PerfSample *end)
+{
+    stage->samplesCount++;
+    stage->time += end->time - start->time;
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) stage->values[i] += end->values[i] - start->values[i];
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Open a counter of the calling thread, user space only so it is allowed with perf_event_paranoid 2
+// NOTE: Returns -1 when the counter is not available
+static int OpenPerfCounter(int counter)
+{
+#if defined(PERF_EVENTS_SUPPORTED)
+    struct perf_event_attr attr = { 0 };
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter)
+    {
+        case PERF_COUNTER_CYCLES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PERF_COUNTER_INSTRUCTIONS: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PERF_COUNTER_BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case PERF_COUNTER_L1D_MISSES:
+        {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        } break;
+        case PERF_COUNTER_LLC_MISSES:
+        {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        } break;
+        default: return -1;
+    }
+
+    // Calling thread, any CPU, no group
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+    return (fd >= 0)? (int)fd : -1;
+#else
+    (void)counter;
+    return -1;
+#endif
+}
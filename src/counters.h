@@ -0,0 +1,78 @@
+/**********************************************************************************************
+*
+*   raycaster - Performance counters
+*
+*   Hardware counters of the calling thread (cycles, instructions, L1 data and last level cache
+*   misses, branch misses) read around the stages of a frame, on Linux with perf_event_open().
+*   Counters the system does not allow (containers, perf_event_paranoid, virtual machines,
+*   other platforms) are reported unavailable and read as 0, timings are always measured.
+*
+*   Counters follow the thread that loaded them: profile stages run on that thread, work done by
+*   the job system workers is not counted.
+*
+**********************************************************************************************/
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum PerfCounter
+{
+    PERF_COUNTER_CYCLES = 0,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_L1D_MISSES,            // L1 data cache read misses
+    PERF_COUNTER_LLC_MISSES,            // Last level cache read misses
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+}
+PerfCounter;
+
+typedef struct PerfCounters
+{
+    int fds[PERF_COUNTER_COUNT];        // Counter file descriptors, -1 when unavailable
+    int availableCount;
+}
+PerfCounters;
+
+// Counter values at a point in time
+typedef struct PerfSample
+{
+    double time;                        // Seconds
+    double values[PERF_COUNTER_COUNT];  // Counts since the counters were loaded, scaled when the kernel multiplexes them
+}
+PerfSample;
+
+// Counts accumulated over the runs of a stage
+typedef struct PerfStage
+{
+    const char *name;
+    int samplesCount;
+    double time;
+    double values[PERF_COUNTER_COUNT];
+}
+PerfStage;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Performance Counters Functions Declaration
+//----------------------------------------------------------------------------------
+PerfCounters *LoadPerfCounters(void);           // Open the counters of the calling thread the system allows
+void UnloadPerfCounters(PerfCounters *counters);
+bool IsPerfCounterAvailable(const PerfCounters *counters, int counter);
+const char *GetPerfCounterName(int counter);
+
+void ReadPerfCounters(const PerfCounters *counters, PerfSample *sample);
+void AddPerfStageSample(PerfStage *stage, const PerfSample *start, const PerfSample *end);  // Add the counts between two samples
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COUNTERS_H
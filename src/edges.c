@@ -0,0 +1,84 @@
+/**********************************************************************************************
+*
+*   raycaster - Map edges
+*
+*   Builds the faces of the map walls, grouped by tile.
+*
+**********************************************************************************************/
+
+#include "edges.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Map Edges Functions Definition
+//----------------------------------------------------------------------------------
+
+// Extract the faces of the non-empty tiles next to a tile that is not a wall
+// NOTE: Faces are listed west, east, north, south for every tile
+MapEdges *BuildMapEdges(const Map *map)
+{
+    static const int normals[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+    MapEdges *edges = (MapEdges *)calloc(1, sizeof(MapEdges));
+    int extendedCols = map->numCols + 2;
+    int extendedRows = map->numRows + 2;
+
+    edges->numCols = map->numCols;
+    edges->numRows = map->numRows;
+    edges->offsets = (int *)calloc((size_t)extendedCols*extendedRows + 1, sizeof(int));
+    edges->edges = (MapEdge *)malloc((size_t)extendedCols*extendedRows*4*sizeof(MapEdge));
+
+    for (int y = -1; y <= map->numRows; y++)
+    {
+        for (int x = -1; x <= map->numCols; x++)
+        {
+            int content = GetMapTile(map, x, y);
+            edges->offsets[(y + 1)*extendedCols + x + 1] = edges->edgesCount;
+
+            if (content == TILE_EMPTY) continue;
+
+            for (int side = 0; side < 4; side++)
+            {
+                int normalX = normals[side][0];
+                int normalY = normals[side][1];
+                int neighbourX = x + normalX;
+                int neighbourY = y + normalY;
+
+                // Nothing reaches a face between two walls, or a face looking out of the ring
+                if ((neighbourX < -1) || (neighbourX > map->numCols) || (neighbourY < -1) || (neighbourY > map->numRows)) continue;
+                if (GetMapTile(map, neighbourX, neighbourY) == TILE_WALL) continue;
+
+                // Face on the side of the neighbour, endpoints ordered along the grid line
+                float lineX = (float)((x + (normalX > 0))*TILE_SIZE);
+                float lineY = (float)((y + (normalY > 0))*TILE_SIZE);
+                MapEdge *edge = &edges->edges[edges->edgesCount++];
+
+                edge->gridIndexX = x;
+                edge->gridIndexY = y;
+                edge->normalX = normalX;
+                edge->normalY = normalY;
+                edge->x0 = (normalX != 0)? lineX : (float)(x*TILE_SIZE);
+                edge->y0 = (normalY != 0)? lineY : (float)(y*TILE_SIZE);
+                edge->x1 = (normalX != 0)? lineX : (float)((x + 1)*TILE_SIZE);
+                edge->y1 = (normalY != 0)? lineY : (float)((y + 1)*TILE_SIZE);
+                edge->content = content;
+            }
+        }
+    }
+
+    edges->offsets[extendedCols*extendedRows] = edges->edgesCount;
+    edges->edges = (MapEdge *)realloc(edges->edges, (edges->edgesCount > 0)? edges->edgesCount*sizeof(MapEdge) : sizeof(MapEdge));
+
+    return edges;
+}
+
+// Unload faces built with BuildMapEdges()
+void UnloadMapEdges(MapEdges *edges)
+{
+    if (edges == NULL) return;
+
+    free(edges->offsets);
+    free(edges->edges);
+    free(edges);
+}
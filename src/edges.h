@@ -0,0 +1,71 @@
+/**********************************************************************************************
+*
+*   raycaster - Map edges
+*
+*   Wall faces a ray can reach, extracted once from the tile grid: the sides of every non-empty
+*   tile whose neighbour is not a wall, so faces between two walls are never considered. Tiles
+*   outside the map are walls, the ring of tiles around the map is included.
+*
+*   Faces are grouped by tile, renderers walking the grid around the camera get the faces of
+*   each tile without looking at its neighbours.
+*
+**********************************************************************************************/
+
+#ifndef EDGES_H
+#define EDGES_H
+
+#include "map.h"
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MapEdge
+{
+    int gridIndexX;             // Tile the face belongs to
+    int gridIndexY;
+    int normalX;                // Direction the face looks at, only seen from that side
+    int normalY;
+    float x0;                   // Face endpoints in world units
+    float y0;
+    float x1;
+    float y1;
+    int content;                // TileType of the tile
+}
+MapEdge;
+
+typedef struct MapEdges
+{
+    int numCols;                // Map size, edges cover the tiles from -1 to numCols/numRows
+    int numRows;
+    int *offsets;               // First face of every tile, (numCols + 2)*(numRows + 2) + 1 entries
+    MapEdge *edges;             // Faces of all the tiles, grouped by tile
+    int edgesCount;
+}
+MapEdges;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Map Edges Functions Declaration
+//----------------------------------------------------------------------------------
+MapEdges *BuildMapEdges(const Map *map);        // Extract the faces of the map walls
+void UnloadMapEdges(MapEdges *edges);
+
+// Faces of a tile, tiles from -1 to numCols/numRows, returns the number of faces
+static inline int GetMapTileEdges(const MapEdges *edges, int gridIndexX, int gridIndexY, const MapEdge **tileEdges)
+{
+    if ((gridIndexX < -1) || (gridIndexX > edges->numCols) || (gridIndexY < -1) || (gridIndexY > edges->numRows)) return 0;
+
+    int tile = (gridIndexY + 1)*(edges->numCols + 2) + gridIndexX + 1;
+    *tileEdges = edges->edges + edges->offsets[tile];
+
+    return edges->offsets[tile + 1] - edges->offsets[tile];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EDGES_H
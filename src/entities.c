@@ -0,0 +1,187 @@
+/**********************************************************************************************
+*
+*   raycaster - Entities module
+*
+*   Dynamic objects stored as contiguous component arrays.
+*
+**********************************************************************************************/
+
+#include "entities.h"
+#include "collision.h"
+#include "jobs.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define ENTITIES_BATCH_SIZE 2048        // Entities per job batch
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MovePass
+{
+    EntityStore *store;
+    const Map *map;
+    float deltaTime;
+}
+MovePass;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void MoveEntities(void *userData, int start, int end);
+static void CompactEntities(EntityStore *store);
+
+//----------------------------------------------------------------------------------
+// Entities Functions Definition
+//----------------------------------------------------------------------------------
+
+// Allocate an entity store for up to capacity entities
+EntityStore *LoadEntityStore(int capacity)
+{
+    EntityStore *store = (EntityStore *)calloc(1, sizeof(EntityStore));
+
+    store->capacity = capacity;
+    store->x = (float *)calloc(capacity, sizeof(float));
+    store->y = (float *)calloc(capacity, sizeof(float));
+    store->velocityX = (float *)calloc(capacity, sizeof(float));
+    store->velocityY = (float *)calloc(capacity, sizeof(float));
+    store->angle = (float *)calloc(capacity, sizeof(float));
+    store->halfExtent = (float *)calloc(capacity, sizeof(float));
+    store->flags = (unsigned int *)calloc(capacity, sizeof(unsigned int));
+
+    return store;
+}
+
+// Release an entity store
+void UnloadEntityStore(EntityStore *store)
+{
+    if (store == NULL) return;
+
+    free(store->x);
+    free(store->y);
+    free(store->velocityX);
+    free(store->velocityY);
+    free(store->angle);
+    free(store->halfExtent);
+    free(store->flags);
+    free(store);
+}
+
+// Add an entity, returns its index or -1 if the store is full
+int SpawnEntity(EntityStore *store, float x, float y, float velocityX, float velocityY, float halfExtent, unsigned int flags)
+{
+    if (store->count >= store->capacity) return -1;
+
+    int index = store->count++;
+
+    store->x[index] = x;
+    store->y[index] = y;
+    store->velocityX[index] = velocityX;
+    store->velocityY[index] = velocityY;
+    store->angle[index] = atan2f(velocityY, velocityX);
+    store->halfExtent[index] = halfExtent;
+    store->flags[index] = (flags | ENTITY_ACTIVE) & ~ENTITY_UPDATE_FLAGS;
+
+    return index;
+}
+
+// Mark an entity for removal, the slot is reused after the next update
+void DespawnEntity(EntityStore *store, int index)
+{
+    if ((index >= 0) && (index < store->count)) store->flags[index] &= ~ENTITY_ACTIVE;
+}
+
+// Move all entities by their velocity, then remove the despawned ones
+void UpdateEntities(EntityStore *store, const Map *map, float deltaTime)
+{
+    MovePass pass = { store, map, deltaTime };
+
+    RunParallelFor(store->count, ENTITIES_BATCH_SIZE, MoveEntities, &pass);
+
+    CompactEntities(store);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Movement pass over entities [start, end)
+// NOTE: Every entity only writes its own slots, batches run in parallel without locking
+static void MoveEntities(void *userData, int start, int end)
+{
+    MovePass *pass = (MovePass *)userData;
+    EntityStore *store = pass->store;
+    float deltaTime = pass->deltaTime;
+
+    for (int i = start; i < end; i++)
+    {
+        unsigned int flags = store->flags[i] & ~ENTITY_UPDATE_FLAGS;
+
+        if (!(flags & ENTITY_ACTIVE))
+        {
+            store->flags[i] = flags;
+            continue;
+        }
+
+        float deltaX = store->velocityX[i]*deltaTime;
+        float deltaY = store->velocityY[i]*deltaTime;
+
+        if (flags & ENTITY_COLLIDES)
+        {
+            MoveResult move = MoveBoxOnMap(pass->map, store->x[i], store->y[i], store->halfExtent[i], store->halfExtent[i], deltaX, deltaY);
+
+            store->x[i] = move.x;
+            store->y[i] = move.y;
+
+            if (move.flags & MOVE_CROSSED_PORTAL) flags |= ENTITY_CROSSED_PORTAL;
+
+            if (move.flags & (MOVE_BLOCKED_X | MOVE_BLOCKED_Y))
+            {
+                flags |= ENTITY_HIT_WALL;
+
+                if (flags & ENTITY_DESPAWN_ON_HIT) flags &= ~ENTITY_ACTIVE;
+                else if (flags & ENTITY_BOUNCES)
+                {
+                    if (move.flags & MOVE_BLOCKED_X) store->velocityX[i] = -store->velocityX[i];
+                    if (move.flags & MOVE_BLOCKED_Y) store->velocityY[i] = -store->velocityY[i];
+                    if (flags & ENTITY_FACES_VELOCITY) store->angle[i] = atan2f(store->velocityY[i], store->velocityX[i]);
+                }
+            }
+        }
+        else
+        {
+            store->x[i] += deltaX;
+            store->y[i] += deltaY;
+        }
+
+        store->flags[i] = flags;
+    }
+}
+
+// Remove despawned entities, moving the last entities into the free slots
+static void CompactEntities(EntityStore *store)
+{
+    int i = 0;
+
+    while (i < store->count)
+    {
+        if (store->flags[i] & ENTITY_ACTIVE)
+        {
+            i++;
+            continue;
+        }
+
+        int last = --store->count;
+
+        store->x[i] = store->x[last];
+        store->y[i] = store->y[last];
+        store->velocityX[i] = store->velocityX[last];
+        store->velocityY[i] = store->velocityY[last];
+        store->angle[i] = store->angle[last];
+        store->halfExtent[i] = store->halfExtent[last];
+        store->flags[i] = store->flags[last];
+    }
+}
@@ -0,0 +1,72 @@
+/**********************************************************************************************
+*
+*   raycaster - Entities module
+*
+*   Dynamic objects (NPCs, projectiles...) stored as contiguous component arrays, one array
+*   per component, so update passes stream through memory and split well across threads.
+*   Movement goes through the same box collision and portal logic as the player.
+*
+*   Entities are addressed by index. Despawned entities are removed at the end of the next
+*   UpdateEntities() by moving the last entity into their slot, so indices are not stable
+*   across updates.
+*
+**********************************************************************************************/
+
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include "map.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+// Entity flags
+#define ENTITY_ACTIVE 1                 // Slot in use, cleared by DespawnEntity()
+#define ENTITY_COLLIDES 2               // Moves with map collision, otherwise moves freely
+#define ENTITY_BOUNCES 4                // Velocity is reflected by walls
+#define ENTITY_DESPAWN_ON_HIT 8         // Despawned when a wall stops it (projectiles)
+#define ENTITY_FACES_VELOCITY 16        // Angle turns to the velocity reflected by walls
+
+// Flags set by the last update
+#define ENTITY_HIT_WALL 256
+#define ENTITY_CROSSED_PORTAL 512
+#define ENTITY_UPDATE_FLAGS (ENTITY_HIT_WALL | ENTITY_CROSSED_PORTAL)
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct EntityStore
+{
+    int capacity;               // Allocated slots
+    int count;                  // Slots in use, entities are packed in [0, count)
+
+    float *x;                   // Position (box center)
+    float *y;
+    float *velocityX;           // Velocity in pixels per second
+    float *velocityY;
+    float *angle;               // Facing angle in radians
+    float *halfExtent;          // Half size of the collision box
+    unsigned int *flags;
+}
+EntityStore;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Entities Functions Declaration
+//----------------------------------------------------------------------------------
+EntityStore *LoadEntityStore(int capacity);
+void UnloadEntityStore(EntityStore *store);
+
+int SpawnEntity(EntityStore *store, float x, float y, float velocityX, float velocityY, float halfExtent, unsigned int flags);
+void DespawnEntity(EntityStore *store, int index);
+
+void UpdateEntities(EntityStore *store, const Map *map, float deltaTime);     // Move all entities, multithreaded
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENTITIES_H
@@ -0,0 +1,353 @@
+/**********************************************************************************************
+*
+*   raycaster - Flow field
+*
+*   Breadth-first search from the goal tile, one level at a time over the job system.
+*
+**********************************************************************************************/
+
+#include "flow.h"
+#include "jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define FLOW_BATCH_SIZE 512             // Frontier tiles per job batch
+#define FLOW_MAX_CLAIMS 8               // Tiles a frontier tile can reach: 4 neighbours and up to 4 portal links
+#define FLOW_ROWS_BATCH_SIZE 16         // Rows per job batch of the directions pass
+
+#define FLOW_LINK_ENTRANCE 1
+#define FLOW_LINK_EXIT 2
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct FlowExpandJob
+{
+    FlowField *field;
+    int nextCount;                      // Tiles added to the next frontier (atomic)
+}
+FlowExpandJob;
+
+typedef struct FlowDirectionsJob
+{
+    FlowField *field;
+    int firstRow;
+}
+FlowDirectionsJob;
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static const int directionStepX[FLOW_DIRECTION_NONE] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int directionStepY[FLOW_DIRECTION_NONE] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void FindFlowLinks(FlowField *field);
+static void ClearFlowCosts(void *userData, int start, int end);
+static void FlushFlowClaims(FlowExpandJob *job, const int *claimed, int *claimedCount);
+static void ExpandFlowFrontier(void *userData, int start, int end);
+static void ComputeFlowDirections(void *userData, int start, int end);
+
+//----------------------------------------------------------------------------------
+// Flow Field Functions Definition
+//----------------------------------------------------------------------------------
+
+FlowField *LoadFlowField(const Map *map)
+{
+    FlowField *field = (FlowField *)calloc(1, sizeof(FlowField));
+    int tilesCount = map->numCols*map->numRows;
+
+    field->map = map;
+    field->goalX = -1;
+    field->goalY = -1;
+    field->costs = (uint32_t *)malloc(tilesCount*sizeof(uint32_t));
+    field->directions = (unsigned char *)malloc(tilesCount);
+    field->buildCosts = (uint32_t *)malloc(tilesCount*sizeof(uint32_t));
+    field->buildDirections = (unsigned char *)malloc(tilesCount);
+    field->frontier = (int *)malloc(tilesCount*sizeof(int));
+    field->nextFrontier = (int *)malloc(tilesCount*sizeof(int));
+    field->linkTiles = (unsigned char *)calloc(tilesCount, 1);
+
+    memset(field->costs, 0xff, tilesCount*sizeof(uint32_t));
+    memset(field->directions, FLOW_DIRECTION_NONE, tilesCount);
+
+    FindFlowLinks(field);
+
+    return field;
+}
+
+void UnloadFlowField(FlowField *field)
+{
+    if (field == NULL) return;
+
+    free(field->links);
+    free(field->linkTiles);
+    free(field->nextFrontier);
+    free(field->frontier);
+    free(field->buildDirections);
+    free(field->buildCosts);
+    free(field->directions);
+    free(field->costs);
+    free(field);
+}
+
+// Start a search from a new goal tile, a goal tile that is not empty leaves every direction to FLOW_DIRECTION_NONE
+void SetFlowFieldGoal(FlowField *field, int gridIndexX, int gridIndexY)
+{
+    if (field->building && (gridIndexX == field->buildGoalX) && (gridIndexY == field->buildGoalY)) return;
+    if (!field->building && (gridIndexX == field->goalX) && (gridIndexY == field->goalY)) return;
+
+    field->building = true;
+    field->buildGoalX = gridIndexX;
+    field->buildGoalY = gridIndexY;
+    field->frontierCount = 0;
+    field->level = 0;
+    field->directionsRow = 0;
+
+    RunParallelFor(field->map->numRows, FLOW_ROWS_BATCH_SIZE, ClearFlowCosts, field);
+
+    if (GetMapTile(field->map, gridIndexX, gridIndexY) == TILE_EMPTY)
+    {
+        int goal = gridIndexY*field->map->numCols + gridIndexX;
+
+        field->buildCosts[goal] = 0;
+        field->frontier[field->frontierCount++] = goal;
+    }
+}
+
+// Expand whole search levels, then compute the directions, until maxTiles have been processed
+bool UpdateFlowField(FlowField *field, int maxTiles)
+{
+    if (!field->building) return true;
+
+    const Map *map = field->map;
+    int processedCount = 0;
+
+    while (field->frontierCount > 0)
+    {
+        if ((maxTiles > 0) && (processedCount >= maxTiles)) return false;
+
+        FlowExpandJob job = { field, 0 };
+        RunParallelFor(field->frontierCount, FLOW_BATCH_SIZE, ExpandFlowFrontier, &job);
+
+        processedCount += field->frontierCount;
+
+        int *frontier = field->frontier;
+        field->frontier = field->nextFrontier;
+        field->nextFrontier = frontier;
+        field->frontierCount = job.nextCount;
+        field->level++;
+    }
+
+    while (field->directionsRow < map->numRows)
+    {
+        if ((maxTiles > 0) && (processedCount >= maxTiles)) return false;
+
+        int rowsCount = map->numRows - field->directionsRow;
+        int budgetRows = (maxTiles > 0)? (maxTiles - processedCount)/map->numCols : rowsCount;
+        if (budgetRows < 1) budgetRows = 1;
+        if (budgetRows < rowsCount) rowsCount = budgetRows;
+
+        FlowDirectionsJob job = { field, field->directionsRow };
+        RunParallelFor(rowsCount, FLOW_ROWS_BATCH_SIZE, ComputeFlowDirections, &job);
+
+        processedCount += rowsCount*map->numCols;
+        field->directionsRow += rowsCount;
+    }
+
+    // The new field replaces the sampled one
+    uint32_t *costs = field->costs;
+    unsigned char *directions = field->directions;
+    field->costs = field->buildCosts;
+    field->directions = field->buildDirections;
+    field->buildCosts = costs;
+    field->buildDirections = directions;
+
+    field->goalX = field->buildGoalX;
+    field->goalY = field->buildGoalY;
+    field->building = false;
+    field->buildsCount++;
+
+    return true;
+}
+
+void BuildFlowField(FlowField *field, int gridIndexX, int gridIndexY)
+{
+    SetFlowFieldGoal(field, gridIndexX, gridIndexY);
+    UpdateFlowField(field, 0);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Find the links of the portal pairs: the empty tile in front of every face of a portal to the empty tile behind its destination
+static void FindFlowLinks(FlowField *field)
+{
+    const Map *map = field->map;
+
+    field->links = (FlowLink *)calloc((size_t)map->portalsCount*4 + 1, sizeof(FlowLink));
+
+    for (int i = 0; i < map->portalsCount; i++)
+    {
+        const portal_t *portal = &map->portals[i];
+        const portal_t *destination = GetMapDestinationPortal(map, portal);
+        if (destination == NULL) continue;
+
+        for (int direction = 0; direction < 4; direction++)
+        {
+            int stepX = directionStepX[direction];
+            int stepY = directionStepY[direction];
+            int entranceX = portal->gridIndexX - stepX;
+            int entranceY = portal->gridIndexY - stepY;
+            int exitX = destination->gridIndexX + stepX;
+            int exitY = destination->gridIndexY + stepY;
+
+            if ((GetMapTile(map, entranceX, entranceY) != TILE_EMPTY) || (GetMapTile(map, exitX, exitY) != TILE_EMPTY)) continue;
+
+            FlowLink link = { entranceY*map->numCols + entranceX, exitY*map->numCols + exitX, direction };
+            field->links[field->linksCount++] = link;
+            field->linkTiles[link.entrance] |= FLOW_LINK_ENTRANCE;
+            field->linkTiles[link.exit] |= FLOW_LINK_EXIT;
+        }
+    }
+}
+
+// Reset the search costs of rows [start, end)
+static void ClearFlowCosts(void *userData, int start, int end)
+{
+    FlowField *field = (FlowField *)userData;
+    int numCols = field->map->numCols;
+
+    memset(field->buildCosts + (size_t)start*numCols, 0xff, (size_t)(end - start)*numCols*sizeof(uint32_t));
+}
+
+// Append claimed tiles to the next frontier
+static void FlushFlowClaims(FlowExpandJob *job, const int *claimed, int *claimedCount)
+{
+    if (*claimedCount == 0) return;
+
+    int offset = __atomic_fetch_add(&job->nextCount, *claimedCount, __ATOMIC_RELAXED);
+    memcpy(job->field->nextFrontier + offset, claimed, *claimedCount*sizeof(int));
+    *claimedCount = 0;
+}
+
+// Claim the unvisited empty tiles one step from frontier tiles [start, end) for the next level
+// NOTE: Tiles reached from several frontier tiles are claimed once, by compare and swap. The range
+// is the whole frontier when RunParallelFor() runs it inline, claims are appended to the next
+// frontier every FLOW_BATCH_SIZE frontier tiles so they fit the stack buffer
+static void ExpandFlowFrontier(void *userData, int start, int end)
+{
+    FlowExpandJob *job = (FlowExpandJob *)userData;
+    FlowField *field = job->field;
+    const Map *map = field->map;
+    uint32_t nextCost = field->level + 1;
+    int claimed[FLOW_BATCH_SIZE*FLOW_MAX_CLAIMS];
+    int claimedCount = 0;
+
+    for (int f = start; f < end; f++)
+    {
+        if ((f - start)%FLOW_BATCH_SIZE == 0) FlushFlowClaims(job, claimed, &claimedCount);
+
+        int tile = field->frontier[f];
+        int gridIndexX = tile%map->numCols;
+        int gridIndexY = tile/map->numCols;
+
+        // Tiles walking to this one, which are the same as the ones it walks to, and the portal entrances coming out here
+        int sources[FLOW_MAX_CLAIMS];
+        int sourcesCount = 0;
+
+        for (int direction = 0; direction < 4; direction++)
+        {
+            int neighbourX = gridIndexX + directionStepX[direction];
+            int neighbourY = gridIndexY + directionStepY[direction];
+
+            if (GetMapTile(map, neighbourX, neighbourY) == TILE_EMPTY) sources[sourcesCount++] = neighbourY*map->numCols + neighbourX;
+        }
+
+        if (field->linkTiles[tile] & FLOW_LINK_EXIT)
+        {
+            for (int i = 0; (i < field->linksCount) && (sourcesCount < FLOW_MAX_CLAIMS); i++)
+            {
+                if (field->links[i].exit == tile) sources[sourcesCount++] = field->links[i].entrance;
+            }
+        }
+
+        for (int i = 0; i < sourcesCount; i++)
+        {
+            uint32_t expected = FLOW_UNREACHABLE;
+
+            if ((__atomic_load_n(&field->buildCosts[sources[i]], __ATOMIC_RELAXED) == FLOW_UNREACHABLE) &&
+                __atomic_compare_exchange_n(&field->buildCosts[sources[i]], &expected, nextCost, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                claimed[claimedCount++] = sources[i];
+            }
+        }
+    }
+
+    FlushFlowClaims(job, claimed, &claimedCount);
+}
+
+// Point every tile of rows [firstRow + start, firstRow + end) to its neighbour closest to the goal
+// NOTE: Diagonals need both orthogonal tiles next to them empty, so agents don't cut wall corners
+static void ComputeFlowDirections(void *userData, int start, int end)
+{
+    FlowDirectionsJob *job = (FlowDirectionsJob *)userData;
+    FlowField *field = job->field;
+    const Map *map = field->map;
+    const uint32_t *costs = field->buildCosts;
+
+    for (int gridIndexY = job->firstRow + start; gridIndexY < job->firstRow + end; gridIndexY++)
+    {
+        for (int gridIndexX = 0; gridIndexX < map->numCols; gridIndexX++)
+        {
+            int tile = gridIndexY*map->numCols + gridIndexX;
+            uint32_t bestCost = costs[tile];
+            int bestDirection = FLOW_DIRECTION_NONE;
+
+            if ((bestCost != FLOW_UNREACHABLE) && (bestCost > 0))
+            {
+                bool open[4] = { false };
+
+                for (int direction = 0; direction < FLOW_DIRECTION_NONE; direction++)
+                {
+                    int neighbourX = gridIndexX + directionStepX[direction];
+                    int neighbourY = gridIndexY + directionStepY[direction];
+
+                    if (GetMapTile(map, neighbourX, neighbourY) != TILE_EMPTY) continue;
+                    if (direction < 4) open[direction] = true;
+                    else if (!open[direction - 4] || !open[(direction - 3)%4]) continue;
+
+                    uint32_t cost = costs[neighbourY*map->numCols + neighbourX];
+
+                    // NOTE: A diagonal is two steps of the search, it wins over both orthogonal tiles it passes by
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestDirection = direction;
+                    }
+                }
+
+                if (field->linkTiles[tile] & FLOW_LINK_ENTRANCE)
+                {
+                    for (int i = 0; i < field->linksCount; i++)
+                    {
+                        if ((field->links[i].entrance == tile) && (costs[field->links[i].exit] < bestCost))
+                        {
+                            bestCost = costs[field->links[i].exit];
+                            bestDirection = field->links[i].direction;
+                        }
+                    }
+                }
+            }
+
+            field->buildDirections[tile] = (unsigned char)bestDirection;
+        }
+    }
+}
@@ -0,0 +1,125 @@
+/**********************************************************************************************
+*
+*   raycaster - Flow field
+*
+*   Shared pathfinding for any number of agents going to the same goal tile. A breadth-first
+*   search from the goal over the empty tiles gives the steps to the goal from every tile, and
+*   every tile keeps the direction of its neighbour closest to the goal, diagonals included
+*   when they don't cut a wall corner. Agents just sample the direction of their tile.
+*
+*   Portal pairs are links: walking into a portal tile comes out on the other side of its
+*   destination portal (like GetMapPortalTransit()), for the cost of the step into the portal.
+*
+*   Rebuilds only happen when the goal tile changes and can be spread over frames: the search
+*   goes on with UpdateFlowField() up to a tiles budget per call while the previous field is
+*   still sampled, then the new field replaces it. Rebuilds are full searches spread over frames,
+*   not incremental: moving the goal one tile changes the cost of every reachable tile (each one
+*   gets a step closer or farther), a dirty frontier seeded from the old and new goal tiles would
+*   reach the whole map. Every search level is expanded in parallel over the job system.
+*
+**********************************************************************************************/
+
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define FLOW_UNREACHABLE 0xffffffffu    // Cost of walls and of the tiles with no path to the goal
+
+// Directions, orthogonal first
+#define FLOW_DIRECTION_EAST 0
+#define FLOW_DIRECTION_SOUTH 1
+#define FLOW_DIRECTION_WEST 2
+#define FLOW_DIRECTION_NORTH 3
+#define FLOW_DIRECTION_SOUTH_EAST 4
+#define FLOW_DIRECTION_SOUTH_WEST 5
+#define FLOW_DIRECTION_NORTH_WEST 6
+#define FLOW_DIRECTION_NORTH_EAST 7
+#define FLOW_DIRECTION_NONE 8           // Goal tile, walls and unreachable tiles
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Walking from the entrance tile into a portal comes out on the exit tile
+typedef struct FlowLink
+{
+    int entrance;                       // Tile indices (row*numCols + col)
+    int exit;
+    int direction;                      // Orthogonal direction of the step into the portal
+}
+FlowLink;
+
+typedef struct FlowField
+{
+    const Map *map;                     // Shared world, never written
+    int goalX;                          // Goal tile of the directions, -1 before the first build
+    int goalY;
+    uint32_t *costs;                    // Steps to the goal from every tile, row-major
+    unsigned char *directions;          // Direction to take on every tile, row-major
+
+    bool building;                      // Search in progress, the field above is still sampled
+    int buildGoalX;
+    int buildGoalY;
+    uint32_t *buildCosts;
+    unsigned char *buildDirections;
+    int *frontier;                      // Tiles of the current search level
+    int frontierCount;
+    int *nextFrontier;
+    uint32_t level;
+    int directionsRow;                  // Next row of the directions pass, once the search is done
+
+    FlowLink *links;
+    int linksCount;
+    unsigned char *linkTiles;           // Entrance (1) and exit (2) flags of the link tiles
+
+    int buildsCount;                    // Completed builds
+}
+FlowField;
+
+// Unit vectors of the directions
+static const float flowDirectionX[FLOW_DIRECTION_NONE + 1] = { 1.0f, 0.0f, -1.0f, 0.0f, 0.70710678f, -0.70710678f, -0.70710678f, 0.70710678f, 0.0f };
+static const float flowDirectionY[FLOW_DIRECTION_NONE + 1] = { 0.0f, 1.0f, 0.0f, -1.0f, 0.70710678f, 0.70710678f, -0.70710678f, -0.70710678f, 0.0f };
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Flow Field Functions Declaration
+//----------------------------------------------------------------------------------
+FlowField *LoadFlowField(const Map *map);       // No goal, every direction is FLOW_DIRECTION_NONE
+void UnloadFlowField(FlowField *field);
+void SetFlowFieldGoal(FlowField *field, int gridIndexX, int gridIndexY);   // Start a rebuild when the goal tile changes
+bool UpdateFlowField(FlowField *field, int maxTiles);       // Go on with the rebuild, maxTiles <= 0 finishes it, true once up to date
+void BuildFlowField(FlowField *field, int gridIndexX, int gridIndexY);     // Set the goal and finish the rebuild
+
+// Direction to take at the given world position, (0, 0) on the goal tile and where the goal can't be reached
+static inline int GetFlowDirection(const FlowField *field, float x, float y, float *directionX, float *directionY)
+{
+    int gridIndexX = (int)floorf(x/TILE_SIZE);
+    int gridIndexY = (int)floorf(y/TILE_SIZE);
+    int direction = FLOW_DIRECTION_NONE;
+
+    if ((gridIndexX >= 0) && (gridIndexX < field->map->numCols) && (gridIndexY >= 0) && (gridIndexY < field->map->numRows))
+    {
+        direction = field->directions[gridIndexY*field->map->numCols + gridIndexX];
+    }
+
+    *directionX = flowDirectionX[direction];
+    *directionY = flowDirectionY[direction];
+
+    return direction;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLOW_H
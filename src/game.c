@@ -6,14 +6,31 @@
 #include <float.h>
 #include <assert.h>
 
+#include "map.h"
+#include "collision.h"
+#include "entities.h"
+#include "flow.h"
+#include "input.h"
+#include "capture.h"
+#include "jobs.h"
+#include "loader.h"
+#include "light.h"
+#include "raycast.h"
+#include "pvs.h"
+#include "edges.h"
+#include "renderer.h"
+#include "pixels.h"
+#include "arena.h"
+
+#if defined(PLATFORM_WEB)
+    #include <emscripten/emscripten.h>
+#endif
+
 #define KEY_UP 265
 #define KEY_DOWN 264
 #define KEY_LEFT 263
 #define KEY_RIGHT 262
 
-#define TWO_PI 2*PI
-
-#define TILE_SIZE 48
 #define MAP_NUM_ROWS 13
 #define MAP_NUM_COLS 20
 
@@ -26,15 +43,36 @@
 #define TEXTURE_HEIGHT 64
 
 #define FOV_ANGLE (60 * (PI / 180))
-#define DIST_PROJ_PLANE ((WINDOW_WIDTH / 2) / tan(FOV_ANGLE / 2))
 
-#define NUM_RAYS WINDOW_WIDTH
-#define MAX_WALLS_TRAVERSED_PER_RAY 10
+#define SPLIT_VIEWS 4
+#define SECURITY_CAMERA_PAN (45 * (PI / 180))
+#define VIEW_CAST_INTERVAL 8            // Columns between ray casts, coherent walls are followed between them
 
 #define FPS 100
+#define INPUT_POLL_INTERVAL 0.001       // Seconds between input samples while waiting for the input latch
+
+#define CAPTURE_SINK CAPTURE_SINK_Y4M   // Recording of the player view, see capture.h
+#define CAPTURE_TARGET "capture.y4m"    // File name, or shared memory object name ("/raycaster") for CAPTURE_SINK_SHM
+#define CAPTURE_POLICY CAPTURE_POLICY_DROP
 
 #define TOTAL_PORTALS 2
 
+#define TOTAL_LIGHTS 4
+#define AMBIENT_LIGHT 96                // Light level of the faces no light reaches
+#define LANTERN_RADIUS (4 * TILE_SIZE)  // Light carried by the player
+#define LANTERN_INTENSITY 0.5f
+
+#define FRAME_STATS_INTERVAL 500    // Frames between frame timing reports
+
+#define FRAME_ARENA_SIZE (WINDOW_WIDTH * WINDOW_HEIGHT * 4 + 64 * 1024)    // Frame scratch: indexed views expanded for the upload
+#define MAP_ARENA_SIZE (64 * 1024)                                         // Map lifetime: minimap visibility
+
+#define MAX_ENTITIES 1024
+#define NUM_WANDERERS 8
+#define WANDERER_SPEED 60
+#define CHASE_BUILD_TILES 4096          // Flow field tiles searched per frame while chasing
+#define PROJECTILE_SPEED 600
+
 const int map[MAP_NUM_ROWS][MAP_NUM_COLS] = {
     { 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
     { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
@@ -62,35 +100,9 @@ struct Player
     float rotationAngle;
     float walkSpeed;
     float turnSpeed;
-    bool isCrossingPortal;
 }
 player;
 
-struct WallHit
-{
-    int wallGridIndexX;
-    int wallGridIndexY;
-    float rayOriginX;
-    float rayOriginY;
-    float wallHitX;
-    float wallHitY;
-    float distance;
-    bool wasHitVertical;
-    int wallHitContent;
-};
-
-struct RayLight
-{
-    float rayAngle;
-    int isRayFacingUp;
-    int isRayFacingDown;
-    int isRayFacingLeft;
-    int isRayFacingRight;
-    int wallsTraversedCount;
-    struct WallHit walls[MAX_WALLS_TRAVERSED_PER_RAY];
-}
-rays[NUM_RAYS];
-
 typedef struct
 {
     int width;
@@ -99,103 +111,202 @@ typedef struct
 }
 texture_t;
 
-typedef struct Portal
-{
-    int gridIndexX;
-    int gridIndexY;
-}
-portal_t;
-
 portal_t portals[TOTAL_PORTALS] = {
     { .gridIndexX = 1, .gridIndexY = 0 },
     { .gridIndexX = 18, .gridIndexY = 12 }
 };
 
-Image windowBuffer = { 0 };
-Texture2D windowTexture = { 0 };
+const Light lights[TOTAL_LIGHTS] = {
+    { .x = 2.5f * TILE_SIZE, .y = 1.5f * TILE_SIZE, .radius = 5 * TILE_SIZE, .intensity = 0.7f },
+    { .x = 10.5f * TILE_SIZE, .y = 6.5f * TILE_SIZE, .radius = 6 * TILE_SIZE, .intensity = 0.6f },
+    { .x = 17.5f * TILE_SIZE, .y = 9.5f * TILE_SIZE, .radius = 5 * TILE_SIZE, .intensity = 0.6f },
+    { .x = 3.5f * TILE_SIZE, .y = 11.5f * TILE_SIZE, .radius = 4 * TILE_SIZE, .intensity = 0.5f }
+};
+
+const Map world = {
+    .numCols = MAP_NUM_COLS,
+    .numRows = MAP_NUM_ROWS,
+    .tiles = &map[0][0],
+    .portals = portals,
+    .portalsCount = TOTAL_PORTALS
+};
+
+EntityStore *entities = NULL;
+
+// Chase: wanderers follow a flow field to the player tile instead of bouncing around
+FlowField *chaseField = NULL;
+bool chasePlayer = false;
+
+MapPvs *worldPvs = NULL;
+bool minimapCulling = true;     // Only draw the tiles and entities potentially visible from the player tile
+bool *visibleTiles = NULL;      // Minimap tiles drawn this frame, row-major
+int *pvsTiles = NULL;           // Tiles potentially visible from the player tile
+
+// Lighting: the lights of the map baked at load time, the player lantern relit on the loader thread as it moves
+Lightmap *worldLightmap = NULL;
+int lanternLight = -1;
+bool litViews = true;
+
+// Input: key events sampled with their time, the simulation runs up to the input latch time
+const int inputKeys[] = { KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_SPACE, KEY_P, KEY_V, KEY_I, KEY_C, KEY_M, KEY_R, KEY_L };
+InputQueue inputQueue = { 0 };
+InputLatch inputLatch = { 0 };
+double inputLatchTime = 0.0;        // Input sampled up to this time is applied this frame
+double previousLatchTime = 0.0;
+double playerTime = 0.0;            // Player moved up to this time
+double latchedInputTime = 0.0;      // Sample times of the events applied this frame, summed
+int latchedInputCount = 0;
+
+// Frame timings accumulated between reports, in seconds
+struct FrameStats
+{
+    double renderTime;
+    double lastFrameTime;
+    double frameTime;
+    double inputLatency;            // From the sample of an event to the present of its frame
+    int inputEventsCount;
+    int framesCount;
+}
+frameStats = { 0 };
+
+// Render contexts: the full window player view, and the quarter window views of the split-screen
+// (player, rear view and two security cameras)
+RenderContext *mainView = NULL;
+RenderContext *splitViews[SPLIT_VIEWS] = { 0 };
+Texture2D mainViewTexture = { 0 };
+Texture2D splitViewTextures[SPLIT_VIEWS] = { 0 };
+bool splitScreen = false;
+
+// Indexed rendering: views write palette indices, expanded to colors before the upload
+RenderPalette *viewPalette = NULL;
+bool indexedViews = false;
+
+// Face walk rendering: views walk the wall faces of the world to find the walls of their columns
+MapEdges *worldEdges = NULL;
+bool faceWalkViews = false;
+
+// Capture: the player view renders straight into the buffers of the capture ring, written out by its thread
+FrameCapture *frameCapture = NULL;
+uint32_t *captureFrame = NULL;      // Capture buffer the main view renders into this frame
+uint32_t *mainViewPixels = NULL;    // Framebuffer of the main view while it renders into captureFrame
+
+// Memory of the main loop, nothing is allocated on the heap after the first frame
+MemoryArena *frameArena = NULL;     // Reset at the start of every frame
+MemoryArena *mapArena = NULL;       // Reset when the map is unloaded
+
+const RenderCamera securityCameras[SPLIT_VIEWS - 2] = {
+    { .x = 1.5f * TILE_SIZE, .y = 11.5f * TILE_SIZE, .angle = -PI / 4 },
+    { .x = 18.5f * TILE_SIZE, .y = 1.5f * TILE_SIZE, .angle = 3 * PI / 4 }
+};
+
+// Creates a GPU texture to upload the framebuffer of a view
+Texture2D LoadViewTexture(const RenderContext *view)
+{
+    Image image = {
+        .data = view->pixels,
+        .width = view->width,
+        .height = view->height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    return LoadTextureFromImage(image);
+}
 
 void ReleaseResources()
 {
-    UnloadImage(windowBuffer);	// Releases the RAM memory allocated for the window buffer data
-    UnloadTexture(windowTexture);	// Releases the texture from the GPU memory
+    UnloadFrameCapture(frameCapture);
+    UnloadTexture(mainViewTexture);	// Releases the textures from the GPU memory
+    UnloadRenderContext(mainView);
+    for (int i = 0; i < SPLIT_VIEWS; i++)
+    {
+        UnloadTexture(splitViewTextures[i]);
+        UnloadRenderContext(splitViews[i]);
+    }
+    UnloadRenderPalette(viewPalette);
+    UnloadEntityStore(entities);
+    UnloadFlowField(chaseField);
+    UnloadMapPvs(worldPvs);
+    UnloadMapEdges(worldEdges);
+    UnloadLightmap(worldLightmap);
+    UnloadMemoryArena(frameArena);
+    UnloadMemoryArena(mapArena);
+    CloseLoader();
+    CloseJobSystem();
 }
 
 void Setup()
 {
     player.x = WINDOW_WIDTH / 2;
     player.y = WINDOW_HEIGHT / 2;
-    player.width = 1;
-    player.height = 1;
+    player.width = 16;
+    player.height = 16;
     player.turnDirection = 0;
     player.walkDirection = 0;
     player.rotationAngle = PI;
     player.walkSpeed = 200;
     player.turnSpeed = 110 *(PI / 180);
-    player.isCrossingPortal = false;
 
-   	// Initialize the window buffer
-    windowBuffer.width = WINDOW_WIDTH;
-    windowBuffer.height = WINDOW_HEIGHT;
-    windowBuffer.mipmaps = 1;
-    windowBuffer.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    InitJobSystem(-1);
+    InitLoader();
 
-   	// allocate memory for the window buffer data
-    unsigned int bufferSize = GetPixelDataSize(windowBuffer.width, windowBuffer.height, windowBuffer.format);
-    windowBuffer.data = (uint32_t*) malloc(bufferSize);
+    // Precompute the tiles visible from every tile of the map
+    worldPvs = BuildMapPvs(&world, PVS_DEFAULT_SAMPLES, PVS_DEFAULT_RAYS);
+    worldEdges = BuildMapEdges(&world);
+    chaseField = LoadFlowField(&world);
 
-   	// Initialize the window texture
-    windowTexture = LoadTextureFromImage(windowBuffer);	// Creates and load the texture in the GPU
-}
+    // Bake the lights of the map and the lantern where the player starts
+    worldLightmap = LoadLightmap(&world, AMBIENT_LIGHT);
+    for (int i = 0; i < TOTAL_LIGHTS; i++) AddLight(worldLightmap, lights[i]);
+    lanternLight = AddLight(worldLightmap, (Light){ .x = player.x, .y = player.y, .radius = LANTERN_RADIUS, .intensity = LANTERN_INTENSITY });
+    BakeLightmap(worldLightmap);
 
-bool MapHasWallAt(float x, float y)
-{
-    if (x < 0 || x > WINDOW_WIDTH || y < 0 || y > WINDOW_HEIGHT)
-    {
-        return true;
-    }
-    int mapGridIndexX = floor(x / TILE_SIZE);
-    int mapGridIndexY = floor(y / TILE_SIZE);
-    return map[mapGridIndexY][mapGridIndexX] != 0;
-}
+    frameArena = LoadMemoryArena(FRAME_ARENA_SIZE);
+    mapArena = LoadMemoryArena(MAP_ARENA_SIZE);
+    visibleTiles = (bool *)ArenaCalloc(mapArena, MAP_NUM_ROWS * MAP_NUM_COLS, sizeof(bool));
+    pvsTiles = (int *)ArenaCalloc(mapArena, MAP_NUM_ROWS * MAP_NUM_COLS, sizeof(int));
 
-int GetMapWallTypeAt(float x, float y)
-{
-    if (x < 0 || x > WINDOW_WIDTH || y < 0 || y > WINDOW_HEIGHT)
+    // Spawn some wanderers bouncing around the empty tiles of the map
+    entities = LoadEntityStore(MAX_ENTITIES);
+    while (entities->count < NUM_WANDERERS)
     {
-        return 1;
+        int gridIndexX = GetRandomValue(0, MAP_NUM_COLS - 1);
+        int gridIndexY = GetRandomValue(0, MAP_NUM_ROWS - 1);
+        if (map[gridIndexY][gridIndexX] != 0) continue;
+
+        float angle = GetRandomValue(0, 359) *(PI / 180);
+        SpawnEntity(entities, (gridIndexX + 0.5f) *TILE_SIZE, (gridIndexY + 0.5f) *TILE_SIZE,
+            cos(angle) *WANDERER_SPEED, sin(angle) *WANDERER_SPEED, 6, ENTITY_COLLIDES | ENTITY_BOUNCES | ENTITY_FACES_VELOCITY);
     }
-    int mapGridIndexX = floor(x / TILE_SIZE);
-    int mapGridIndexY = floor(y / TILE_SIZE);
-    return map[mapGridIndexY][mapGridIndexX];
-}
 
-portal_t* GetPortalAtGridPosition(int x, int y)
-{
-    for (int i=0; i < TOTAL_PORTALS; i++)
+   	// Initialize the views, each one with its own camera, rays and framebuffer over the shared world
+    mainView = LoadRenderContext(&world, WINDOW_WIDTH, WINDOW_HEIGHT, FOV_ANGLE);
+    mainViewTexture = LoadViewTexture(mainView);
+
+    for (int i = 0; i < SPLIT_VIEWS; i++)
     {
-        if ((portals[i].gridIndexX == x) && (portals[i].gridIndexY == y))
-        {
-            return &portals[i];
-        }
+        splitViews[i] = LoadRenderContext(&world, WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2, FOV_ANGLE);
+        splitViewTextures[i] = LoadViewTexture(splitViews[i]);
     }
 
-    // No portal found at the given position of the map grid
-    return NULL;
-}
-
-portal_t* GetDestinationPortalFromSourcePortal(portal_t *sourcePortal)
-{
-    for (int i=0; i < TOTAL_PORTALS; i++)
+    viewPalette = LoadRenderPalette(NULL, 0);
+    mainView->palette = viewPalette;
+    mainView->castInterval = VIEW_CAST_INTERVAL;
+    mainView->edges = worldEdges;
+    mainView->lightmap = worldLightmap;
+    for (int i = 0; i < SPLIT_VIEWS; i++)
     {
-        // Return the other portal
-        if (&portals[i] != sourcePortal)
-        {
-            return &portals[i];
-        }
+        splitViews[i]->palette = viewPalette;
+        splitViews[i]->castInterval = VIEW_CAST_INTERVAL;
+        splitViews[i]->edges = worldEdges;
+        splitViews[i]->lightmap = worldLightmap;
     }
 
-    // No destination portal found
-    return NULL;
+    InitInputQueue(&inputQueue, inputKeys, sizeof(inputKeys)/sizeof(inputKeys[0]));
+    InitInputLatch(&inputLatch, 1.0 / FPS, GetTime());
+    inputLatchTime = previousLatchTime = playerTime = GetTime();
+
+    frameStats.lastFrameTime = GetTime();
 }
 
 void MovePlayer(float deltaTime)
@@ -203,44 +314,43 @@ void MovePlayer(float deltaTime)
     player.rotationAngle += player.turnDirection *player.turnSpeed * deltaTime;
     float moveStep = player.walkDirection *player.walkSpeed * deltaTime;
 
-    float newPlayerX = player.x + cos(player.rotationAngle) *moveStep;
-    float newPlayerY = player.y + sin(player.rotationAngle) *moveStep;
+    // Sweep the player box against the map, sliding along walls and going through portals
+    MoveResult move = MoveBoxOnMap(&world, player.x, player.y, player.width / 2, player.height / 2,
+        cos(player.rotationAngle) *moveStep, sin(player.rotationAngle) *moveStep);
 
-    int wallType = GetMapWallTypeAt(newPlayerX, newPlayerY);
-    if (wallType == 0)
-    {
-        player.x = newPlayerX;
-        player.y = newPlayerY;
-        player.isCrossingPortal = false;
-    }
-    else if (player.isCrossingPortal && (wallType == 3))
-    {
-        player.x = newPlayerX;
-        player.y = newPlayerY;
-    }
-    else if (!player.isCrossingPortal && (wallType == 3))
-    {
-        // Player is crossing a portal
-        int portalGridIndexX = floor(newPlayerX / TILE_SIZE);
-        int portalGridIndexY = floor(newPlayerY / TILE_SIZE);
+    player.x = move.x;
+    player.y = move.y;
+}
 
-        portal_t *sourcePortal = GetPortalAtGridPosition(portalGridIndexX, portalGridIndexY);
-        assert (sourcePortal != NULL);
-        portal_t *destinationPortal = GetDestinationPortalFromSourcePortal(sourcePortal);
-        assert (destinationPortal != NULL);
+void FireProjectile()
+{
+    SpawnEntity(entities, player.x, player.y,
+        cos(player.rotationAngle) *PROJECTILE_SPEED, sin(player.rotationAngle) *PROJECTILE_SPEED,
+        2, ENTITY_COLLIDES | ENTITY_DESPAWN_ON_HIT);
+}
 
-        // Set the new position of the player in the destination portal
-        player.x = (destinationPortal->gridIndexX * TILE_SIZE) + fmodf(newPlayerX, TILE_SIZE);
-        player.y = ((destinationPortal->gridIndexY + 1) * TILE_SIZE) + sin(player.rotationAngle) *moveStep;;
+void RenderEntities()
+{
+    for (int i = 0; i < entities->count; i++)
+    {
+        int gridIndexX = (int)floorf(entities->x[i] / TILE_SIZE);
+        int gridIndexY = (int)floorf(entities->y[i] / TILE_SIZE);
+        if ((gridIndexX >= 0) && (gridIndexX < MAP_NUM_COLS) && (gridIndexY >= 0) && (gridIndexY < MAP_NUM_ROWS) && !visibleTiles[gridIndexY * MAP_NUM_COLS + gridIndexX]) continue;
 
-        player.isCrossingPortal = true;
+        float halfExtent = entities->halfExtent[i];
+
+        DrawRectangle((entities->x[i] - halfExtent) *MINIMAP_SCALE_FACTOR,
+            (entities->y[i] - halfExtent) *MINIMAP_SCALE_FACTOR,
+            2 *halfExtent *MINIMAP_SCALE_FACTOR,
+            2 *halfExtent *MINIMAP_SCALE_FACTOR,
+            (entities->flags[i] & ENTITY_DESPAWN_ON_HIT) ? RED : ORANGE);
     }
 }
 
 void RenderPlayer()
 {
-    DrawRectangle(player.x *MINIMAP_SCALE_FACTOR,
-        player.y *MINIMAP_SCALE_FACTOR,
+    DrawRectangle((player.x - player.width / 2) *MINIMAP_SCALE_FACTOR,
+        (player.y - player.height / 2) *MINIMAP_SCALE_FACTOR,
         player.width *MINIMAP_SCALE_FACTOR,
         player.height *MINIMAP_SCALE_FACTOR,
         YELLOW);
@@ -252,262 +362,14 @@ void RenderPlayer()
         YELLOW);
 }
 
-float NormalizeAngle(float angle)
-{
-    angle = remainder(angle, TWO_PI);
-    if (angle < 0)
-    {
-        angle = TWO_PI + angle;
-    }
-    return angle;
-}
-
-float distanceBetweenPoints(float x1, float y1, float x2, float y2, bool calculateSqrt)
-{
-    float dist = (x2 - x1) *(x2 - x1) + (y2 - y1) *(y2 - y1);
-    return calculateSqrt ? sqrt(dist) : dist;
-}
-
-void CastRay(float rayAngle, int stripId)
-{
-    bool rayCastingFinished = false;
-    int wallsTraversedCount = 0;
-    rayAngle = NormalizeAngle(rayAngle);
-
-    int isRayFacingDown = rayAngle > 0 && rayAngle < PI;
-    int isRayFacingUp = !isRayFacingDown;
-
-    int isRayFacingRight = rayAngle < 0.5 *PI || rayAngle > 1.5 * PI;
-    int isRayFacingLeft = !isRayFacingRight;
-
-    float x = player.x;
-    float y = player.y;
-
-   	// Find the y-coordinate of the closest horizontal grid intersection
-    float yinterceptHorz = floor(y / TILE_SIZE) *TILE_SIZE;
-    yinterceptHorz += isRayFacingDown ? TILE_SIZE : 0;
-
-   	// Find the x-coordinate of the closest horizontal grid intersection
-    float xinterceptHorz = x + (yinterceptHorz - y) / tan(rayAngle);
-
-   	// Calculate the increment xstepHorz and ystepHorz
-    float ystepHorz = TILE_SIZE;
-    ystepHorz *= isRayFacingUp ? -1 : 1;
-
-    float xstepHorz = TILE_SIZE / tan(rayAngle);
-    xstepHorz *= (isRayFacingLeft && xstepHorz > 0) ? -1 : 1;
-    xstepHorz *= (isRayFacingRight && xstepHorz < 0) ? -1 : 1;
-
-    float nextHorzTouchX = xinterceptHorz;
-    float nextHorzTouchY = yinterceptHorz;
-
-   	// - - - - - - - - - -
-
-   	// Find the x-coordinate of the closest vertical grid intersection
-    float xinterceptVert = floor(x / TILE_SIZE) *TILE_SIZE;
-    xinterceptVert += isRayFacingRight ? TILE_SIZE : 0;
-
-   	// Find the y-coordinate of the closest vertical grid intersection
-    float yinterceptVert = y + (xinterceptVert - x) *tan(rayAngle);
-
-   	// Calculate the increment xstepVert and ystepVert
-    float xstepVert = TILE_SIZE;
-    xstepVert *= isRayFacingLeft ? -1 : 1;
-
-    float ystepVert = TILE_SIZE* tan(rayAngle);
-    ystepVert *= (isRayFacingUp && ystepVert > 0) ? -1 : 1;
-    ystepVert *= (isRayFacingDown && ystepVert < 0) ? -1 : 1;
-
-    float nextVertTouchX = xinterceptVert;
-    float nextVertTouchY = yinterceptVert;
-
-    bool rayIsCrossingPortal = false;
-    float additionalDistance = 0.0f;
-
-    while (!rayCastingFinished)
-    {
-
-       	// Check for horizontal ray-grid intersections
-        bool foundHorzWallHit = false;
-        float horzWallHitX = 0;
-        float horzWallHitY = 0;
-        int horzWallContent = 0;
-        float horzXToCheck = 0;
-        float horzYToCheck = 0;
-
-       	// Increment xstepHorz and ystepHorz until we find a wall
-        while (!foundHorzWallHit && nextHorzTouchX >= 0 && nextHorzTouchX <= WINDOW_WIDTH && nextHorzTouchY >= 0 && nextHorzTouchY <= WINDOW_HEIGHT)
-        {
-            horzXToCheck = nextHorzTouchX;
-            horzYToCheck = nextHorzTouchY + (isRayFacingUp ? -1 : 0);
-
-            if (MapHasWallAt(horzXToCheck, horzYToCheck))
-            {
-               	// found a wall hit
-                horzWallHitX = nextHorzTouchX;
-                horzWallHitY = nextHorzTouchY;
-                horzWallContent = map[(int) floor(horzYToCheck / TILE_SIZE)][(int) floor(horzXToCheck / TILE_SIZE)];
-                foundHorzWallHit = true;
-                break;
-            }
-
-            nextHorzTouchX += xstepHorz;
-            nextHorzTouchY += ystepHorz;
-        }
-
-       	// Check for vertical ray-grid intersections
-        bool foundVertWallHit = false;
-        float vertWallHitX = 0;
-        float vertWallHitY = 0;
-        int vertWallContent = 0;
-        float vertXToCheck = 0;
-        float vertYToCheck = 0;
-
-       	// Increment xstepVert and ystepVert until we find a wall
-        while (!foundVertWallHit && nextVertTouchX >= 0 && nextVertTouchX <= WINDOW_WIDTH && nextVertTouchY >= 0 && nextVertTouchY <= WINDOW_HEIGHT)
-        {
-            vertXToCheck = nextVertTouchX + (isRayFacingLeft ? -1 : 0);
-            vertYToCheck = nextVertTouchY;
-
-            if (MapHasWallAt(vertXToCheck, vertYToCheck))
-            {
-               	// found a wall hit
-                vertWallHitX = nextVertTouchX;
-                vertWallHitY = nextVertTouchY;
-                vertWallContent = map[(int) floor(vertYToCheck / TILE_SIZE)][(int) floor(vertXToCheck / TILE_SIZE)];
-                foundVertWallHit = true;
-                break;
-            }
-
-            nextVertTouchX += xstepVert;
-            nextVertTouchY += ystepVert;
-        }
-
-       	// Calculate both horizontal and vertical hit distances and choose the smallest one
-        float horzHitDistance = foundHorzWallHit ?
-            distanceBetweenPoints(x, y, horzWallHitX, horzWallHitY, true) :
-            FLT_MAX;
-        float vertHitDistance = foundVertWallHit ?
-            distanceBetweenPoints(x, y, vertWallHitX, vertWallHitY, true) :
-            FLT_MAX;
-
-        if (vertHitDistance < horzHitDistance)
-        {
-            rays[stripId].walls[wallsTraversedCount].wallGridIndexX = (int) floor(vertXToCheck / TILE_SIZE);
-            rays[stripId].walls[wallsTraversedCount].wallGridIndexY =  (int) floor(vertYToCheck / TILE_SIZE);
-            rays[stripId].walls[wallsTraversedCount].distance = vertHitDistance + additionalDistance;
-            rays[stripId].walls[wallsTraversedCount].wallHitX = vertWallHitX;
-            rays[stripId].walls[wallsTraversedCount].wallHitY = vertWallHitY;
-            rays[stripId].walls[wallsTraversedCount].wallHitContent = vertWallContent;
-            rays[stripId].walls[wallsTraversedCount].wasHitVertical = true;
-
-            nextVertTouchX += xstepVert;
-            nextVertTouchY += ystepVert;
-        }
-        else
-        {
-            rays[stripId].walls[wallsTraversedCount].wallGridIndexX =  (int) floor(horzXToCheck / TILE_SIZE);
-            rays[stripId].walls[wallsTraversedCount].wallGridIndexY = (int) floor(horzYToCheck / TILE_SIZE);
-            rays[stripId].walls[wallsTraversedCount].distance = horzHitDistance + additionalDistance;
-            rays[stripId].walls[wallsTraversedCount].wallHitX = horzWallHitX;
-            rays[stripId].walls[wallsTraversedCount].wallHitY = horzWallHitY;
-            rays[stripId].walls[wallsTraversedCount].wallHitContent = horzWallContent;
-            rays[stripId].walls[wallsTraversedCount].wasHitVertical = false;
-
-            nextHorzTouchX += xstepHorz;
-            nextHorzTouchY += ystepHorz;
-        }
-
-        rays[stripId].walls[wallsTraversedCount].rayOriginX = x;
-        rays[stripId].walls[wallsTraversedCount].rayOriginY = y;
-
-        int wallHitType = rays[stripId].walls[wallsTraversedCount].wallHitContent;
-
-        // Discard store the wall hit inside a portal tile
-        if (rayIsCrossingPortal)
-        {
-            rayIsCrossingPortal = false;
-            continue;
-        }
-
-        //if (stripId == 0)
-        //{
-        //    printf("(x:%f) (y:%f) (wallsTraversedCount:%d) (colission:%f,%f) (content:%d) (distance:%f)\n", x, y, wallsTraversedCount, rays[stripId].walls[wallsTraversedCount].wallHitX, rays[stripId].walls[wallsTraversedCount].wallHitY, wallHitType, rays[stripId].walls[wallsTraversedCount].distance);
-        //}
-
-       	// Walls of type 2 are translucid walls. Walls of type 3 are portals.
-        if (((wallHitType != 2) && (wallHitType != 3)) || (wallsTraversedCount + 1 >= MAX_WALLS_TRAVERSED_PER_RAY))
-        {
-            rayCastingFinished = true;
-        }
-        else if (wallHitType == 3)
-        {
-            // A portal wall appeared in the viewport
-            int wallGridIndexX = rays[stripId].walls[wallsTraversedCount].wallGridIndexX;
-            int wallGridIndexY = rays[stripId].walls[wallsTraversedCount].wallGridIndexY;
-
-            portal_t *sourcePortal = GetPortalAtGridPosition(wallGridIndexX, wallGridIndexY);
-            assert (sourcePortal != NULL);
-            portal_t *destinationPortal = GetDestinationPortalFromSourcePortal(sourcePortal);
-            assert (destinationPortal != NULL);
-
-            float wallHitX = rays[stripId].walls[wallsTraversedCount].wallHitX;
-            float wallHitY = rays[stripId].walls[wallsTraversedCount].wallHitY;
-
-            // Set the current position of the player in the destination portal
-            x = (destinationPortal->gridIndexX * TILE_SIZE) + fmodf(wallHitX, TILE_SIZE);
-            y = (destinationPortal->gridIndexY + 1) * TILE_SIZE;
-
-            // Find the y-coordinate of the closest horizontal grid intersection
-            yinterceptHorz = floor(y / TILE_SIZE) *TILE_SIZE;
-            yinterceptHorz += isRayFacingDown ? TILE_SIZE : 0;
-
-            // Find the x-coordinate of the closest horizontal grid intersection
-            xinterceptHorz = x + (yinterceptHorz - y) / tan(rayAngle);
-
-            nextHorzTouchX = xinterceptHorz;
-            nextHorzTouchY = yinterceptHorz;
-
-            // Find the x-coordinate of the closest vertical grid intersection
-            xinterceptVert = floor(x / TILE_SIZE) *TILE_SIZE;
-            xinterceptVert += isRayFacingRight ? TILE_SIZE : 0;
-
-            // Find the y-coordinate of the closest vertical grid intersection
-            yinterceptVert = y + (xinterceptVert - x) *tan(rayAngle);
-
-            nextVertTouchX = xinterceptVert;
-            nextVertTouchY = yinterceptVert;
-
-            additionalDistance += rays[stripId].walls[wallsTraversedCount].distance;
-            rayIsCrossingPortal = true;
-        }
-
-        wallsTraversedCount++;
-    }
-
-    rays[stripId].rayAngle = rayAngle;
-    rays[stripId].wallsTraversedCount = wallsTraversedCount;
-    rays[stripId].isRayFacingDown = isRayFacingDown;
-    rays[stripId].isRayFacingUp = isRayFacingUp;
-    rays[stripId].isRayFacingLeft = isRayFacingLeft;
-    rays[stripId].isRayFacingRight = isRayFacingRight;
-}
-
-void CastAllRays()
-{
-    for (int col = 0; col < NUM_RAYS; col++)
-    {
-        float rayAngle = player.rotationAngle + atan((col - NUM_RAYS / 2) / DIST_PROJ_PLANE);
-        CastRay(rayAngle, col);
-    }
-}
-
 void RenderMap()
 {
     for (int i = 0; i < MAP_NUM_ROWS; i++)
     {
         for (int j = 0; j < MAP_NUM_COLS; j++)
         {
+            if (!visibleTiles[i * MAP_NUM_COLS + j]) continue;
+
             int tileX = j * TILE_SIZE;
             int tileY = i * TILE_SIZE;
             Color tileColor;
@@ -537,26 +399,27 @@ void RenderMap()
     }
 }
 
-void RenderRays()
+void RenderRays(const RenderContext *view)
 {
-    for (int i = 0; i < NUM_RAYS; i++)
+    for (int i = 0; i < view->width; i++)
     {
-        float startX = MINIMAP_SCALE_FACTOR *player.x;
-        float startY = MINIMAP_SCALE_FACTOR *player.y;
-        for (int j = 0; j < rays[i].wallsTraversedCount; j++)
+        const RenderColumn *ray = &view->columns[i];
+        float startX = MINIMAP_SCALE_FACTOR *view->camera.x;
+        float startY = MINIMAP_SCALE_FACTOR *view->camera.y;
+        for (int j = 0; j < ray->wallsCount; j++)
         {
-            float endX = MINIMAP_SCALE_FACTOR *rays[i].walls[j].wallHitX;
-            float endY = MINIMAP_SCALE_FACTOR *rays[i].walls[j].wallHitY;
+            float endX = MINIMAP_SCALE_FACTOR *ray->walls[j].wallHitX;
+            float endY = MINIMAP_SCALE_FACTOR *ray->walls[j].wallHitY;
             DrawLine(startX,
                 startY,
                 endX,
                 endY,
                 j == 0 ? DARKGREEN : GREEN);
 
-            if ((rays[i].walls[j].wallHitContent == 3) && (j+1 < rays[i].wallsTraversedCount))
+            if ((ray->walls[j].wallHitContent == 3) && (j+1 < ray->wallsCount))
             {
-                startX = MINIMAP_SCALE_FACTOR * rays[i].walls[j+1].rayOriginX;
-                startY = MINIMAP_SCALE_FACTOR * rays[i].walls[j+1].rayOriginY;
+                startX = MINIMAP_SCALE_FACTOR * ray->walls[j+1].rayOriginX;
+                startY = MINIMAP_SCALE_FACTOR * ray->walls[j+1].rayOriginY;
             }
             else
             {
@@ -567,184 +430,408 @@ void RenderRays()
     }
 }
 
-void ProcessInput()
+// Start or stop recording the player view, stopping writes the frames still queued
+void ToggleCapture()
+{
+    if (frameCapture == NULL)
+    {
+        frameCapture = LoadFrameCapture(WINDOW_WIDTH, WINDOW_HEIGHT, FPS, CAPTURE_SINK, CAPTURE_TARGET, CAPTURE_POLICY);
+        if (frameCapture == NULL) printf("capture: %s can't be opened\n", CAPTURE_TARGET);
+        return;
+    }
+
+    CaptureStats stats = GetCaptureStats(frameCapture);
+    UnloadFrameCapture(frameCapture);
+    frameCapture = NULL;
+
+    printf("capture: %i frames written to %s, %i dropped | writer: %.3f ms/frame\n", stats.submittedCount, CAPTURE_TARGET,
+        stats.droppedCount, (stats.writtenCount > 0) ? stats.writeTime * 1000 / stats.writtenCount : 0.0);
+}
+
+// Apply a key event: releases stop the matching move, presses start a move or toggle a feature
+void ApplyKeyEvent(const InputEvent *event)
 {
+    bool released = !event->pressed;
+    bool pressed = event->pressed;
 
-    if (IsKeyReleased(KEY_UP) && player.walkDirection == +1)
+    if (released && (event->key == KEY_UP) && player.walkDirection == +1)
     {
         player.walkDirection = 0;
     }
-    if (IsKeyReleased(KEY_DOWN) && player.walkDirection == -1)
+    if (released && (event->key == KEY_DOWN) && player.walkDirection == -1)
     {
         player.walkDirection = 0;
     }
-    if (IsKeyReleased(KEY_RIGHT) && player.turnDirection == +1)
+    if (released && (event->key == KEY_RIGHT) && player.turnDirection == +1)
     {
         player.turnDirection = 0;
     }
-    if (IsKeyReleased(KEY_LEFT) && player.turnDirection == -1)
+    if (released && (event->key == KEY_LEFT) && player.turnDirection == -1)
     {
         player.turnDirection = 0;
     }
 
-    if (IsKeyPressed(KEY_UP))
+    if (pressed && (event->key == KEY_UP))
     {
         player.walkDirection = +1;
     }
-    if (IsKeyPressed(KEY_DOWN))
+    if (pressed && (event->key == KEY_DOWN))
     {
         player.walkDirection = -1;
     }
-    if (IsKeyPressed(KEY_RIGHT))
+    if (pressed && (event->key == KEY_RIGHT))
     {
         player.turnDirection = +1;
     }
-    if (IsKeyPressed(KEY_LEFT))
+    if (pressed && (event->key == KEY_LEFT))
     {
         player.turnDirection = -1;
     }
+    if (pressed && (event->key == KEY_SPACE))
+    {
+        FireProjectile();
+    }
+    if (pressed && (event->key == KEY_P))
+    {
+        minimapCulling = !minimapCulling;
+    }
+    if (pressed && (event->key == KEY_V))
+    {
+        splitScreen = !splitScreen;
+    }
+    if (pressed && (event->key == KEY_I))
+    {
+        indexedViews = !indexedViews;
+
+        int outputs = indexedViews ? RENDER_OUTPUT_INDEXED : RENDER_OUTPUT_COLOR;
+        SetRenderContextOutputs(mainView, outputs);
+        for (int i = 0; i < SPLIT_VIEWS; i++) SetRenderContextOutputs(splitViews[i], outputs);
+    }
+    if (pressed && (event->key == KEY_C))
+    {
+        chasePlayer = !chasePlayer;
+    }
+    if (pressed && (event->key == KEY_R))
+    {
+        ToggleCapture();
+    }
+    if (pressed && (event->key == KEY_M))
+    {
+        faceWalkViews = !faceWalkViews;
+
+        int method = faceWalkViews ? RENDER_METHOD_FACES : RENDER_METHOD_RAYS;
+        SetRenderContextMethod(mainView, method);
+        for (int i = 0; i < SPLIT_VIEWS; i++) SetRenderContextMethod(splitViews[i], method);
+    }
+    if (pressed && (event->key == KEY_L))
+    {
+        litViews = !litViews;
+
+        const Lightmap *lightmap = litViews ? worldLightmap : NULL;
+        mainView->lightmap = lightmap;
+        for (int i = 0; i < SPLIT_VIEWS; i++) splitViews[i]->lightmap = lightmap;
+    }
 }
 
-void Update()
+// Queue the key changes of the last input poll
+// NOTE: Every poll clears the keys pressed since the previous one, sample after each of them
+void SampleInput()
 {
-    float deltaTime = GetFrameTime();
-    MovePlayer(deltaTime);
-    CastAllRays();
+    SampleInputKeys(&inputQueue, IsKeyDown, GetKeyPressed, GetTime());
 }
 
-uint32_t GetMixedColor(uint32_t colorA, uint32_t colorB)
+void PollInputKeys()
 {
-    unsigned char blueA = colorA &(0xff);
-    unsigned char greenA = (colorA >> 8) &(0xff);
-    unsigned char redA = (colorA >> 16) &(0xff);
-    unsigned char alphaA = (colorA >> 24) &(0xff);
+    PollInputEvents();
+    SampleInput();
+}
 
-    unsigned char blueB = colorB &(0xff);
-    unsigned char greenB = (colorB >> 8) &(0xff);
-    unsigned char redB = (colorB >> 16) &(0xff);
-    unsigned char alphaB = (colorB >> 24) &(0xff);
+// Sample the input one last time, the frame applies the events sampled up to now
+void LatchInput()
+{
+#if defined(PLATFORM_WEB)
+    SampleInput();          // Polled by the last EndDrawing(), the browser schedules the frames
+#else
+    PollInputKeys();
+#endif
+    previousLatchTime = inputLatchTime;
+    inputLatchTime = GetTime();
+}
 
-    unsigned char blueResult = (blueA *alphaA / 255) + (blueB *alphaB *(255 - alphaA) / (255 *255));
-    unsigned char greenResult = (greenA *alphaA / 255) + (greenB *alphaB *(255 - alphaA) / (255 *255));
-    unsigned char redResult = (redA *alphaA / 255) + (redB *alphaB *(255 - alphaA) / (255 *255));
-    unsigned char alphaResult = alphaA + (alphaB *(255 - alphaA) / 255);
+// Apply the events latched this frame in the order they happened, moving the player up to each
+// one with the keys held before it, so a key moves the player from the sample that saw it down
+void ProcessInput()
+{
+    InputEvent event = { 0 };
 
-    uint32_t result = ((uint32_t) 0 &0xFFFFFF00) | blueResult;
-    result = (result & 0xFFFF00FF) | ((uint32_t) greenResult << 8);
-    result = (result & 0xFF00FFFF) | ((uint32_t) redResult << 16);
-    result = (result & 0x00FFFFFF) | ((uint32_t) alphaResult << 24);
+    while (PopInputEvent(&inputQueue, inputLatchTime, &event))
+    {
+        if (event.time > playerTime)
+        {
+            MovePlayer((float)(event.time - playerTime));
+            playerTime = event.time;
+        }
 
-    return result;
+        ApplyKeyEvent(&event);
+        latchedInputTime += event.time;
+        latchedInputCount++;
+    }
 }
 
-void SetPixelColorWindowBuffer(uint32_t color, int offset, bool makeOpaque)
+// Account the latency of the events applied by the frame presented at presentTime
+void PresentInputEvents(double presentTime)
 {
-    ((uint32_t*) windowBuffer.data)[offset] = makeOpaque ? (color | ((uint32_t) 255 << 24)) : color;
+    frameStats.inputLatency += latchedInputCount * presentTime - latchedInputTime;
+    frameStats.inputEventsCount += latchedInputCount;
+    latchedInputTime = 0.0;
+    latchedInputCount = 0;
+
+    UpdateInputLatch(&inputLatch, inputLatchTime, presentTime);
 }
 
-void MixPixelColorWindowBuffer(uint32_t color, int offset, bool makeOpaque)
+// Sample the input every INPUT_POLL_INTERVAL until the latch time of the next frame, then latch it
+void WaitInputLatch()
 {
-    uint32_t mixedColor = GetMixedColor(color, ((uint32_t*) windowBuffer.data)[offset]);
-    ((uint32_t*) windowBuffer.data)[offset] = makeOpaque ? (mixedColor | ((uint32_t) 255 << 24)) : mixedColor;
+    double latchTime = GetInputLatchTime(&inputLatch);
+
+    for (double now = GetTime(); now < latchTime; now = GetTime())
+    {
+        PollInputKeys();
+        WaitTime(((latchTime - now) < INPUT_POLL_INTERVAL) ? latchTime - now : INPUT_POLL_INTERVAL);
+    }
+
+    LatchInput();
 }
 
-void Generate3DProjection()
+void UpdateVisibleTiles()
 {
-    for (int i = 0; i < NUM_RAYS; i++)
+    int gridIndexX = (int)floorf(player.x / TILE_SIZE);
+    int gridIndexY = (int)floorf(player.y / TILE_SIZE);
+    bool culling = minimapCulling && (GetMapTile(&world, gridIndexX, gridIndexY) == TILE_EMPTY);
+
+    for (int i = 0; i < MAP_NUM_ROWS * MAP_NUM_COLS; i++) visibleTiles[i] = !culling;
+
+    if (culling)
     {
-        bool isFarthestWall = true;
+        int tilesCount = GetPvsTiles(worldPvs, gridIndexX, gridIndexY, pvsTiles, MAP_NUM_ROWS * MAP_NUM_COLS);
 
-        for (int w = rays[i].wallsTraversedCount - 1; w >= 0; w--)
-        {
-            float perpDistance = rays[i].walls[w].distance* cos(rays[i].rayAngle - player.rotationAngle);
-            float projectedWallHeight = (TILE_SIZE / perpDistance) *DIST_PROJ_PLANE;
+        for (int t = 0; t < tilesCount; t++) visibleTiles[pvsTiles[t]] = true;
+    }
+}
 
-            int wallStripHeight = (int) projectedWallHeight;
+// Steer the wanderers along the flow field to the player, the field is rebuilt over a few frames when the player changes tile
+void UpdateChase()
+{
+    SetFlowFieldGoal(chaseField, (int)floorf(player.x / TILE_SIZE), (int)floorf(player.y / TILE_SIZE));
+    UpdateFlowField(chaseField, CHASE_BUILD_TILES);
 
-            int wallTopPixel = (WINDOW_HEIGHT / 2) - (wallStripHeight / 2);
-            wallTopPixel = wallTopPixel < 0 ? 0 : wallTopPixel;
+    for (int i = 0; i < entities->count; i++)
+    {
+        if (entities->flags[i] & ENTITY_DESPAWN_ON_HIT) continue;
 
-            int wallBottomPixel = (WINDOW_HEIGHT / 2) + (wallStripHeight / 2);
-            wallBottomPixel = wallBottomPixel > WINDOW_HEIGHT ? WINDOW_HEIGHT : wallBottomPixel;
+        float directionX = 0.0f;
+        float directionY = 0.0f;
+        if (GetFlowDirection(chaseField, entities->x[i], entities->y[i], &directionX, &directionY) == FLOW_DIRECTION_NONE) continue;
 
-            bool rayHitPortal = rays[i].walls[w].wallHitContent == 3;
-            int pixelAddr;
+        entities->velocityX[i] = directionX *WANDERER_SPEED;
+        entities->velocityY[i] = directionY *WANDERER_SPEED;
+    }
+}
 
-           	// set the color of the ceiling
-            for (int y = 0; y < wallTopPixel; y++)
-            {
-                pixelAddr = (WINDOW_WIDTH *y) + i;
-                SetPixelColorWindowBuffer(0xC8333333, pixelAddr, true);
-            }
+// Move the lantern with the player, its tiles are relit on the loader thread and installed once done
+void UpdateLighting()
+{
+    MoveLight(worldLightmap, lanternLight, player.x, player.y);
+    UpdateLightmap(worldLightmap);
+}
 
-            if (!rayHitPortal)
-            {
-                // render the wall from wallTopPixel to wallBottomPixel
-                for (int y = wallTopPixel; y < wallBottomPixel; y++)
-                {
-                    pixelAddr = (WINDOW_WIDTH *y) + i;
-                    uint32_t wallPixelColor = rays[i].walls[w].wasHitVertical ? 0xC8FFFFFF : 0xC8CCCCCC;
-
-                    if (isFarthestWall) SetPixelColorWindowBuffer(wallPixelColor, pixelAddr, w == 0);
-                    else MixPixelColorWindowBuffer(wallPixelColor, pixelAddr, w == 0);
-                }
-            }
+void Update()
+{
+    float deltaTime = (float)(inputLatchTime - previousLatchTime);
+    MovePlayer((float)(inputLatchTime - playerTime));
+    playerTime = inputLatchTime;
+    if (chasePlayer) UpdateChase();
+    UpdateEntities(entities, &world, deltaTime);
+    UpdateVisibleTiles();
+    UpdateLighting();
+}
 
-           	// set the color of the floor
-            for (int y = wallBottomPixel; y < WINDOW_HEIGHT; y++)
-            {
-                pixelAddr = (WINDOW_WIDTH *y) + i;
-                SetPixelColorWindowBuffer(0xC8777777, pixelAddr, true);
-            }
+// Renders the views shown this frame, split-screen views render together over the job system
+void RenderWorldViews()
+{
+    RenderCamera playerCamera = { .x = player.x, .y = player.y, .angle = player.rotationAngle };
 
-            isFarthestWall = false;
+    if (!splitScreen)
+    {
+        mainView->camera = playerCamera;
+
+        // Render into the next capture buffer, a color framebuffer is swapped for it until the capture is submitted
+        captureFrame = (frameCapture != NULL) ? AcquireCaptureFrame(frameCapture) : NULL;
+        if ((captureFrame != NULL) && (mainView->pixels != NULL))
+        {
+            mainViewPixels = mainView->pixels;
+            mainView->pixels = captureFrame;
         }
+
+        RenderView(mainView);
+        return;
     }
+
+    float pan = sin(GetTime() * 0.5) *SECURITY_CAMERA_PAN;
+
+    splitViews[0]->camera = playerCamera;
+    splitViews[1]->camera = playerCamera;
+    splitViews[1]->camera.angle += PI;
+
+    for (int i = 2; i < SPLIT_VIEWS; i++)
+    {
+        splitViews[i]->camera = securityCameras[i - 2];
+        splitViews[i]->camera.angle += pan;
+    }
+
+    RenderViews(splitViews, SPLIT_VIEWS);
 }
 
-void ClearWindowBuffer(uint32_t color)
+// Gets the colors of the framebuffer of a view, indexed framebuffers are expanded in the frame arena
+// or in the capture buffer of the main view
+// NOTE: Returns NULL when the frame arena is full
+const uint32_t *GetViewPixels(const RenderContext *view)
 {
-    for (int x = 0; x < WINDOW_WIDTH; x++)
-        for (int y = 0; y < WINDOW_HEIGHT; y++)
-            ((uint32_t*) windowBuffer.data)[(WINDOW_WIDTH *y) + x] = color;
+    if (view->pixels != NULL) return view->pixels;
+
+    uint32_t *pixels = ((view == mainView) && (captureFrame != NULL)) ? captureFrame : (uint32_t *)ArenaAlloc(frameArena, view->width * view->height * sizeof(uint32_t));
+    if (pixels != NULL) ExpandIndexedPixels(pixels, view->indices, view->width * view->height, view->palette->colors);
+
+    return pixels;
 }
 
-void RenderWindowBuffer()
+// Hand the capture buffer of the main view to the writer once uploaded, the view gets its framebuffer back
+void SubmitViewCapture()
 {
-   	// Update the texture in the GPU with the data of the window buffer
-    UpdateTexture(windowTexture, windowBuffer.data);
+    if (captureFrame == NULL) return;
 
-   	// Send the order to the GPU to draw the texture
-    DrawTexture(windowTexture, 0, 0, WHITE);
+    SubmitCaptureFrame(frameCapture);
+    if (mainViewPixels != NULL) mainView->pixels = mainViewPixels;
+
+    captureFrame = NULL;
+    mainViewPixels = NULL;
+}
+
+void RenderViewTextures()
+{
+   	// Update the textures in the GPU with the framebuffers of the views and draw them
+    if (!splitScreen)
+    {
+        const uint32_t *pixels = GetViewPixels(mainView);
+        if (pixels != NULL) UpdateTexture(mainViewTexture, pixels);
+        DrawTexture(mainViewTexture, 0, 0, WHITE);
+        return;
+    }
+
+    for (int i = 0; i < SPLIT_VIEWS; i++)
+    {
+        const uint32_t *pixels = GetViewPixels(splitViews[i]);
+        if (pixels != NULL) UpdateTexture(splitViewTextures[i], pixels);
+        DrawTexture(splitViewTextures[i], (i % 2) *(WINDOW_WIDTH / 2), (i / 2) *(WINDOW_HEIGHT / 2), WHITE);
+    }
 }
 
 static void RenderFrame(void)
 {
+    ResetMemoryArena(frameArena);
     BeginDrawing();
     ClearBackground(RAYWHITE);
-    Generate3DProjection();
-    RenderWindowBuffer();
-    ClearWindowBuffer(0xFF000000);
+
+    double renderStart = GetTime();
+    RenderWorldViews();
+    frameStats.renderTime += GetTime() - renderStart;
+
+    RenderViewTextures();
+    SubmitViewCapture();
     RenderMap();
-    RenderRays();
+    RenderRays(splitScreen ? splitViews[0] : mainView);
+    RenderEntities();
     RenderPlayer();
     DrawFPS(850, 10);
     EndDrawing();
+#if defined(SUPPORT_CUSTOM_FRAME_CONTROL)
+    SwapScreenBuffer();             // EndDrawing() neither presents nor polls the input
+#elif !defined(PLATFORM_WEB)
+    SampleInput();                  // EndDrawing() presented and polled the input, no target FPS so it did not wait
+#endif
+    PresentInputEvents(GetTime());
+}
+
+// Print the average frame timings every FRAME_STATS_INTERVAL frames (browser console on the web)
+static void ReportFrameStats(void)
+{
+    double now = GetTime();
+    frameStats.frameTime += now - frameStats.lastFrameTime;
+    frameStats.lastFrameTime = now;
+
+    if (++frameStats.framesCount < FRAME_STATS_INTERVAL) return;
+
+    LightmapStats lightStats = GetLightmapStats(worldLightmap);
+
+    printf("frame: %.3f ms | render: %.3f ms | input latency: %.3f ms (%i events) | views: %i | threads: %i | frame arena peak: %.1f/%.1f KB (%i failed) | map arena peak: %.1f/%.1f KB | last relight: %.3f ms, %i tiles\n",
+        frameStats.frameTime * 1000 / frameStats.framesCount,
+        frameStats.renderTime * 1000 / frameStats.framesCount,
+        (frameStats.inputEventsCount > 0) ? frameStats.inputLatency * 1000 / frameStats.inputEventsCount : 0.0,
+        frameStats.inputEventsCount,
+        splitScreen ? SPLIT_VIEWS : 1,
+        GetJobWorkersCount() + 1,
+        frameArena->peak / 1024.0, frameArena->capacity / 1024.0, frameArena->failedCount,
+        mapArena->peak / 1024.0, mapArena->capacity / 1024.0,
+        lightStats.relightTime * 1000, lightStats.relitTiles);
+
+    frameStats = (struct FrameStats){ .lastFrameTime = now };
+}
+
+static void UpdateDrawFrame(void)
+{
+    static bool isFirstFrame = true;
+
+#if defined(PLATFORM_WEB)
+    LatchInput();       // Input polled once per frame, only taps between frames are kept
+#endif
+
+    // NOTE: Input toggles reconfigure the views and may allocate their framebuffers
+    ProcessInput();
+
+    long allocationsCount = GetAllocationsCount();
+    Update();
+    RenderFrame();
+    ReportFrameStats();
+
+    // Everything a frame needs is allocated by the end of the first one (TRACK_ALLOCATIONS builds)
+    // NOTE: Main thread allocations only, the job workers, loader and capture threads are not counted,
+    // nor the allocations inside the C library and raylib (see arena.h)
+    assert(isFirstFrame || (GetAllocationsCount() == allocationsCount));
+    isFirstFrame = false;
 }
 
 int main(void)
 {
     SetTraceLogLevel(4);
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "ray caster v0.1.0");
-   	SetTargetFPS(FPS);
     Setup();
 
-    while (!WindowShouldClose())	// Detect window close button or ESC key
+#if defined(PLATFORM_WEB)
+    emscripten_set_main_loop(UpdateDrawFrame, 0, 1);     // 0: run on the browser animation frames
+#else
+    // Late latching: the input is sampled while waiting for the next frame and latched right before
+    // it, so it is as recent as possible. No target FPS, WaitInputLatch() paces the frames
+    // NOTE: Stock raylib also polls in EndDrawing(), raylib built with SUPPORT_CUSTOM_FRAME_CONTROL only here
+    // NOTE: VSync stays off, a swap blocking until the vertical blank would be measured as frame work,
+    // moving the latch back to the start of the frame. Drivers forcing VSync on are not handled
+    if (IsWindowState(FLAG_VSYNC_HINT)) ClearWindowState(FLAG_VSYNC_HINT);
+
+    while (!WindowShouldClose())    // Detect window close button or ESC key
     {
-        ProcessInput();
-        Update();
-        RenderFrame();
+        WaitInputLatch();
+        UpdateDrawFrame();
     }
+#endif
 
     ReleaseResources();
     CloseWindow();
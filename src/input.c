@@ -0,0 +1,138 @@
+/**********************************************************************************************
+*
+*   raycaster - Input events
+*
+*   Timestamped key events queue and late latch schedule.
+*
+**********************************************************************************************/
+
+#include "input.h"
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static int GetInputKeyIndex(const InputQueue *queue, int key);
+static bool SetInputKey(InputQueue *queue, int index, bool down, double time);
+
+//----------------------------------------------------------------------------------
+// Input Functions Definition
+//----------------------------------------------------------------------------------
+
+// Watch keys, extra keys over MAX_INPUT_KEYS are ignored
+void InitInputQueue(InputQueue *queue, const int *keys, int keysCount)
+{
+    *queue = (InputQueue){ 0 };
+
+    if (keysCount > MAX_INPUT_KEYS) keysCount = MAX_INPUT_KEYS;
+    for (int i = 0; i < keysCount; i++) queue->keys[i] = keys[i];
+    queue->keysCount = keysCount;
+}
+
+// Queue the changes of the watched keys since the last sample
+// NOTE: Keys pressed since the last poll come first, so a key pressed and released between two
+// polls gives a press and a release, and a key released and pressed again a release and a press
+void SampleInputKeys(InputQueue *queue, InputKeyDownFunc isKeyDown, InputKeyPressedFunc getKeyPressed, double time)
+{
+    if (getKeyPressed != NULL)
+    {
+        for (int key = getKeyPressed(); key != 0; key = getKeyPressed())
+        {
+            int index = GetInputKeyIndex(queue, key);
+            if (index < 0) continue;
+
+            if (queue->keysDown[index]) SetInputKey(queue, index, false, time);
+            SetInputKey(queue, index, true, time);
+        }
+    }
+
+    for (int i = 0; i < queue->keysCount; i++)
+    {
+        bool down = isKeyDown(queue->keys[i]);
+        if (down != queue->keysDown[i]) SetInputKey(queue, i, down, time);
+    }
+}
+
+// Queue an event at the back
+bool PushInputEvent(InputQueue *queue, int key, bool pressed, double time)
+{
+    if (queue->count == MAX_INPUT_EVENTS)
+    {
+        queue->droppedCount++;
+        return false;
+    }
+
+    queue->events[(queue->first + queue->count)%MAX_INPUT_EVENTS] = (InputEvent){ time, key, pressed };
+    queue->count++;
+
+    return true;
+}
+
+// Take the oldest event, events sampled after latchTime are left for the next frame
+bool PopInputEvent(InputQueue *queue, double latchTime, InputEvent *event)
+{
+    if ((queue->count == 0) || (queue->events[queue->first].time > latchTime)) return false;
+
+    *event = queue->events[queue->first];
+    queue->first = (queue->first + 1)%MAX_INPUT_EVENTS;
+    queue->count--;
+
+    return true;
+}
+
+// Present every framePeriod seconds, the first frame is assumed to take the whole period
+void InitInputLatch(InputLatch *latch, double framePeriod, double time)
+{
+    latch->framePeriod = framePeriod;
+    latch->presentTime = time + framePeriod;
+    latch->workTime = framePeriod - INPUT_LATCH_MARGIN;
+}
+
+// Latest time to latch the input so the frame is presented on time, never before the previous present
+double GetInputLatchTime(const InputLatch *latch)
+{
+    double latchTime = latch->presentTime - latch->workTime - INPUT_LATCH_MARGIN;
+    double earliest = latch->presentTime - latch->framePeriod;
+
+    return (latchTime > earliest)? latchTime : earliest;
+}
+
+// Learn the frame work time and schedule the next present
+// NOTE: Slower frames are taken at once, faster ones slowly, a late frame misses one present, not
+// all the following ones
+void UpdateInputLatch(InputLatch *latch, double latchTime, double presentTime)
+{
+    double workTime = presentTime - latchTime;
+
+    if (workTime > latch->workTime) latch->workTime = workTime;
+    else latch->workTime += (workTime - latch->workTime)*0.1;
+
+    latch->presentTime += latch->framePeriod;
+    if (latch->presentTime < presentTime) latch->presentTime = presentTime + latch->framePeriod;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Index of a watched key, -1 when not watched
+static int GetInputKeyIndex(const InputQueue *queue, int key)
+{
+    for (int i = 0; i < queue->keysCount; i++)
+    {
+        if (queue->keys[i] == key) return i;
+    }
+
+    return -1;
+}
+
+// Queue a key change, the key keeps its state when the queue is full so the next sample retries
+static bool SetInputKey(InputQueue *queue, int index, bool down, double time)
+{
+    if (!PushInputEvent(queue, queue->keys[index], down, time)) return false;
+
+    queue->keysDown[index] = down;
+
+    return true;
+}
@@ -0,0 +1,90 @@
+/**********************************************************************************************
+*
+*   raycaster - Input events
+*
+*   Key presses and releases recorded with the time they were sampled into a queue, so the
+*   simulation consumes them in order and moves with a key from the moment it went down instead
+*   of from the start of the frame. Sampling takes the key state and the keys pressed since the
+*   last poll (raylib IsKeyDown() and GetKeyPressed()), a key pressed and released between two
+*   polls still gives a press and a release.
+*
+*   Input is sampled many times per frame while waiting for the next one, then latched as late
+*   as possible before the simulation: the input latch schedules the latch so that updating and
+*   rendering the frame ends right at the present time, with the time the last frames took.
+*   Where the platform schedules the frames (browsers) input is polled once per frame: the queue
+*   still keeps the taps between two polls, but every event gets the poll time, so latency and
+*   held times are those of plain polling.
+*
+*   The module does not depend on raylib, key functions are given by the caller.
+*
+**********************************************************************************************/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_INPUT_EVENTS 256            // Events waiting in the queue
+#define MAX_INPUT_KEYS 32               // Keys watched by a queue
+#define INPUT_LATCH_MARGIN 0.002        // Seconds kept between the end of a frame and its present time
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef bool (*InputKeyDownFunc)(int key);
+typedef int (*InputKeyPressedFunc)(void);  // Next key pressed since the last poll, 0 when none
+
+typedef struct InputEvent
+{
+    double time;                // Seconds, time of the sample that saw the event
+    int key;
+    bool pressed;               // false for a release
+}
+InputEvent;
+
+typedef struct InputQueue
+{
+    int keys[MAX_INPUT_KEYS];   // Keys watched, other keys are ignored
+    bool keysDown[MAX_INPUT_KEYS];      // State of the keys after the last event queued
+    int keysCount;
+
+    InputEvent events[MAX_INPUT_EVENTS];    // Ring of events, oldest first
+    int first;
+    int count;
+    int droppedCount;           // Events that did not fit, key changes are queued again by the next sample
+}
+InputQueue;
+
+// Schedule of the latest latch time that still presents a frame on time
+typedef struct InputLatch
+{
+    double framePeriod;         // Seconds between presents
+    double presentTime;         // Next present time
+    double workTime;            // Seconds from latch to present of the last frames, smoothed
+}
+InputLatch;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Input Functions Declaration
+//----------------------------------------------------------------------------------
+void InitInputQueue(InputQueue *queue, const int *keys, int keysCount);    // Every key up
+void SampleInputKeys(InputQueue *queue, InputKeyDownFunc isKeyDown, InputKeyPressedFunc getKeyPressed, double time);  // After every input poll, getKeyPressed can be NULL
+bool PushInputEvent(InputQueue *queue, int key, bool pressed, double time);   // false when the queue is full
+bool PopInputEvent(InputQueue *queue, double latchTime, InputEvent *event);    // Oldest event sampled up to latchTime
+
+void InitInputLatch(InputLatch *latch, double framePeriod, double time);      // First present one period after time
+double GetInputLatchTime(const InputLatch *latch);     // Time to latch the input of the next frame
+void UpdateInputLatch(InputLatch *latch, double latchTime, double presentTime);    // After presenting a frame
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INPUT_H
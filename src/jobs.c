@@ -0,0 +1,193 @@
+/**********************************************************************************************
+*
+*   raycaster - Job system
+*
+*   Fixed pool of worker threads running data-parallel loops.
+*
+**********************************************************************************************/
+
+#include "jobs.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_JOB_WORKERS 63
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct ParallelJob
+{
+    JobFunc func;
+    void *userData;
+    int count;
+    int batchSize;
+    int nextIndex;              // First item of the next batch to take (atomic)
+}
+ParallelJob;
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static pthread_t workers[MAX_JOB_WORKERS] = { 0 };
+static int workersCount = 0;
+
+static pthread_mutex_t runMutex = PTHREAD_MUTEX_INITIALIZER;     // One parallel loop at a time
+static pthread_mutex_t jobMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobAvailable = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobFinished = PTHREAD_COND_INITIALIZER;
+static ParallelJob *currentJob = NULL;
+static unsigned int jobGeneration = 0;
+static int activeWorkers = 0;               // Workers inside currentJob
+static bool shutdownRequested = false;
+
+static __thread bool insideJob = false;     // Nested loops run on the calling thread
+static __thread int workerIndex = 0;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void *WorkerThread(void *arg);
+static void ProcessJobBatches(ParallelJob *job);
+
+//----------------------------------------------------------------------------------
+// Job System Functions Definition
+//----------------------------------------------------------------------------------
+
+// Start worker threads
+void InitJobSystem(int count)
+{
+    if (workersCount > 0) return;
+
+    if (count < 0)
+    {
+        long cores = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        count = (cores > 1)? (int)cores - 1 : 0;
+    }
+    if (count > MAX_JOB_WORKERS) count = MAX_JOB_WORKERS;
+
+    shutdownRequested = false;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (pthread_create(&workers[workersCount], NULL, WorkerThread, (void *)(intptr_t)(workersCount + 1)) != 0) break;
+        workersCount++;
+    }
+}
+
+// Stop and join worker threads
+void CloseJobSystem(void)
+{
+    pthread_mutex_lock(&jobMutex);
+    shutdownRequested = true;
+    pthread_cond_broadcast(&jobAvailable);
+    pthread_mutex_unlock(&jobMutex);
+
+    for (int i = 0; i < workersCount; i++) pthread_join(workers[i], NULL);
+
+    workersCount = 0;
+}
+
+// Number of worker threads
+int GetJobWorkersCount(void)
+{
+    return workersCount;
+}
+
+// Index of the calling thread, lets jobs pick per-thread scratch data
+int GetJobWorkerIndex(void)
+{
+    return workerIndex;
+}
+
+// Run func over [0, count) in batches of batchSize items, spread over the worker threads
+void RunParallelFor(int count, int batchSize, JobFunc func, void *userData)
+{
+    if (count <= 0) return;
+    if (batchSize < 1) batchSize = 1;
+
+    // Small ranges, nested calls and concurrent callers don't pay for synchronization
+    if ((workersCount == 0) || (count <= batchSize) || insideJob || (pthread_mutex_trylock(&runMutex) != 0))
+    {
+        func(userData, 0, count);
+        return;
+    }
+
+    ParallelJob job = { func, userData, count, batchSize, 0 };
+
+    pthread_mutex_lock(&jobMutex);
+    currentJob = &job;
+    jobGeneration++;
+    pthread_cond_broadcast(&jobAvailable);
+    pthread_mutex_unlock(&jobMutex);
+
+    insideJob = true;
+    ProcessJobBatches(&job);
+    insideJob = false;
+
+    // Stop more workers from joining and wait for the ones still working
+    pthread_mutex_lock(&jobMutex);
+    currentJob = NULL;
+    while (activeWorkers > 0) pthread_cond_wait(&jobFinished, &jobMutex);
+    pthread_mutex_unlock(&jobMutex);
+
+    pthread_mutex_unlock(&runMutex);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Worker thread main loop: wait for a new job and help processing it
+static void *WorkerThread(void *arg)
+{
+    unsigned int seenGeneration = 0;
+
+    insideJob = true;
+    workerIndex = (int)(intptr_t)arg;
+
+    pthread_mutex_lock(&jobMutex);
+
+    while (true)
+    {
+        while (!shutdownRequested && ((currentJob == NULL) || (seenGeneration == jobGeneration))) pthread_cond_wait(&jobAvailable, &jobMutex);
+
+        if (shutdownRequested) break;
+
+        ParallelJob *job = currentJob;
+        seenGeneration = jobGeneration;
+        activeWorkers++;
+        pthread_mutex_unlock(&jobMutex);
+
+        ProcessJobBatches(job);
+
+        pthread_mutex_lock(&jobMutex);
+        activeWorkers--;
+        if (activeWorkers == 0) pthread_cond_signal(&jobFinished);
+    }
+
+    pthread_mutex_unlock(&jobMutex);
+
+    return NULL;
+}
+
+// Take batches of the job until all of them have been taken
+static void ProcessJobBatches(ParallelJob *job)
+{
+    while (true)
+    {
+        int start = __atomic_fetch_add(&job->nextIndex, job->batchSize, __ATOMIC_RELAXED);
+        if (start >= job->count) break;
+
+        int end = (start + job->batchSize < job->count)? start + job->batchSize : job->count;
+        job->func(job->userData, start, end);
+    }
+}
@@ -0,0 +1,38 @@
+/**********************************************************************************************
+*
+*   raycaster - Job system
+*
+*   Fixed pool of worker threads running data-parallel loops. RunParallelFor() splits a range
+*   in batches that the workers and the calling thread take in turns, and returns once the
+*   whole range has been processed.
+*
+*   Calls made from inside a job, or with no workers available, run on the calling thread.
+*
+**********************************************************************************************/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef void (*JobFunc)(void *userData, int start, int end);    // Processes items [start, end)
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Job System Functions Declaration
+//----------------------------------------------------------------------------------
+void InitJobSystem(int workersCount);       // Start worker threads, -1 uses one per extra CPU core
+void CloseJobSystem(void);                  // Stop and join worker threads
+int GetJobWorkersCount(void);               // Number of worker threads (calling thread excluded)
+int GetJobWorkerIndex(void);                // 1..workersCount on worker threads, 0 on any other thread (all of them share index 0)
+void RunParallelFor(int count, int batchSize, JobFunc func, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JOBS_H
@@ -0,0 +1,529 @@
+/**********************************************************************************************
+*
+*   raycaster - Lightmaps
+*
+*   Every level is the ambient level plus the light of every source reaching its sample point,
+*   the face center nudged out of the wall. Sources are the lights and their images through the
+*   portal pairs, seen from the portal exit face.
+*
+**********************************************************************************************/
+
+#include "light.h"
+#include "jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <time.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_LIGHT_SOURCES (MAX_LIGHTS*(1 + MAX_LIGHT_IMAGES))
+#define LIGHT_SAMPLE_OFFSET 0.5f            // Distance from the face to its sample point, world units
+#define LIGHT_TILES_BATCH_SIZE 256          // Tiles per job batch of the bakes
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Light or image of a light through a portal, blocked by the walls between origin and sample points
+typedef struct LightSource
+{
+    float x;                    // Position the distance is measured from
+    float y;
+    float originX;              // Position the light comes from, the portal exit for images
+    float originY;
+    float radius;
+    float intensity;
+}
+LightSource;
+
+struct LightmapRelight
+{
+    Map map;                    // Copy of the map with the tiles read when the relight was submitted
+    int *mapTiles;              // Only the tiles the relight reads are up to date
+    unsigned char ambient;
+    Light lights[MAX_LIGHTS];   // Lights when the relight was submitted
+    int lightsCount;
+    LightSource sources[MAX_LIGHT_SOURCES];
+    int sourcesCount;
+    int droppedImages;          // Images over MAX_LIGHT_IMAGES, not lit
+    int *tiles;                 // Tiles to relight
+    int tilesCount;
+    unsigned char *levels;      // LIGHTMAP_LAYERS levels per tile of the list
+    double time;
+    bool busy;                  // Submitted, not installed yet
+    LoadFence fence;
+};
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static double GetLightTime(void);
+static bool IsLightPathClear(const Map *map, float x0, float y0, float x1, float y1);
+static int GetLightSources(const Map *map, const Light *light, LightSource *sources, int *droppedCount);
+static void MarkLightmapTile(Lightmap *lightmap, int gridIndexX, int gridIndexY);
+static void MarkLightTiles(Lightmap *lightmap, const Light *light);
+static void PrepareRelight(Lightmap *lightmap);
+static void RelightTiles(void *userData, int start, int end);
+static void RelightJob(void *userData);
+static void InstallRelight(Lightmap *lightmap);
+
+//----------------------------------------------------------------------------------
+// Lightmap Functions Definition
+//----------------------------------------------------------------------------------
+
+// Allocate a lightmap of a map, every level at the ambient level
+Lightmap *LoadLightmap(const Map *map, unsigned char ambient)
+{
+    Lightmap *lightmap = (Lightmap *)calloc(1, sizeof(Lightmap));
+    int tilesCount = map->numCols*map->numRows;
+
+    lightmap->map = map;
+    lightmap->ambient = ambient;
+    lightmap->levels = (unsigned char *)malloc((size_t)tilesCount*LIGHTMAP_LAYERS);
+    lightmap->marked = (unsigned char *)calloc(tilesCount, 1);
+    lightmap->markedTiles = (int *)malloc(tilesCount*sizeof(int));
+
+    lightmap->relight = (LightmapRelight *)calloc(1, sizeof(LightmapRelight));
+    lightmap->relight->map = *map;
+    lightmap->relight->mapTiles = (int *)malloc(tilesCount*sizeof(int));
+    lightmap->relight->map.tiles = lightmap->relight->mapTiles;
+    lightmap->relight->ambient = ambient;
+    lightmap->relight->tiles = (int *)malloc(tilesCount*sizeof(int));
+    lightmap->relight->levels = (unsigned char *)malloc((size_t)tilesCount*LIGHTMAP_LAYERS);
+
+    memset(lightmap->levels, ambient, (size_t)tilesCount*LIGHTMAP_LAYERS);
+
+    return lightmap;
+}
+
+void UnloadLightmap(Lightmap *lightmap)
+{
+    if (lightmap == NULL) return;
+
+    if (lightmap->relight->busy) WaitLoadFence(lightmap->relight->fence);
+
+    free(lightmap->relight->levels);
+    free(lightmap->relight->tiles);
+    free(lightmap->relight->mapTiles);
+    free(lightmap->relight);
+    free(lightmap->markedTiles);
+    free(lightmap->marked);
+    free(lightmap->levels);
+    free(lightmap);
+}
+
+// Relight the marked tiles on the calling thread and the job system workers
+void BakeLightmap(Lightmap *lightmap)
+{
+    LightmapRelight *relight = lightmap->relight;
+
+    if (relight->busy)
+    {
+        WaitLoadFence(relight->fence);
+        InstallRelight(lightmap);
+    }
+
+    double start = GetLightTime();
+
+    PrepareRelight(lightmap);
+    RunParallelFor(relight->tilesCount, LIGHT_TILES_BATCH_SIZE, RelightTiles, relight);
+
+    relight->time = GetLightTime() - start;
+    InstallRelight(lightmap);
+}
+
+// Add a light and mark the tiles it reaches
+int AddLight(Lightmap *lightmap, Light light)
+{
+    if (lightmap->lightsCount == MAX_LIGHTS) return -1;
+
+    lightmap->lights[lightmap->lightsCount] = light;
+    MarkLightTiles(lightmap, &light);
+
+    return lightmap->lightsCount++;
+}
+
+// Move a light, the tiles it reached and the tiles it reaches now are marked
+void MoveLight(Lightmap *lightmap, int light, float x, float y)
+{
+    Light *moved = &lightmap->lights[light];
+    if ((moved->x == x) && (moved->y == y)) return;
+
+    MarkLightTiles(lightmap, moved);
+    moved->x = x;
+    moved->y = y;
+    MarkLightTiles(lightmap, moved);
+}
+
+// Mark the tile, its neighbours and the tiles of every light reaching it
+// NOTE: Light going through the tile can reach any tile of its lights
+void InvalidateLightmapTile(Lightmap *lightmap, int gridIndexX, int gridIndexY)
+{
+    LightSource sources[1 + MAX_LIGHT_IMAGES];
+    float x = (gridIndexX + 0.5f)*TILE_SIZE;
+    float y = (gridIndexY + 0.5f)*TILE_SIZE;
+
+    MarkLightmapTile(lightmap, gridIndexX, gridIndexY);
+    MarkLightmapTile(lightmap, gridIndexX - 1, gridIndexY);
+    MarkLightmapTile(lightmap, gridIndexX + 1, gridIndexY);
+    MarkLightmapTile(lightmap, gridIndexX, gridIndexY - 1);
+    MarkLightmapTile(lightmap, gridIndexX, gridIndexY + 1);
+
+    for (int i = 0; i < lightmap->lightsCount; i++)
+    {
+        int sourcesCount = GetLightSources(lightmap->map, &lightmap->lights[i], sources, NULL);
+
+        for (int s = 0; s < sourcesCount; s++)
+        {
+            float reach = sources[s].radius + TILE_SIZE;
+
+            if ((fabsf(sources[s].x - x) <= reach) && (fabsf(sources[s].y - y) <= reach))
+            {
+                MarkLightTiles(lightmap, &lightmap->lights[i]);
+                break;
+            }
+        }
+    }
+}
+
+// Install the last relight once done and send the marked tiles to the loader
+bool UpdateLightmap(Lightmap *lightmap)
+{
+    LightmapRelight *relight = lightmap->relight;
+
+    if (relight->busy)
+    {
+        if (!IsLoadFenceReached(relight->fence)) return false;
+        InstallRelight(lightmap);
+    }
+
+    if (lightmap->markedCount == 0) return true;
+
+    PrepareRelight(lightmap);
+    relight->busy = true;
+    relight->fence = SubmitLoadJob(RelightJob, relight);
+
+    // Jobs run as they are submitted when the loader thread is not running
+    if (IsLoadFenceReached(relight->fence)) InstallRelight(lightmap);
+
+    return false;
+}
+
+LightmapStats GetLightmapStats(const Lightmap *lightmap)
+{
+    LightmapStats stats = lightmap->stats;
+    stats.pendingTiles = lightmap->markedCount;
+
+    return stats;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Get monotonic time in seconds
+static double GetLightTime(void)
+{
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+}
+
+// Check that no wall or portal tile is between two points, translucent walls let light through
+// NOTE: Tiles are walked in the order the segment crosses them, the first tile is not checked
+static bool IsLightPathClear(const Map *map, float x0, float y0, float x1, float y1)
+{
+    int tileX = (int)floorf(x0/TILE_SIZE);
+    int tileY = (int)floorf(y0/TILE_SIZE);
+    int endX = (int)floorf(x1/TILE_SIZE);
+    int endY = (int)floorf(y1/TILE_SIZE);
+    int stepsCount = abs(endX - tileX) + abs(endY - tileY);
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    int stepX = (dx > 0.0f)? 1 : -1;
+    int stepY = (dy > 0.0f)? 1 : -1;
+    float deltaX = (dx != 0.0f)? fabsf(TILE_SIZE/dx) : FLT_MAX;
+    float deltaY = (dy != 0.0f)? fabsf(TILE_SIZE/dy) : FLT_MAX;
+    float nextX = (dx != 0.0f)? ((stepX > 0)? (tileX + 1)*TILE_SIZE - x0 : x0 - tileX*TILE_SIZE)/fabsf(dx) : FLT_MAX;
+    float nextY = (dy != 0.0f)? ((stepY > 0)? (tileY + 1)*TILE_SIZE - y0 : y0 - tileY*TILE_SIZE)/fabsf(dy) : FLT_MAX;
+
+    for (int i = 0; i < stepsCount; i++)
+    {
+        if (nextX < nextY)
+        {
+            tileX += stepX;
+            nextX += deltaX;
+        }
+        else
+        {
+            tileY += stepY;
+            nextY += deltaY;
+        }
+
+        int tile = GetMapTile(map, tileX, tileY);
+        if ((tile == TILE_WALL) || (tile == TILE_PORTAL)) return false;
+    }
+
+    return true;
+}
+
+// Get the light and its images through the portal faces it sees within its radius, the images past
+// MAX_LIGHT_IMAGES are added to droppedCount (can be NULL)
+// NOTE: Light reaching the center of a portal face goes on from the exit face of the destination portal,
+// the image is the light translated like anything going through (GetMapPortalTransit())
+static int GetLightSources(const Map *map, const Light *light, LightSource *sources, int *droppedCount)
+{
+    static const int stepsX[4] = { 1, 0, -1, 0 };
+    static const int stepsY[4] = { 0, 1, 0, -1 };
+    int count = 0;
+
+    sources[count++] = (LightSource){ light->x, light->y, light->x, light->y, light->radius, light->intensity };
+
+    for (int i = 0; i < map->portalsCount; i++)
+    {
+        const portal_t *portal = &map->portals[i];
+        const portal_t *destination = GetMapDestinationPortal(map, portal);
+        if (destination == NULL) continue;
+
+        for (int s = 0; s < 4; s++)
+        {
+            if (GetMapTile(map, portal->gridIndexX - stepsX[s], portal->gridIndexY - stepsY[s]) != TILE_EMPTY) continue;
+            if (GetMapTile(map, destination->gridIndexX + stepsX[s], destination->gridIndexY + stepsY[s]) != TILE_EMPTY) continue;
+
+            // Entrance face center, seen from the tile in front of it
+            float faceX = (portal->gridIndexX + 0.5f - 0.5f*stepsX[s])*TILE_SIZE - stepsX[s]*LIGHT_SAMPLE_OFFSET;
+            float faceY = (portal->gridIndexY + 0.5f - 0.5f*stepsY[s])*TILE_SIZE - stepsY[s]*LIGHT_SAMPLE_OFFSET;
+            float dx = faceX - light->x;
+            float dy = faceY - light->y;
+
+            if ((dx*stepsX[s] + dy*stepsY[s] <= 0.0f) || (dx*dx + dy*dy >= light->radius*light->radius)) continue;
+            if (!IsLightPathClear(map, light->x, light->y, faceX, faceY)) continue;
+
+            if (count == 1 + MAX_LIGHT_IMAGES)
+            {
+                if (droppedCount != NULL) (*droppedCount)++;
+                continue;
+            }
+
+            float offsetX = (float)((destination->gridIndexX - portal->gridIndexX + stepsX[s])*TILE_SIZE);
+            float offsetY = (float)((destination->gridIndexY - portal->gridIndexY + stepsY[s])*TILE_SIZE);
+
+            sources[count++] = (LightSource){ light->x + offsetX, light->y + offsetY, faceX + offsetX + 2*stepsX[s]*LIGHT_SAMPLE_OFFSET,
+                faceY + offsetY + 2*stepsY[s]*LIGHT_SAMPLE_OFFSET, light->radius, light->intensity };
+        }
+    }
+
+    return count;
+}
+
+static void MarkLightmapTile(Lightmap *lightmap, int gridIndexX, int gridIndexY)
+{
+    if ((gridIndexX < 0) || (gridIndexX >= lightmap->map->numCols) || (gridIndexY < 0) || (gridIndexY >= lightmap->map->numRows)) return;
+
+    int tile = gridIndexY*lightmap->map->numCols + gridIndexX;
+
+    if (!lightmap->marked[tile])
+    {
+        lightmap->marked[tile] = 1;
+        lightmap->markedTiles[lightmap->markedCount++] = tile;
+    }
+}
+
+// Mark the tiles within the radius of a light and of its images, with the walls around
+static void MarkLightTiles(Lightmap *lightmap, const Light *light)
+{
+    LightSource sources[1 + MAX_LIGHT_IMAGES];
+    int sourcesCount = GetLightSources(lightmap->map, light, sources, NULL);
+
+    for (int s = 0; s < sourcesCount; s++)
+    {
+        int minX = (int)floorf((sources[s].x - sources[s].radius)/TILE_SIZE) - 1;
+        int maxX = (int)floorf((sources[s].x + sources[s].radius)/TILE_SIZE) + 1;
+        int minY = (int)floorf((sources[s].y - sources[s].radius)/TILE_SIZE) - 1;
+        int maxY = (int)floorf((sources[s].y + sources[s].radius)/TILE_SIZE) + 1;
+
+        if (minX < 0) minX = 0;
+        if (minY < 0) minY = 0;
+        if (maxX >= lightmap->map->numCols) maxX = lightmap->map->numCols - 1;
+        if (maxY >= lightmap->map->numRows) maxY = lightmap->map->numRows - 1;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++) MarkLightmapTile(lightmap, x, y);
+        }
+    }
+}
+
+// Hand the marked tiles, the lights, their sources and a copy of the map tiles the relight reads over to the relight
+// NOTE: The relight never reads the shared map, its tiles can change while the loader thread relights.
+// It reads the marked tiles, their neighbours and the tiles between them and the sources reaching them:
+// only that rectangle is copied, grown by a tile for the paths crossing a corner
+static void PrepareRelight(Lightmap *lightmap)
+{
+    LightmapRelight *relight = lightmap->relight;
+    const Map *map = lightmap->map;
+    int *tiles = relight->tiles;
+
+    relight->tiles = lightmap->markedTiles;
+    relight->tilesCount = lightmap->markedCount;
+    lightmap->markedTiles = tiles;
+    lightmap->markedCount = 0;
+
+    for (int i = 0; i < relight->tilesCount; i++) lightmap->marked[relight->tiles[i]] = 0;
+
+    memcpy(relight->lights, lightmap->lights, lightmap->lightsCount*sizeof(Light));
+    relight->lightsCount = lightmap->lightsCount;
+
+    // Light paths to the portals can be anywhere, sources are found on the shared map
+    relight->sourcesCount = 0;
+    relight->droppedImages = 0;
+    for (int i = 0; i < relight->lightsCount; i++) relight->sourcesCount += GetLightSources(map, &relight->lights[i], relight->sources + relight->sourcesCount, &relight->droppedImages);
+
+    relight->map.portals = map->portals;
+    relight->map.portalsCount = map->portalsCount;
+
+    if (relight->tilesCount == 0) return;
+
+    int minX = map->numCols;
+    int minY = map->numRows;
+    int maxX = -1;
+    int maxY = -1;
+
+    for (int i = 0; i < relight->tilesCount; i++)
+    {
+        int x = relight->tiles[i]%map->numCols;
+        int y = relight->tiles[i]/map->numCols;
+
+        if (x < minX) minX = x;
+        if (x > maxX) maxX = x;
+        if (y < minY) minY = y;
+        if (y > maxY) maxY = y;
+    }
+
+    // Sample points are in the marked tiles or their neighbours
+    minX--;
+    minY--;
+    maxX++;
+    maxY++;
+
+    float areaMinX = (float)(minX*TILE_SIZE);
+    float areaMinY = (float)(minY*TILE_SIZE);
+    float areaMaxX = (float)((maxX + 1)*TILE_SIZE);
+    float areaMaxY = (float)((maxY + 1)*TILE_SIZE);
+
+    for (int s = 0; s < relight->sourcesCount; s++)
+    {
+        const LightSource *source = &relight->sources[s];
+        float dx = fmaxf(0.0f, fmaxf(areaMinX - source->x, source->x - areaMaxX));
+        float dy = fmaxf(0.0f, fmaxf(areaMinY - source->y, source->y - areaMaxY));
+        if (dx*dx + dy*dy >= source->radius*source->radius) continue;
+
+        int originX = (int)floorf(source->originX/TILE_SIZE);
+        int originY = (int)floorf(source->originY/TILE_SIZE);
+
+        if (originX < minX) minX = originX;
+        if (originX > maxX) maxX = originX;
+        if (originY < minY) minY = originY;
+        if (originY > maxY) maxY = originY;
+    }
+
+    minX = (minX > 0)? minX - 1 : 0;
+    minY = (minY > 0)? minY - 1 : 0;
+    maxX = (maxX < map->numCols - 1)? maxX + 1 : map->numCols - 1;
+    maxY = (maxY < map->numRows - 1)? maxY + 1 : map->numRows - 1;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        memcpy(relight->mapTiles + (size_t)y*map->numCols + minX, map->tiles + (size_t)y*map->numCols + minX, (maxX - minX + 1)*sizeof(int));
+    }
+}
+
+// Compute the levels of the tiles [start, end) of the relight list
+static void RelightTiles(void *userData, int start, int end)
+{
+    static const int normalsX[LIGHTMAP_LAYERS] = { 0, 0, 1, -1 };
+    static const int normalsY[LIGHTMAP_LAYERS] = { -1, 1, 0, 0 };
+    LightmapRelight *relight = (LightmapRelight *)userData;
+    const Map *map = &relight->map;
+
+    for (int i = start; i < end; i++)
+    {
+        int tile = relight->tiles[i];
+        int gridIndexX = tile%map->numCols;
+        int gridIndexY = tile/map->numCols;
+        int content = GetMapTile(map, gridIndexX, gridIndexY);
+        unsigned char *levels = relight->levels + (size_t)i*LIGHTMAP_LAYERS;
+
+        for (int layer = 0; layer < LIGHTMAP_LAYERS; layer++)
+        {
+            float sampleX = (gridIndexX + 0.5f)*TILE_SIZE;
+            float sampleY = (gridIndexY + 0.5f)*TILE_SIZE;
+            float light = 0.0f;
+
+            levels[layer] = relight->ambient;
+
+            // Faces of walls next to a tile light goes through
+            int neighbour = GetMapTile(map, gridIndexX + normalsX[layer], gridIndexY + normalsY[layer]);
+            if ((content == TILE_EMPTY) || (neighbour == TILE_WALL) || (neighbour == TILE_PORTAL)) continue;
+
+            sampleX += normalsX[layer]*(0.5f*TILE_SIZE + LIGHT_SAMPLE_OFFSET);
+            sampleY += normalsY[layer]*(0.5f*TILE_SIZE + LIGHT_SAMPLE_OFFSET);
+
+            for (int s = 0; s < relight->sourcesCount; s++)
+            {
+                const LightSource *source = &relight->sources[s];
+                float dx = source->x - sampleX;
+                float dy = source->y - sampleY;
+                float distanceSquared = dx*dx + dy*dy;
+
+                if (distanceSquared >= source->radius*source->radius) continue;
+
+                float distance = sqrtf(distanceSquared);
+                if (distance == 0.0f) continue;
+
+                float facing = (dx*normalsX[layer] + dy*normalsY[layer])/distance;
+                if (facing <= 0.0f) continue;
+
+                if (!IsLightPathClear(map, sampleX, sampleY, source->originX, source->originY)) continue;
+
+                float falloff = 1.0f - distance/source->radius;
+                light += source->intensity*falloff*falloff*facing;
+            }
+
+            int level = relight->ambient + (int)(light*255.0f);
+            levels[layer] = (unsigned char)((level < 255)? level : 255);
+        }
+    }
+}
+
+// Load job, relights the whole list on the loader thread
+static void RelightJob(void *userData)
+{
+    LightmapRelight *relight = (LightmapRelight *)userData;
+    double start = GetLightTime();
+
+    RelightTiles(relight, 0, relight->tilesCount);
+
+    relight->time = GetLightTime() - start;
+}
+
+// Copy the relit levels to the lightmap
+static void InstallRelight(Lightmap *lightmap)
+{
+    LightmapRelight *relight = lightmap->relight;
+
+    for (int i = 0; i < relight->tilesCount; i++)
+    {
+        memcpy(lightmap->levels + (size_t)relight->tiles[i]*LIGHTMAP_LAYERS, relight->levels + (size_t)i*LIGHTMAP_LAYERS, LIGHTMAP_LAYERS);
+    }
+
+    lightmap->stats.relightsCount++;
+    lightmap->stats.relitTiles = relight->tilesCount;
+    lightmap->stats.relightTime = relight->time;
+    lightmap->stats.totalRelightTime += relight->time;
+    lightmap->stats.droppedImages = relight->droppedImages;
+    relight->busy = false;
+}
@@ -0,0 +1,116 @@
+/**********************************************************************************************
+*
+*   raycaster - Lightmaps
+*
+*   Point lights placed in the map, baked into a light level per wall face: LIGHTMAP_LAYERS bytes
+*   per tile, the four faces of wall tiles. Renderers sample one level per wall and column, nothing
+*   is computed per pixel, ceilings and floors are not lit.
+*
+*   A light reaches the faces within its radius that it sees, walls and portals
+*   block it, translucent walls let it through. Light going into a portal comes out of its
+*   destination portal, as if the light was translated through the portal pair.
+*
+*   Moving a light or changing a tile marks the tiles it can reach, before and after, for a
+*   relight. UpdateLightmap() sends the marked tiles to the loader thread (loader.h) and installs
+*   the levels of the last relight once done, so renderers never see a half updated region.
+*   Relights work on a copy of the map tiles they read (the marked tiles and the light paths to
+*   them) taken when they are sent, tiles can change (then InvalidateLightmapTile()) while the
+*   loader thread relights. When the loader thread is not
+*   running relights run on the calling thread.
+*
+**********************************************************************************************/
+
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include "map.h"
+#include "loader.h"
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_LIGHTS 64
+#define MAX_LIGHT_IMAGES 16         // Images of a light through portal faces, the others are dropped
+
+// Layers of every tile, faces are named after the direction they face
+#define LIGHTMAP_FACE_NORTH 0
+#define LIGHTMAP_FACE_SOUTH 1
+#define LIGHTMAP_FACE_EAST 2
+#define LIGHTMAP_FACE_WEST 3
+#define LIGHTMAP_LAYERS 4
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Light
+{
+    float x;                    // World position
+    float y;
+    float radius;               // No light reaches farther
+    float intensity;            // Light added at the light position, 1.0f is full brightness
+}
+Light;
+
+typedef struct LightmapStats
+{
+    int relightsCount;          // Relights installed
+    int relitTiles;             // Tiles of the last relight
+    double relightTime;         // Seconds spent on the last relight
+    double totalRelightTime;
+    int droppedImages;          // Light images over MAX_LIGHT_IMAGES in the last relight, not lit
+    int pendingTiles;           // Tiles marked, waiting for a relight
+}
+LightmapStats;
+
+typedef struct LightmapRelight LightmapRelight;     // Relight in the background
+
+typedef struct Lightmap
+{
+    const Map *map;             // Shared world, tiles read are copied for every relight, portals must not change
+    unsigned char ambient;      // Level of the faces no light reaches
+    unsigned char *levels;      // LIGHTMAP_LAYERS levels per tile, row-major
+    Light lights[MAX_LIGHTS];
+    int lightsCount;
+
+    unsigned char *marked;      // Tiles waiting for a relight
+    int *markedTiles;
+    int markedCount;
+
+    LightmapRelight *relight;
+    LightmapStats stats;
+}
+Lightmap;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Lightmap Functions Declaration
+//----------------------------------------------------------------------------------
+Lightmap *LoadLightmap(const Map *map, unsigned char ambient);     // Every level at ambient, no lights
+void UnloadLightmap(Lightmap *lightmap);
+void BakeLightmap(Lightmap *lightmap);          // Relight the marked tiles now, multithreaded (load time)
+
+int AddLight(Lightmap *lightmap, Light light);  // Light index, -1 when full
+void MoveLight(Lightmap *lightmap, int light, float x, float y);
+void InvalidateLightmapTile(Lightmap *lightmap, int gridIndexX, int gridIndexY);   // After changing a map tile
+
+bool UpdateLightmap(Lightmap *lightmap);        // Once per frame, true when no relight is pending
+LightmapStats GetLightmapStats(const Lightmap *lightmap);
+
+// Light level of a layer of a tile, tiles outside the map are at ambient level
+static inline unsigned char GetLightmapLevel(const Lightmap *lightmap, int gridIndexX, int gridIndexY, int layer)
+{
+    if ((gridIndexX < 0) || (gridIndexX >= lightmap->map->numCols) || (gridIndexY < 0) || (gridIndexY >= lightmap->map->numRows)) return lightmap->ambient;
+
+    return lightmap->levels[(gridIndexY*lightmap->map->numCols + gridIndexX)*LIGHTMAP_LAYERS + layer];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIGHT_H
@@ -0,0 +1,144 @@
+/**********************************************************************************************
+*
+*   raycaster - Background loader
+*
+*   Load jobs queue served by one thread, completion tracked with fences.
+*
+**********************************************************************************************/
+
+#include "loader.h"
+
+#include <stddef.h>
+#include <pthread.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct LoadJob
+{
+    LoadJobFunc func;
+    void *userData;
+}
+LoadJob;
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static pthread_t loaderThread = { 0 };
+static bool loaderRunning = false;
+
+static pthread_mutex_t queueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobSubmitted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobCompleted = PTHREAD_COND_INITIALIZER;
+static LoadJob queue[MAX_LOAD_JOBS] = { 0 };    // Ring buffer, job n at queue[n%MAX_LOAD_JOBS]
+static LoadFence submittedCount = 0;
+static LoadFence completedCount = 0;    // Jobs finish in order, so this is the last fence reached (atomic)
+static LoadFence takenCount = 0;        // Jobs taken by the loader thread
+static bool shutdownRequested = false;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void *LoaderThread(void *arg);
+
+//----------------------------------------------------------------------------------
+// Loader Functions Definition
+//----------------------------------------------------------------------------------
+
+// Start the loader thread, jobs keep running on the calling thread if it can't be created
+void InitLoader(void)
+{
+    if (loaderRunning) return;
+
+    shutdownRequested = false;
+    loaderRunning = (pthread_create(&loaderThread, NULL, LoaderThread, NULL) == 0);
+}
+
+// Stop the loader thread once the queue is empty
+void CloseLoader(void)
+{
+    if (!loaderRunning) return;
+
+    pthread_mutex_lock(&queueMutex);
+    shutdownRequested = true;
+    pthread_cond_signal(&jobSubmitted);
+    pthread_mutex_unlock(&queueMutex);
+
+    pthread_join(loaderThread, NULL);
+    loaderRunning = false;
+}
+
+// Queue a job, the fence returned is reached once it has run
+// NOTE: Waits for room when the queue is full, jobs must not submit jobs
+LoadFence SubmitLoadJob(LoadJobFunc func, void *userData)
+{
+    pthread_mutex_lock(&queueMutex);
+
+    if (!loaderRunning)
+    {
+        LoadFence fence = ++submittedCount;
+        takenCount = fence;
+        pthread_mutex_unlock(&queueMutex);
+
+        func(userData);
+
+        __atomic_store_n(&completedCount, fence, __ATOMIC_RELEASE);
+
+        return fence;
+    }
+
+    while (submittedCount - takenCount >= MAX_LOAD_JOBS) pthread_cond_wait(&jobCompleted, &queueMutex);
+
+    queue[submittedCount%MAX_LOAD_JOBS] = (LoadJob){ func, userData };
+    LoadFence fence = ++submittedCount;
+    pthread_cond_signal(&jobSubmitted);
+    pthread_mutex_unlock(&queueMutex);
+
+    return fence;
+}
+
+// Check a fence without waiting, the data written by the jobs before it is visible once it returns true
+bool IsLoadFenceReached(LoadFence fence)
+{
+    return (int)(__atomic_load_n(&completedCount, __ATOMIC_ACQUIRE) - fence) >= 0;
+}
+
+void WaitLoadFence(LoadFence fence)
+{
+    pthread_mutex_lock(&queueMutex);
+    while (!IsLoadFenceReached(fence)) pthread_cond_wait(&jobCompleted, &queueMutex);
+    pthread_mutex_unlock(&queueMutex);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Loader thread main loop: run the queued jobs in order until shutdown
+static void *LoaderThread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&queueMutex);
+
+    while (true)
+    {
+        while (!shutdownRequested && (takenCount == submittedCount)) pthread_cond_wait(&jobSubmitted, &queueMutex);
+
+        if (takenCount == submittedCount) break;    // Shutdown with an empty queue
+
+        LoadJob job = queue[takenCount%MAX_LOAD_JOBS];
+        LoadFence fence = ++takenCount;
+        pthread_mutex_unlock(&queueMutex);
+
+        job.func(job.userData);
+
+        pthread_mutex_lock(&queueMutex);
+        __atomic_store_n(&completedCount, fence, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&jobCompleted);
+    }
+
+    pthread_mutex_unlock(&queueMutex);
+
+    return NULL;
+}
@@ -0,0 +1,50 @@
+/**********************************************************************************************
+*
+*   raycaster - Background loader
+*
+*   One loader thread running load jobs in submission order, so screens can prepare their data
+*   (map loading, image conversion, acceleration structures) while another screen is playing.
+*   Every submitted job returns a fence; a fence is reached once its job and every job
+*   submitted before it have finished.
+*
+*   Load jobs must not touch the GPU, uploads are left to the main thread once the fence is
+*   reached. When the loader thread is not running (not initialized, no threads on the
+*   platform) jobs run on the calling thread as they are submitted.
+*
+**********************************************************************************************/
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_LOAD_JOBS 64                // Jobs waiting in the queue
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef void (*LoadJobFunc)(void *userData);
+
+typedef unsigned int LoadFence;         // Number of jobs submitted up to and including a job
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Loader Functions Declaration
+//----------------------------------------------------------------------------------
+void InitLoader(void);                  // Start the loader thread
+void CloseLoader(void);                 // Finish the queued jobs and join the loader thread
+LoadFence SubmitLoadJob(LoadJobFunc func, void *userData);
+bool IsLoadFenceReached(LoadFence fence);   // Never blocks, call it every frame
+void WaitLoadFence(LoadFence fence);    // Block until the fence is reached
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOADER_H
@@ -0,0 +1,308 @@
+/**********************************************************************************************
+*
+*   raycaster - Map module
+*
+*   Tile grid and portal pair lookups shared by the game systems, and map files.
+*
+**********************************************************************************************/
+
+#include "map.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static const char *derivedChunkTags[] = { "PVS " };    // Chunks built from the tiles and portals
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static bool IsMapPortalsValid(const Map *map);
+
+//----------------------------------------------------------------------------------
+// Map Functions Definition
+//----------------------------------------------------------------------------------
+
+// Get the portal placed at the given grid position, NULL if there is none
+const portal_t *GetMapPortalAt(const Map *map, int gridIndexX, int gridIndexY)
+{
+    for (int i = 0; i < map->portalsCount; i++)
+    {
+        if ((map->portals[i].gridIndexX == gridIndexX) && (map->portals[i].gridIndexY == gridIndexY)) return &map->portals[i];
+    }
+
+    // No portal found at the given position of the map grid
+    return NULL;
+}
+
+// Get the portal linked to the given one
+const portal_t *GetMapDestinationPortal(const Map *map, const portal_t *sourcePortal)
+{
+    int index = (int)(sourcePortal - map->portals);
+    int destinationIndex = index ^ 1;
+
+    if ((index < 0) || (destinationIndex >= map->portalsCount)) return NULL;
+
+    return &map->portals[destinationIndex];
+}
+
+// Get the translation applied to anything entering the portal tile at the given grid position
+// NOTE: Portals behave as zero-thickness links: a point on the entry face of the source tile
+// (the face crossed when moving by stepX/stepY) maps to the same point on the opposite face of
+// the destination tile, so movement continues in the same direction on the other side.
+bool GetMapPortalTransit(const Map *map, int gridIndexX, int gridIndexY, int stepX, int stepY, float *offsetX, float *offsetY)
+{
+    const portal_t *sourcePortal = GetMapPortalAt(map, gridIndexX, gridIndexY);
+    if (sourcePortal == NULL) return false;
+
+    const portal_t *destinationPortal = GetMapDestinationPortal(map, sourcePortal);
+    if (destinationPortal == NULL) return false;
+
+    *offsetX = (float)((destinationPortal->gridIndexX - sourcePortal->gridIndexX + stepX)*TILE_SIZE);
+    *offsetY = (float)((destinationPortal->gridIndexY - sourcePortal->gridIndexY + stepY)*TILE_SIZE);
+
+    return true;
+}
+
+// Load map tiles and portals from a map file
+// NOTE: Returns an empty map (numCols = 0) if the file can't be read or its portals are not
+// valid pairs of distinct portal tiles of the map
+Map LoadMap(const char *fileName)
+{
+    Map map = { 0 };
+    int tilesSize = 0;
+    int portalsSize = 0;
+    unsigned char *tilesChunk = (unsigned char *)LoadMapChunk(fileName, "TILE", &tilesSize);
+    unsigned char *portalsChunk = (unsigned char *)LoadMapChunk(fileName, "PORT", &portalsSize);
+
+    if ((tilesChunk != NULL) && (tilesSize >= 8))
+    {
+        int32_t size[2] = { ReadMapInt32(tilesChunk), ReadMapInt32(tilesChunk + 4) };
+
+        if ((size[0] > 0) && (size[1] > 0) && (size[1] <= (tilesSize - 8)/size[0]))
+        {
+            int *tiles = (int *)malloc((size_t)size[0]*size[1]*sizeof(int));
+            for (long i = 0; i < (long)size[0]*size[1]; i++) tiles[i] = tilesChunk[8 + i];
+
+            map.numCols = size[0];
+            map.numRows = size[1];
+            map.tiles = tiles;
+        }
+    }
+
+    if ((map.tiles != NULL) && (portalsChunk != NULL) && (portalsSize >= 4))
+    {
+        int count = ReadMapInt32(portalsChunk);
+        bool countValid = (count >= 0) && (count <= (portalsSize - 4)/8);
+
+        if (countValid && (count > 0))
+        {
+            portal_t *portals = (portal_t *)malloc(count*sizeof(portal_t));
+            for (int i = 0; i < count; i++) portals[i] = (portal_t){ ReadMapInt32(portalsChunk + 4 + i*8), ReadMapInt32(portalsChunk + 8 + i*8) };
+
+            map.portals = portals;
+            map.portalsCount = count;
+        }
+
+        if (!countValid || !IsMapPortalsValid(&map))
+        {
+            UnloadMap(map);
+            map = (Map){ 0 };
+        }
+    }
+
+    free(tilesChunk);
+    free(portalsChunk);
+
+    return map;
+}
+
+// Unload map data loaded with LoadMap()
+void UnloadMap(Map map)
+{
+    free((void *)map.tiles);
+    free((void *)map.portals);
+}
+
+// Export map tiles and portals, other chunks already in the file are kept
+// NOTE: Chunks built from the tiles and portals (derivedChunkTags) are removed when they change,
+// export them again once rebuilt
+bool ExportMap(const Map *map, const char *fileName)
+{
+    int tilesSize = 8 + map->numCols*map->numRows;
+    unsigned char *tilesChunk = (unsigned char *)malloc(tilesSize);
+
+    WriteMapInt32(tilesChunk, map->numCols);
+    WriteMapInt32(tilesChunk + 4, map->numRows);
+    for (int i = 0; i < map->numCols*map->numRows; i++) tilesChunk[8 + i] = (unsigned char)map->tiles[i];
+
+    int portalsSize = 4 + map->portalsCount*8;
+    unsigned char *portalsChunk = (unsigned char *)malloc(portalsSize);
+
+    WriteMapInt32(portalsChunk, map->portalsCount);
+    for (int i = 0; i < map->portalsCount; i++)
+    {
+        WriteMapInt32(portalsChunk + 4 + i*8, map->portals[i].gridIndexX);
+        WriteMapInt32(portalsChunk + 8 + i*8, map->portals[i].gridIndexY);
+    }
+
+    // Previous tiles and portals, derived chunks are only kept when they were built from the same ones
+    int previousTilesSize = 0;
+    int previousPortalsSize = 0;
+    void *previousTiles = LoadMapChunk(fileName, "TILE", &previousTilesSize);
+    void *previousPortals = LoadMapChunk(fileName, "PORT", &previousPortalsSize);
+    bool changed = (previousTiles == NULL) || (previousTilesSize != tilesSize) || (memcmp(previousTiles, tilesChunk, tilesSize) != 0) ||
+        (previousPortals == NULL) || (previousPortalsSize != portalsSize) || (memcmp(previousPortals, portalsChunk, portalsSize) != 0);
+
+    free(previousTiles);
+    free(previousPortals);
+
+    bool success = true;
+
+    if (changed)
+    {
+        for (int i = 0; (i < (int)(sizeof(derivedChunkTags)/sizeof(derivedChunkTags[0]))) && success; i++)
+        {
+            success = ExportMapChunk(fileName, derivedChunkTags[i], NULL, 0);
+        }
+    }
+
+    success = success && ExportMapChunk(fileName, "TILE", tilesChunk, tilesSize) && ExportMapChunk(fileName, "PORT", portalsChunk, portalsSize);
+
+    free(tilesChunk);
+    free(portalsChunk);
+
+    return success;
+}
+
+// Load the data of a map file chunk, NULL if the file or the chunk don't exist
+void *LoadMapChunk(const char *fileName, const char *tag, int *size)
+{
+    FILE *file = fopen(fileName, "rb");
+    void *data = NULL;
+
+    *size = 0;
+    if (file == NULL) return NULL;
+
+    unsigned char header[8] = { 0 };
+
+    if ((fread(header, 1, 8, file) == 8) && (memcmp(header, "RCMP", 4) == 0) && (ReadMapInt32(header + 4) == MAP_FILE_VERSION))
+    {
+        unsigned char chunkHeader[8] = { 0 };
+        int32_t chunkSize = 0;
+
+        while ((fread(chunkHeader, 1, 8, file) == 8) && ((chunkSize = ReadMapInt32(chunkHeader + 4)) >= 0))
+        {
+            if (memcmp(chunkHeader, tag, 4) != 0)
+            {
+                if (fseek(file, chunkSize, SEEK_CUR) != 0) break;
+                continue;
+            }
+
+            data = malloc((chunkSize > 0)? chunkSize : 1);
+            if (fread(data, 1, chunkSize, file) != (size_t)chunkSize)
+            {
+                free(data);
+                data = NULL;
+            }
+            else *size = chunkSize;
+
+            break;
+        }
+    }
+
+    fclose(file);
+
+    return data;
+}
+
+// Add a chunk to a map file, replacing the chunk with the same tag, the file is created if needed
+// NOTE: A NULL data removes the chunk
+bool ExportMapChunk(const char *fileName, const char *tag, const void *data, int size)
+{
+    // Keep the other chunks of the existing file, if any
+    unsigned char *previous = NULL;
+    long previousSize = 0;
+    FILE *file = fopen(fileName, "rb");
+
+    if (file != NULL)
+    {
+        unsigned char header[8] = { 0 };
+
+        if ((fread(header, 1, 8, file) == 8) && (memcmp(header, "RCMP", 4) == 0) && (ReadMapInt32(header + 4) == MAP_FILE_VERSION) &&
+            (fseek(file, 0, SEEK_END) == 0) && ((previousSize = ftell(file) - 8) > 0) && (fseek(file, 8, SEEK_SET) == 0))
+        {
+            previous = (unsigned char *)malloc(previousSize);
+            if (fread(previous, 1, previousSize, file) != (size_t)previousSize) previousSize = 0;
+        }
+        else previousSize = 0;
+
+        fclose(file);
+    }
+
+    file = fopen(fileName, "wb");
+    if (file == NULL)
+    {
+        free(previous);
+        return false;
+    }
+
+    unsigned char header[8] = { 'R', 'C', 'M', 'P' };
+    unsigned char chunkHeader[8] = { 0 };
+
+    WriteMapInt32(header + 4, MAP_FILE_VERSION);
+    memcpy(chunkHeader, tag, 4);
+    WriteMapInt32(chunkHeader + 4, size);
+
+    bool success = (fwrite(header, 1, 8, file) == 8);
+
+    for (long offset = 0; success && (offset + 8 <= previousSize);)
+    {
+        int32_t previousChunkSize = ReadMapInt32(previous + offset + 4);
+
+        if ((previousChunkSize < 0) || (offset + 8 + previousChunkSize > previousSize)) break;
+        if (memcmp(previous + offset, tag, 4) != 0) success = (fwrite(previous + offset, 1, 8 + previousChunkSize, file) == (size_t)(8 + previousChunkSize));
+
+        offset += 8 + previousChunkSize;
+    }
+
+    if (data != NULL) success = success && (fwrite(chunkHeader, 1, 8, file) == 8) && (fwrite(data, 1, size, file) == (size_t)size);
+
+    fclose(file);
+    free(previous);
+
+    return success;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Check that portals pair up (even count) and sit on distinct portal tiles of the map
+// NOTE: GetMapPortalAt() returns the first portal of a tile, a second one would never be reached
+static bool IsMapPortalsValid(const Map *map)
+{
+    if ((map->portalsCount & 1) != 0) return false;
+
+    unsigned char *used = (unsigned char *)calloc((size_t)map->numCols*map->numRows, 1);
+    bool valid = true;
+
+    for (int i = 0; (i < map->portalsCount) && valid; i++)
+    {
+        int x = map->portals[i].gridIndexX;
+        int y = map->portals[i].gridIndexY;
+
+        if ((x < 0) || (x >= map->numCols) || (y < 0) || (y >= map->numRows) || (map->tiles[y*map->numCols + x] != TILE_PORTAL)) valid = false;
+        else if (used[y*map->numCols + x]) valid = false;
+        else used[y*map->numCols + x] = 1;
+    }
+
+    free(used);
+
+    return valid;
+}
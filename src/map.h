@@ -0,0 +1,114 @@
+/**********************************************************************************************
+*
+*   raycaster - Map module
+*
+*   Read-only view of the tile grid and the portal pairs linking its tiles. Every system that
+*   reasons about the world (collision, ray queries, simulation) works on a Map so it does not
+*   depend on the globals of a particular game or on raylib.
+*
+*   Map files start with the "RCMP" identifier and the format version, followed by chunks made
+*   of a 4 character tag, the data size and the data, all values little-endian:
+*
+*     "TILE": int32 numCols, int32 numRows, numCols*numRows uint8 tiles (row-major)
+*     "PORT": int32 portalsCount, portalsCount pairs of int32 gridIndexX, gridIndexY
+*
+*   Other modules store their own chunks (i.e. "PVS "), unknown chunks are skipped. Chunks built
+*   from the tiles and portals are dropped by ExportMap() when these change.
+*
+**********************************************************************************************/
+
+#ifndef MAP_H
+#define MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define TILE_SIZE 48
+
+#define MAP_FILE_VERSION 1
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum TileType {
+    TILE_EMPTY = 0,
+    TILE_WALL = 1,
+    TILE_TRANSLUCENT = 2,       // Translucent wall, solid for movement but not for rays
+    TILE_PORTAL = 3             // Portal wall, linked to another portal tile
+} TileType;
+
+typedef struct Portal
+{
+    int gridIndexX;
+    int gridIndexY;
+}
+portal_t;
+
+// NOTE: Portals are linked in consecutive pairs: portals[0] <-> portals[1], portals[2] <-> portals[3]...
+typedef struct Map
+{
+    int numCols;                // Number of tiles along the x axis
+    int numRows;                // Number of tiles along the y axis
+    const int *tiles;           // Tile contents (TileType), row-major: tiles[row*numCols + col]
+    const portal_t *portals;    // Portal tiles
+    int portalsCount;           // Number of portals (always even)
+}
+Map;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Map Functions Declaration
+//----------------------------------------------------------------------------------
+Map LoadMap(const char *fileName);                      // Load map tiles and portals from a map file
+void UnloadMap(Map map);                                // Unload map data loaded with LoadMap()
+bool ExportMap(const Map *map, const char *fileName);   // Export map tiles and portals, other chunks are kept
+
+void *LoadMapChunk(const char *fileName, const char *tag, int *size);                  // Load a chunk of a map file (free() it)
+bool ExportMapChunk(const char *fileName, const char *tag, const void *data, int size); // Add or replace a chunk of a map file, NULL data removes it
+
+const portal_t *GetMapPortalAt(const Map *map, int gridIndexX, int gridIndexY);
+const portal_t *GetMapDestinationPortal(const Map *map, const portal_t *sourcePortal);
+bool GetMapPortalTransit(const Map *map, int gridIndexX, int gridIndexY, int stepX, int stepY, float *offsetX, float *offsetY);
+
+// Little-endian int32 of map files, any host byte order
+static inline int32_t ReadMapInt32(const unsigned char *bytes)
+{
+    return (int32_t)((uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24));
+}
+
+static inline void WriteMapInt32(unsigned char *bytes, int32_t value)
+{
+    for (int i = 0; i < 4; i++) bytes[i] = (unsigned char)((uint32_t)value >> (8*i));
+}
+
+// Tile content at the given grid position, tiles outside the map are walls
+static inline int GetMapTile(const Map *map, int gridIndexX, int gridIndexY)
+{
+    if ((gridIndexX < 0) || (gridIndexX >= map->numCols) || (gridIndexY < 0) || (gridIndexY >= map->numRows)) return TILE_WALL;
+    return map->tiles[gridIndexY*map->numCols + gridIndexX];
+}
+
+// Tile content at the given world position
+static inline int GetMapWallTypeAt(const Map *map, float x, float y)
+{
+    return GetMapTile(map, (int)floorf(x/TILE_SIZE), (int)floorf(y/TILE_SIZE));
+}
+
+// Check if there is a wall (any non-empty tile) at the given world position
+static inline bool MapHasWallAt(const Map *map, float x, float y)
+{
+    return GetMapWallTypeAt(map, x, y) != TILE_EMPTY;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MAP_H
@@ -0,0 +1,343 @@
+/**********************************************************************************************
+*
+*   raycaster - Paged map
+*
+*   Chunked tile storage with a least recently used chunk cache and background prefetching.
+*
+**********************************************************************************************/
+
+#include "paged.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#if !defined(_WIN32)
+    #include <sys/types.h>      // off_t, 64 bit file offsets
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define PAGED_HEADER_SIZE 16            // Identifier, version, numCols and numRows
+#define PAGED_MAX_SIZE 65536            // Tiles per side
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+struct PagedFile
+{
+    FILE *file;
+    pthread_mutex_t mutex;              // Seek and read of a chunk, lookups and loader thread
+};
+
+struct PagedRequest
+{
+    PagedFile *file;
+    uint32_t page;
+    unsigned char *data;
+};
+
+//----------------------------------------------------------------------------------
+// Module Variables Definition (local)
+//----------------------------------------------------------------------------------
+static const unsigned char emptyChunk[PAGED_PAGE_SIZE] = { 0 };    // Shared by the chunks with no tiles set
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static bool SeekPagedFile(FILE *file, uint64_t offset);
+static void ReadPagedChunk(PagedFile *file, uint32_t page, unsigned char *data);
+static void ReadPagedChunkJob(void *userData);
+static int AcquirePagedSlot(PagedMap *map);
+static void InstallPagedSlot(PagedMap *map, int slot);
+static void PrefetchPagedChunks(PagedMap *map, int centerX, int centerY);
+
+//----------------------------------------------------------------------------------
+// Paged Map Functions Definition
+//----------------------------------------------------------------------------------
+
+// Open a paged map file keeping at most cachedChunks chunks in memory, the chunk pages index is read whole
+PagedMap *LoadPagedMap(const char *fileName, int cachedChunks)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) return NULL;
+
+    unsigned char header[PAGED_HEADER_SIZE] = { 0 };
+    int32_t numCols = 0;
+    int32_t numRows = 0;
+
+    if ((fread(header, 1, PAGED_HEADER_SIZE, file) != PAGED_HEADER_SIZE) || (memcmp(header, "RCPM", 4) != 0) || (ReadMapInt32(header + 4) != PAGED_MAP_FILE_VERSION) ||
+        ((numCols = ReadMapInt32(header + 8)) <= 0) || ((numRows = ReadMapInt32(header + 12)) <= 0) || (numCols > PAGED_MAX_SIZE) || (numRows > PAGED_MAX_SIZE))
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    PagedMap *map = (PagedMap *)calloc(1, sizeof(PagedMap));
+    map->numCols = numCols;
+    map->numRows = numRows;
+    map->chunkCols = (map->numCols + PAGED_CHUNK_MASK) >> PAGED_CHUNK_SHIFT;
+    map->chunkRows = (map->numRows + PAGED_CHUNK_MASK) >> PAGED_CHUNK_SHIFT;
+
+    int chunksCount = map->chunkCols*map->chunkRows;
+    map->chunkPages = (uint32_t *)malloc(chunksCount*sizeof(uint32_t));
+
+    if (fread(map->chunkPages, sizeof(uint32_t), chunksCount, file) != (size_t)chunksCount)
+    {
+        fclose(file);
+        free(map->chunkPages);
+        free(map);
+        return NULL;
+    }
+
+    // Page indices are little-endian in the file, converted in place
+    for (int i = 0; i < chunksCount; i++) map->chunkPages[i] = (uint32_t)ReadMapInt32((const unsigned char *)&map->chunkPages[i]);
+
+    map->chunks = (const unsigned char **)calloc(chunksCount, sizeof(unsigned char *));
+    map->chunkUses = (uint32_t *)calloc(chunksCount, sizeof(uint32_t));
+    map->chunkLoading = (bool *)calloc(chunksCount, sizeof(bool));
+
+    for (int i = 0; i < chunksCount; i++)
+    {
+        if (map->chunkPages[i] == 0) map->chunks[i] = emptyChunk;
+    }
+
+    map->prefetchRadius = PAGED_PREFETCH_RADIUS;
+    map->slotsCount = (cachedChunks > PAGED_MIN_CACHED_CHUNKS)? cachedChunks : PAGED_MIN_CACHED_CHUNKS;
+    map->slots = (PagedChunkSlot *)calloc(map->slotsCount, sizeof(PagedChunkSlot));
+    map->slotData = (unsigned char *)malloc((size_t)map->slotsCount*PAGED_PAGE_SIZE);
+    map->requests = (PagedRequest *)calloc(map->slotsCount, sizeof(PagedRequest));
+    for (int i = 0; i < map->slotsCount; i++) map->slots[i].chunkIndex = -1;
+
+    map->file = (PagedFile *)calloc(1, sizeof(PagedFile));
+    map->file->file = file;
+    pthread_mutex_init(&map->file->mutex, NULL);
+
+    return map;
+}
+
+// Close a paged map once its background reads are done
+void UnloadPagedMap(PagedMap *map)
+{
+    if (map == NULL) return;
+
+    for (int i = 0; i < map->slotsCount; i++)
+    {
+        if (map->slots[i].loading) WaitLoadFence(map->slots[i].fence);
+    }
+
+    fclose(map->file->file);
+    pthread_mutex_destroy(&map->file->mutex);
+    free(map->file);
+
+    free(map->requests);
+    free(map->slotData);
+    free(map->slots);
+    free(map->chunkLoading);
+    free(map->chunkUses);
+    free(map->chunks);
+    free(map->chunkPages);
+    free(map);
+}
+
+// Write a paged map, func fills the tiles of every chunk, chunks left empty are not stored
+bool ExportPagedMap(const char *fileName, int numCols, int numRows, PagedChunkFunc func, void *userData)
+{
+    if ((numCols <= 0) || (numRows <= 0) || (numCols > PAGED_MAX_SIZE) || (numRows > PAGED_MAX_SIZE)) return false;
+
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL) return false;
+
+    int chunkCols = (numCols + PAGED_CHUNK_MASK) >> PAGED_CHUNK_SHIFT;
+    int chunkRows = (numRows + PAGED_CHUNK_MASK) >> PAGED_CHUNK_SHIFT;
+    int chunksCount = chunkCols*chunkRows;
+    uint32_t *chunkPages = (uint32_t *)calloc(chunksCount, sizeof(uint32_t));
+    unsigned char *tiles = (unsigned char *)malloc(PAGED_PAGE_SIZE);
+
+    // Chunk pages start on the first page after the index
+    uint32_t page = (uint32_t)((PAGED_HEADER_SIZE + (size_t)chunksCount*sizeof(uint32_t) + PAGED_PAGE_SIZE - 1)/PAGED_PAGE_SIZE);
+    bool success = SeekPagedFile(file, (uint64_t)page*PAGED_PAGE_SIZE);
+
+    for (int i = 0; success && (i < chunksCount); i++)
+    {
+        memset(tiles, 0, PAGED_PAGE_SIZE);
+        func(userData, i%chunkCols, i/chunkCols, tiles);
+
+        if (memcmp(tiles, emptyChunk, PAGED_PAGE_SIZE) == 0) continue;
+
+        success = (fwrite(tiles, 1, PAGED_PAGE_SIZE, file) == PAGED_PAGE_SIZE);
+        chunkPages[i] = page++;
+    }
+
+    unsigned char header[PAGED_HEADER_SIZE] = { 'R', 'C', 'P', 'M' };
+
+    WriteMapInt32(header + 4, PAGED_MAP_FILE_VERSION);
+    WriteMapInt32(header + 8, numCols);
+    WriteMapInt32(header + 12, numRows);
+    for (int i = 0; i < chunksCount; i++) WriteMapInt32((unsigned char *)&chunkPages[i], (int32_t)chunkPages[i]);
+
+    success = success && SeekPagedFile(file, 0) && (fwrite(header, 1, PAGED_HEADER_SIZE, file) == PAGED_HEADER_SIZE) &&
+        (fwrite(chunkPages, sizeof(uint32_t), chunksCount, file) == (size_t)chunksCount);
+    success = (fclose(file) == 0) && success;
+
+    free(tiles);
+    free(chunkPages);
+
+    return success;
+}
+
+// Install the chunks read in the background and prefetch the chunks around the position and ahead of the movement
+void UpdatePagedMap(PagedMap *map, float x, float y, float velocityX, float velocityY)
+{
+    map->useClock++;
+
+    for (int i = 0; i < map->slotsCount; i++)
+    {
+        if (map->slots[i].loading && IsLoadFenceReached(map->slots[i].fence)) InstallPagedSlot(map, i);
+    }
+
+    int chunkX = (int)floorf(x/TILE_SIZE) >> PAGED_CHUNK_SHIFT;
+    int chunkY = (int)floorf(y/TILE_SIZE) >> PAGED_CHUNK_SHIFT;
+    int aheadX = (int)floorf((x + velocityX*PAGED_PREFETCH_TIME)/TILE_SIZE) >> PAGED_CHUNK_SHIFT;
+    int aheadY = (int)floorf((y + velocityY*PAGED_PREFETCH_TIME)/TILE_SIZE) >> PAGED_CHUNK_SHIFT;
+
+    if (map->prefetchRadius < 0) return;
+
+    PrefetchPagedChunks(map, chunkX, chunkY);
+    if ((aheadX != chunkX) || (aheadY != chunkY)) PrefetchPagedChunks(map, aheadX, aheadY);
+}
+
+// Read a chunk missing from the chunk table, waits for it when it is already being read in the background
+const unsigned char *LoadPagedMapChunk(PagedMap *map, int chunkIndex)
+{
+    map->stats.missesCount++;
+
+    if (map->chunkLoading[chunkIndex])
+    {
+        for (int i = 0; i < map->slotsCount; i++)
+        {
+            if (map->slots[i].loading && (map->slots[i].chunkIndex == chunkIndex))
+            {
+                WaitLoadFence(map->slots[i].fence);
+                InstallPagedSlot(map, i);
+                break;
+            }
+        }
+    }
+    else
+    {
+        int slot = AcquirePagedSlot(map);
+
+        map->slots[slot].chunkIndex = chunkIndex;
+        ReadPagedChunk(map->file, map->chunkPages[chunkIndex], map->slotData + (size_t)slot*PAGED_PAGE_SIZE);
+        InstallPagedSlot(map, slot);
+    }
+
+    return map->chunks[chunkIndex];
+}
+
+PagedMapStats GetPagedMapStats(const PagedMap *map)
+{
+    return map->stats;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Seek from the start of a file with 64 bit offsets, maps bigger than 2 GB
+static bool SeekPagedFile(FILE *file, uint64_t offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Read the tiles of a chunk page, a page that can't be read is all walls
+static void ReadPagedChunk(PagedFile *file, uint32_t page, unsigned char *data)
+{
+    pthread_mutex_lock(&file->mutex);
+    bool success = SeekPagedFile(file->file, (uint64_t)page*PAGED_PAGE_SIZE) && (fread(data, 1, PAGED_PAGE_SIZE, file->file) == PAGED_PAGE_SIZE);
+    pthread_mutex_unlock(&file->mutex);
+
+    if (!success) memset(data, TILE_WALL, PAGED_PAGE_SIZE);
+}
+
+// Load job reading a chunk into its slot
+static void ReadPagedChunkJob(void *userData)
+{
+    PagedRequest *request = (PagedRequest *)userData;
+    ReadPagedChunk(request->file, request->page, request->data);
+}
+
+// Get a free slot or evict the least recently used chunk, slots being read are never evicted
+static int AcquirePagedSlot(PagedMap *map)
+{
+    int victim = -1;
+
+    for (int i = 0; i < map->slotsCount; i++)
+    {
+        if (map->slots[i].loading) continue;
+        if (map->slots[i].chunkIndex < 0) return i;
+
+        if ((victim < 0) || ((int32_t)(map->chunkUses[map->slots[i].chunkIndex] - map->chunkUses[map->slots[victim].chunkIndex]) < 0)) victim = i;
+    }
+
+    // NOTE: Prefetching keeps at most half of the slots loading, there is always a victim
+    assert(victim >= 0);
+
+    map->chunks[map->slots[victim].chunkIndex] = NULL;
+    map->slots[victim].chunkIndex = -1;
+    map->stats.evictionsCount++;
+    map->stats.residentCount--;
+
+    return victim;
+}
+
+// Make the chunk of a slot visible to the lookups
+static void InstallPagedSlot(PagedMap *map, int slot)
+{
+    int chunkIndex = map->slots[slot].chunkIndex;
+
+    map->chunks[chunkIndex] = map->slotData + (size_t)slot*PAGED_PAGE_SIZE;
+    map->chunkUses[chunkIndex] = map->useClock;
+    map->chunkLoading[chunkIndex] = false;
+    map->slots[slot].loading = false;
+    map->stats.residentCount++;
+}
+
+// Keep the chunks around a chunk resident, reading the missing ones in the background
+static void PrefetchPagedChunks(PagedMap *map, int centerX, int centerY)
+{
+    int loadingCount = 0;
+    for (int i = 0; i < map->slotsCount; i++) loadingCount += map->slots[i].loading;
+
+    for (int chunkY = centerY - map->prefetchRadius; chunkY <= centerY + map->prefetchRadius; chunkY++)
+    {
+        for (int chunkX = centerX - map->prefetchRadius; chunkX <= centerX + map->prefetchRadius; chunkX++)
+        {
+            if ((chunkX < 0) || (chunkX >= map->chunkCols) || (chunkY < 0) || (chunkY >= map->chunkRows)) continue;
+
+            int chunkIndex = chunkY*map->chunkCols + chunkX;
+
+            if (map->chunks[chunkIndex] != NULL) map->chunkUses[chunkIndex] = map->useClock;
+            else if (!map->chunkLoading[chunkIndex] && (loadingCount < map->slotsCount/2))
+            {
+                int slot = AcquirePagedSlot(map);
+
+                map->slots[slot].chunkIndex = chunkIndex;
+                map->slots[slot].loading = true;
+                map->chunkLoading[chunkIndex] = true;
+                map->requests[slot] = (PagedRequest){ map->file, map->chunkPages[chunkIndex], map->slotData + (size_t)slot*PAGED_PAGE_SIZE };
+                map->slots[slot].fence = SubmitLoadJob(ReadPagedChunkJob, &map->requests[slot]);
+                map->stats.prefetchesCount++;
+                loadingCount++;
+            }
+        }
+    }
+}
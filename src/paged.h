@@ -0,0 +1,150 @@
+/**********************************************************************************************
+*
+*   raycaster - Paged map
+*
+*   Tile grids larger than memory, i.e. 65536x65536 tiles, stored in a file as chunks of
+*   PAGED_CHUNK_SIZE x PAGED_CHUNK_SIZE one byte tiles. Only the chunks in use stay in memory,
+*   in a fixed cache of chunk slots that evicts the least recently used one. Lookups go through
+*   a table with a pointer per chunk, a missing chunk is read from the file on the spot.
+*
+*   UpdatePagedMap() installs the chunks read in the background and requests the ones around
+*   a position and ahead of its movement, so they are in memory before the lookups need them.
+*   Background reads are load jobs (loader.h), they run on the calling thread when the loader
+*   thread is not running. Everything else must be called from one thread.
+*
+*   Paged map files start with the "RCPM" identifier, the format version, numCols and numRows,
+*   followed by a page index per chunk (row-major, 0 for chunks with no tiles set, not stored)
+*   and the chunk pages, PAGED_PAGE_SIZE bytes each at offset pageIndex*PAGED_PAGE_SIZE.
+*   All values little-endian, on any host (see ReadMapInt32()).
+*
+*   The cache statistics (GetPagedMapStats()) are meant for the frame reports of a game paging
+*   its world; the example game keeps its small map in memory, bench_paged reports them. Lookups
+*   hitting memory write nothing but the first use of their chunk in a frame, the statistics
+*   only count the misses.
+*
+*   The ray caster, collision and renderer read the tiles of a Map (map.h), not of a paged map:
+*   a game paging its world pages it around the player into a Map of the area in view.
+*
+**********************************************************************************************/
+
+#ifndef PAGED_H
+#define PAGED_H
+
+#include "map.h"
+#include "loader.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define PAGED_MAP_FILE_VERSION 1
+
+#define PAGED_CHUNK_SHIFT 6
+#define PAGED_CHUNK_SIZE (1 << PAGED_CHUNK_SHIFT)     // Chunk side in tiles
+#define PAGED_CHUNK_MASK (PAGED_CHUNK_SIZE - 1)
+#define PAGED_PAGE_SIZE (PAGED_CHUNK_SIZE*PAGED_CHUNK_SIZE)     // Chunk bytes, one per tile
+
+#define PAGED_PREFETCH_RADIUS 1         // Default prefetch radius, in chunks
+#define PAGED_PREFETCH_TIME 1.0f        // Seconds of movement the prefetch looks ahead
+#define PAGED_MIN_CACHED_CHUNKS (4*(2*PAGED_PREFETCH_RADIUS + 1)*(2*PAGED_PREFETCH_RADIUS + 1))
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct PagedMapStats
+{
+    uint64_t missesCount;               // Lookups reading their chunk from the file
+    uint64_t prefetchesCount;           // Chunks read in the background
+    uint64_t evictionsCount;            // Chunks dropped to make room
+    int residentCount;                  // Chunks in memory
+}
+PagedMapStats;
+
+typedef struct PagedFile PagedFile;         // Chunk reads, shared with the loader thread
+typedef struct PagedRequest PagedRequest;   // Background read of a slot
+
+// Chunk slot of the cache
+typedef struct PagedChunkSlot
+{
+    int chunkIndex;                     // Chunk held, -1 when free
+    bool loading;                       // Read in the background, not in the chunk table yet
+    LoadFence fence;
+}
+PagedChunkSlot;
+
+typedef struct PagedMap
+{
+    int numCols;                        // Number of tiles along the x axis
+    int numRows;
+    int chunkCols;                      // Number of chunks along the x axis
+    int chunkRows;
+    const unsigned char **chunks;       // Tiles of every chunk in memory, NULL when not resident (chunkCols*chunkRows)
+    uint32_t *chunkPages;               // File page of every chunk, 0 for empty chunks
+    uint32_t *chunkUses;                // Last use of every chunk, in UpdatePagedMap() calls
+    bool *chunkLoading;                 // Chunk being read in the background
+    uint32_t useClock;
+
+    int prefetchRadius;                 // Chunks around the position and the predicted position kept resident, -1 disables prefetching
+    int slotsCount;
+    PagedChunkSlot *slots;
+    unsigned char *slotData;            // PAGED_PAGE_SIZE bytes per slot
+
+    PagedFile *file;
+    PagedRequest *requests;             // One per slot
+
+    PagedMapStats stats;
+}
+PagedMap;
+
+// Fills the tiles of a chunk, row-major PAGED_CHUNK_SIZE*PAGED_CHUNK_SIZE, when exporting a map
+typedef void (*PagedChunkFunc)(void *userData, int chunkX, int chunkY, unsigned char *tiles);
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Paged Map Functions Declaration
+//----------------------------------------------------------------------------------
+PagedMap *LoadPagedMap(const char *fileName, int cachedChunks);     // Open a paged map file, NULL when missing or invalid
+void UnloadPagedMap(PagedMap *map);
+bool ExportPagedMap(const char *fileName, int numCols, int numRows, PagedChunkFunc func, void *userData);
+
+void UpdatePagedMap(PagedMap *map, float x, float y, float velocityX, float velocityY);    // Once per frame, world units
+const unsigned char *LoadPagedMapChunk(PagedMap *map, int chunkIndex);     // Miss path of the lookups, reads the chunk now
+PagedMapStats GetPagedMapStats(const PagedMap *map);
+
+// Tile content at the given grid position, tiles outside the map are walls
+static inline int GetPagedMapTile(PagedMap *map, int gridIndexX, int gridIndexY)
+{
+    if ((gridIndexX < 0) || (gridIndexX >= map->numCols) || (gridIndexY < 0) || (gridIndexY >= map->numRows)) return TILE_WALL;
+
+    int chunkIndex = (gridIndexY >> PAGED_CHUNK_SHIFT)*map->chunkCols + (gridIndexX >> PAGED_CHUNK_SHIFT);
+    const unsigned char *chunk = map->chunks[chunkIndex];
+
+    if (chunk == NULL) chunk = LoadPagedMapChunk(map, chunkIndex);
+    else if (map->chunkUses[chunkIndex] != map->useClock) map->chunkUses[chunkIndex] = map->useClock;     // Written once per chunk and frame
+
+    return chunk[(gridIndexY & PAGED_CHUNK_MASK)*PAGED_CHUNK_SIZE + (gridIndexX & PAGED_CHUNK_MASK)];
+}
+
+// Tile content at the given world position
+static inline int GetPagedMapWallTypeAt(PagedMap *map, float x, float y)
+{
+    return GetPagedMapTile(map, (int)floorf(x/TILE_SIZE), (int)floorf(y/TILE_SIZE));
+}
+
+// Check if there is a wall (any non-empty tile) at the given world position
+static inline bool PagedMapHasWallAt(PagedMap *map, float x, float y)
+{
+    return GetPagedMapWallTypeAt(map, x, y) != TILE_EMPTY;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAGED_H
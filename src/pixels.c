@@ -0,0 +1,158 @@
+/**********************************************************************************************
+*
+*   raycaster - Pixel kernels
+*
+*   Scalar kernels plus a four pixels wide blending path written with GCC/Clang vector
+*   extensions, lowered to SSE2 on desktop.
+*
+**********************************************************************************************/
+
+#include "pixels.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+    #define PIXELS_SIMD
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+#if defined(PIXELS_SIMD)
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef float f32x4 __attribute__((vector_size(16)));
+#endif
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+#if defined(PIXELS_SIMD)
+// Exact x/255 for 0 <= x < 65535
+static inline i32x4 DivideBy255(i32x4 x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+// Exact x/65025 for 0 <= x <= 255*255*255, the float estimate is off by one at most
+static inline i32x4 DivideBy65025(i32x4 x)
+{
+    i32x4 q = __builtin_convertvector(__builtin_convertvector(x, f32x4)*(1.0f/65025.0f), i32x4);
+
+    q -= ((q + 1)*65025 <= x);      // Comparisons give -1 on true lanes
+    q += (q*65025 > x);
+
+    return q;
+}
+#endif
+
+//----------------------------------------------------------------------------------
+// Pixel Kernels Functions Definition
+//----------------------------------------------------------------------------------
+
+// Color A over color B, both with alpha
+uint32_t GetMixedColor(uint32_t colorA, uint32_t colorB)
+{
+    unsigned char blueA = colorA &(0xff);
+    unsigned char greenA = (colorA >> 8) &(0xff);
+    unsigned char redA = (colorA >> 16) &(0xff);
+    unsigned char alphaA = (colorA >> 24) &(0xff);
+
+    unsigned char blueB = colorB &(0xff);
+    unsigned char greenB = (colorB >> 8) &(0xff);
+    unsigned char redB = (colorB >> 16) &(0xff);
+    unsigned char alphaB = (colorB >> 24) &(0xff);
+
+    unsigned char blueResult = (blueA *alphaA / 255) + (blueB *alphaB *(255 - alphaA) / (255 *255));
+    unsigned char greenResult = (greenA *alphaA / 255) + (greenB *alphaB *(255 - alphaA) / (255 *255));
+    unsigned char redResult = (redA *alphaA / 255) + (redB *alphaB *(255 - alphaA) / (255 *255));
+    unsigned char alphaResult = alphaA + (alphaB *(255 - alphaA) / 255);
+
+    uint32_t result = ((uint32_t) 0 &0xFFFFFF00) | blueResult;
+    result = (result & 0xFFFF00FF) | ((uint32_t) greenResult << 8);
+    result = (result & 0xFF00FFFF) | ((uint32_t) redResult << 16);
+    result = (result & 0x00FFFFFF) | ((uint32_t) alphaResult << 24);
+
+    return result;
+}
+
+// Fill count consecutive pixels
+void FillPixels(uint32_t *pixels, int count, uint32_t color)
+{
+    for (int i = 0; i < count; i++) pixels[i] = color;
+}
+
+// Fill count pixels, stride pixels apart
+void FillPixelColumn(uint32_t *pixels, int stride, int count, uint32_t color)
+{
+    for (int i = 0; i < count; i++) pixels[i*stride] = color;
+}
+
+// Blend a color over count pixels, stride pixels apart, optionally making the results opaque
+void MixPixelColumn(uint32_t *pixels, int stride, int count, uint32_t color, bool makeOpaque)
+{
+    uint32_t opaqueMask = makeOpaque? ((uint32_t)255 << 24) : 0;
+    int i = 0;
+
+#if defined(PIXELS_SIMD)
+    // The source color is the same for all the pixels, only the destination terms change
+    int alphaA = (color >> 24) & 0xff;
+    int inverseAlphaA = 255 - alphaA;
+    int blueTerm = (color & 0xff)*alphaA/255;
+    int greenTerm = ((color >> 8) & 0xff)*alphaA/255;
+    int redTerm = ((color >> 16) & 0xff)*alphaA/255;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t *p = pixels + i*stride;
+        i32x4 colorB = { (int32_t)p[0], (int32_t)p[stride], (int32_t)p[2*stride], (int32_t)p[3*stride] };
+
+        i32x4 alphaB = (colorB >> 24) & 0xff;
+        i32x4 weightB = alphaB*inverseAlphaA;
+
+        i32x4 blue = blueTerm + DivideBy65025((colorB & 0xff)*weightB);
+        i32x4 green = greenTerm + DivideBy65025(((colorB >> 8) & 0xff)*weightB);
+        i32x4 red = redTerm + DivideBy65025(((colorB >> 16) & 0xff)*weightB);
+        i32x4 alpha = alphaA + DivideBy255(weightB);
+
+        u32x4 result = (u32x4)blue | ((u32x4)green << 8) | ((u32x4)red << 16) | ((u32x4)alpha << 24) | opaqueMask;
+
+        p[0] = result[0];
+        p[stride] = result[1];
+        p[2*stride] = result[2];
+        p[3*stride] = result[3];
+    }
+#endif
+
+    for (; i < count; i++) pixels[i*stride] = GetMixedColor(color, pixels[i*stride]) | opaqueMask;
+}
+
+// Fill count indexed pixels, stride pixels apart
+void FillIndexColumn(unsigned char *indices, int stride, int count, unsigned char index)
+{
+    for (int i = 0; i < count; i++) indices[i*stride] = index;
+}
+
+// Expand count indexed pixels to palette colors
+// NOTE: 128 bit SIMD has no gather, four indices are read with a single load instead, swapped
+// on big-endian hosts so the first index is always the low byte
+void ExpandIndexedPixels(uint32_t *pixels, const unsigned char *indices, int count, const uint32_t *palette)
+{
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t quad = 0;
+        memcpy(&quad, indices + i, sizeof(quad));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        quad = __builtin_bswap32(quad);
+#endif
+
+        pixels[i] = palette[quad & 0xff];
+        pixels[i + 1] = palette[(quad >> 8) & 0xff];
+        pixels[i + 2] = palette[(quad >> 16) & 0xff];
+        pixels[i + 3] = palette[quad >> 24];
+    }
+
+    for (; i < count; i++) pixels[i] = palette[indices[i]];
+}
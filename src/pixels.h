@@ -0,0 +1,42 @@
+/**********************************************************************************************
+*
+*   raycaster - Pixel kernels
+*
+*   Fill and blend kernels working on 32 bit pixels (0xAARRGGBB as stored by the window buffer).
+*   The renderer draws columns, so the kernels take a stride between consecutive pixels.
+*
+*   Blending runs four pixels at a time on targets with SSE2 (desktop), with results identical
+*   to GetMixedColor(). Other targets, WebAssembly included, blend one pixel at a time.
+*
+*   Indexed framebuffers (one byte per pixel) are expanded to 32 bit pixels through a 256 colors
+*   palette in a single pass, right before uploading them.
+*
+**********************************************************************************************/
+
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Pixel Kernels Functions Declaration
+//----------------------------------------------------------------------------------
+uint32_t GetMixedColor(uint32_t colorA, uint32_t colorB);      // Color A over color B, both with alpha
+
+void FillPixels(uint32_t *pixels, int count, uint32_t color);
+void FillPixelColumn(uint32_t *pixels, int stride, int count, uint32_t color);
+void MixPixelColumn(uint32_t *pixels, int stride, int count, uint32_t color, bool makeOpaque);
+
+void FillIndexColumn(unsigned char *indices, int stride, int count, unsigned char index);
+void ExpandIndexedPixels(uint32_t *pixels, const unsigned char *indices, int count, const uint32_t *palette);    // palette of 256 colors
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIXELS_H
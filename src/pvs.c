@@ -0,0 +1,567 @@
+/**********************************************************************************************
+*
+*   raycaster - Potentially visible sets
+*
+*   Builds, stores and queries the encoded visibility sets of the map tiles.
+*
+**********************************************************************************************/
+
+#include "pvs.h"
+#include "raycast.h"
+#include "jobs.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define PVS_MAX_HITS_PER_RAY 64
+#define PVS_BUILD_BATCH_SIZE 4          // Tiles per job batch, every tile casts hundreds of rays
+#define PVS_SAMPLE_INSET 0.01f          // Edge sample points, in tiles, off the grid lines
+#define PVS_MAX_HEADER_SIZE 21          // Encoding byte and four varints
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct PvsBuild
+{
+    const Map *map;
+    int samples;
+    int rays;
+    unsigned char **sets;       // Encoded set of every tile, written by the jobs
+    int *setsSizes;
+}
+PvsBuild;
+
+// Visible tiles of the set being built, one byte per map tile, and their bounding rectangle
+typedef struct PvsScratch
+{
+    unsigned char *visible;
+    int minCol;
+    int minRow;
+    int maxCol;
+    int maxRow;
+}
+PvsScratch;
+
+// Decoded start of a set
+typedef struct PvsSetHeader
+{
+    int encoding;               // PvsEncoding
+    int minCol;
+    int minRow;
+    int width;
+    int height;
+}
+PvsSetHeader;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+
+// Mark a tile visible, tiles outside the map (hits on a map without border walls) are skipped
+static inline void MarkPvsTile(const Map *map, PvsScratch *scratch, int gridIndexX, int gridIndexY)
+{
+    if ((gridIndexX < 0) || (gridIndexX >= map->numCols) || (gridIndexY < 0) || (gridIndexY >= map->numRows)) return;
+
+    scratch->visible[gridIndexY*map->numCols + gridIndexX] = 1;
+
+    if (gridIndexX < scratch->minCol) scratch->minCol = gridIndexX;
+    if (gridIndexX > scratch->maxCol) scratch->maxCol = gridIndexX;
+    if (gridIndexY < scratch->minRow) scratch->minRow = gridIndexY;
+    if (gridIndexY > scratch->maxRow) scratch->maxRow = gridIndexY;
+}
+
+// Mark the tiles crossed by a segment (grid traversal, every tile touched by the segment)
+static void MarkSegmentTiles(const Map *map, PvsScratch *scratch, float x0, float y0, float x1, float y1)
+{
+    int gridIndexX = (int)floorf(x0/TILE_SIZE);
+    int gridIndexY = (int)floorf(y0/TILE_SIZE);
+    int endIndexX = (int)floorf(x1/TILE_SIZE);
+    int endIndexY = (int)floorf(y1/TILE_SIZE);
+    float deltaX = x1 - x0;
+    float deltaY = y1 - y0;
+    int stepX = (deltaX > 0.0f)? 1 : -1;
+    int stepY = (deltaY > 0.0f)? 1 : -1;
+
+    // Segment parameter where the next vertical/horizontal grid line is crossed, and its increment per tile
+    float tDeltaX = (deltaX != 0.0f)? fabsf(TILE_SIZE/deltaX) : FLT_MAX;
+    float tDeltaY = (deltaY != 0.0f)? fabsf(TILE_SIZE/deltaY) : FLT_MAX;
+    float tMaxX = (deltaX != 0.0f)? (((gridIndexX + (stepX > 0))*TILE_SIZE - x0)/deltaX) : FLT_MAX;
+    float tMaxY = (deltaY != 0.0f)? (((gridIndexY + (stepY > 0))*TILE_SIZE - y0)/deltaY) : FLT_MAX;
+
+    int maxSteps = abs(endIndexX - gridIndexX) + abs(endIndexY - gridIndexY);
+
+    for (int i = 0; i <= maxSteps; i++)
+    {
+        MarkPvsTile(map, scratch, gridIndexX, gridIndexY);
+
+        if (tMaxX < tMaxY)
+        {
+            if (tMaxX > 1.0f) break;
+            gridIndexX += stepX;
+            tMaxX += tDeltaX;
+        }
+        else
+        {
+            if (tMaxY > 1.0f) break;
+            gridIndexY += stepY;
+            tMaxY += tDeltaY;
+        }
+    }
+}
+
+// Append an unsigned LEB128 varint, returns the number of bytes written
+static int WriteVarint(unsigned char *data, unsigned int value)
+{
+    int size = 0;
+
+    do
+    {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        data[size++] = (value != 0)? (byte | 0x80) : byte;
+    } while (value != 0);
+
+    return size;
+}
+
+// Read an unsigned LEB128 varint, returns the number of bytes read, 0 when truncated
+static int ReadVarint(const unsigned char *data, const unsigned char *end, unsigned int *value)
+{
+    int size = 0;
+    int shift = 0;
+
+    *value = 0;
+
+    while ((data + size < end) && (shift < 32))
+    {
+        unsigned char byte = data[size++];
+        *value |= (unsigned int)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return size;
+        shift += 7;
+    }
+
+    return 0;
+}
+
+// Read the header of a non-empty set, returns its size, 0 when truncated
+static int ReadPvsSetHeader(const unsigned char *data, const unsigned char *end, PvsSetHeader *header)
+{
+    unsigned int values[4] = { 0 };
+    int size = 1;
+
+    if (data >= end) return 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int valueSize = ReadVarint(data + size, end, &values[i]);
+        if ((valueSize == 0) || (values[i] > INT32_MAX)) return 0;
+        size += valueSize;
+    }
+
+    *header = (PvsSetHeader){ .encoding = data[0], .minCol = (int)values[0], .minRow = (int)values[1], .width = (int)values[2], .height = (int)values[3] };
+
+    return size;
+}
+
+// Encode the rectangle of the visible tiles of a set, returns the set size
+// NOTE: Runs are only kept when smaller than the bitset, set must hold PVS_MAX_HEADER_SIZE + bitset bytes
+static int EncodePvsSet(const Map *map, const PvsScratch *scratch, unsigned char *set)
+{
+    int width = scratch->maxCol - scratch->minCol + 1;
+    int height = scratch->maxRow - scratch->minRow + 1;
+    int bitsSize = (width*height + 7)/8;
+
+    int headerSize = 1;
+    headerSize += WriteVarint(set + headerSize, (unsigned int)scratch->minCol);
+    headerSize += WriteVarint(set + headerSize, (unsigned int)scratch->minRow);
+    headerSize += WriteVarint(set + headerSize, (unsigned int)width);
+    headerSize += WriteVarint(set + headerSize, (unsigned int)height);
+
+    // Alternating runs, given up as soon as they get as large as the bitset
+    unsigned char *runs = set + headerSize;
+    unsigned char value = 0;
+    int runsSize = 0;
+    int length = 0;
+
+    for (int row = scratch->minRow; (row <= scratch->maxRow) && (runsSize < bitsSize); row++)
+    {
+        const unsigned char *visible = scratch->visible + row*map->numCols;
+
+        for (int col = scratch->minCol; col <= scratch->maxCol; col++)
+        {
+            if (visible[col] == value) length++;
+            else
+            {
+                if (runsSize + 5 > bitsSize)
+                {
+                    runsSize = bitsSize;
+                    break;
+                }
+
+                runsSize += WriteVarint(runs + runsSize, (unsigned int)length);
+                value ^= 1;
+                length = 1;
+            }
+        }
+    }
+
+    // A trailing hidden run is never written
+    if ((value == 1) && (runsSize + 5 <= bitsSize)) runsSize += WriteVarint(runs + runsSize, (unsigned int)length);
+    else if (value == 1) runsSize = bitsSize;
+
+    if (runsSize < bitsSize)
+    {
+        set[0] = PVS_ENCODING_RUNS;
+
+        return headerSize + runsSize;
+    }
+
+    memset(runs, 0, bitsSize);
+
+    for (int row = scratch->minRow; row <= scratch->maxRow; row++)
+    {
+        const unsigned char *visible = scratch->visible + row*map->numCols;
+
+        for (int col = scratch->minCol; col <= scratch->maxCol; col++)
+        {
+            int bit = (row - scratch->minRow)*width + (col - scratch->minCol);
+            if (visible[col]) runs[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+        }
+    }
+
+    set[0] = PVS_ENCODING_BITS;
+
+    return headerSize + bitsSize;
+}
+
+// Check that a set decodes within its bytes and its rectangle within the map
+static bool IsPvsSetValid(const MapPvs *pvs, const unsigned char *data, const unsigned char *end)
+{
+    if (data == end) return true;
+
+    PvsSetHeader header = { 0 };
+    int headerSize = ReadPvsSetHeader(data, end, &header);
+
+    if ((headerSize == 0) || (header.width == 0) || (header.height == 0) ||
+        (header.minCol >= pvs->numCols) || (header.width > pvs->numCols - header.minCol) ||
+        (header.minRow >= pvs->numRows) || (header.height > pvs->numRows - header.minRow)) return false;
+
+    data += headerSize;
+    long area = (long)header.width*header.height;
+
+    if (header.encoding == PVS_ENCODING_BITS) return (end - data == (area + 7)/8);
+    if (header.encoding != PVS_ENCODING_RUNS) return false;
+
+    long position = 0;
+
+    while (data < end)
+    {
+        unsigned int length = 0;
+        int lengthSize = ReadVarint(data, end, &length);
+
+        if (lengthSize == 0) return false;
+        data += lengthSize;
+        position += length;
+        if (position > area) return false;
+    }
+
+    return true;
+}
+
+// Job function, builds the sets of tiles [start, end)
+static void BuildPvsTiles(void *userData, int start, int end)
+{
+    PvsBuild *build = (PvsBuild *)userData;
+    const Map *map = build->map;
+    int tilesCount = map->numCols*map->numRows;
+
+    PvsScratch scratch = { .visible = (unsigned char *)calloc(tilesCount, 1) };
+    unsigned char *set = (unsigned char *)malloc(PVS_MAX_HEADER_SIZE + (tilesCount + 7)/8);
+    WallHit hits[PVS_MAX_HITS_PER_RAY];
+
+    for (int tile = start; tile < end; tile++)
+    {
+        int gridIndexX = tile%map->numCols;
+        int gridIndexY = tile/map->numCols;
+
+        // Only empty tiles can hold the camera, the other tiles get empty sets
+        if (map->tiles[tile] != TILE_EMPTY) continue;
+
+        scratch.minCol = scratch.maxCol = gridIndexX;
+        scratch.minRow = scratch.maxRow = gridIndexY;
+        MarkPvsTile(map, &scratch, gridIndexX, gridIndexY);
+
+        for (int sy = 0; sy < build->samples; sy++)
+        {
+            for (int sx = 0; sx < build->samples; sx++)
+            {
+                // Sample points from edge to edge, a single one at the center
+                float spacing = (build->samples > 1)? (1.0f - 2*PVS_SAMPLE_INSET)/(build->samples - 1) : 0.0f;
+                float offsetX = (build->samples > 1)? PVS_SAMPLE_INSET + sx*spacing : 0.5f;
+                float offsetY = (build->samples > 1)? PVS_SAMPLE_INSET + sy*spacing : 0.5f;
+                float originX = (gridIndexX + offsetX)*TILE_SIZE;
+                float originY = (gridIndexY + offsetY)*TILE_SIZE;
+
+                for (int r = 0; r < build->rays; r++)
+                {
+                    // Half step offset keeps the rays off the axis directions
+                    RayQuery query = { .originX = originX, .originY = originY, .angle = (r + 0.5f)*TWO_PI/build->rays,
+                        .maxDistance = FLT_MAX, .flags = RAY_PASS_TRANSLUCENT | RAY_PASS_PORTALS, .maxTranslucentWalls = 0 };
+                    int hitsCount = CastRayQuery(map, &query, hits, PVS_MAX_HITS_PER_RAY);
+
+                    for (int h = 0; h < hitsCount; h++)
+                    {
+                        MarkSegmentTiles(map, &scratch, hits[h].rayOriginX, hits[h].rayOriginY, hits[h].wallHitX, hits[h].wallHitY);
+                        MarkPvsTile(map, &scratch, hits[h].wallGridIndexX, hits[h].wallGridIndexY);
+                    }
+                }
+            }
+        }
+
+        int size = EncodePvsSet(map, &scratch, set);
+
+        build->sets[tile] = (unsigned char *)malloc(size);
+        memcpy(build->sets[tile], set, size);
+        build->setsSizes[tile] = size;
+
+        // Only the rectangle was marked
+        for (int row = scratch.minRow; row <= scratch.maxRow; row++) memset(scratch.visible + row*map->numCols + scratch.minCol, 0, scratch.maxCol - scratch.minCol + 1);
+    }
+
+    free(scratch.visible);
+    free(set);
+}
+
+//----------------------------------------------------------------------------------
+// Potentially Visible Sets Functions Definition
+//----------------------------------------------------------------------------------
+
+// Build the sets of all the map tiles, samples*samples points per tile casting the given number of rays
+// NOTE: Runs over the job system workers when InitJobSystem() was called
+MapPvs *BuildMapPvs(const Map *map, int samples, int rays)
+{
+    int tilesCount = map->numCols*map->numRows;
+    PvsBuild build = { .map = map, .samples = (samples > 0)? samples : PVS_DEFAULT_SAMPLES, .rays = (rays > 0)? rays : PVS_DEFAULT_RAYS,
+        .sets = (unsigned char **)calloc(tilesCount, sizeof(unsigned char *)), .setsSizes = (int *)calloc(tilesCount, sizeof(int)) };
+
+    RunParallelFor(tilesCount, PVS_BUILD_BATCH_SIZE, BuildPvsTiles, &build);
+
+    MapPvs *pvs = (MapPvs *)calloc(1, sizeof(MapPvs));
+    pvs->numCols = map->numCols;
+    pvs->numRows = map->numRows;
+    pvs->offsets = (int *)malloc((tilesCount + 1)*sizeof(int));
+
+    for (int i = 0; i < tilesCount; i++)
+    {
+        pvs->offsets[i] = pvs->dataSize;
+        pvs->dataSize += build.setsSizes[i];
+    }
+    pvs->offsets[tilesCount] = pvs->dataSize;
+
+    pvs->data = (unsigned char *)malloc((pvs->dataSize > 0)? pvs->dataSize : 1);
+
+    for (int i = 0; i < tilesCount; i++)
+    {
+        if (build.setsSizes[i] > 0) memcpy(pvs->data + pvs->offsets[i], build.sets[i], build.setsSizes[i]);
+        free(build.sets[i]);
+    }
+
+    free(build.sets);
+    free(build.setsSizes);
+
+    return pvs;
+}
+
+// Load the sets of a map stored in the "PVS " chunk of its file
+// NOTE: Returns NULL when there are none, or they are malformed or were built for another grid size
+MapPvs *LoadMapPvs(const Map *map, const char *fileName)
+{
+    int size = 0;
+    unsigned char *chunk = (unsigned char *)LoadMapChunk(fileName, "PVS ", &size);
+    if (chunk == NULL) return NULL;
+
+    MapPvs *pvs = NULL;
+
+    if (size >= 12)
+    {
+        int32_t numCols = ReadMapInt32(chunk);
+        int32_t numRows = ReadMapInt32(chunk + 4);
+        int32_t dataSize = ReadMapInt32(chunk + 8);
+        int tilesCount = map->numCols*map->numRows;
+
+        if ((numCols == map->numCols) && (numRows == map->numRows) && (tilesCount > 0) && (dataSize >= 0) &&
+            (tilesCount < (size - 12)/4) && (dataSize == size - 12 - (tilesCount + 1)*4))
+        {
+            pvs = (MapPvs *)calloc(1, sizeof(MapPvs));
+            pvs->numCols = numCols;
+            pvs->numRows = numRows;
+            pvs->dataSize = dataSize;
+            pvs->offsets = (int *)malloc((tilesCount + 1)*sizeof(int));
+            pvs->data = (unsigned char *)malloc((dataSize > 0)? dataSize : 1);
+
+            for (int i = 0; i <= tilesCount; i++) pvs->offsets[i] = ReadMapInt32(chunk + 12 + i*4);
+            memcpy(pvs->data, chunk + 12 + (tilesCount + 1)*4, dataSize);
+
+            // Reject offsets out of the data and sets not decoding within their bytes
+            bool valid = (pvs->offsets[0] == 0) && (pvs->offsets[tilesCount] == dataSize);
+
+            for (int i = 0; (i < tilesCount) && valid; i++)
+            {
+                valid = (pvs->offsets[i] <= pvs->offsets[i + 1]) && (pvs->offsets[i + 1] <= dataSize) &&
+                    IsPvsSetValid(pvs, pvs->data + pvs->offsets[i], pvs->data + pvs->offsets[i + 1]);
+            }
+
+            if (!valid)
+            {
+                UnloadMapPvs(pvs);
+                pvs = NULL;
+            }
+        }
+    }
+
+    free(chunk);
+
+    return pvs;
+}
+
+// Store the sets into the "PVS " chunk of a map file, replacing the previous ones
+bool ExportMapPvs(const MapPvs *pvs, const char *fileName)
+{
+    int tilesCount = pvs->numCols*pvs->numRows;
+    int size = 12 + (tilesCount + 1)*4 + pvs->dataSize;
+    unsigned char *chunk = (unsigned char *)malloc(size);
+
+    WriteMapInt32(chunk, pvs->numCols);
+    WriteMapInt32(chunk + 4, pvs->numRows);
+    WriteMapInt32(chunk + 8, pvs->dataSize);
+    for (int i = 0; i <= tilesCount; i++) WriteMapInt32(chunk + 12 + i*4, pvs->offsets[i]);
+    memcpy(chunk + 12 + (tilesCount + 1)*4, pvs->data, pvs->dataSize);
+
+    bool success = ExportMapChunk(fileName, "PVS ", chunk, size);
+
+    free(chunk);
+
+    return success;
+}
+
+// Unload sets built with BuildMapPvs() or loaded with LoadMapPvs()
+void UnloadMapPvs(MapPvs *pvs)
+{
+    if (pvs == NULL) return;
+
+    free(pvs->offsets);
+    free(pvs->data);
+    free(pvs);
+}
+
+// Check if a tile is potentially visible from another tile
+bool IsTileInPvs(const MapPvs *pvs, int fromX, int fromY, int gridIndexX, int gridIndexY)
+{
+    if ((fromX < 0) || (fromX >= pvs->numCols) || (fromY < 0) || (fromY >= pvs->numRows)) return false;
+
+    int from = fromY*pvs->numCols + fromX;
+    const unsigned char *data = pvs->data + pvs->offsets[from];
+    const unsigned char *end = pvs->data + pvs->offsets[from + 1];
+    PvsSetHeader header = { 0 };
+    int headerSize = ReadPvsSetHeader(data, end, &header);
+
+    // Tiles out of the set rectangle are hidden, wall tiles sets are empty
+    if (headerSize == 0) return false;
+    if ((gridIndexX < header.minCol) || (gridIndexX >= header.minCol + header.width) ||
+        (gridIndexY < header.minRow) || (gridIndexY >= header.minRow + header.height)) return false;
+
+    unsigned int target = (unsigned int)((gridIndexY - header.minRow)*header.width + (gridIndexX - header.minCol));
+    data += headerSize;
+
+    if (header.encoding == PVS_ENCODING_BITS) return (data[target >> 3] >> (target & 7)) & 1;
+
+    unsigned int position = 0;
+    bool visible = false;
+
+    while (data < end)
+    {
+        unsigned int length = 0;
+        int lengthSize = ReadVarint(data, end, &length);
+
+        if (lengthSize == 0) break;
+        data += lengthSize;
+        position += length;
+
+        if (target < position) return visible;
+        visible = !visible;
+    }
+
+    return false;
+}
+
+// Get the indices (row*numCols + col) of the tiles potentially visible from a tile, returns the number written
+int GetPvsTiles(const MapPvs *pvs, int fromX, int fromY, int *tiles, int maxTiles)
+{
+    if ((fromX < 0) || (fromX >= pvs->numCols) || (fromY < 0) || (fromY >= pvs->numRows)) return 0;
+
+    int from = fromY*pvs->numCols + fromX;
+    const unsigned char *data = pvs->data + pvs->offsets[from];
+    const unsigned char *end = pvs->data + pvs->offsets[from + 1];
+    PvsSetHeader header = { 0 };
+    int headerSize = ReadPvsSetHeader(data, end, &header);
+    int count = 0;
+
+    if (headerSize == 0) return 0;
+    data += headerSize;
+
+    // Rectangle tile b is map tile first + (b/width)*numCols + b%width
+    int first = header.minRow*pvs->numCols + header.minCol;
+
+    if (header.encoding == PVS_ENCODING_BITS)
+    {
+        for (int i = 0; (data + i < end) && (count < maxTiles); i++)
+        {
+            // Bytes of hidden tiles are skipped whole
+            for (unsigned int bits = data[i]; (bits != 0) && (count < maxTiles); bits &= bits - 1)
+            {
+                int bit = i*8 + __builtin_ctz(bits);
+                tiles[count++] = first + (bit/header.width)*pvs->numCols + bit%header.width;
+            }
+        }
+
+        return count;
+    }
+
+    unsigned int position = 0;
+    bool visible = false;
+
+    while ((data < end) && (count < maxTiles))
+    {
+        unsigned int length = 0;
+        int lengthSize = ReadVarint(data, end, &length);
+
+        if (lengthSize == 0) break;
+        data += lengthSize;
+
+        if (visible)
+        {
+            int row = (int)position/header.width;
+            int col = (int)position%header.width;
+
+            for (unsigned int i = 0; (i < length) && (count < maxTiles); i++)
+            {
+                tiles[count++] = first + row*pvs->numCols + col;
+                if (++col == header.width)
+                {
+                    col = 0;
+                    row++;
+                }
+            }
+        }
+
+        position += length;
+        visible = !visible;
+    }
+
+    return count;
+}
@@ -0,0 +1,77 @@
+/**********************************************************************************************
+*
+*   raycaster - Potentially visible sets
+*
+*   For every empty tile of a map, the set of tiles that can be seen from somewhere inside it,
+*   looking through translucent walls and portal pairs. Per-frame work (minimap, sprites, world
+*   updates) can iterate the set of the camera tile instead of the whole map.
+*
+*   Sets are built by casting rays in all directions from a grid of sample points spanning each
+*   tile, edges and corners included. Sampling is not conservative: a tile only seen through a
+*   gap narrower than the spacing between rays at its distance (about distance*2*PI/rays) from
+*   every sample point is missed. bench_pvs counts the tiles missed against a dense build.
+*
+*   Every set only covers the bounding rectangle of its visible tiles, stored as a bitset or as
+*   alternating runs of hidden and visible tiles (starting with a hidden run, row-major within
+*   the rectangle), whichever is smaller, so sets grow with what can be seen and not with the
+*   map. All varints are unsigned LEB128:
+*
+*     uint8 encoding, varint minCol, varint minRow, varint width, varint height, then either
+*     (width*height + 7)/8 bytes (bit b%8 of byte b/8 for rectangle tile b) or the run lengths
+*
+*   Wall tiles have empty sets (no bytes). In map files sets go in the "PVS " chunk, built from
+*   the "TILE" and "PORT" chunks (ExportMap() drops it when they change), little-endian:
+*
+*     int32 numCols, int32 numRows, int32 dataSize, (numCols*numRows + 1) int32 offsets, data
+*
+**********************************************************************************************/
+
+#ifndef PVS_H
+#define PVS_H
+
+#include "map.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define PVS_DEFAULT_SAMPLES 3           // Sample points per tile side
+#define PVS_DEFAULT_RAYS 360            // Rays cast from every sample point
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum PvsEncoding {
+    PVS_ENCODING_BITS = 0,      // Bitset of the rectangle tiles
+    PVS_ENCODING_RUNS           // Alternating hidden and visible run lengths over the rectangle
+} PvsEncoding;
+
+typedef struct MapPvs
+{
+    int numCols;
+    int numRows;
+    int *offsets;               // Start of the set of every tile in data, numCols*numRows + 1 entries
+    unsigned char *data;        // Encoded sets of all the tiles
+    int dataSize;
+}
+MapPvs;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Potentially Visible Sets Functions Declaration
+//----------------------------------------------------------------------------------
+MapPvs *BuildMapPvs(const Map *map, int samples, int rays);     // Build all sets, multithreaded
+MapPvs *LoadMapPvs(const Map *map, const char *fileName);       // Load sets of a map from its file "PVS " chunk
+bool ExportMapPvs(const MapPvs *pvs, const char *fileName);     // Store sets into a map file "PVS " chunk
+void UnloadMapPvs(MapPvs *pvs);
+
+bool IsTileInPvs(const MapPvs *pvs, int fromX, int fromY, int gridIndexX, int gridIndexY);
+int GetPvsTiles(const MapPvs *pvs, int fromX, int fromY, int *tiles, int maxTiles);    // Tile indices (row*numCols + col)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PVS_H
@@ -0,0 +1,89 @@
+/**********************************************************************************************
+*
+*   raycaster - Ray casting module
+*
+*   Reentrant grid ray caster shared by the renderer and the gameplay queries (line of sight,
+*   audio occlusion, sprite visibility). Rays start at any origin, can pass through translucent
+*   walls and portals, and write the walls they traverse into a caller-provided buffer.
+*
+**********************************************************************************************/
+
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "map.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+#define TWO_PI 2*PI
+
+#define MAX_RAY_PORTAL_TRANSITS 8       // Stops rays bouncing forever between aligned portals
+
+// Ray query flags
+#define RAY_PASS_TRANSLUCENT 1          // Translucent walls are reported and the ray goes on
+#define RAY_PASS_PORTALS 2              // Portals are reported and the ray goes on from the linked portal
+#define RAY_REPORT_BLOCKING_ONLY 4      // Only the wall stopping the ray is reported
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct WallHit
+{
+    int wallGridIndexX;
+    int wallGridIndexY;
+    float rayOriginX;           // Ray origin for this hit, it changes after going through a portal
+    float rayOriginY;
+    float wallHitX;
+    float wallHitY;
+    float distance;             // Distance traveled from the query origin, portals included
+    bool wasHitVertical;
+    int wallHitContent;
+}
+WallHit;
+
+typedef struct RayQuery
+{
+    float originX;
+    float originY;
+    float angle;                // Ray direction in radians
+    float maxDistance;          // Walls farther than this are not reported
+    int flags;                  // RAY_PASS_TRANSLUCENT | RAY_PASS_PORTALS | RAY_REPORT_BLOCKING_ONLY
+    int maxTranslucentWalls;    // Translucent walls passed before they stop the ray, 0 for no limit
+}
+RayQuery;
+
+typedef struct LineOfSightQuery
+{
+    float fromX;
+    float fromY;
+    float toX;
+    float toY;
+}
+LineOfSightQuery;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Ray Casting Functions Declaration
+//----------------------------------------------------------------------------------
+float NormalizeAngle(float angle);
+float distanceBetweenPoints(float x1, float y1, float x2, float y2, bool calculateSqrt);
+
+int CastRayQuery(const Map *map, const RayQuery *query, WallHit *hits, int maxHits);     // Returns the number of hits written
+int CastRayQueryAlongWalls(const Map *map, const RayQuery *query, const WallHit *walls, int wallsCount, WallHit *hits);   // Walls of a neighbour ray
+void CastRayQueryBatch(const Map *map, const RayQuery *queries, int count, WallHit *hits, int maxHitsPerQuery, int *hitsCounts);
+
+bool CheckLineOfSight(const Map *map, float fromX, float fromY, float toX, float toY, int flags);
+void CheckLineOfSightBatch(const Map *map, const LineOfSightQuery *queries, int count, int flags, bool *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAYCAST_H
@@ -14,6 +14,12 @@
 
 #include "raylib.h"
 #include "screens.h"    // NOTE: Declares global (extern) variables and screens functions
+#include "bundle.h"
+#include "loader.h"
+#include "audio.h"
+
+#define STB_VORBIS_HEADER_ONLY
+#include "stb_vorbis.c"     // OGG pull decoding, implemented by raylib (raudio.c)
 
 #if defined(PLATFORM_WEB)
     #include <emscripten/emscripten.h>
@@ -25,7 +31,6 @@
 //----------------------------------------------------------------------------------
 GameScreen currentScreen = 0;
 Font font = { 0 };
-Music music = { 0 };
 Sound fxCoin = { 0 };
 
 //----------------------------------------------------------------------------------
@@ -40,6 +45,23 @@ static bool onTransition = false;
 static bool transFadeOut = false;
 static int transFromScreen = -1;
 static int transToScreen = -1;
+static float transMaxFrameTime = 0.0f;  // Longest frame of the transition, checked against the frame budget
+static float transFrameTime = 0.0f;     // Frame times of the transition, summed
+static int transFramesCount = 0;
+static int transHeldFrames = 0;         // Faded out frames held waiting for the gameplay data
+
+// Pre-decoded assets, mapped until the music streaming from it is stopped
+static AssetBundle *bundle = NULL;
+
+// Music streamed by its own thread into the audio device callback, frame rate independent
+static AudioStream musicStream = { 0 };
+static AudioStreamer *musicStreamer = NULL;
+static stb_vorbis *musicDecoder = NULL; // Music decoded by the streaming thread as it plays
+static unsigned int musicUnderruns = 0; // Underruns already reported
+
+// Startup time, reported once the first frame is drawn
+static double assetsLoadTime = 0.0;
+static bool firstFrameDrawn = false;
 
 //----------------------------------------------------------------------------------
 // Local Functions Declaration
@@ -52,6 +74,11 @@ static void DrawTransition(void);           // Draw transition effect (full-scre
 
 static void UpdateDrawFrame(void);          // Update and draw one frame
 
+static void LoadGlobalAssets(void);         // Load font, music and sound, from the bundle when available
+static void MusicStreamCallback(void *bufferData, unsigned int frames);     // Audio device thread
+static unsigned int DecodeMusic(void *userData, short *samples, unsigned int frames);   // Music streaming thread
+static void RewindMusic(void *userData);
+
 //----------------------------------------------------------------------------------
 // Main entry point
 //----------------------------------------------------------------------------------
@@ -62,14 +89,13 @@ int main(void)
     InitWindow(screenWidth, screenHeight, "raylib game template");
 
     InitAudioDevice();      // Initialize audio device
+    InitLoader();           // Start the loader thread, screens prepare their data in the background
 
     // Load global data (assets that must be available in all screens, i.e. font)
-    font = LoadFont("resources/mecha.png");
-    music = LoadMusicStream("resources/ambient.ogg");
-    fxCoin = LoadSound("resources/coin.wav");
+    LoadGlobalAssets();
 
-    SetMusicVolume(music, 1.0f);
-    PlayMusicStream(music);
+    SetAudioStreamVolume(musicStream, 1.0f);
+    PlayAudioStream(musicStream);
 
     // Setup and init first screen
     currentScreen = LOGO;
@@ -100,10 +126,17 @@ int main(void)
         default: break;
     }
 
+    // Gameplay data is prepared ahead of the screen, it may be loaded while another screen shows
+    CloseLoader();
+    UnloadGameplayScreen();
+
     // Unload global data loaded
     UnloadFont(font);
-    UnloadMusicStream(music);
+    UnloadAudioStream(musicStream);
+    UnloadAudioStreamer(musicStreamer);
+    if (musicDecoder != NULL) stb_vorbis_close(musicDecoder);     // NOTE: Decoded by the streamer, closed after it
     UnloadSound(fxCoin);
+    UnloadAssetBundle(bundle);      // NOTE: Music streams from the bundle, unloaded after it
 
     CloseAudioDevice();     // Close audio context
 
@@ -116,6 +149,93 @@ int main(void)
 //----------------------------------------------------------------------------------
 // Module specific Functions Definition
 //----------------------------------------------------------------------------------
+// Load global data, zero-copy from the assets bundle (make bundle) or decoding the resource files
+// NOTE: Bundle images and waves are already in their final format, music is decoded as it plays
+static void LoadGlobalAssets(void)
+{
+    double loadStart = GetTime();
+
+    bundle = LoadAssetBundle("resources/assets.bundle");
+
+    const BundleAsset *fontAsset = GetBundleAsset(bundle, "resources/mecha.png");
+    const BundleAsset *musicAsset = GetBundleAsset(bundle, "resources/ambient.ogg");
+    const BundleAsset *coinAsset = GetBundleAsset(bundle, "resources/coin.wav");
+
+    if ((fontAsset != NULL) && (fontAsset->type == BUNDLE_ASSET_IMAGE))
+    {
+        Image image = {
+            .data = (void *)GetBundleAssetData(bundle, fontAsset),
+            .width = fontAsset->width,
+            .height = fontAsset->height,
+            .mipmaps = 1,
+            .format = fontAsset->format
+        };
+
+        font = LoadFontFromImage(image, MAGENTA, 32);   // Same keys as LoadFont() for image fonts
+    }
+    else font = LoadFont("resources/mecha.png");
+
+    // Music stays compressed in the bundle, it is decoded by the streaming thread from the mapping or the resource file
+    if ((musicAsset != NULL) && (musicAsset->type == BUNDLE_ASSET_RAW))
+    {
+        musicDecoder = stb_vorbis_open_memory((const unsigned char *)GetBundleAssetData(bundle, musicAsset), (int)musicAsset->size, NULL, NULL);
+    }
+    else musicDecoder = stb_vorbis_open_filename("resources/ambient.ogg", NULL, NULL);
+
+    if (musicDecoder != NULL)
+    {
+        stb_vorbis_info info = stb_vorbis_get_info(musicDecoder);
+
+        musicStreamer = LoadAudioStreamerFromDecoder(DecodeMusic, RewindMusic, musicDecoder, info.channels, (int)info.sample_rate, true);
+        musicStream = LoadAudioStream(info.sample_rate, 16, (unsigned int)info.channels);
+    }
+    else
+    {
+        TraceLog(LOG_WARNING, "AUDIO: Music could not be opened, playing silence");
+
+        musicStreamer = LoadAudioStreamer(NULL, 0, 2, 44100, false);
+        musicStream = LoadAudioStream(44100, 16, 2);
+    }
+
+    SetAudioStreamCallback(musicStream, MusicStreamCallback);
+
+    if ((coinAsset != NULL) && (coinAsset->type == BUNDLE_ASSET_WAVE))
+    {
+        Wave wave = {
+            .frameCount = coinAsset->frameCount,
+            .sampleRate = (unsigned int)coinAsset->sampleRate,
+            .sampleSize = (unsigned int)coinAsset->sampleSize,
+            .channels = (unsigned int)coinAsset->channels,
+            .data = (void *)GetBundleAssetData(bundle, coinAsset)
+        };
+
+        fxCoin = LoadSoundFromWave(wave);
+    }
+    else fxCoin = LoadSound("resources/coin.wav");
+
+    assetsLoadTime = GetTime() - loadStart;
+}
+
+// Audio device callback, takes the frames the streaming thread left in the ring, never waits
+static void MusicStreamCallback(void *bufferData, unsigned int frames)
+{
+    ReadAudioStreamer(musicStreamer, (short *)bufferData, frames);
+}
+
+// Streaming thread decoder, frames pulled straight into the ring
+static unsigned int DecodeMusic(void *userData, short *samples, unsigned int frames)
+{
+    stb_vorbis *decoder = (stb_vorbis *)userData;
+    int channels = stb_vorbis_get_info(decoder).channels;
+
+    return (unsigned int)stb_vorbis_get_samples_short_interleaved(decoder, channels, samples, (int)frames*channels);
+}
+
+static void RewindMusic(void *userData)
+{
+    stb_vorbis_seek_start((stb_vorbis *)userData);
+}
+
 // Change to next screen, no transition
 static void ChangeToScreen(int screen)
 {
@@ -150,11 +270,19 @@ static void TransitionToScreen(int screen)
     transFromScreen = currentScreen;
     transToScreen = screen;
     transAlpha = 0.0f;
+    transMaxFrameTime = 0.0f;
+    transFrameTime = 0.0f;
+    transFramesCount = 0;
+    transHeldFrames = 0;
 }
 
 // Update transition effect (fade-in, fade-out)
 static void UpdateTransition(void)
 {
+    if (GetFrameTime() > transMaxFrameTime) transMaxFrameTime = GetFrameTime();
+    transFrameTime += GetFrameTime();
+    transFramesCount++;
+
     if (!transFadeOut)
     {
         transAlpha += 0.05f;
@@ -165,6 +293,18 @@ static void UpdateTransition(void)
         {
             transAlpha = 1.0f;
 
+            // Hold the faded out screen until the gameplay data is ready, so its init never blocks a frame
+            // NOTE: Preparation is only submitted here when no screen before did it
+            if (transToScreen == GAMEPLAY)
+            {
+                PrepareGameplayScreen();
+                if (!IsGameplayScreenReady())
+                {
+                    transHeldFrames++;
+                    return;
+                }
+            }
+
             // Unload current screen
             switch (transFromScreen)
             {
@@ -203,6 +343,9 @@ static void UpdateTransition(void)
             onTransition = false;
             transFromScreen = -1;
             transToScreen = -1;
+
+            TraceLog(LOG_INFO, "TRANSITION: %i frames, average %.2f ms, longest %.2f ms (budget %.2f ms), %i held for loading",
+                transFramesCount, transFrameTime*1000.0f/transFramesCount, transMaxFrameTime*1000.0f, 1000.0f/60.0f, transHeldFrames);
         }
     }
 }
@@ -218,7 +361,16 @@ static void UpdateDrawFrame(void)
 {
     // Update
     //----------------------------------------------------------------------------------
-    UpdateMusicStream(music);       // NOTE: Music keeps playing between screens
+    UpdateAudioStreamer(musicStreamer);     // NOTE: Music streams from its own thread, this only fills it without threads
+
+    // Report the frames of music that reached the device late, the ring should never run dry
+    AudioStreamerStats musicStats = GetAudioStreamerStats(musicStreamer);
+    if (musicStats.underrunsCount != musicUnderruns)
+    {
+        TraceLog(LOG_WARNING, "AUDIO: Music underruns: %u (%u frames silent), ring at %u/%u frames",
+            musicStats.underrunsCount, musicStats.underrunFrames, musicStats.fillFrames, musicStats.capacityFrames);
+        musicUnderruns = musicStats.underrunsCount;
+    }
 
     if (!onTransition)
     {
@@ -290,4 +442,13 @@ static void UpdateDrawFrame(void)
 
     EndDrawing();
     //----------------------------------------------------------------------------------
+
+    // Time to first frame, since InitWindow(), to compare startup with and without the assets bundle
+    // NOTE: Both startups must be run and compared, the bundle gain depends on the resources
+    if (!firstFrameDrawn)
+    {
+        TraceLog(LOG_INFO, "STARTUP: First frame at %.2f ms, assets loaded in %.2f ms (%s)",
+            GetTime()*1000.0, assetsLoadTime*1000.0, (bundle != NULL)? "bundle" : "resource files");
+        firstFrameDrawn = true;
+    }
 }
@@ -0,0 +1,1193 @@
+/**********************************************************************************************
+*
+*   raycaster - Renderer module
+*
+*   Every screen column is independent: its ray is cast and its walls projected by the same
+*   job, so columns of any context can be processed in any order on any thread.
+*
+*   Walls are composited front to back with the "under" operator. Spans of farther walls are
+*   nested inside the spans of nearer ones, so a column is a stack of constant color runs: the
+*   color of every run is resolved once and filled, and the column ends as soon as the walls in
+*   front hide whatever is behind them.
+*
+*   The face walk method walks the tiles around the camera by increasing grid (Manhattan) distance,
+*   the order any ray goes through them, so every face seen is added behind the walls the columns
+*   already have. Each portal seen opens a new walk from the translated camera, skipping the tiles
+*   before the exit face, for the columns that go through it. The walk is a wall candidates cache:
+*   columns are still resolved along their faces and projected one by one.
+*
+**********************************************************************************************/
+
+#include "renderer.h"
+#include "pixels.h"
+#include "jobs.h"
+
+#include <stdlib.h>
+#include <float.h>
+#include <limits.h>
+#include <assert.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define RENDER_COLUMNS_BATCH_SIZE 32        // Screen columns per job batch
+#define GEOMETRY_COLUMNS_GROUP 64           // Screen columns written row by row by the geometry outputs
+#define DEFAULT_CAST_INTERVAL 1
+
+#define CEILING_COLOR 0xFF333333
+#define FLOOR_COLOR 0xFF777777
+#define WALL_COLOR_VERTICAL 0xC8FFFFFF
+#define WALL_COLOR_HORIZONTAL 0xC8CCCCCC
+
+#define WALL_SHADE_HORIZONTAL 12            // WALL_COLOR_HORIZONTAL is WALL_COLOR_VERTICAL at 12/15 brightness
+
+// Walls in front hide the rest once less than half a color step shows through them
+#define OCCLUDED_TRANSMITTANCE (0.5f/255.0f)
+
+#define WALK_NEAR_DEPTH 0.001               // Faces are clipped this far in front of the camera
+#define WALK_EDGE_MARGIN 0.0625             // Columns passing closer than this to a face endpoint (world units),
+#define WALK_COLUMN_MARGIN 0.01             // or than this fraction of a column, are cast
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct RenderViewsJob
+{
+    RenderContext **contexts;
+    int count;
+}
+RenderViewsJob;
+
+typedef struct RenderBatchJob
+{
+    RenderBatch *batch;
+    const RenderCamera *poses;
+    unsigned char *frames;
+}
+RenderBatchJob;
+
+// Face walk state of a column
+typedef struct WalkColumn
+{
+    int pass;                   // Walk the column is open in, -1 once its walls are known
+    int translucentWalls;       // Translucent walls passed
+    int portalTransits;
+    bool isCast;                // Walls not found by the walks, the column ray is cast
+}
+WalkColumn;
+
+// Walk of the tiles around the camera, or around the camera translated through a portal
+typedef struct FaceWalk
+{
+    double x;                   // Camera position
+    double y;
+    int portalX;                // Portal tile and ray direction the walk comes through
+    int portalY;
+    int stepX;
+    int stepY;
+    int clipIndex;              // First tile after the portal exit face along the ray direction
+    int firstChild;             // Walks opened by this one start here
+    int startCol;               // Columns range of the walk, inclusive
+    int endCol;
+    int columnsCount;           // Columns still open in the walk
+}
+FaceWalk;
+
+struct RenderWalks
+{
+    WalkColumn *columns;        // Context width entries
+    int *nextColumns;           // Occlusion buffer, next column open in the current walk (width + 1 entries)
+    FaceWalk *passes;           // Walks of the frame, at most one per column and the camera one
+    int passesCount;
+    double cosAngle;            // Camera direction
+    double sinAngle;
+    int flags;                  // RayQuery flags of the columns
+    int occludingWalls;
+};
+
+// Premultiplied color of the walls in front of a run, accumulated front to back
+typedef struct RenderLayers
+{
+    float red;                  // Premultiplied channels, [0, 255]
+    float green;
+    float blue;
+    float transmittance;        // Fraction of the color behind that shows through, [0, 1]
+    bool isOpaque;              // Nearest layer is a wall, the result is made opaque
+}
+RenderLayers;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+
+// Translucent walls needed to hide anything behind them, rays don't go farther
+static int GetOccludingWallsCount(void)
+{
+    float wallAlpha = ((WALL_COLOR_VERTICAL >> 24) < (WALL_COLOR_HORIZONTAL >> 24))? (WALL_COLOR_VERTICAL >> 24)/255.0f : (WALL_COLOR_HORIZONTAL >> 24)/255.0f;
+    float transmittance = 1.0f;
+    int count = 0;
+
+    while ((transmittance >= OCCLUDED_TRANSMITTANCE) && (count < MAX_RENDER_WALLS_PER_COLUMN))
+    {
+        transmittance *= 1.0f - wallAlpha;
+        count++;
+    }
+
+    return count;
+}
+
+// Add a layer behind the accumulated ones ("under" operator)
+static void AddLayerUnder(RenderLayers *layers, uint32_t color)
+{
+    float alpha = (color >> 24)/255.0f;
+    float weight = layers->transmittance*alpha;
+
+    layers->red += weight*((color >> 16) & 0xFF);
+    layers->green += weight*((color >> 8) & 0xFF);
+    layers->blue += weight*(color & 0xFF);
+    layers->transmittance *= 1.0f - alpha;
+}
+
+// Resolve the color of the accumulated layers over a backdrop
+static uint32_t GetLayersColor(const RenderLayers *layers, uint32_t backdrop)
+{
+    RenderLayers result = *layers;
+    AddLayerUnder(&result, backdrop);
+
+    float coverage = 1.0f - result.transmittance;
+
+    // Pixels keep straight alpha, translucent results are unpremultiplied
+    if (!result.isOpaque && (coverage < 1.0f))
+    {
+        float scale = (coverage > 0.0f)? 1.0f/coverage : 0.0f;
+        result.red *= scale;
+        result.green *= scale;
+        result.blue *= scale;
+    }
+
+    uint32_t alpha = result.isOpaque? 255 : (uint32_t)(coverage*255.0f + 0.5f);
+
+    return (alpha << 24) | ((uint32_t)(result.red + 0.5f) << 16) | ((uint32_t)(result.green + 0.5f) << 8) | (uint32_t)(result.blue + 0.5f);
+}
+
+// Get the ray query of a column of a context
+static RayQuery GetColumnQuery(const RenderContext *context, int col, int occludingWalls)
+{
+    float rayAngle = context->camera.angle + atan((col - context->width / 2) / context->projectionPlaneDistance);
+
+    // Geometry outputs only need the nearest wall that is not a portal
+    RayQuery query = {
+        .originX = context->camera.x,
+        .originY = context->camera.y,
+        .angle = NormalizeAngle(rayAngle),
+        .maxDistance = FLT_MAX,
+        .flags = (context->outputs & (RENDER_OUTPUT_COLOR | RENDER_OUTPUT_INDEXED))? (RAY_PASS_TRANSLUCENT | RAY_PASS_PORTALS) : RAY_PASS_PORTALS,
+        .maxTranslucentWalls = occludingWalls
+    };
+
+    return query;
+}
+
+static void CastColumn(RenderContext *context, int col, int occludingWalls)
+{
+    RenderColumn *column = &context->columns[col];
+    RayQuery query = GetColumnQuery(context, col, occludingWalls);
+
+    column->rayAngle = query.angle;
+    column->wallsCount = CastRayQuery(context->map, &query, column->walls, MAX_RENDER_WALLS_PER_COLUMN);
+    column->wasCast = true;
+}
+
+// Check if two columns go through the same wall faces
+static bool AreColumnsCoherent(const RenderColumn *columnA, const RenderColumn *columnB)
+{
+    if ((columnA->wallsCount == 0) || (columnA->wallsCount != columnB->wallsCount)) return false;
+
+    for (int w = 0; w < columnA->wallsCount; w++)
+    {
+        const WallHit *wallA = &columnA->walls[w];
+        const WallHit *wallB = &columnB->walls[w];
+
+        if ((wallA->wallGridIndexX != wallB->wallGridIndexX) || (wallA->wallGridIndexY != wallB->wallGridIndexY) ||
+            (wallA->wasHitVertical != wallB->wasHitVertical)) return false;
+    }
+
+    return true;
+}
+
+// Fill the columns between two cast columns a and b, subdividing the gap until the columns at
+// both ends go through the same wall faces, then the columns between go through them too
+static void SubdivideColumns(RenderContext *context, int a, int b, int occludingWalls)
+{
+    if (b - a < 2) return;
+
+    if (AreColumnsCoherent(&context->columns[a], &context->columns[b]))
+    {
+        const RenderColumn *columnA = &context->columns[a];
+
+        for (int col = a + 1; col < b; col++)
+        {
+            RenderColumn *column = &context->columns[col];
+            RayQuery query = GetColumnQuery(context, col, occludingWalls);
+
+            column->rayAngle = query.angle;
+            column->wallsCount = CastRayQueryAlongWalls(context->map, &query, columnA->walls, columnA->wallsCount, column->walls);
+            column->wasCast = false;
+
+            if (column->wallsCount < 0) CastColumn(context, col, occludingWalls);
+        }
+
+        return;
+    }
+
+    int middle = (a + b)/2;
+
+    CastColumn(context, middle, occludingWalls);
+    SubdivideColumns(context, a, middle, occludingWalls);
+    SubdivideColumns(context, middle, b, occludingWalls);
+}
+
+// Get the first column open in the current walk from a column on
+static int FindWalkColumn(RenderWalks *walks, int col)
+{
+    int *nextColumns = walks->nextColumns;
+
+    while (nextColumns[col] != col)
+    {
+        nextColumns[col] = nextColumns[nextColumns[col]];
+        col = nextColumns[col];
+    }
+
+    return col;
+}
+
+// Remove a column from the current walk, its walls are known or it goes on through a portal
+static void CloseWalkColumn(RenderWalks *walks, int pass, int col)
+{
+    walks->nextColumns[col] = col + 1;
+    walks->passes[pass].columnsCount--;
+}
+
+// Get the walk opened by a walk through a portal face, NULL when there is no room for it
+static FaceWalk *GetFaceWalkChild(RenderWalks *walks, int pass, const MapEdge *edge, int width, float offsetX, float offsetY)
+{
+    int stepX = -edge->normalX;
+    int stepY = -edge->normalY;
+
+    for (int i = walks->passes[pass].firstChild; i < walks->passesCount; i++)
+    {
+        FaceWalk *child = &walks->passes[i];
+        if ((child->portalX == edge->gridIndexX) && (child->portalY == edge->gridIndexY) && (child->stepX == stepX) && (child->stepY == stepY)) return child;
+    }
+
+    if (walks->passesCount > width) return NULL;
+
+    FaceWalk *child = &walks->passes[walks->passesCount++];
+
+    // Rays come out of the far side of the linked portal tile
+    *child = (FaceWalk){
+        .x = walks->passes[pass].x + offsetX,
+        .y = walks->passes[pass].y + offsetY,
+        .portalX = edge->gridIndexX,
+        .portalY = edge->gridIndexY,
+        .stepX = stepX,
+        .stepY = stepY,
+        .clipIndex = (stepX != 0)? edge->gridIndexX + (int)lroundf(offsetX/TILE_SIZE) : edge->gridIndexY + (int)lroundf(offsetY/TILE_SIZE),
+        .startCol = width,
+        .endCol = -1
+    };
+
+    return child;
+}
+
+// Add a face to the walls of a column, the same way CastRayQuery() reports it
+static void AddWalkWall(RenderContext *context, int pass, int col, const MapEdge *edge)
+{
+    RenderWalks *walks = context->walks;
+    RenderColumn *column = &context->columns[col];
+    WalkColumn *state = &walks->columns[col];
+    const Map *map = context->map;
+
+    // Rays leaving the map are left to the ray caster
+    if ((edge->gridIndexX < 0) || (edge->gridIndexX >= map->numCols) || (edge->gridIndexY < 0) || (edge->gridIndexY >= map->numRows))
+    {
+        CloseWalkColumn(walks, pass, col);
+        state->pass = -1;
+        state->isCast = true;
+        return;
+    }
+
+    column->walls[column->wallsCount++] = (WallHit){
+        .wallGridIndexX = edge->gridIndexX,
+        .wallGridIndexY = edge->gridIndexY,
+        .wasHitVertical = (edge->normalX != 0),
+        .wallHitContent = edge->content
+    };
+
+    bool isFull = (column->wallsCount == MAX_RENDER_WALLS_PER_COLUMN);
+
+    if ((edge->content == TILE_TRANSLUCENT) && !isFull && (walks->flags & RAY_PASS_TRANSLUCENT) &&
+        ((walks->occludingWalls == 0) || (state->translucentWalls < walks->occludingWalls)))
+    {
+        state->translucentWalls++;
+        return;
+    }
+
+    CloseWalkColumn(walks, pass, col);
+    state->pass = -1;
+
+    if ((edge->content == TILE_PORTAL) && !isFull && (walks->flags & RAY_PASS_PORTALS) && (state->portalTransits < MAX_RAY_PORTAL_TRANSITS))
+    {
+        float offsetX = 0.0f;
+        float offsetY = 0.0f;
+
+        if (GetMapPortalTransit(map, edge->gridIndexX, edge->gridIndexY, -edge->normalX, -edge->normalY, &offsetX, &offsetY))
+        {
+            FaceWalk *child = GetFaceWalkChild(walks, pass, edge, context->width, offsetX, offsetY);
+
+            if (child == NULL) state->isCast = true;
+            else
+            {
+                state->pass = (int)(child - walks->passes);
+                state->portalTransits++;
+                if (col < child->startCol) child->startCol = col;
+                if (col > child->endCol) child->endCol = col;
+                child->columnsCount++;
+            }
+        }
+    }
+}
+
+// Add a face to the open columns of a walk it covers
+// NOTE: Faces are clipped to the near plane, columns passing next to an endpoint can go through the
+// face or the next one, their rays are cast
+static void AddWalkFace(RenderContext *context, int pass, const MapEdge *edge)
+{
+    RenderWalks *walks = context->walks;
+    const FaceWalk *walk = &walks->passes[pass];
+
+    // Faces are only seen from the side they look at
+    double side = (edge->normalX != 0)? (walk->x - edge->x0)*edge->normalX : (walk->y - edge->y0)*edge->normalY;
+    if (side <= 0.0) return;
+
+    double depth0 = (edge->x0 - walk->x)*walks->cosAngle + (edge->y0 - walk->y)*walks->sinAngle;
+    double depth1 = (edge->x1 - walk->x)*walks->cosAngle + (edge->y1 - walk->y)*walks->sinAngle;
+    double lateral0 = (edge->y0 - walk->y)*walks->cosAngle - (edge->x0 - walk->x)*walks->sinAngle;
+    double lateral1 = (edge->y1 - walk->y)*walks->cosAngle - (edge->x1 - walk->x)*walks->sinAngle;
+
+    if ((depth0 < WALK_NEAR_DEPTH) && (depth1 < WALK_NEAR_DEPTH)) return;
+
+    double ppd = context->projectionPlaneDistance;
+    double margin0 = fmax(WALK_COLUMN_MARGIN, WALK_EDGE_MARGIN*ppd/depth0);
+    double margin1 = fmax(WALK_COLUMN_MARGIN, WALK_EDGE_MARGIN*ppd/depth1);
+
+    if (depth0 < WALK_NEAR_DEPTH)
+    {
+        lateral0 += (lateral1 - lateral0)*(WALK_NEAR_DEPTH - depth0)/(depth1 - depth0);
+        depth0 = WALK_NEAR_DEPTH;
+        margin0 = 0.0;
+    }
+    else if (depth1 < WALK_NEAR_DEPTH)
+    {
+        lateral1 += (lateral0 - lateral1)*(WALK_NEAR_DEPTH - depth1)/(depth0 - depth1);
+        depth1 = WALK_NEAR_DEPTH;
+        margin1 = 0.0;
+    }
+
+    // Column of the ray through each endpoint, the inverse of the column ray angle
+    double column0 = context->width/2 + ppd*lateral0/depth0;
+    double column1 = context->width/2 + ppd*lateral1/depth1;
+
+    if (column0 > column1)
+    {
+        double column = column0;
+        column0 = column1;
+        column1 = column;
+
+        double margin = margin0;
+        margin0 = margin1;
+        margin1 = margin;
+    }
+
+    double first = ceil(column0 - margin0);
+    double last = floor(column1 + margin1);
+    if (first < walk->startCol) first = walk->startCol;
+    if (last > walk->endCol) last = walk->endCol;
+    if (first > last) return;
+
+    for (int col = FindWalkColumn(walks, (int)first); col <= (int)last; col = FindWalkColumn(walks, col + 1))
+    {
+        if ((fabs(col - column0) <= margin0) || (fabs(col - column1) <= margin1))
+        {
+            CloseWalkColumn(walks, pass, col);
+            walks->columns[col].pass = -1;
+            walks->columns[col].isCast = true;
+        }
+        else AddWalkWall(context, pass, col, edge);
+    }
+}
+
+// Walk the tiles around the camera of a walk, from the nearest to the farthest, until every column
+// of the walk found a wall it can't go through
+static void WalkFaceWalk(RenderContext *context, int pass)
+{
+    RenderWalks *walks = context->walks;
+    FaceWalk *walk = &walks->passes[pass];
+    const MapEdges *edges = context->edges;
+
+    walk->firstChild = walks->passesCount;
+
+    for (int col = walk->startCol; col <= walk->endCol; col++) walks->nextColumns[col] = (walks->columns[col].pass == pass)? col : col + 1;
+    walks->nextColumns[walk->endCol + 1] = walk->endCol + 1;
+
+    int cameraX = (int)floor(walk->x/TILE_SIZE);
+    int cameraY = (int)floor(walk->y/TILE_SIZE);
+
+    // Rings of tiles from -1 to numCols/numRows
+    int minRing = ((cameraX < -1)? -1 - cameraX : ((cameraX > edges->numCols)? cameraX - edges->numCols : 0)) +
+        ((cameraY < -1)? -1 - cameraY : ((cameraY > edges->numRows)? cameraY - edges->numRows : 0));
+    int maxRing = ((cameraX + 1 > edges->numCols - cameraX)? cameraX + 1 : edges->numCols - cameraX) +
+        ((cameraY + 1 > edges->numRows - cameraY)? cameraY + 1 : edges->numRows - cameraY);
+
+    for (int ring = (minRing > 1)? minRing : 1; (ring <= maxRing) && (walk->columnsCount > 0); ring++)
+    {
+        for (int i = 0; i < ring; i++)
+        {
+            int ringX[4] = { cameraX + ring - i, cameraX - i, cameraX - ring + i, cameraX + i };
+            int ringY[4] = { cameraY + i, cameraY + ring - i, cameraY - i, cameraY - ring + i };
+
+            for (int quadrant = 0; quadrant < 4; quadrant++)
+            {
+                int gridIndexX = ringX[quadrant];
+                int gridIndexY = ringY[quadrant];
+
+                // Tiles before the portal exit face are not on the rays
+                if ((walk->stepX != 0) && ((gridIndexX - walk->clipIndex)*walk->stepX < 0)) continue;
+                if ((walk->stepY != 0) && ((gridIndexY - walk->clipIndex)*walk->stepY < 0)) continue;
+
+                const MapEdge *tileEdges = NULL;
+                int tileEdgesCount = GetMapTileEdges(edges, gridIndexX, gridIndexY, &tileEdges);
+
+                for (int e = 0; e < tileEdgesCount; e++) AddWalkFace(context, pass, &tileEdges[e]);
+            }
+        }
+    }
+
+    for (int col = walk->startCol; col <= walk->endCol; col++)
+    {
+        if (walks->columns[col].pass == pass)
+        {
+            walks->columns[col].pass = -1;
+            walks->columns[col].isCast = true;
+        }
+    }
+}
+
+// Check if a context finds its walls with the face walk method
+static bool IsFaceWalkContext(const RenderContext *context)
+{
+    return (context->method == RENDER_METHOD_FACES) && (context->edges != NULL) && (context->walks != NULL);
+}
+
+// Find the walls of all the columns of a context walking the map faces, before they are projected
+// NOTE: Cameras on a grid line or inside a wall start the rays differently, all their columns are cast
+static void FindFaceWalkWalls(RenderContext *context)
+{
+    RenderWalks *walks = context->walks;
+    const Map *map = context->map;
+    RenderCamera camera = context->camera;
+    RayQuery query = GetColumnQuery(context, 0, GetOccludingWallsCount());
+    bool isCameraCast = (GetMapWallTypeAt(map, camera.x, camera.y) != TILE_EMPTY) ||
+        (camera.x == floorf(camera.x/TILE_SIZE)*TILE_SIZE) || (camera.y == floorf(camera.y/TILE_SIZE)*TILE_SIZE);
+
+    walks->cosAngle = cos(camera.angle);
+    walks->sinAngle = sin(camera.angle);
+    walks->flags = query.flags;
+    walks->occludingWalls = query.maxTranslucentWalls;
+    walks->passes[0] = (FaceWalk){ .x = camera.x, .y = camera.y, .startCol = 0, .endCol = context->width - 1, .columnsCount = context->width };
+    walks->passesCount = 1;
+
+    for (int col = 0; col < context->width; col++)
+    {
+        context->columns[col].wallsCount = 0;
+        walks->columns[col] = (WalkColumn){ isCameraCast? -1 : 0, 0, 0, isCameraCast };
+    }
+
+    if (isCameraCast) return;
+
+    for (int pass = 0; pass < walks->passesCount; pass++) WalkFaceWalk(context, pass);
+}
+
+// Resolve the walls found by the face walk method for the columns [start, end) of a context
+static void CastWalkColumns(RenderContext *context, int start, int end)
+{
+    int occludingWalls = GetOccludingWallsCount();
+
+    for (int col = start; col < end; col++)
+    {
+        RenderColumn *column = &context->columns[col];
+        int wallsCount = column->wallsCount;
+
+        if (context->walks->columns[col].isCast || (wallsCount == 0))
+        {
+            CastColumn(context, col, occludingWalls);
+            continue;
+        }
+
+        WallHit walls[MAX_RENDER_WALLS_PER_COLUMN];
+        for (int w = 0; w < wallsCount; w++) walls[w] = column->walls[w];
+
+        RayQuery query = GetColumnQuery(context, col, occludingWalls);
+
+        column->rayAngle = query.angle;
+        column->wallsCount = CastRayQueryAlongWalls(context->map, &query, walls, wallsCount, column->walls);
+        column->wasCast = false;
+
+        if (column->wallsCount < 0) CastColumn(context, col, occludingWalls);
+    }
+}
+
+// Cast the rays of the columns [start, end) of a context, every castInterval columns and where
+// the walls found change between them
+static void CastColumns(RenderContext *context, int start, int end)
+{
+    if (IsFaceWalkContext(context))
+    {
+        CastWalkColumns(context, start, end);
+        return;
+    }
+
+    int occludingWalls = GetOccludingWallsCount();
+    int interval = (context->castInterval > 1)? context->castInterval : 1;
+
+    CastColumn(context, start, occludingWalls);
+
+    for (int col = start; col < end - 1; col += interval)
+    {
+        int next = (col + interval < end - 1)? col + interval : end - 1;
+
+        CastColumn(context, next, occludingWalls);
+        SubdivideColumns(context, col, next, occludingWalls);
+    }
+}
+
+// Get the light level of the face shown by a wall hit
+// NOTE: Rays moving towards +x hit west faces, rays moving towards +y (down) hit north faces
+static unsigned char GetWallLevel(const RenderContext *context, const WallHit *hit)
+{
+    int face = 0;
+    if (hit->wasHitVertical) face = (hit->wallHitX > hit->rayOriginX)? LIGHTMAP_FACE_WEST : LIGHTMAP_FACE_EAST;
+    else face = (hit->wallHitY > hit->rayOriginY)? LIGHTMAP_FACE_NORTH : LIGHTMAP_FACE_SOUTH;
+
+    return GetLightmapLevel(context->lightmap, hit->wallGridIndexX, hit->wallGridIndexY, face);
+}
+
+// Get the color of a wall of a column, shaded by the light level of its face when the context has a lightmap
+static uint32_t GetWallColor(const RenderContext *context, const WallHit *hit)
+{
+    uint32_t color = hit->wasHitVertical? WALL_COLOR_VERTICAL : WALL_COLOR_HORIZONTAL;
+    if (context->lightmap == NULL) return color;
+
+    uint32_t level = GetWallLevel(context, hit);
+    uint32_t red = ((color >> 16) & 0xFF)*level/255;
+    uint32_t green = ((color >> 8) & 0xFF)*level/255;
+    uint32_t blue = (color & 0xFF)*level/255;
+
+    return (color & 0xFF000000) | (red << 16) | (green << 8) | blue;
+}
+
+// Get the palette index of a wall of a column, the light level of its face picks the shade when the context has a lightmap
+static unsigned char GetWallIndex(const RenderContext *context, const WallHit *hit)
+{
+    const RenderPalette *palette = context->palette;
+
+    if (context->lightmap == NULL) return hit->wasHitVertical? palette->wallIndex : palette->shades[WALL_SHADE_HORIZONTAL][palette->wallIndex];
+
+    int shade = (hit->wasHitVertical? RENDER_PALETTE_SHADES - 1 : WALL_SHADE_HORIZONTAL)*GetWallLevel(context, hit)/255;
+
+    return palette->shades[shade][palette->wallIndex];
+}
+
+// Get the rows covered by a wall of a column, returns the wall perpendicular distance
+static float GetWallSpan(const RenderContext *context, const RenderColumn *column, int wall, int *wallTopPixel, int *wallBottomPixel)
+{
+    int height = context->height;
+    float perpDistance = column->walls[wall].distance*cos(column->rayAngle - context->camera.angle);
+    float projectedWallHeight = (TILE_SIZE/perpDistance)*context->projectionPlaneDistance;
+
+    // Walls closer than the projection plane can't overflow the strip height
+    int wallStripHeight = (projectedWallHeight < 2*height)? (int)projectedWallHeight : 2*height;
+
+    *wallTopPixel = (height/2) - (wallStripHeight/2);
+    if (*wallTopPixel < 0) *wallTopPixel = 0;
+
+    *wallBottomPixel = (height/2) + (wallStripHeight/2);
+    if (*wallBottomPixel > height) *wallBottomPixel = height;
+
+    return perpDistance;
+}
+
+// Project the walls colors of the columns [start, end) of a context, from the nearest to the farthest
+// NOTE: Rows between the span of a wall and the span of the wall behind it see the walls in front
+// over the ceiling or floor. The farthest wall has nothing behind, when it is also the nearest
+// one it is drawn opaque
+static void ProjectColumnsColor(RenderContext *context, int start, int end)
+{
+    int width = context->width;
+    int height = context->height;
+
+    for (int col = start; col < end; col++)
+    {
+        const RenderColumn *column = &context->columns[col];
+        uint32_t *pixels = context->pixels + col;
+        RenderLayers layers = { 0.0f, 0.0f, 0.0f, 1.0f, (column->wallsCount > 0) && (column->walls[0].wallHitContent != TILE_PORTAL) };
+        int drawnTopPixel = 0;          // Rows drawn above and below the span of the current wall
+        int drawnBottomPixel = height;
+
+        if (column->wallsCount == 0) FillPixelColumn(pixels, width, height, context->backgroundColor);
+
+        for (int w = 0; w < column->wallsCount; w++)
+        {
+            int wallTopPixel = 0;
+            int wallBottomPixel = 0;
+            GetWallSpan(context, column, w, &wallTopPixel, &wallBottomPixel);
+
+            FillPixelColumn(pixels + width*drawnTopPixel, width, wallTopPixel - drawnTopPixel, GetLayersColor(&layers, CEILING_COLOR));
+            FillPixelColumn(pixels + width*wallBottomPixel, width, drawnBottomPixel - wallBottomPixel, GetLayersColor(&layers, FLOOR_COLOR));
+
+            drawnTopPixel = wallTopPixel;
+            drawnBottomPixel = wallBottomPixel;
+
+            uint32_t *wallPixels = pixels + width*wallTopPixel;
+            int wallPixelsCount = wallBottomPixel - wallTopPixel;
+            bool isFarthestWall = (w == column->wallsCount - 1);
+
+            if (column->walls[w].wallHitContent == TILE_PORTAL)
+            {
+                if (isFarthestWall) FillPixelColumn(wallPixels, width, wallPixelsCount, GetLayersColor(&layers, context->backgroundColor));
+                continue;
+            }
+
+            uint32_t wallPixelColor = GetWallColor(context, &column->walls[w]);
+
+            if (isFarthestWall && (w == 0)) FillPixelColumn(wallPixels, width, wallPixelsCount, wallPixelColor | 0xFF000000);
+            else
+            {
+                AddLayerUnder(&layers, wallPixelColor);
+
+                // Nothing behind the farthest wall, or nothing visible through the walls in front
+                if (isFarthestWall || (layers.transmittance < OCCLUDED_TRANSMITTANCE))
+                {
+                    FillPixelColumn(wallPixels, width, wallPixelsCount, GetLayersColor(&layers, 0x00000000));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Get the palette index of layers of translucent walls over a backdrop, from the farthest to the nearest
+static unsigned char GetLayersIndex(const RenderPalette *palette, const unsigned char *layers, int count, unsigned char backdrop)
+{
+    unsigned char index = backdrop;
+
+    for (int i = count - 1; i >= 0; i--) index = palette->translucency[layers[i]][index];
+
+    return index;
+}
+
+// Project the walls palette indices of the columns [start, end) of a context, from the nearest to the farthest
+// NOTE: Same runs as the color projection, translucent results are resolved over black
+static void ProjectColumnsIndexed(RenderContext *context, int start, int end)
+{
+    const RenderPalette *palette = context->palette;
+    int width = context->width;
+    int height = context->height;
+    int occludingWalls = GetOccludingWallsCount();
+    unsigned char backgroundIndex = GetRenderPaletteIndex(palette, context->backgroundColor);
+
+    for (int col = start; col < end; col++)
+    {
+        const RenderColumn *column = &context->columns[col];
+        unsigned char *indices = context->indices + col;
+        unsigned char layers[MAX_RENDER_WALLS_PER_COLUMN] = { 0 };
+        int layersCount = 0;
+        int drawnTopPixel = 0;
+        int drawnBottomPixel = height;
+
+        if (column->wallsCount == 0) FillIndexColumn(indices, width, height, backgroundIndex);
+
+        for (int w = 0; w < column->wallsCount; w++)
+        {
+            int wallTopPixel = 0;
+            int wallBottomPixel = 0;
+            GetWallSpan(context, column, w, &wallTopPixel, &wallBottomPixel);
+
+            FillIndexColumn(indices + width*drawnTopPixel, width, wallTopPixel - drawnTopPixel, GetLayersIndex(palette, layers, layersCount, palette->ceilingIndex));
+            FillIndexColumn(indices + width*wallBottomPixel, width, drawnBottomPixel - wallBottomPixel, GetLayersIndex(palette, layers, layersCount, palette->floorIndex));
+
+            drawnTopPixel = wallTopPixel;
+            drawnBottomPixel = wallBottomPixel;
+
+            unsigned char *wallIndices = indices + width*wallTopPixel;
+            int wallPixelsCount = wallBottomPixel - wallTopPixel;
+            bool isFarthestWall = (w == column->wallsCount - 1);
+
+            if (column->walls[w].wallHitContent == TILE_PORTAL)
+            {
+                if (isFarthestWall) FillIndexColumn(wallIndices, width, wallPixelsCount, GetLayersIndex(palette, layers, layersCount, backgroundIndex));
+                continue;
+            }
+
+            unsigned char wallIndex = GetWallIndex(context, &column->walls[w]);
+
+            if (isFarthestWall && (w == 0)) FillIndexColumn(wallIndices, width, wallPixelsCount, wallIndex);
+            else
+            {
+                layers[layersCount++] = wallIndex;
+
+                if (isFarthestWall || (layersCount == occludingWalls))
+                {
+                    FillIndexColumn(wallIndices, width, wallPixelsCount, GetLayersIndex(palette, layers, layersCount, palette->blackIndex));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Write the depth and hit information outputs of the columns [start, end) of a context
+// NOTE: The nearest wall that is not a portal hides everything behind it, rows out of its span
+// show the ceiling or floor, seen through the portals whose span contains the row. Outputs are
+// written row by row in groups of columns, so every row writes a contiguous run of pixels
+static void ProjectColumnsGeometry(RenderContext *context, int start, int end)
+{
+    int width = context->width;
+    int height = context->height;
+    float *depths = (context->outputs & RENDER_OUTPUT_DEPTH)? context->depths : NULL;
+    RenderHitInfo *hitInfos = (context->outputs & RENDER_OUTPUT_HIT_INFO)? context->hitInfos : NULL;
+
+    int wallTopPixels[GEOMETRY_COLUMNS_GROUP] = { 0 };
+    int wallBottomPixels[GEOMETRY_COLUMNS_GROUP] = { 0 };
+    float wallDepths[GEOMETRY_COLUMNS_GROUP] = { 0 };
+    RenderHitInfo wallInfos[GEOMETRY_COLUMNS_GROUP] = { 0 };
+
+    for (int groupStart = start; groupStart < end; groupStart += GEOMETRY_COLUMNS_GROUP)
+    {
+        int count = (end - groupStart < GEOMETRY_COLUMNS_GROUP)? end - groupStart : GEOMETRY_COLUMNS_GROUP;
+        bool hasPortals = false;
+
+        for (int i = 0; i < count; i++)
+        {
+            const RenderColumn *column = &context->columns[groupStart + i];
+            int wall = 0;
+
+            while ((wall < column->wallsCount) && (column->walls[wall].wallHitContent == TILE_PORTAL)) wall++;
+
+            wallTopPixels[i] = height/2;
+            wallBottomPixels[i] = height/2;
+            wallDepths[i] = FLT_MAX;
+            wallInfos[i] = (RenderHitInfo){ -1, TILE_EMPTY, RENDER_FACE_NONE, (unsigned char)wall, 0 };
+            hasPortals = hasPortals || (wall > 0);
+
+            if (wall < column->wallsCount)
+            {
+                const WallHit *hit = &column->walls[wall];
+
+                wallDepths[i] = GetWallSpan(context, column, wall, &wallTopPixels[i], &wallBottomPixels[i]);
+                wallInfos[i].wallId = hit->wallGridIndexY*context->map->numCols + hit->wallGridIndexX;
+                wallInfos[i].wallType = (unsigned char)hit->wallHitContent;
+
+                // Rays moving towards +x hit west faces, rays moving towards +y (down) hit north faces
+                if (hit->wasHitVertical) wallInfos[i].face = (cosf(column->rayAngle) > 0.0f)? RENDER_FACE_WEST : RENDER_FACE_EAST;
+                else wallInfos[i].face = (sinf(column->rayAngle) > 0.0f)? RENDER_FACE_NORTH : RENDER_FACE_SOUTH;
+            }
+        }
+
+        for (int y = 0; y < height; y++)
+        {
+            float rowDepth = context->rowDepths[y];
+            RenderHitInfo rowInfo = { -1, TILE_EMPTY, (y < height/2)? RENDER_FACE_CEILING : RENDER_FACE_FLOOR, 0, 0 };
+
+            if (depths != NULL)
+            {
+                float *row = depths + y*width + groupStart;
+                for (int i = 0; i < count; i++) row[i] = ((y >= wallTopPixels[i]) && (y < wallBottomPixels[i]))? wallDepths[i] : rowDepth;
+            }
+
+            if (hitInfos != NULL)
+            {
+                RenderHitInfo *row = hitInfos + y*width + groupStart;
+                for (int i = 0; i < count; i++) row[i] = ((y >= wallTopPixels[i]) && (y < wallBottomPixels[i]))? wallInfos[i] : rowInfo;
+            }
+        }
+
+        if ((hitInfos == NULL) || !hasPortals) continue;
+
+        // Ceiling and floor rows inside the span of a portal are seen through it
+        for (int i = 0; i < count; i++)
+        {
+            const RenderColumn *column = &context->columns[groupStart + i];
+
+            for (int p = 0; p < wallInfos[i].portalsCount; p++)
+            {
+                int portalTopPixel = 0;
+                int portalBottomPixel = 0;
+                GetWallSpan(context, column, p, &portalTopPixel, &portalBottomPixel);
+
+                for (int y = portalTopPixel; y < portalBottomPixel; y++)
+                {
+                    if ((y < wallTopPixels[i]) || (y >= wallBottomPixels[i])) hitInfos[y*width + groupStart + i].portalsCount++;
+                }
+            }
+        }
+    }
+}
+
+// Project the walls of the columns [start, end) of a context into its outputs
+static void ProjectColumns(RenderContext *context, int start, int end)
+{
+    if (context->outputs & RENDER_OUTPUT_COLOR) ProjectColumnsColor(context, start, end);
+    if ((context->outputs & RENDER_OUTPUT_INDEXED) && (context->palette != NULL)) ProjectColumnsIndexed(context, start, end);
+    if (context->outputs & (RENDER_OUTPUT_DEPTH | RENDER_OUTPUT_HIT_INFO)) ProjectColumnsGeometry(context, start, end);
+}
+
+// Cast and project the columns [start, end) of a context into its outputs
+static void RenderColumns(RenderContext *context, int start, int end)
+{
+    CastColumns(context, start, end);
+    ProjectColumns(context, start, end);
+}
+
+// Job function, renders the frames of the poses [start, end) of a batch
+static void RenderBatchPoses(void *userData, int start, int end)
+{
+    RenderBatchJob *job = (RenderBatchJob *)userData;
+    RenderBatch *batch = job->batch;
+    int slot = GetJobWorkerIndex();
+    RenderContext *context = batch->contexts[(slot < batch->contextsCount)? slot : 0];
+    int pixelsCount = batch->width*batch->height;
+    int frameSize = GetRenderBatchFrameSize(batch);
+
+    for (int i = start; i < end; i++)
+    {
+        unsigned char *frame = job->frames + (size_t)i*frameSize;
+
+        context->camera = job->poses[i];
+        if (IsFaceWalkContext(context)) FindFaceWalkWalls(context);
+
+        switch (batch->format)
+        {
+            case RENDER_FORMAT_RGBA:
+            {
+                // Project straight into the frame
+                uint32_t *pixels = context->pixels;
+                context->pixels = (uint32_t *)frame;
+                RenderColumns(context, 0, batch->width);
+                context->pixels = pixels;
+            } break;
+            case RENDER_FORMAT_GRAY:
+            {
+                RenderColumns(context, 0, batch->width);
+
+                for (int p = 0; p < pixelsCount; p++)
+                {
+                    uint32_t color = context->pixels[p];
+                    frame[p] = (unsigned char)((29*(color & 0xff) + 150*((color >> 8) & 0xff) + 77*((color >> 16) & 0xff)) >> 8);
+                }
+            } break;
+            case RENDER_FORMAT_DEPTH:
+            {
+                RenderColumns(context, 0, batch->width);
+
+                for (int p = 0; p < pixelsCount; p++)
+                {
+                    float depth = context->depths[p];
+                    frame[p] = (depth < batch->maxDepth)? (unsigned char)(depth*255/batch->maxDepth) : 255;
+                }
+            } break;
+            default: break;
+        }
+    }
+}
+
+// Job function, finds the walls of the contexts [start, end) using the face walk method
+static void FindViewsFaceWalkWalls(void *userData, int start, int end)
+{
+    RenderViewsJob *job = (RenderViewsJob *)userData;
+
+    for (int i = start; i < end; i++)
+    {
+        if (IsFaceWalkContext(job->contexts[i])) FindFaceWalkWalls(job->contexts[i]);
+    }
+}
+
+// Job function, renders the columns [start, end) of the contexts placed side by side
+static void RenderViewsColumns(void *userData, int start, int end)
+{
+    RenderViewsJob *job = (RenderViewsJob *)userData;
+    int first = 0;      // First column of the current context
+
+    for (int i = 0; (i < job->count) && (first < end); i++)
+    {
+        RenderContext *context = job->contexts[i];
+        int columnsStart = ((start > first)? start : first) - first;
+        int columnsEnd = ((end < first + context->width)? end : first + context->width) - first;
+
+        if (columnsStart < columnsEnd) RenderColumns(context, columnsStart, columnsEnd);
+
+        first += context->width;
+    }
+}
+
+//----------------------------------------------------------------------------------
+// Renderer Functions Definition
+//----------------------------------------------------------------------------------
+
+// Create a render context with its own camera, hits buffer and framebuffer
+RenderContext *LoadRenderContext(const Map *map, int width, int height, float fov)
+{
+    RenderContext *context = (RenderContext *)calloc(1, sizeof(RenderContext));
+
+    context->map = map;
+    context->width = width;
+    context->height = height;
+    context->projectionPlaneDistance = (width/2)/tan(fov/2);
+    context->backgroundColor = 0xFF000000;
+    context->method = RENDER_METHOD_RAYS;
+    context->castInterval = DEFAULT_CAST_INTERVAL;
+    context->columns = (RenderColumn *)calloc(width, sizeof(RenderColumn));
+    context->rowDepths = (float *)malloc(height*sizeof(float));
+
+    // Ceiling and floor are planes half a tile away from the camera
+    for (int y = 0; y < height; y++) context->rowDepths[y] = (float)((TILE_SIZE/2)*context->projectionPlaneDistance/fabs(y + 0.5 - height/2.0));
+
+    SetRenderContextOutputs(context, RENDER_OUTPUT_COLOR);
+
+    return context;
+}
+
+// Free a render context, the map is not owned by the context
+void UnloadRenderContext(RenderContext *context)
+{
+    if (context == NULL) return;
+
+    free(context->columns);
+    free(context->pixels);
+    free(context->depths);
+    free(context->hitInfos);
+    free(context->rowDepths);
+    free(context->indices);
+    if (context->walks != NULL)
+    {
+        free(context->walks->columns);
+        free(context->walks->nextColumns);
+        free(context->walks->passes);
+        free(context->walks);
+    }
+    free(context);
+}
+
+// Select the outputs written by the renders of a context, allocating their buffers
+void SetRenderContextOutputs(RenderContext *context, int outputs)
+{
+    size_t pixelsCount = (size_t)context->width*context->height;
+
+    if ((outputs & RENDER_OUTPUT_COLOR) && (context->pixels == NULL)) context->pixels = (uint32_t *)calloc(pixelsCount, sizeof(uint32_t));
+    if ((outputs & RENDER_OUTPUT_DEPTH) && (context->depths == NULL)) context->depths = (float *)calloc(pixelsCount, sizeof(float));
+    if ((outputs & RENDER_OUTPUT_HIT_INFO) && (context->hitInfos == NULL)) context->hitInfos = (RenderHitInfo *)calloc(pixelsCount, sizeof(RenderHitInfo));
+    if ((outputs & RENDER_OUTPUT_INDEXED) && (context->indices == NULL)) context->indices = (unsigned char *)calloc(pixelsCount, 1);
+
+    if (!(outputs & RENDER_OUTPUT_COLOR)) { free(context->pixels); context->pixels = NULL; }
+    if (!(outputs & RENDER_OUTPUT_DEPTH)) { free(context->depths); context->depths = NULL; }
+    if (!(outputs & RENDER_OUTPUT_HIT_INFO)) { free(context->hitInfos); context->hitInfos = NULL; }
+    if (!(outputs & RENDER_OUTPUT_INDEXED)) { free(context->indices); context->indices = NULL; }
+
+    context->outputs = outputs;
+}
+
+// Select the method finding the walls of the columns, the face walk method scratch is allocated on first use
+void SetRenderContextMethod(RenderContext *context, int method)
+{
+    if ((method == RENDER_METHOD_FACES) && (context->walks == NULL))
+    {
+        context->walks = (RenderWalks *)calloc(1, sizeof(RenderWalks));
+        context->walks->columns = (WalkColumn *)calloc(context->width, sizeof(WalkColumn));
+        context->walks->nextColumns = (int *)calloc(context->width + 1, sizeof(int));
+        context->walks->passes = (FaceWalk *)calloc(context->width + 1, sizeof(FaceWalk));
+    }
+
+    context->method = method;
+}
+
+// Cast and project the view of a context into its framebuffer
+void RenderView(RenderContext *context)
+{
+    RenderViews(&context, 1);
+}
+
+// Render several contexts, all their columns are spread over the job system workers
+void RenderViews(RenderContext **contexts, int count)
+{
+    RenderViewsJob job = { contexts, count };
+    int columnsCount = 0;
+
+    for (int i = 0; i < count; i++) columnsCount += contexts[i]->width;
+
+    RunParallelFor(count, 1, FindViewsFaceWalkWalls, &job);
+    RunParallelFor(columnsCount, RENDER_COLUMNS_BATCH_SIZE, RenderViewsColumns, &job);
+}
+
+// Find the walls of every column of a context, on the calling thread
+void CastRenderColumns(RenderContext *context)
+{
+    if (IsFaceWalkContext(context)) FindFaceWalkWalls(context);
+    CastColumns(context, 0, context->width);
+}
+
+// Project the walls found by CastRenderColumns() into the context outputs, on the calling thread
+void ProjectRenderColumns(RenderContext *context)
+{
+    ProjectColumns(context, 0, context->width);
+}
+
+// Create a palette for indexed outputs and build its lookup tables
+// NOTE: Table entries are the nearest palette colors, building them searches the palette for
+// every pair of colors
+RenderPalette *LoadRenderPalette(const uint32_t *colors, int count)
+{
+    RenderPalette *palette = (RenderPalette *)calloc(1, sizeof(RenderPalette));
+
+    if (count > 256) count = 256;
+
+    for (int i = 0; i < 256; i++)
+    {
+        if (colors == NULL) palette->colors[i] = 0xFF000000 | ((uint32_t)i*0x010101);
+        else palette->colors[i] = 0xFF000000 | colors[(i < count)? i : count - 1];
+    }
+
+    for (int level = 0; level < RENDER_PALETTE_SHADES; level++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t color = palette->colors[i];
+            uint32_t red = ((color >> 16) & 0xFF)*level/(RENDER_PALETTE_SHADES - 1);
+            uint32_t green = ((color >> 8) & 0xFF)*level/(RENDER_PALETTE_SHADES - 1);
+            uint32_t blue = (color & 0xFF)*level/(RENDER_PALETTE_SHADES - 1);
+
+            palette->shades[level][i] = GetRenderPaletteIndex(palette, (red << 16) | (green << 8) | blue);
+        }
+    }
+
+    // Every wall shares the same translucency
+    uint32_t wallAlpha = WALL_COLOR_VERTICAL >> 24;
+
+    for (int front = 0; front < 256; front++)
+    {
+        for (int back = 0; back < 256; back++)
+        {
+            uint32_t frontColor = palette->colors[front];
+            uint32_t backColor = palette->colors[back];
+            uint32_t color = 0;
+
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                uint32_t channel = (((frontColor >> shift) & 0xFF)*wallAlpha + ((backColor >> shift) & 0xFF)*(255 - wallAlpha) + 127)/255;
+                color |= channel << shift;
+            }
+
+            palette->translucency[front][back] = GetRenderPaletteIndex(palette, color);
+        }
+    }
+
+    palette->ceilingIndex = GetRenderPaletteIndex(palette, CEILING_COLOR);
+    palette->floorIndex = GetRenderPaletteIndex(palette, FLOOR_COLOR);
+    palette->wallIndex = GetRenderPaletteIndex(palette, WALL_COLOR_VERTICAL);
+    palette->blackIndex = GetRenderPaletteIndex(palette, 0x00000000);
+
+    return palette;
+}
+
+void UnloadRenderPalette(RenderPalette *palette)
+{
+    free(palette);
+}
+
+// Get the palette color nearest to a color, alpha is ignored
+unsigned char GetRenderPaletteIndex(const RenderPalette *palette, uint32_t color)
+{
+    int nearest = 0;
+    int nearestDistance = INT_MAX;
+
+    for (int i = 0; (i < 256) && (nearestDistance > 0); i++)
+    {
+        int red = (int)((palette->colors[i] >> 16) & 0xFF) - (int)((color >> 16) & 0xFF);
+        int green = (int)((palette->colors[i] >> 8) & 0xFF) - (int)((color >> 8) & 0xFF);
+        int blue = (int)(palette->colors[i] & 0xFF) - (int)(color & 0xFF);
+        int distance = red*red + green*green + blue*blue;
+
+        if (distance < nearestDistance)
+        {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+
+    return (unsigned char)nearest;
+}
+
+// Create a batch renderer of frames of the given size and format
+RenderBatch *LoadRenderBatch(const Map *map, int width, int height, float fov, int format, float maxDepth)
+{
+    RenderBatch *batch = (RenderBatch *)calloc(1, sizeof(RenderBatch));
+
+    batch->map = map;
+    batch->width = width;
+    batch->height = height;
+    batch->format = format;
+    batch->maxDepth = (maxDepth > 0.0f)? maxDepth : 16*TILE_SIZE;
+    batch->contextsCount = GetJobWorkersCount() + 1;
+    batch->contexts = (RenderContext **)calloc(batch->contextsCount, sizeof(RenderContext *));
+
+    for (int i = 0; i < batch->contextsCount; i++)
+    {
+        batch->contexts[i] = LoadRenderContext(map, width, height, fov);
+        if (format == RENDER_FORMAT_DEPTH) SetRenderContextOutputs(batch->contexts[i], RENDER_OUTPUT_DEPTH);
+    }
+
+    return batch;
+}
+
+// Free a batch renderer and its scratch contexts
+void UnloadRenderBatch(RenderBatch *batch)
+{
+    if (batch == NULL) return;
+
+    for (int i = 0; i < batch->contextsCount; i++) UnloadRenderContext(batch->contexts[i]);
+
+    free(batch->contexts);
+    free(batch);
+}
+
+// Render one frame per pose into the frames buffer, frame i starts at i*GetRenderBatchFrameSize()
+void RenderBatchFrames(RenderBatch *batch, const RenderCamera *poses, int count, void *frames)
+{
+    RenderBatchJob job = { batch, poses, (unsigned char *)frames };
+
+    // Every thread but the workers renders with context 0, only one of them can render the batch at a time
+    bool rendering = __atomic_exchange_n(&batch->rendering, true, __ATOMIC_ACQUIRE);
+    assert(!rendering);
+    (void)rendering;
+
+    // Workers started after loading the batch have no scratch context, render on the calling thread
+    if (GetJobWorkersCount() + 1 > batch->contextsCount) RenderBatchPoses(&job, 0, count);
+    else RunParallelFor(count, 1, RenderBatchPoses, &job);
+
+    __atomic_store_n(&batch->rendering, false, __ATOMIC_RELEASE);
+}
+
+// Bytes per frame of a batch
+int GetRenderBatchFrameSize(const RenderBatch *batch)
+{
+    return batch->width*batch->height*((batch->format == RENDER_FORMAT_RGBA)? 4 : 1);
+}
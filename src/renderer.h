@@ -0,0 +1,206 @@
+/**********************************************************************************************
+*
+*   raycaster - Renderer module
+*
+*   Software ray casting renderer. A render context owns everything a view needs (camera, hits
+*   buffer and target framebuffer) while the map is shared read-only, so several contexts can
+*   render at the same time: split-screen, rear-view mirrors, security cameras...
+*
+*   RenderViews() renders a group of contexts spreading all their columns over the job system
+*   workers. Contexts can also be rendered from different threads, one context per thread.
+*
+*   Besides color, contexts can write per pixel linear depth and hit information (wall tile,
+*   type, face and portals traversed) in the same pass. Without color output rays stop at the
+*   first wall that is not a portal, so geometry-only views are much cheaper. The walls hit by
+*   every column are always available in the context columns.
+*
+*   With a cast interval above 1 only every Nth column ray is cast: between two casts going
+*   through the same wall faces, columns follow those walls without looking the map up, other
+*   gaps are subdivided with new casts. Frames are the same as casting every column.
+*
+*   Contexts can also render into an indexed framebuffer, one byte per pixel over a palette of
+*   256 colors with the wall shading and translucency resolved by lookup tables, a quarter of the
+*   memory traffic of color. Indices are expanded to colors with ExpandIndexedPixels() on upload.
+*
+*   Instead of stepping a ray through the grid per column, the face walk method caches the wall
+*   candidates of every column: it walks the map wall faces around the camera front to back,
+*   projecting every face to the range of columns it covers and keeping the columns still open
+*   in an occlusion buffer; the faces of a portal are walked again from the camera translated to
+*   the linked portal. The walls of every column are then resolved along its candidate faces like
+*   with cast intervals, and projected per column, the few columns passing next to a face corner
+*   are cast. The walk only saves the grid stepping: resolving and projecting still cost per
+*   column. Cameras on a grid line or inside a wall cast every column. Frames are the same as
+*   casting every column.
+*
+*   With a lightmap, every wall of a column is shaded by the light level of the face it shows,
+*   looked up once per wall and column.
+*
+*   Render batches produce many small frames from independent poses (i.e. observations for
+*   training agents) into one contiguous frames buffer, frame after frame, row-major. Frames
+*   are spread over the job system workers and rendering them allocates no memory. A batch is
+*   rendered by one thread at a time: the calling thread renders with the scratch context 0,
+*   shared by every thread that is not a job worker (main, loader, audio...), rendering the
+*   same batch from two threads at once is asserted.
+*
+**********************************************************************************************/
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "map.h"
+#include "raycast.h"
+#include "edges.h"
+#include "light.h"
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_RENDER_WALLS_PER_COLUMN 10      // Walls kept per column, translucent and portal walls included
+
+// Render context outputs
+#define RENDER_OUTPUT_COLOR 1           // pixels
+#define RENDER_OUTPUT_DEPTH 2           // depths
+#define RENDER_OUTPUT_HIT_INFO 4        // hitInfos
+#define RENDER_OUTPUT_INDEXED 8         // indices, requires a palette
+
+#define RENDER_PALETTE_SHADES 16        // Shading levels of the palette, from black to full color
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum RenderFormat {
+    RENDER_FORMAT_RGBA = 0,     // 4 bytes per pixel, the framebuffer pixels
+    RENDER_FORMAT_GRAY,         // 1 byte per pixel, luma
+    RENDER_FORMAT_DEPTH         // 1 byte per pixel, perpendicular distance scaled from [0, maxDepth] to [0, 255]
+} RenderFormat;
+
+typedef enum RenderMethod {
+    RENDER_METHOD_RAYS = 0,     // One ray cast per column, every castInterval columns
+    RENDER_METHOD_FACES         // Wall faces walked once as the wall candidates of the columns, requires the map edges
+} RenderMethod;
+
+typedef enum RenderFace {
+    RENDER_FACE_NONE = 0,
+    RENDER_FACE_NORTH,          // Wall faces, named after the direction they face
+    RENDER_FACE_SOUTH,
+    RENDER_FACE_EAST,
+    RENDER_FACE_WEST,
+    RENDER_FACE_CEILING,
+    RENDER_FACE_FLOOR
+} RenderFace;
+
+// Surface seen through a pixel, the nearest wall that is not a portal or the ceiling/floor around it
+typedef struct RenderHitInfo
+{
+    int wallId;                 // Wall tile index (row*numCols + col), -1 for ceiling and floor
+    unsigned char wallType;     // TileType, TILE_EMPTY for ceiling and floor
+    unsigned char face;         // RenderFace
+    unsigned char portalsCount; // Portals traversed to reach the surface
+    unsigned char reserved;
+}
+RenderHitInfo;
+
+// Palette of the indexed output, with the lookup tables replacing color arithmetic
+typedef struct RenderPalette
+{
+    uint32_t colors[256];       // Opaque colors (0xAARRGGBB)
+    unsigned char shades[RENDER_PALETTE_SHADES][256];      // Color at level/(RENDER_PALETTE_SHADES - 1) brightness
+    unsigned char translucency[256][256];                   // Translucent wall color [front] over color [back]
+    unsigned char ceilingIndex;
+    unsigned char floorIndex;
+    unsigned char wallIndex;    // Walls hit on a vertical grid line, horizontal hits are shaded
+    unsigned char blackIndex;
+}
+RenderPalette;
+
+typedef struct RenderCamera
+{
+    float x;
+    float y;
+    float angle;                // Viewing direction in radians
+}
+RenderCamera;
+
+// Walls traversed by the ray of a screen column, nearest first
+typedef struct RenderColumn
+{
+    float rayAngle;
+    int wallsCount;
+    WallHit walls[MAX_RENDER_WALLS_PER_COLUMN];
+    bool wasCast;               // Walls found casting the ray, false when they came from the neighbour columns
+}
+RenderColumn;
+
+typedef struct RenderWalks RenderWalks;     // Scratch of the face walk method, allocated by SetRenderContextMethod()
+
+typedef struct RenderContext
+{
+    const Map *map;             // Shared world, never written
+    RenderCamera camera;
+    int width;                  // Framebuffer size, one ray per column
+    int height;
+    double projectionPlaneDistance;
+    uint32_t backgroundColor;   // Color behind the farthest wall (0xAARRGGBB)
+    int outputs;                // RENDER_OUTPUT_* written by renders, change with SetRenderContextOutputs()
+    int method;                 // RenderMethod finding the walls of the columns, change with SetRenderContextMethod()
+    int castInterval;           // Columns between ray casts, 1 casts every column
+    RenderColumn *columns;      // Hits buffer, width entries
+    uint32_t *pixels;           // Target framebuffer (0xAARRGGBB), width*height pixels
+    float *depths;              // Perpendicular distance of every pixel
+    RenderHitInfo *hitInfos;    // Surface of every pixel
+    float *rowDepths;           // Perpendicular distance of the ceiling or floor seen by every row
+    unsigned char *indices;     // Indexed framebuffer, width*height palette indices
+    const RenderPalette *palette;   // Shared palette of the indexed framebuffer, never written
+    const MapEdges *edges;      // Shared wall faces of the map, never written, rays are cast without them
+    RenderWalks *walks;         // NULL until the face walk method is selected
+    const Lightmap *lightmap;   // Shared light levels of the wall faces, never written, NULL for flat shading
+}
+RenderContext;
+
+typedef struct RenderBatch
+{
+    const Map *map;
+    int width;                  // Frames size
+    int height;
+    int format;                 // RenderFormat
+    float maxDepth;             // Distance mapped to 255 by RENDER_FORMAT_DEPTH
+    int contextsCount;          // Scratch context of every thread, the calling thread included
+    RenderContext **contexts;
+    bool rendering;             // A thread is rendering the batch, context 0 is its own (atomic)
+}
+RenderBatch;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Renderer Functions Declaration
+//----------------------------------------------------------------------------------
+RenderContext *LoadRenderContext(const Map *map, int width, int height, float fov);    // Field of view in radians, color output
+void UnloadRenderContext(RenderContext *context);
+void SetRenderContextOutputs(RenderContext *context, int outputs);     // Allocates the buffers of the outputs, frees the others
+void SetRenderContextMethod(RenderContext *context, int method);       // Allocates the face walk method scratch on first use
+
+void RenderView(RenderContext *context);                        // Cast and project the context view
+void RenderViews(RenderContext **contexts, int count);          // Render several contexts together, multithreaded
+void CastRenderColumns(RenderContext *context);                 // First stage of RenderView(), on the calling thread (profiling)
+void ProjectRenderColumns(RenderContext *context);              // Second stage of RenderView(), on the calling thread (profiling)
+
+RenderPalette *LoadRenderPalette(const uint32_t *colors, int count);   // Up to 256 colors, NULL for a gray ramp
+void UnloadRenderPalette(RenderPalette *palette);
+unsigned char GetRenderPaletteIndex(const RenderPalette *palette, uint32_t color);    // Nearest palette color
+
+// NOTE: Load batches after InitJobSystem() so every worker gets its scratch context
+RenderBatch *LoadRenderBatch(const Map *map, int width, int height, float fov, int format, float maxDepth);
+void UnloadRenderBatch(RenderBatch *batch);
+void RenderBatchFrames(RenderBatch *batch, const RenderCamera *poses, int count, void *frames);    // Frames buffer of count*GetRenderBatchFrameSize() bytes, 4 bytes aligned
+int GetRenderBatchFrameSize(const RenderBatch *batch);         // Bytes per frame
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RENDERER_H
@@ -26,28 +26,107 @@
 #include "raylib.h"
 #include "screens.h"
 
+#include "map.h"
+#include "edges.h"
+#include "renderer.h"
+#include "loader.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define LEVEL_NUM_COLS 12
+#define LEVEL_NUM_ROWS 10
+#define LEVEL_VIEW_WIDTH 800            // Screen size, set before the window size can be queried
+#define LEVEL_VIEW_HEIGHT 450
+
 //----------------------------------------------------------------------------------
 // Module Variables Definition (local)
 //----------------------------------------------------------------------------------
 static int framesCounter = 0;
 static int finishScreen = 0;
 
+// Level used when no "resources/level.rcm" map file is found
+static const int defaultLevelTiles[LEVEL_NUM_ROWS*LEVEL_NUM_COLS] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 1, 0, 0, 0, 0, 2, 2, 0, 1,
+    1, 0, 1, 0, 0, 0, 0, 0, 0, 2, 0, 1,
+    1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1,
+    1, 0, 2, 0, 0, 0, 0, 0, 0, 1, 0, 1,
+    1, 0, 2, 2, 0, 0, 0, 0, 1, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+// Level data, prepared on the loader thread while the previous screens play
+static Map level = { 0 };
+static bool levelLoaded = false;        // level tiles come from a map file
+static MapEdges *levelEdges = NULL;
+static RenderContext *levelView = NULL;
+static LoadFence levelFence = 0;
+static bool levelPrepared = false;      // Preparation submitted and not unloaded yet
+
+static Texture2D levelViewTexture = { 0 };
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static void PrepareLevel(void *userData);   // Load job: everything but the GPU texture
+
 //----------------------------------------------------------------------------------
 // Gameplay Screen Functions Definition
 //----------------------------------------------------------------------------------
 
+// Gameplay Screen background preparation, call it screens ahead of InitGameplayScreen()
+void PrepareGameplayScreen(void)
+{
+    if (levelPrepared) return;
+
+    levelFence = SubmitLoadJob(PrepareLevel, NULL);
+    levelPrepared = true;
+}
+
+// Gameplay Screen data prepared? Init won't block once it is
+bool IsGameplayScreenReady(void)
+{
+    return levelPrepared && IsLoadFenceReached(levelFence);
+}
+
 // Gameplay Screen Initialization logic
 void InitGameplayScreen(void)
 {
-    // TODO: Initialize GAMEPLAY screen variables here!
     framesCounter = 0;
     finishScreen = 0;
+
+    // NOTE: Waits only when the screen is entered before its preparation is done
+    PrepareGameplayScreen();
+    WaitLoadFence(levelFence);
+
+    // Only the GPU upload happens here, the first frame was rendered by the loader
+    Image image = {
+        .data = levelView->pixels,
+        .width = levelView->width,
+        .height = levelView->height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    levelViewTexture = LoadTextureFromImage(image);
 }
 
 // Gameplay Screen Update logic
 void UpdateGameplayScreen(void)
 {
-    // TODO: Update GAMEPLAY screen variables here!
+    framesCounter++;
+
+    // Look around from the center of the level
+    levelView->camera.angle = (float)framesCounter*0.01f;
+    RenderView(levelView);
+    UpdateTexture(levelViewTexture, levelView->pixels);
 
     // Press enter or tap to change to ENDING screen
     if (IsKeyPressed(KEY_ENTER) || IsGestureDetected(GESTURE_TAP))
@@ -60,8 +139,7 @@ void UpdateGameplayScreen(void)
 // Gameplay Screen Draw logic
 void DrawGameplayScreen(void)
 {
-    // TODO: Draw GAMEPLAY screen here!
-    DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), PURPLE);
+    DrawTexture(levelViewTexture, 0, 0, WHITE);
     DrawTextEx(font, "GAMEPLAY SCREEN", (Vector2){ 20, 10 }, font.baseSize*3, 4, MAROON);
     DrawText("PRESS ENTER or TAP to JUMP to ENDING SCREEN", 130, 220, 20, MAROON);
 }
@@ -69,11 +147,49 @@ void DrawGameplayScreen(void)
 // Gameplay Screen Unload logic
 void UnloadGameplayScreen(void)
 {
-    // TODO: Unload GAMEPLAY screen variables here!
+    if (!levelPrepared) return;
+
+    WaitLoadFence(levelFence);
+
+    UnloadTexture(levelViewTexture);
+    UnloadRenderContext(levelView);
+    UnloadMapEdges(levelEdges);
+    if (levelLoaded) UnloadMap(level);
+
+    levelViewTexture = (Texture2D){ 0 };
+    levelView = NULL;
+    levelEdges = NULL;
+    level = (Map){ 0 };
+    levelLoaded = false;
+    levelPrepared = false;
 }
 
 // Gameplay Screen should finish?
 int FinishGameplayScreen(void)
 {
     return finishScreen;
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Load the level, extract its wall faces and render its first frame
+// NOTE: Runs on the loader thread, no raylib calls here
+static void PrepareLevel(void *userData)
+{
+    (void)userData;
+
+    level = LoadMap("resources/level.rcm");
+    levelLoaded = (level.tiles != NULL);
+
+    if (!levelLoaded) level = (Map){ .numCols = LEVEL_NUM_COLS, .numRows = LEVEL_NUM_ROWS, .tiles = defaultLevelTiles };
+
+    levelEdges = BuildMapEdges(&level);
+
+    levelView = LoadRenderContext(&level, LEVEL_VIEW_WIDTH, LEVEL_VIEW_HEIGHT, 60.0f*(PI/180.0f));
+    levelView->edges = levelEdges;
+    SetRenderContextMethod(levelView, RENDER_METHOD_FACES);
+    levelView->camera = (RenderCamera){ .x = 0.5f*level.numCols*TILE_SIZE, .y = 0.5f*level.numRows*TILE_SIZE, .angle = 0.0f };
+    RenderView(levelView);
+}
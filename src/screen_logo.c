@@ -67,6 +67,8 @@ void InitLogoScreen(void)
 
     state = 0;
     alpha = 1.0f;
+
+    PrepareGameplayScreen();    // Prepare gameplay data on the loader thread while the logo animation plays
 }
 
 // Logo Screen Update logic
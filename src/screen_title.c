@@ -42,6 +42,8 @@ void InitTitleScreen(void)
     // TODO: Initialize TITLE screen variables here!
     framesCounter = 0;
     finishScreen = 0;
+
+    PrepareGameplayScreen();    // Gameplay comes next, prepare it while the title shows
 }
 
 // Title Screen Update logic
@@ -36,7 +36,6 @@ typedef enum GameScreen { LOGO = 0, TITLE, OPTIONS, GAMEPLAY, ENDING } GameScree
 //----------------------------------------------------------------------------------
 extern GameScreen currentScreen;
 extern Font font;
-extern Music music;
 extern Sound fxCoin;
 
 #ifdef __cplusplus
@@ -73,6 +72,8 @@ int FinishOptionsScreen(void);
 //----------------------------------------------------------------------------------
 // Gameplay Screen Functions Declaration
 //----------------------------------------------------------------------------------
+void PrepareGameplayScreen(void);          // Start preparing the screen data on the loader thread
+bool IsGameplayScreenReady(void);
 void InitGameplayScreen(void);
 void UpdateGameplayScreen(void);
 void DrawGameplayScreen(void);
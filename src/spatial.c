@@ -0,0 +1,331 @@
+/**********************************************************************************************
+*
+*   raycaster - Spatial hash
+*
+*   Buckets of TILE_SIZE cells as chains of fixed size blocks.
+*
+**********************************************************************************************/
+
+#include "spatial.h"
+#include "jobs.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define SPATIAL_MIN_BUCKETS_COLUMNS 8
+#define SPATIAL_BATCH_SIZE 64           // Queries per job batch
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct SpatialBatch
+{
+    const SpatialGrid *grid;
+    const SpatialQuery *queries;
+    int *ids;
+    int maxIdsPerQuery;
+    int *results;                       // Count of every radius query, or nearest object
+}
+SpatialBatch;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//----------------------------------------------------------------------------------
+static inline int GetSpatialCell(float x);
+static inline int GetSpatialBucket(const SpatialGrid *grid, int cellX, int cellY);
+static void QueryRadiusJob(void *userData, int start, int end);
+static void FindNearestJob(void *userData, int start, int end);
+
+//----------------------------------------------------------------------------------
+// Spatial Hash Functions Definition
+//----------------------------------------------------------------------------------
+
+// Allocate an empty grid for object ids in [0, capacity)
+SpatialGrid *LoadSpatialGrid(int capacity)
+{
+    SpatialGrid *grid = (SpatialGrid *)calloc(1, sizeof(SpatialGrid));
+
+    grid->capacity = capacity;
+    grid->bucketsColumns = SPATIAL_MIN_BUCKETS_COLUMNS;
+    while (grid->bucketsColumns*grid->bucketsColumns < capacity) grid->bucketsColumns *= 2;
+    grid->bucketsCount = grid->bucketsColumns*grid->bucketsColumns;
+
+    // Non-empty buckets have one block that is not full at most
+    grid->blocksCount = capacity + capacity/SPATIAL_BLOCK_SLOTS + 1;
+
+    grid->buckets = (int *)malloc(grid->bucketsCount*sizeof(int));
+    grid->blocks = (SpatialBlock *)malloc(grid->blocksCount*sizeof(SpatialBlock));
+    grid->objectBuckets = (int *)malloc(capacity*sizeof(int));
+    grid->objectBlocks = (int *)malloc(capacity*sizeof(int));
+    grid->objectSlots = (int *)malloc(capacity*sizeof(int));
+
+    ClearSpatialGrid(grid);
+
+    return grid;
+}
+
+void UnloadSpatialGrid(SpatialGrid *grid)
+{
+    if (grid == NULL) return;
+
+    free(grid->objectSlots);
+    free(grid->objectBlocks);
+    free(grid->objectBuckets);
+    free(grid->blocks);
+    free(grid->buckets);
+    free(grid);
+}
+
+// Remove all the objects
+void ClearSpatialGrid(SpatialGrid *grid)
+{
+    for (int i = 0; i < grid->bucketsCount; i++) grid->buckets[i] = -1;
+    for (int i = 0; i < grid->capacity; i++) grid->objectBuckets[i] = -1;
+
+    for (int i = 0; i < grid->blocksCount; i++) grid->blocks[i].next = i + 1;
+    grid->blocks[grid->blocksCount - 1].next = -1;
+    grid->freeBlock = 0;
+    grid->count = 0;
+}
+
+// Add an object to the first block of its bucket
+// NOTE: The object must not be in the grid
+void InsertSpatialObject(SpatialGrid *grid, int id, float x, float y)
+{
+    int bucket = GetSpatialBucket(grid, GetSpatialCell(x), GetSpatialCell(y));
+    int block = grid->buckets[bucket];
+
+    if ((block < 0) || (grid->blocks[block].count == SPATIAL_BLOCK_SLOTS))
+    {
+        int newBlock = grid->freeBlock;
+        grid->freeBlock = grid->blocks[newBlock].next;
+        grid->blocks[newBlock].count = 0;
+        grid->blocks[newBlock].next = block;
+        grid->buckets[bucket] = newBlock;
+        block = newBlock;
+    }
+
+    SpatialBlock *head = &grid->blocks[block];
+    int slot = head->count++;
+
+    head->ids[slot] = id;
+    head->x[slot] = x;
+    head->y[slot] = y;
+
+    grid->objectBuckets[id] = bucket;
+    grid->objectBlocks[id] = block;
+    grid->objectSlots[id] = slot;
+    grid->count++;
+}
+
+// Update the position of an object, it only changes blocks when it changes bucket
+void MoveSpatialObject(SpatialGrid *grid, int id, float x, float y)
+{
+    int bucket = grid->objectBuckets[id];
+
+    if (bucket == GetSpatialBucket(grid, GetSpatialCell(x), GetSpatialCell(y)))
+    {
+        SpatialBlock *block = &grid->blocks[grid->objectBlocks[id]];
+        block->x[grid->objectSlots[id]] = x;
+        block->y[grid->objectSlots[id]] = y;
+        return;
+    }
+
+    if (bucket >= 0) RemoveSpatialObject(grid, id);
+    InsertSpatialObject(grid, id, x, y);
+}
+
+// Fill the slot of an object with the last object of the first block of its bucket
+void RemoveSpatialObject(SpatialGrid *grid, int id)
+{
+    int bucket = grid->objectBuckets[id];
+    if (bucket < 0) return;
+
+    int headIndex = grid->buckets[bucket];
+    SpatialBlock *head = &grid->blocks[headIndex];
+    SpatialBlock *block = &grid->blocks[grid->objectBlocks[id]];
+    int slot = grid->objectSlots[id];
+    int last = head->count - 1;
+    int lastId = head->ids[last];
+
+    block->ids[slot] = lastId;
+    block->x[slot] = head->x[last];
+    block->y[slot] = head->y[last];
+    grid->objectBlocks[lastId] = grid->objectBlocks[id];
+    grid->objectSlots[lastId] = slot;
+
+    head->count--;
+    if (head->count == 0)
+    {
+        grid->buckets[bucket] = head->next;
+        head->next = grid->freeBlock;
+        grid->freeBlock = headIndex;
+    }
+
+    grid->objectBuckets[id] = -1;
+    grid->count--;
+}
+
+// Get the objects within radius of a position
+// NOTE: Cells sharing a bucket are filtered out by cell, so every object is listed once
+int QuerySpatialRadius(const SpatialGrid *grid, float x, float y, float radius, int *ids, int maxIds)
+{
+    int minCellX = GetSpatialCell(x - radius);
+    int maxCellX = GetSpatialCell(x + radius);
+    int minCellY = GetSpatialCell(y - radius);
+    int maxCellY = GetSpatialCell(y + radius);
+    float radiusSquared = radius*radius;
+    int count = 0;
+
+    for (int cellY = minCellY; cellY <= maxCellY; cellY++)
+    {
+        for (int cellX = minCellX; cellX <= maxCellX; cellX++)
+        {
+            for (int b = grid->buckets[GetSpatialBucket(grid, cellX, cellY)]; b >= 0; b = grid->blocks[b].next)
+            {
+                const SpatialBlock *block = &grid->blocks[b];
+
+                for (int s = 0; s < block->count; s++)
+                {
+                    float dx = block->x[s] - x;
+                    float dy = block->y[s] - y;
+
+                    if ((dx*dx + dy*dy <= radiusSquared) && (GetSpatialCell(block->x[s]) == cellX) && (GetSpatialCell(block->y[s]) == cellY))
+                    {
+                        if (count == maxIds) return count;
+                        ids[count++] = block->ids[s];
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+// Get the nearest object within maxRadius, searching rings of cells outwards
+// NOTE: Objects of ring k are at least (k - 1)*TILE_SIZE away, the search stops once that is farther than the nearest found.
+// Every object of a bucket is checked whatever cell it is in, so once the rings span the buckets grid all objects were
+// seen, farther rings only wrap around to the same buckets
+int FindNearestSpatialObject(const SpatialGrid *grid, float x, float y, float maxRadius, int excludedId)
+{
+    int centerX = GetSpatialCell(x);
+    int centerY = GetSpatialCell(y);
+    int maxRing = grid->bucketsColumns/2;    // Ring spanning the buckets grid, 2*maxRing + 1 >= bucketsColumns
+    float nearestDistance = maxRadius*maxRadius;
+    int nearest = -1;
+
+    if (grid->count - (((excludedId >= 0) && IsSpatialObjectInGrid(grid, excludedId))? 1 : 0) <= 0) return -1;
+
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        float ringDistance = (float)((ring - 1)*TILE_SIZE);
+        if ((ring > 0) && (ringDistance*ringDistance > nearestDistance)) break;
+
+        for (int cellY = centerY - ring; cellY <= centerY + ring; cellY++)
+        {
+            // Inner rows of the ring only have their two end cells
+            int stepX = ((cellY == centerY - ring) || (cellY == centerY + ring))? 1 : 2*ring;
+
+            for (int cellX = centerX - ring; cellX <= centerX + ring; cellX += stepX)
+            {
+                for (int b = grid->buckets[GetSpatialBucket(grid, cellX, cellY)]; b >= 0; b = grid->blocks[b].next)
+                {
+                    const SpatialBlock *block = &grid->blocks[b];
+
+                    for (int s = 0; s < block->count; s++)
+                    {
+                        float dx = block->x[s] - x;
+                        float dy = block->y[s] - y;
+                        float distance = dx*dx + dy*dy;
+
+                        if ((distance <= nearestDistance) && (block->ids[s] != excludedId))
+                        {
+                            nearestDistance = distance;
+                            nearest = block->ids[s];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return nearest;
+}
+
+// Get the objects on a tile
+int GetSpatialTileObjects(const SpatialGrid *grid, int gridIndexX, int gridIndexY, int *ids, int maxIds)
+{
+    int count = 0;
+
+    for (int b = grid->buckets[GetSpatialBucket(grid, gridIndexX, gridIndexY)]; b >= 0; b = grid->blocks[b].next)
+    {
+        const SpatialBlock *block = &grid->blocks[b];
+
+        for (int s = 0; s < block->count; s++)
+        {
+            if ((GetSpatialCell(block->x[s]) == gridIndexX) && (GetSpatialCell(block->y[s]) == gridIndexY))
+            {
+                if (count == maxIds) return count;
+                ids[count++] = block->ids[s];
+            }
+        }
+    }
+
+    return count;
+}
+
+// Run radius queries, the ids of query i go to ids[i*maxIdsPerQuery] and their count to counts[i]
+void QuerySpatialRadiusBatch(const SpatialGrid *grid, const SpatialQuery *queries, int queriesCount, int *ids, int maxIdsPerQuery, int *counts)
+{
+    SpatialBatch batch = { grid, queries, ids, maxIdsPerQuery, counts };
+    RunParallelFor(queriesCount, SPATIAL_BATCH_SIZE, QueryRadiusJob, &batch);
+}
+
+// Find the nearest object of every query position, within the query radius
+void FindNearestSpatialObjectBatch(const SpatialGrid *grid, const SpatialQuery *queries, int queriesCount, int *nearestIds)
+{
+    SpatialBatch batch = { grid, queries, NULL, 0, nearestIds };
+    RunParallelFor(queriesCount, SPATIAL_BATCH_SIZE, FindNearestJob, &batch);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (local)
+//----------------------------------------------------------------------------------
+
+// Get the cell of a world coordinate, same as the map tile
+static inline int GetSpatialCell(float x)
+{
+    return (int)floorf(x/TILE_SIZE);
+}
+
+// Get the bucket of a cell, cells wrap around a grid of buckets so neighbour cells get neighbour buckets
+static inline int GetSpatialBucket(const SpatialGrid *grid, int cellX, int cellY)
+{
+    int mask = grid->bucketsColumns - 1;
+    return (cellY & mask)*grid->bucketsColumns + (cellX & mask);
+}
+
+static void QueryRadiusJob(void *userData, int start, int end)
+{
+    SpatialBatch *batch = (SpatialBatch *)userData;
+
+    for (int i = start; i < end; i++)
+    {
+        const SpatialQuery *query = &batch->queries[i];
+        batch->results[i] = QuerySpatialRadius(batch->grid, query->x, query->y, query->radius, batch->ids + (size_t)i*batch->maxIdsPerQuery, batch->maxIdsPerQuery);
+    }
+}
+
+static void FindNearestJob(void *userData, int start, int end)
+{
+    SpatialBatch *batch = (SpatialBatch *)userData;
+
+    for (int i = start; i < end; i++)
+    {
+        const SpatialQuery *query = &batch->queries[i];
+        batch->results[i] = FindNearestSpatialObject(batch->grid, query->x, query->y, query->radius, -1);
+    }
+}
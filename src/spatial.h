@@ -0,0 +1,108 @@
+/**********************************************************************************************
+*
+*   raycaster - Spatial hash
+*
+*   Proximity queries over dynamic objects (pickups, projectiles, NPCs): objects within a
+*   radius, nearest object and objects on a tile. Objects are hashed by the TILE_SIZE cell
+*   they are in, the cells wrap around a square grid of buckets, so the world has no bounds,
+*   memory only depends on the number of objects and neighbour cells stay close in memory.
+*
+*   Every bucket is a chain of fixed size blocks holding the ids and positions of its objects
+*   side by side, and every object knows its block and slot: insert, move and remove are O(1)
+*   and a moving object only changes blocks when it changes bucket. The grid is kept up to date
+*   by moving the objects as they move, never rebuilt.
+*
+*   Objects are addressed by caller ids in [0, capacity). Queries only read the grid, batches
+*   run over the job system.
+*
+**********************************************************************************************/
+
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "map.h"
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define SPATIAL_BLOCK_SLOTS 10          // Objects per block, 128 bytes blocks
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Objects of a bucket, only the first block of a bucket chain is not full
+typedef struct SpatialBlock
+{
+    int count;                          // Slots in use, packed in [0, count)
+    int next;                           // Next block of the bucket, -1 at the end
+    int ids[SPATIAL_BLOCK_SLOTS];
+    float x[SPATIAL_BLOCK_SLOTS];
+    float y[SPATIAL_BLOCK_SLOTS];
+}
+SpatialBlock;
+
+typedef struct SpatialGrid
+{
+    int capacity;                       // Object ids in [0, capacity)
+    int count;                          // Objects in the grid
+
+    int bucketsColumns;                 // Power of two, bucketsColumns*bucketsColumns buckets
+    int bucketsCount;
+    int *buckets;                       // First block of every bucket, -1 when empty
+
+    SpatialBlock *blocks;
+    int blocksCount;
+    int freeBlock;                      // First unused block, chained by next
+
+    int *objectBuckets;                 // Bucket of every object, -1 when not in the grid
+    int *objectBlocks;
+    int *objectSlots;
+}
+SpatialGrid;
+
+// Radius query of a batch
+typedef struct SpatialQuery
+{
+    float x;
+    float y;
+    float radius;
+}
+SpatialQuery;
+
+#ifdef __cplusplus
+extern "C" {            // Prevents name mangling of functions
+#endif
+
+//----------------------------------------------------------------------------------
+// Spatial Hash Functions Declaration
+//----------------------------------------------------------------------------------
+SpatialGrid *LoadSpatialGrid(int capacity);
+void UnloadSpatialGrid(SpatialGrid *grid);
+void ClearSpatialGrid(SpatialGrid *grid);
+
+void InsertSpatialObject(SpatialGrid *grid, int id, float x, float y);
+void MoveSpatialObject(SpatialGrid *grid, int id, float x, float y);       // Inserts the object when not in the grid
+void RemoveSpatialObject(SpatialGrid *grid, int id);
+
+int QuerySpatialRadius(const SpatialGrid *grid, float x, float y, float radius, int *ids, int maxIds);     // Objects within radius, unordered
+int FindNearestSpatialObject(const SpatialGrid *grid, float x, float y, float maxRadius, int excludedId);  // Nearest object within maxRadius, -1 when none
+int GetSpatialTileObjects(const SpatialGrid *grid, int gridIndexX, int gridIndexY, int *ids, int maxIds); // Objects on a tile
+
+// Batches, over the job system
+void QuerySpatialRadiusBatch(const SpatialGrid *grid, const SpatialQuery *queries, int queriesCount, int *ids, int maxIdsPerQuery, int *counts);
+void FindNearestSpatialObjectBatch(const SpatialGrid *grid, const SpatialQuery *queries, int queriesCount, int *nearestIds);     // Query radius is the max radius
+
+// Check if an object is in the grid
+static inline bool IsSpatialObjectInGrid(const SpatialGrid *grid, int id)
+{
+    return grid->objectBuckets[id] >= 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPATIAL_H